@@ -20,8 +20,10 @@
 // Author: Dave Houlton <daveh@lunarg.com>
 //
 
+#include "api_dump_ring.h"
 #include "hex_and_handles.h"
 #include "loader_interfaces.h"
+#include "object_info.h"
 #include "platform_utils.hpp"
 #include "xr_generated_api_dump.hpp"
 #include "xr_generated_dispatch_table.h"
@@ -29,16 +31,29 @@
 #include <openxr/openxr.h>
 
 #include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <cctype>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <tuple>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -58,6 +73,10 @@ enum ApiDumpRecordType {
     RECORD_TEXT_FILE,
     RECORD_HTML_FILE,
     RECORD_CODE_FILE,
+    RECORD_TRACE_FILE,
+    RECORD_BINARY_FILE,
+    RECORD_RING_FILE,
+    RECORD_STATS,
 };
 
 struct ApiDumpRecordInfo {
@@ -69,6 +88,273 @@ struct ApiDumpRecordInfo {
 static ApiDumpRecordInfo g_record_info = {};
 static std::mutex g_record_mutex = {};
 
+// One timed call, written out as a Chrome trace "complete" event.
+struct ApiDumpTraceEvent {
+    const char *command_name;
+    uint64_t handle;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+    uint32_t thread_index;
+};
+
+// Trace events are written out in batches of this size, and when the last instance is destroyed.
+static const size_t kTraceFlushEventCount = 1024;
+
+// These are all protected by g_record_mutex
+static std::vector<ApiDumpTraceEvent> g_trace_events;
+static std::unordered_map<std::thread::id, uint32_t> g_trace_thread_indices;
+static uint64_t g_trace_start_ns = 0;
+static uint64_t g_trace_events_written = 0;
+static bool g_trace_header_written = false;
+
+// The note written in place of records that had to be dropped.  A binary capture gets a record with no command
+// name, which the decoder turns back into the text or HTML note.
+static std::string ApiDumpLayerDroppedRecordsNote(ApiDumpRecordType type, uint64_t dropped) {
+    std::ostringstream note;
+    switch (type) {
+        case RECORD_HTML_FILE:
+            note << "<div class='thd'>" << dropped << " records dropped because the output queue was full</div>\n";
+            break;
+        case RECORD_BINARY_FILE: {
+            std::string record;
+            ApiDumpCaptureBeginRecord(record, "");
+            ApiDumpCaptureWrite(record, &dropped, sizeof(dropped));
+            ApiDumpCaptureEndRecord(record);
+            return record;
+        }
+        default:
+            note << "// " << dropped << " records dropped because the output queue was full\n";
+            break;
+    }
+    return note.str();
+}
+
+// ApiDumpAsyncWriter class -
+// Moves file output off the threads making OpenXR calls.  Those threads format their records and push them into
+// a fixed-size ring with a compare-and-swap, without taking a lock, and one writer thread appends them to a file
+// that stays open.  When the ring is full, a record is either dropped (and counted) or the caller waits for room.
+// Producers register themselves before touching the ring, so Stop() can wait for those already inside Enqueue().
+class ApiDumpAsyncWriter {
+   public:
+    enum EnqueueResult { ENQUEUE_QUEUED, ENQUEUE_DROPPED, ENQUEUE_STOPPED };
+
+    ApiDumpAsyncWriter() = default;
+    ~ApiDumpAsyncWriter() { Stop(); }
+
+    // Returns false if the file could not be opened, in which case output stays synchronous.
+    bool Start(const std::string &file_name, ApiDumpRecordType type, size_t capacity, bool drop_when_full);
+    bool Running() const { return _running.load(std::memory_order_acquire); }
+    // The record is only moved from when it is queued.  ENQUEUE_STOPPED means the writer no longer accepts records,
+    // and the caller should write the record itself.
+    EnqueueResult Enqueue(std::string &record);
+    // Stops accepting records, waits for producers already inside Enqueue(), writes out everything queued, then
+    // closes the file.
+    void Stop();
+
+    // Non-copyable
+    ApiDumpAsyncWriter(const ApiDumpAsyncWriter &) = delete;
+    ApiDumpAsyncWriter &operator=(const ApiDumpAsyncWriter &) = delete;
+
+   private:
+    // A slot holds a record when its sequence is one past the enqueue position that claimed it, and is free for
+    // the enqueue position equal to its sequence.
+    struct Slot {
+        std::atomic<size_t> sequence;
+        std::string record;
+    };
+
+    bool HasRecord() const;
+    bool Dequeue(std::string &record);
+    void WriteDropped();
+    void WriterLoop();
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask = 0;
+    bool _drop_when_full = false;
+    ApiDumpRecordType _type = RECORD_NONE;
+    std::atomic<size_t> _enqueue_pos{0};
+    size_t _dequeue_pos = 0;  // Only used by the writer thread
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint32_t> _producers{0};
+    std::atomic<bool> _running{false};
+    std::atomic<bool> _stopping{false};
+    std::atomic<bool> _writer_waiting{false};
+    std::mutex _wake_mutex;
+    std::condition_variable _wake;
+    std::ofstream _file;
+    std::thread _thread;
+};
+
+bool ApiDumpAsyncWriter::Start(const std::string &file_name, ApiDumpRecordType type, size_t capacity, bool drop_when_full) {
+    if (Running()) {
+        return true;
+    }
+    std::ios::openmode mode = std::ios::out | std::ios::app;
+    if (type == RECORD_BINARY_FILE) {
+        mode |= std::ios::binary;
+    }
+    _file.open(file_name, mode);
+    if (!_file.is_open()) {
+        return false;
+    }
+    // Producers turned away by the last Stop() may still be leaving Enqueue(); none of them touch the ring, but
+    // wait for them anyway before replacing it.
+    while (_producers.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    size_t slot_count = 2;
+    while (slot_count < capacity) {
+        slot_count <<= 1;
+    }
+    _slots.reset(new Slot[slot_count]);
+    for (size_t slot = 0; slot < slot_count; ++slot) {
+        _slots[slot].sequence.store(slot, std::memory_order_relaxed);
+    }
+    _mask = slot_count - 1;
+    _type = type;
+    _drop_when_full = drop_when_full;
+    _enqueue_pos.store(0, std::memory_order_relaxed);
+    _dequeue_pos = 0;
+    _dropped.store(0, std::memory_order_relaxed);
+    _stopping.store(false, std::memory_order_relaxed);
+    _thread = std::thread(&ApiDumpAsyncWriter::WriterLoop, this);
+    _running.store(true, std::memory_order_release);
+    return true;
+}
+
+ApiDumpAsyncWriter::EnqueueResult ApiDumpAsyncWriter::Enqueue(std::string &record) {
+    // Register before checking _running, so that Stop() either sees this producer or this producer sees Stop().
+    _producers.fetch_add(1, std::memory_order_seq_cst);
+    if (!_running.load(std::memory_order_seq_cst)) {
+        _producers.fetch_sub(1, std::memory_order_release);
+        return ENQUEUE_STOPPED;
+    }
+    EnqueueResult result = ENQUEUE_QUEUED;
+    size_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot &slot = _slots[pos & _mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (difference == 0) {
+            if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.record = std::move(record);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                break;
+            }
+        } else if (difference < 0) {
+            // The ring is full.  The writer keeps draining until every registered producer has left, so waiting
+            // for room is safe even while stopping.
+            if (_drop_when_full) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                result = ENQUEUE_DROPPED;
+                break;
+            }
+            _wake.notify_one();
+            std::this_thread::yield();
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+        } else {
+            // Another thread claimed this position first.
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    if (result == ENQUEUE_QUEUED && _writer_waiting.load(std::memory_order_acquire)) {
+        _wake.notify_one();
+    }
+    _producers.fetch_sub(1, std::memory_order_release);
+    return result;
+}
+
+bool ApiDumpAsyncWriter::HasRecord() const {
+    return _slots[_dequeue_pos & _mask].sequence.load(std::memory_order_acquire) == _dequeue_pos + 1;
+}
+
+bool ApiDumpAsyncWriter::Dequeue(std::string &record) {
+    if (!HasRecord()) {
+        return false;
+    }
+    Slot &slot = _slots[_dequeue_pos & _mask];
+    record = std::move(slot.record);
+    slot.record.clear();
+    slot.sequence.store(_dequeue_pos + _mask + 1, std::memory_order_release);
+    ++_dequeue_pos;
+    return true;
+}
+
+void ApiDumpAsyncWriter::WriteDropped() {
+    uint64_t dropped = _dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped != 0) {
+        _file << ApiDumpLayerDroppedRecordsNote(_type, dropped);
+    }
+}
+
+void ApiDumpAsyncWriter::WriterLoop() {
+    std::string record;
+    for (;;) {
+        bool stopping = _stopping.load(std::memory_order_acquire);
+        bool wrote = false;
+        while (Dequeue(record)) {
+            _file << record;
+            wrote = true;
+        }
+        WriteDropped();
+        if (wrote) {
+            _file.flush();
+        }
+        if (stopping) {
+            break;
+        }
+
+        // Wait for more records.  A wake-up can be missed when a record arrives just before the flag is set, so
+        // the wait is also bounded.
+        std::unique_lock<std::mutex> lock(_wake_mutex);
+        _writer_waiting.store(true, std::memory_order_seq_cst);
+        if (!HasRecord() && !_stopping.load(std::memory_order_acquire)) {
+            _wake.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        _writer_waiting.store(false, std::memory_order_relaxed);
+    }
+}
+
+void ApiDumpAsyncWriter::Stop() {
+    if (!_running.exchange(false, std::memory_order_seq_cst)) {
+        return;
+    }
+    // Records from producers already inside Enqueue() are either queued or counted as dropped before the last drain.
+    while (_producers.load(std::memory_order_seq_cst) != 0) {
+        _wake.notify_one();
+        std::this_thread::yield();
+    }
+    {
+        std::unique_lock<std::mutex> lock(_wake_mutex);
+        _stopping.store(true, std::memory_order_release);
+    }
+    _wake.notify_one();
+    _thread.join();
+    _file.close();
+}
+
+static ApiDumpAsyncWriter g_async_writer;
+
+// Start the asynchronous writer for file output if XR_API_DUMP_ASYNC is set.
+static void ApiDumpLayerStartAsyncWriter() {
+    std::string async_mode = PlatformUtilsGetEnv("XR_API_DUMP_ASYNC");
+    if (async_mode.empty() || g_record_info.file_name.empty() ||
+        (g_record_info.type != RECORD_TEXT_FILE && g_record_info.type != RECORD_HTML_FILE &&
+         g_record_info.type != RECORD_BINARY_FILE)) {
+        return;
+    }
+    std::transform(async_mode.begin(), async_mode.end(), async_mode.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t capacity = 8192;
+    std::string queue_size = PlatformUtilsGetEnv("XR_API_DUMP_ASYNC_QUEUE_SIZE");
+    if (!queue_size.empty()) {
+        unsigned long long requested = std::strtoull(queue_size.c_str(), nullptr, 10);
+        if (requested > 0 && requested <= (1ull << 24)) {
+            capacity = static_cast<size_t>(requested);
+        }
+    }
+    g_async_writer.Start(g_record_info.file_name, g_record_info.type, capacity, async_mode == "drop");
+}
+
 // HTML utilities
 bool ApiDumpLayerWriteHtmlHeader() {
     try {
@@ -200,201 +486,806 @@ bool ApiDumpLayerWriteHtmlFooter() {
     }
 }
 
+// Trace utilities
+static uint64_t ApiDumpLayerTraceTimestamp() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Filtering and sampling, configured once when the first instance is created.  Only ever written before any
+// other thread can be inside the layer, so only the counters need to be atomic.
+struct ApiDumpFilter {
+    bool active;
+    std::bitset<API_DUMP_COMMAND_COUNT> commands;
+    uint64_t frame_interval;
+    uint64_t max_bytes_per_second;
+    std::atomic<uint64_t> frame_index;
+    std::atomic<uint64_t> window_begin_ns;
+    std::atomic<uint64_t> window_bytes;
+    std::unordered_set<std::string> object_names;
+};
+
+static ApiDumpFilter g_filter = {};
+
+// Names given to objects with xrSetDebugUtilsObjectNameEXT.  Most applications never name anything, so the
+// lock is only taken once something has been named.
+static ObjectInfoCollection g_object_names;
+static std::shared_timed_mutex g_object_names_mutex;
+static std::atomic<bool> g_object_names_present(false);
+
+// Trace events are small and formatted later, so each one is counted as roughly this many bytes.
+static const uint64_t kTraceEventBytes = 128;
+
+// Command lists may be separated by commas or whitespace.  Names the layer does not know are ignored.
+static std::bitset<API_DUMP_COMMAND_COUNT> ApiDumpLayerParseCommandList(const std::string &command_list) {
+    std::bitset<API_DUMP_COMMAND_COUNT> commands;
+    std::string::size_type start = 0;
+    while (start < command_list.size()) {
+        std::string::size_type end = command_list.find_first_of(", \t", start);
+        if (end == std::string::npos) {
+            end = command_list.size();
+        }
+        std::string command_name = command_list.substr(start, end - start);
+        for (uint32_t command = 0; command < API_DUMP_COMMAND_COUNT; ++command) {
+            if (command_name == g_api_dump_command_names[command]) {
+                commands.set(command);
+                break;
+            }
+        }
+        start = end + 1;
+    }
+    return commands;
+}
+
+// Reads the "key = value" lines of the file named by XR_API_DUMP_SETTINGS_FILE.  Lines starting with '#' are comments.
+static std::unordered_map<std::string, std::string> ApiDumpLayerReadSettingsFile() {
+    std::unordered_map<std::string, std::string> settings;
+    std::string settings_file_name = PlatformUtilsGetEnv("XR_API_DUMP_SETTINGS_FILE");
+    if (settings_file_name.empty()) {
+        return settings;
+    }
+    std::ifstream settings_file(settings_file_name);
+    std::string line;
+    while (std::getline(settings_file, line)) {
+        std::string::size_type equals = line.find('=');
+        std::string::size_type key_begin = line.find_first_not_of(" \t");
+        if (equals == std::string::npos || key_begin == std::string::npos || line[key_begin] == '#') {
+            continue;
+        }
+        std::string key = line.substr(key_begin, equals - key_begin);
+        key.erase(key.find_last_not_of(" \t") + 1);
+        std::string value = line.substr(equals + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t\r") + 1);
+        settings[key] = value;
+    }
+    return settings;
+}
+
+// An environment variable overrides the same setting in the settings file.
+static std::string ApiDumpLayerGetSetting(const std::unordered_map<std::string, std::string> &settings, const char *key,
+                                          const char *env_var_name) {
+    std::string value = PlatformUtilsGetEnv(env_var_name);
+    if (value.empty()) {
+        auto setting = settings.find(key);
+        if (setting != settings.end()) {
+            value = setting->second;
+        }
+    }
+    return value;
+}
+
+static void ApiDumpLayerConfigureFilter() {
+    std::unordered_map<std::string, std::string> settings = ApiDumpLayerReadSettingsFile();
+    std::string include_commands = ApiDumpLayerGetSetting(settings, "include_commands", "XR_API_DUMP_INCLUDE_COMMANDS");
+    std::string exclude_commands = ApiDumpLayerGetSetting(settings, "exclude_commands", "XR_API_DUMP_EXCLUDE_COMMANDS");
+    std::string frame_interval = ApiDumpLayerGetSetting(settings, "frame_interval", "XR_API_DUMP_FRAME_INTERVAL");
+    std::string max_bytes_per_second =
+        ApiDumpLayerGetSetting(settings, "max_bytes_per_second", "XR_API_DUMP_MAX_BYTES_PER_SECOND");
+    std::string object_names = ApiDumpLayerGetSetting(settings, "object_names", "XR_API_DUMP_OBJECT_NAMES");
+
+    if (include_commands.empty()) {
+        g_filter.commands.set();
+    } else {
+        g_filter.commands = ApiDumpLayerParseCommandList(include_commands);
+    }
+    g_filter.commands &= ~ApiDumpLayerParseCommandList(exclude_commands);
+    g_filter.frame_interval = std::strtoull(frame_interval.c_str(), nullptr, 10);
+    g_filter.max_bytes_per_second = std::strtoull(max_bytes_per_second.c_str(), nullptr, 10);
+    g_filter.frame_index = 0;
+    g_filter.window_begin_ns = ApiDumpLayerTraceTimestamp();
+    g_filter.window_bytes = 0;
+    g_filter.object_names.clear();
+    std::string::size_type start = 0;
+    while (start < object_names.size()) {
+        std::string::size_type end = object_names.find(',', start);
+        if (end == std::string::npos) {
+            end = object_names.size();
+        }
+        std::string object_name = object_names.substr(start, end - start);
+        object_name.erase(0, object_name.find_first_not_of(" \t"));
+        object_name.erase(object_name.find_last_not_of(" \t") + 1);
+        if (!object_name.empty()) {
+            g_filter.object_names.insert(object_name);
+        }
+        start = end + 1;
+    }
+    g_filter.active = !g_filter.commands.all() || g_filter.frame_interval > 1 || g_filter.max_bytes_per_second > 0;
+}
+
+// Decides whether a call is dumped at all, before anything about it is formatted or copied.  Frames are counted
+// by xrEndFrame, which belongs to the frame it ends.
+bool ApiDumpLayerShouldDump(ApiDumpCommandId command) {
+    if (!g_filter.active) {
+        return true;
+    }
+    bool dump = g_filter.commands.test(command);
+    if (g_filter.frame_interval > 1) {
+        uint64_t frame_index = command == API_DUMP_COMMAND_xrEndFrame ? g_filter.frame_index.fetch_add(1, std::memory_order_relaxed)
+                                                                      : g_filter.frame_index.load(std::memory_order_relaxed);
+        dump = dump && 0 == frame_index % g_filter.frame_interval;
+    }
+    if (dump && g_filter.max_bytes_per_second > 0) {
+        uint64_t now_ns = ApiDumpLayerTraceTimestamp();
+        uint64_t window_begin_ns = g_filter.window_begin_ns.load(std::memory_order_relaxed);
+        if (now_ns - window_begin_ns >= 1000000000 &&
+            g_filter.window_begin_ns.compare_exchange_strong(window_begin_ns, now_ns, std::memory_order_relaxed)) {
+            g_filter.window_bytes.store(0, std::memory_order_relaxed);
+        }
+        dump = g_filter.window_bytes.load(std::memory_order_relaxed) < g_filter.max_bytes_per_second;
+    }
+    return dump;
+}
+
+// True when only calls touching one of the named objects are dumped.
+bool ApiDumpLayerFilteringObjects() { return !g_filter.object_names.empty(); }
+
+// Object names are matched when the call is made, so naming an object after creating it still lets its calls through.
+bool ApiDumpLayerIsFilteredObject(uint64_t handle, XrObjectType object_type) {
+    if (!g_object_names_present.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::shared_lock<std::shared_timed_mutex> lock(g_object_names_mutex);
+    const XrSdkLogObjectInfo *object_info = g_object_names.LookUpStoredObjectInfo(handle, object_type);
+    return nullptr != object_info && 0 != g_filter.object_names.count(object_info->name);
+}
+
+void ApiDumpLayerSetObjectName(const XrDebugUtilsObjectNameInfoEXT *name_info) {
+    if (nullptr == name_info) {
+        return;
+    }
+    std::unique_lock<std::shared_timed_mutex> lock(g_object_names_mutex);
+    g_object_names.AddObjectName(name_info->objectHandle, name_info->objectType,
+                                 nullptr == name_info->objectName ? "" : name_info->objectName);
+    g_object_names_present.store(!g_object_names.Empty(), std::memory_order_release);
+}
+
+void ApiDumpLayerRemoveObjectName(uint64_t handle, XrObjectType object_type) {
+    if (!g_object_names_present.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::unique_lock<std::shared_timed_mutex> lock(g_object_names_mutex);
+    g_object_names.RemoveObject(handle, object_type);
+    g_object_names_present.store(!g_object_names.Empty(), std::memory_order_release);
+}
+
+void ApiDumpLayerAddHandle(ApiDumpContents &contents, ApiDumpContentView type, ApiDumpContentName name, uint64_t handle,
+                           XrObjectType object_type) {
+    if (!g_object_names_present.load(std::memory_order_acquire)) {
+        contents.AddHandle(type, name, handle, {});
+        return;
+    }
+    std::shared_lock<std::shared_timed_mutex> lock(g_object_names_mutex);
+    const XrSdkLogObjectInfo *object_info = g_object_names.LookUpStoredObjectInfo(handle, object_type);
+    contents.AddHandle(type, name, handle, nullptr == object_info ? ApiDumpContentView() : ApiDumpContentView(object_info->name));
+}
+
+// Counts what was written against the bytes-per-second budget.
+static void ApiDumpLayerChargeFilter(uint64_t bytes) {
+    if (g_filter.active && g_filter.max_bytes_per_second > 0) {
+        g_filter.window_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+// The trace is a JSON array of events, which trace viewers accept even if the closing bracket is missing,
+// so everything written before a crash can still be loaded.  Instances created after the first add to the same
+// array, so the header is only written once.
+bool ApiDumpLayerWriteTraceHeader() {
+    try {
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        if (g_trace_header_written) {
+            return true;
+        }
+        g_trace_header_written = true;
+        std::ofstream trace_file;
+        trace_file.open(g_record_info.file_name, std::ios::out);
+        trace_file << "[\n";
+        g_trace_start_ns = ApiDumpLayerTraceTimestamp();
+        g_trace_events_written = 0;
+        return trace_file.good();
+    } catch (...) {
+        return false;
+    }
+}
+
+// Must be called with g_record_mutex held.
+static void ApiDumpLayerFlushTraceEvents() {
+    if (g_trace_events.empty()) {
+        return;
+    }
+    std::ofstream trace_file;
+    trace_file.open(g_record_info.file_name, std::ios::out | std::ios::app);
+    trace_file << std::fixed << std::setprecision(3);
+    for (const auto &event : g_trace_events) {
+        if (g_trace_events_written++ != 0) {
+            trace_file << ",\n";
+        }
+        // Chrome trace timestamps and durations are in microseconds.
+        uint64_t begin_ns = event.begin_ns > g_trace_start_ns ? event.begin_ns - g_trace_start_ns : 0;
+        trace_file << "{\"name\":\"" << event.command_name << "\",\"cat\":\"openxr\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                   << event.thread_index << ",\"ts\":" << static_cast<double>(begin_ns) / 1000.0
+                   << ",\"dur\":" << static_cast<double>(event.end_ns - event.begin_ns) / 1000.0
+                   << ",\"args\":{\"handle\":\"" << Uint64ToHexString(event.handle) << "\"}}";
+    }
+    g_trace_events.clear();
+}
+
+static void ApiDumpLayerFlushTrace() {
+    try {
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        ApiDumpLayerFlushTraceEvents();
+    } catch (...) {
+        // The events stay buffered until the next flush.
+    }
+}
+
+bool ApiDumpLayerWriteTraceFooter() {
+    try {
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        if (!g_trace_header_written) {
+            return true;
+        }
+        ApiDumpLayerFlushTraceEvents();
+        std::ofstream trace_file;
+        trace_file.open(g_record_info.file_name, std::ios::out | std::ios::app);
+        trace_file << "\n]\n";
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// An application may create another instance after destroying the last one, so the trace is only closed once the
+// layer is unloaded.  This is defined after everything the footer uses, so it is destroyed before any of it.
+struct ApiDumpTraceCloser {
+    ~ApiDumpTraceCloser() { ApiDumpLayerWriteTraceFooter(); }
+};
+static ApiDumpTraceCloser g_trace_closer;
+
+// Statistics utilities.  Each thread counts its own calls, so recording a call takes no lock and touches no memory
+// shared with other threads.  The counts are only added up when a report is written.
+
+// Latencies are kept in buckets with kStatsSubBuckets buckets per power of two nanoseconds, so any latency is
+// within about 6% of the middle of its bucket.  Latencies above 2^kStatsMaxLog2 nanoseconds share the last bucket.
+static const uint32_t kStatsSubBucketBits = 3;
+static const uint64_t kStatsSubBuckets = 1 << kStatsSubBucketBits;
+static const uint32_t kStatsMaxLog2 = 47;
+static const uint32_t kStatsBucketCount = (kStatsMaxLog2 - kStatsSubBucketBits + 2) * kStatsSubBuckets;
+
+static uint32_t ApiDumpLayerStatsLog2(uint64_t value) {
+    uint32_t log2 = 0;
+    for (uint32_t shift = 32; shift > 0; shift /= 2) {
+        if (value >> shift) {
+            value >>= shift;
+            log2 += shift;
+        }
+    }
+    return log2;
+}
+
+static uint32_t ApiDumpLayerStatsBucket(uint64_t latency_ns) {
+    if (latency_ns < kStatsSubBuckets) {
+        return static_cast<uint32_t>(latency_ns);
+    }
+    uint32_t log2 = std::min(ApiDumpLayerStatsLog2(latency_ns), kStatsMaxLog2);
+    uint64_t sub_bucket = (latency_ns >> (log2 - kStatsSubBucketBits)) & (kStatsSubBuckets - 1);
+    return static_cast<uint32_t>((log2 - kStatsSubBucketBits + 1) * kStatsSubBuckets + sub_bucket);
+}
+
+// The latency in the middle of a bucket.
+static double ApiDumpLayerStatsBucketLatency(uint32_t bucket) {
+    if (bucket < kStatsSubBuckets) {
+        return static_cast<double>(bucket);
+    }
+    uint32_t log2 = bucket / kStatsSubBuckets + kStatsSubBucketBits - 1;
+    uint64_t lowest = (kStatsSubBuckets + bucket % kStatsSubBuckets) << (log2 - kStatsSubBucketBits);
+    return static_cast<double>(lowest) + static_cast<double>(1ull << (log2 - kStatsSubBucketBits)) / 2.0;
+}
+
+// The calls to one command made by one thread.  Only that thread writes to it, but a report may read it at any time.
+struct ApiDumpCommandStats {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> max_ns;
+    std::atomic<uint64_t> buckets[kStatsBucketCount];
+};
+
+// The calls to one command added up over every thread.
+struct ApiDumpCommandTotals {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    std::vector<uint64_t> buckets;
+
+    void Add(const ApiDumpCommandStats &stats) {
+        count += stats.count.load(std::memory_order_relaxed);
+        total_ns += stats.total_ns.load(std::memory_order_relaxed);
+        max_ns = std::max(max_ns, stats.max_ns.load(std::memory_order_relaxed));
+        buckets.resize(kStatsBucketCount);
+        for (uint32_t bucket = 0; bucket < kStatsBucketCount; ++bucket) {
+            buckets[bucket] += stats.buckets[bucket].load(std::memory_order_relaxed);
+        }
+    }
+
+    // The latency of the call at the given fraction of the way through the calls sorted by latency.
+    double Percentile(double fraction) const {
+        uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count)));
+        uint64_t seen = 0;
+        for (uint32_t bucket = 0; bucket < buckets.size(); ++bucket) {
+            seen += buckets[bucket];
+            if (seen >= rank && seen > 0) {
+                return std::min(ApiDumpLayerStatsBucketLatency(bucket), static_cast<double>(max_ns));
+            }
+        }
+        return static_cast<double>(max_ns);
+    }
+};
+
+// These are all protected by g_stats_mutex
+class ApiDumpThreadStats;
+static std::mutex g_stats_mutex;
+static std::vector<ApiDumpThreadStats *> g_stats_threads;
+static std::vector<ApiDumpCommandTotals> g_stats_finished_threads(API_DUMP_COMMAND_COUNT);
+static uint64_t g_stats_thread_count = 0;
+static uint64_t g_stats_start_ns = 0;
+
+// Set from a signal handler to ask for a report the next time a call is recorded.
+static std::atomic<bool> g_stats_report_requested(false);
+
+// ApiDumpThreadStats class -
+// One thread's calls to every command.  The stats for a command are only allocated once the thread calls it.
+// When the thread exits, its stats are added to g_stats_finished_threads.
+class ApiDumpThreadStats {
+   public:
+    ApiDumpThreadStats() {
+        for (auto &command : _commands) {
+            command.store(nullptr, std::memory_order_relaxed);
+        }
+        std::unique_lock<std::mutex> mlock(g_stats_mutex);
+        g_stats_threads.push_back(this);
+        ++g_stats_thread_count;
+    }
+
+    ~ApiDumpThreadStats() {
+        std::unique_lock<std::mutex> mlock(g_stats_mutex);
+        AddTo(g_stats_finished_threads);
+        g_stats_threads.erase(std::remove(g_stats_threads.begin(), g_stats_threads.end(), this), g_stats_threads.end());
+        mlock.unlock();
+        for (auto &command : _commands) {
+            delete command.load(std::memory_order_relaxed);
+        }
+    }
+
+    ApiDumpThreadStats(const ApiDumpThreadStats &) = delete;
+    ApiDumpThreadStats &operator=(const ApiDumpThreadStats &) = delete;
+
+    void Record(ApiDumpCommandId command, uint64_t latency_ns) {
+        ApiDumpCommandStats *stats = _commands[command].load(std::memory_order_relaxed);
+        if (nullptr == stats) {
+            stats = new ApiDumpCommandStats();
+            _commands[command].store(stats, std::memory_order_release);
+        }
+        // Only this thread writes, so there is no need for read-modify-write operations.
+        Increase(stats->count, 1);
+        Increase(stats->total_ns, latency_ns);
+        Increase(stats->buckets[ApiDumpLayerStatsBucket(latency_ns)], 1);
+        if (latency_ns > stats->max_ns.load(std::memory_order_relaxed)) {
+            stats->max_ns.store(latency_ns, std::memory_order_relaxed);
+        }
+    }
+
+    // Must be called with g_stats_mutex held.
+    void AddTo(std::vector<ApiDumpCommandTotals> &totals) const {
+        for (uint32_t command = 0; command < API_DUMP_COMMAND_COUNT; ++command) {
+            const ApiDumpCommandStats *stats = _commands[command].load(std::memory_order_acquire);
+            if (nullptr != stats) {
+                totals[command].Add(*stats);
+            }
+        }
+    }
+
+   private:
+    static void Increase(std::atomic<uint64_t> &value, uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    std::atomic<ApiDumpCommandStats *> _commands[API_DUMP_COMMAND_COUNT];
+};
+
+// Write a table of every command called so far, slowest in total first.
+static void ApiDumpLayerWriteStatsReport() {
+    try {
+        std::vector<ApiDumpCommandTotals> totals;
+        uint64_t thread_count = 0;
+        uint64_t start_ns = 0;
+        {
+            std::unique_lock<std::mutex> mlock(g_stats_mutex);
+            totals = g_stats_finished_threads;
+            for (const ApiDumpThreadStats *thread_stats : g_stats_threads) {
+                thread_stats->AddTo(totals);
+            }
+            thread_count = g_stats_thread_count;
+            start_ns = g_stats_start_ns;
+        }
+        double seconds = static_cast<double>(ApiDumpLayerTraceTimestamp() - start_ns) / 1000000000.0;
+
+        std::vector<uint32_t> commands;
+        for (uint32_t command = 0; command < API_DUMP_COMMAND_COUNT; ++command) {
+            if (totals[command].count > 0) {
+                commands.push_back(command);
+            }
+        }
+        std::sort(commands.begin(), commands.end(),
+                  [&totals](uint32_t a, uint32_t b) { return totals[a].total_ns > totals[b].total_ns; });
+
+        std::ostringstream report;
+        report << std::fixed << std::setprecision(3);
+        report << "API dump statistics over " << seconds << " seconds (threads seen: " << thread_count << ")\n";
+        report << std::left << std::setw(48) << "Command" << std::right << std::setw(12) << "Calls" << std::setw(14)
+               << "Calls/s" << std::setw(14) << "Total ms" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us"
+               << std::setw(12) << "p99.9 us" << std::setw(12) << "Max us"
+               << "\n";
+        for (uint32_t command : commands) {
+            const ApiDumpCommandTotals &command_totals = totals[command];
+            report << std::left << std::setw(48) << g_api_dump_command_names[command] << std::right << std::setw(12)
+                   << command_totals.count << std::setw(14)
+                   << (seconds > 0 ? static_cast<double>(command_totals.count) / seconds : 0.0) << std::setw(14)
+                   << static_cast<double>(command_totals.total_ns) / 1000000.0 << std::setw(12)
+                   << command_totals.Percentile(0.5) / 1000.0 << std::setw(12) << command_totals.Percentile(0.99) / 1000.0
+                   << std::setw(12) << command_totals.Percentile(0.999) / 1000.0 << std::setw(12)
+                   << static_cast<double>(command_totals.max_ns) / 1000.0 << "\n";
+        }
+
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        if (g_record_info.file_name.empty()) {
+            std::cout << report.str() << std::flush;
+        } else {
+            std::ofstream stats_file(g_record_info.file_name, std::ios::out | std::ios::app);
+            stats_file << report.str();
+        }
+    } catch (...) {
+        // A report that can't be written is simply skipped.
+    }
+}
+
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+static void ApiDumpLayerStatsSignalHandler(int /*signal_number*/) {
+    g_stats_report_requested.store(true, std::memory_order_relaxed);
+}
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+
+// Start counting calls, and if XR_API_DUMP_STATS_SIGNAL is set, write a report whenever SIGUSR1 is received.
+// Instances created later keep adding to the same counts.
+static void ApiDumpLayerStartStats() {
+    {
+        std::unique_lock<std::mutex> mlock(g_stats_mutex);
+        if (0 != g_stats_start_ns) {
+            return;
+        }
+        g_stats_start_ns = ApiDumpLayerTraceTimestamp();
+    }
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    if (!PlatformUtilsGetEnv("XR_API_DUMP_STATS_SIGNAL").empty()) {
+        std::signal(SIGUSR1, ApiDumpLayerStatsSignalHandler);
+    }
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+}
+
+static void ApiDumpLayerRecordStats(ApiDumpCommandId command, uint64_t latency_ns) {
+    static thread_local ApiDumpThreadStats thread_stats;
+    thread_stats.Record(command, latency_ns);
+    if (g_stats_report_requested.load(std::memory_order_relaxed) && g_stats_report_requested.exchange(false)) {
+        ApiDumpLayerWriteStatsReport();
+    }
+}
+
+// Both traces and statistics only time the calls, without dumping their parameters.
+bool ApiDumpLayerTracing() {
+    return g_record_info.initialized && (g_record_info.type == RECORD_TRACE_FILE || g_record_info.type == RECORD_STATS);
+}
+
+// Returns the time a traced call starts, or 0 if no trace is being recorded.
+uint64_t ApiDumpLayerTraceBegin() { return ApiDumpLayerTracing() ? ApiDumpLayerTraceTimestamp() : 0; }
+
+void ApiDumpLayerRecordTrace(ApiDumpCommandId command, uint64_t handle, uint64_t begin_ns) {
+    if (0 == begin_ns) {
+        return;
+    }
+    uint64_t end_ns = ApiDumpLayerTraceTimestamp();
+    try {
+        if (g_record_info.type == RECORD_STATS) {
+            ApiDumpLayerRecordStats(command, end_ns - begin_ns);
+            return;
+        }
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        if (g_record_info.type != RECORD_TRACE_FILE) {
+            return;
+        }
+        auto thread_index =
+            g_trace_thread_indices.emplace(std::this_thread::get_id(), static_cast<uint32_t>(g_trace_thread_indices.size() + 1));
+        g_trace_events.push_back({g_api_dump_command_names[command], handle, begin_ns, end_ns, thread_index.first->second});
+        ApiDumpLayerChargeFilter(kTraceEventBytes);
+        if (g_trace_events.size() >= kTraceFlushEventCount) {
+            ApiDumpLayerFlushTraceEvents();
+        }
+    } catch (...) {
+        // Dropping a trace event must not affect the call being traced.
+    }
+}
+
+// Binary capture utilities
+// The capture file last started by this process, protected by g_record_mutex.  Instances created later add to it.
+static std::string g_capture_file_name;
+
+bool ApiDumpLayerWriteCaptureHeader() {
+    try {
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        if (g_capture_file_name == g_record_info.file_name) {
+            return true;
+        }
+        std::ofstream capture_file;
+        capture_file.open(g_record_info.file_name, std::ios::out | std::ios::binary);
+        ApiDumpCaptureHeader header = {};
+        memcpy(header.magic, kApiDumpCaptureMagic, sizeof(header.magic));
+        header.version = kApiDumpCaptureVersion;
+        header.pointer_size = static_cast<uint32_t>(sizeof(void *));
+        capture_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (!capture_file.good()) {
+            return false;
+        }
+        g_capture_file_name = g_record_info.file_name;
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Ring file utilities.  The ring is protected by g_record_mutex, and stays mapped until the process exits so a
+// viewer can still read the last records once the application is done.
+static ApiDumpRing g_ring;
+
+// Ring size used when XR_API_DUMP_RING_SIZE is not set.
+static const uint64_t kDefaultRingSize = 16 * 1024 * 1024;
+
+static bool ApiDumpLayerCreateRing() {
+    std::unique_lock<std::mutex> mlock(g_record_mutex);
+    if (g_ring.IsOpen()) {
+        return true;
+    }
+    uint64_t ring_size = kDefaultRingSize;
+    std::string ring_size_setting = PlatformUtilsGetEnv("XR_API_DUMP_RING_SIZE");
+    if (!ring_size_setting.empty()) {
+        unsigned long long requested = std::strtoull(ring_size_setting.c_str(), nullptr, 10);
+        if (requested >= 4096 && requested <= (1ull << 40)) {
+            ring_size = static_cast<uint64_t>(requested);
+        }
+    }
+    return g_ring.Create(g_record_info.file_name, ring_size);
+}
+
+bool ApiDumpLayerCapturing() {
+    return g_record_info.initialized && (g_record_info.type == RECORD_BINARY_FILE || g_record_info.type == RECORD_RING_FILE);
+}
+
+bool ApiDumpLayerRecordCapture(std::string record) {
+    ApiDumpCaptureEndRecord(record);
+    ApiDumpLayerChargeFilter(record.size());
+    if (g_record_info.type == RECORD_RING_FILE) {
+        uint64_t timestamp_ns = ApiDumpLayerTraceTimestamp();
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        return g_ring.Write(record.data() + sizeof(uint32_t), record.size() - sizeof(uint32_t), timestamp_ns);
+    }
+    if (g_async_writer.Running()) {
+        ApiDumpAsyncWriter::EnqueueResult queued = g_async_writer.Enqueue(record);
+        if (queued != ApiDumpAsyncWriter::ENQUEUE_STOPPED) {
+            return queued == ApiDumpAsyncWriter::ENQUEUE_QUEUED;
+        }
+    }
+    try {
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        std::ofstream capture_file;
+        capture_file.open(g_record_info.file_name, std::ios::out | std::ios::app | std::ios::binary);
+        capture_file.write(record.data(), static_cast<std::streamsize>(record.size()));
+        return capture_file.good();
+    } catch (...) {
+        return false;
+    }
+}
+
+// Reverse of g_instance_dispatch_map so the instance owning a dispatch table can be found without walking
+// every instance.  Guarded by g_instance_dispatch_mutex, like the map it mirrors.
+static std::unordered_map<XrGeneratedDispatchTable *, XrInstance> g_dispatch_instance_map;
+
 // Api Dump Utility function to return an instance based on the generated dispatch table
 // pointer.
 XrInstance FindInstanceFromDispatchTable(XrGeneratedDispatchTable *dispatch_table) {
-    std::unique_lock<std::mutex> mlock(g_instance_dispatch_mutex);
-    XrInstance instance = XR_NULL_HANDLE;
-    for (auto it = g_instance_dispatch_map.begin(); it != g_instance_dispatch_map.end();) {
-        if (it->second == dispatch_table) {
-            instance = it->first;
-            break;
+    std::shared_lock<std::shared_timed_mutex> mlock(g_instance_dispatch_mutex);
+    auto map_iter = g_dispatch_instance_map.find(dispatch_table);
+    if (map_iter == g_dispatch_instance_map.end()) {
+        return XR_NULL_HANDLE;
+    }
+    return map_iter->second;
+}
+
+// Write one command's content as lines of text
+static void ApiDumpLayerWriteTextContent(std::ostream &out, const ApiDumpContents &contents) {
+    for (size_t content_index = 0; content_index < contents.size(); ++content_index) {
+        if (content_index != 0) {
+            out << "    ";
         }
+        ApiDumpContentView content_value = contents.Value(content_index);
+        out << contents.Type(content_index) << " " << contents.Name(content_index);
+        if (!content_value.empty()) {
+            out << " = " << content_value;
+        }
+        out << "\n";
     }
-    return instance;
 }
 
-// Function to record all the API dump information
-bool ApiDumpLayerRecordContent(std::vector<std::tuple<std::string, std::string, std::string>> contents) {
-    bool success = false;
-    if (g_record_info.initialized) {
-        std::unique_lock<std::mutex> mlock(g_record_mutex);
-        uint32_t count = 0;
-        switch (g_record_info.type) {
-            case RECORD_TEXT_COUT: {
-                for (const auto &content : contents) {
-                    std::string content_type;
-                    std::string content_name;
-                    std::string content_value;
-                    std::tie(content_type, content_name, content_value) = content;
-                    if (count++ != 0) {
-                        std::cout << "    ";
-                    }
-                    if (!content_value.empty()) {
-                        std::cout << content_type << " " << content_name << " = " << content_value << "\n";
-                    } else {
-                        std::cout << content_type << " " << content_name << "\n";
-                    }
+// Count number of structure, pointer and array dereferences in a name
+static uint32_t ApiDumpLayerCountDereferences(ApiDumpContentView content_name) {
+    return static_cast<uint32_t>(content_name.Count(".") + content_name.Count("->") + content_name.Count("["));
+}
+
+// Write one command's content as a block of nested HTML details
+static void ApiDumpLayerWriteHtmlContent(std::ostream &out, const ApiDumpContents &contents) {
+    out << "<details class='data'>\n";
+    std::vector<ApiDumpContentView> prefixes;
+    uint32_t last_deref_count = 0;
+    for (size_t content_index = 0; content_index < contents.size(); ++content_index) {
+        ApiDumpContentView content_type = contents.Type(content_index);
+        ApiDumpContentView content_name = contents.Name(content_index);
+        ApiDumpContentView content_value = contents.Value(content_index);
+        if (content_index == 0) {
+            out << "   <summary>\n"
+                << "      <div class='headertype'>" << content_type << "</div>\n"
+                << "      <div class='headervar'>" << content_name << "</div>\n"
+                << "   </summary>\n";
+        } else {
+            uint32_t cur_deref_count = ApiDumpLayerCountDereferences(content_name);
+            uint32_t next_deref_count = 0;
+
+            // If there's something after this, see if it's a sub-component of this.
+            if (content_index < contents.size() - 1) {
+                next_deref_count = ApiDumpLayerCountDereferences(contents.Name(content_index + 1));
+            }
+
+            // If we've reduced the number of dereferences in the name from last time, we need
+            // to close up those detail sections.
+            if (cur_deref_count < last_deref_count) {
+                uint32_t diff_count = last_deref_count - cur_deref_count;
+                while ((diff_count--) != 0u) {
+                    out << "   </details>\n";
+                    prefixes.pop_back();
                 }
-                success = true;
-                break;
             }
-            case RECORD_TEXT_FILE: {
-                std::ofstream text_file;
-                text_file.open(g_record_info.file_name, std::ios::out | std::ios::app);
-                for (const auto &content : contents) {
-                    std::string content_type;
-                    std::string content_name;
-                    std::string content_value;
-                    std::tie(content_type, content_name, content_value) = content;
-                    if (count++ != 0) {
-                        text_file << "    ";
-                    }
-                    if (!content_value.empty()) {
-                        text_file << content_type << " " << content_name << " = " << content_value << "\n";
-                    } else {
-                        text_file << content_type << " " << content_name << "\n";
+
+            // Look through any prefixes we've saved (going backwards through the list)
+            // and find the one that matches our beginning.
+            ApiDumpContentView short_name = content_name;
+            if (cur_deref_count > 0) {
+                for (auto it = prefixes.rbegin(); it != prefixes.rend(); ++it) {
+                    if (content_name.StartsWith(*it)) {
+                        size_t additional_offset = it->size + 1;
+                        if (content_name.data[additional_offset - 1] == '-') {
+                            additional_offset++;
+                        } else if (content_name.data[additional_offset - 1] == '[') {
+                            additional_offset--;
+                        }
+                        short_name = content_name.Suffix(additional_offset);
+                        break;
                     }
                 }
-                text_file.close();
-                success = true;
-                break;
             }
-            case RECORD_HTML_FILE: {
-                std::ofstream text_file;
-                text_file.open(g_record_info.file_name, std::ios::out | std::ios::app);
-                text_file << "<details class='data'>\n";
-                std::vector<std::string> prefixes;
-                uint32_t last_deref_count = 0;
-                for (uint32_t content_index = 0; content_index < contents.size(); ++content_index) {
-                    std::string content_type;
-                    std::string content_name;
-                    std::string content_value;
-                    std::tie(content_type, content_name, content_value) = contents[content_index];
-                    if (content_index == 0) {
-                        text_file << "   <summary>\n"
-                                  << "      <div class='headertype'>" << content_type << "</div>\n"
-                                  << "      <div class='headervar'>" << content_name << "</div>\n"
-                                  << "   </summary>\n";
-                    } else {
-                        uint32_t cur_deref_count = 0;
-                        uint32_t next_deref_count = 0;
-
-                        // Count number of structure and pointer dereferences for the current line
-                        cur_deref_count = static_cast<uint32_t>(std::count(content_name.begin(), content_name.end(), '.'));
-                        std::string::size_type start = 0;
-                        while ((start = content_name.find("->", start)) != std::string::npos) {
-                            ++cur_deref_count;
-                            start += 2;
-                        }
-                        // Now look for array dereferences
-                        start = 0;
-                        while ((start = content_name.find('[', start)) != std::string::npos) {
-                            ++cur_deref_count;
-                            start++;
-                        }
 
-                        // If there's something after this, see if it's a sub-component of this.
-                        if (content_index < contents.size() - 1) {
-                            std::string next_content_type;
-                            std::string next_content_name;
-                            std::string next_content_value;
-                            std::tie(next_content_type, next_content_name, next_content_value) = contents[content_index + 1];
-
-                            // Count number of structure and pointer dereferences for the next line
-                            next_deref_count =
-                                static_cast<uint32_t>(std::count(next_content_name.begin(), next_content_name.end(), '.'));
-                            start = 0;
-                            while ((start = next_content_name.find("->", start)) != std::string::npos) {
-                                ++next_deref_count;
-                                start += 2;
-                            }
-                            // Now look for array dereferences
-                            start = 0;
-                            while ((start = next_content_name.find('[', start)) != std::string::npos) {
-                                ++next_deref_count;
-                                start++;
-                            }
-                        }
+            bool writing_summary = false;
 
-                        // If we've reduced the number of dereferences in the name from last time, we need
-                        // to close up those detail sections.
-                        if (cur_deref_count < last_deref_count) {
-                            uint32_t diff_count = last_deref_count - cur_deref_count;
-                            while ((diff_count--) != 0u) {
-                                text_file << "   </details>\n";
-                                prefixes.pop_back();
-                            }
-                        }
+            // If the next item contains this item as a prefix, start the summary.  Otherwise,
+            // start a <div> marker so that each component lands on its own line.
+            if (cur_deref_count < next_deref_count) {
+                out << "   <details class='data'>\n"
+                    << "      <summary>\n";
+                writing_summary = true;
+                prefixes.push_back(content_name);
+            } else {
+                out << "      <div class='data'>\n";
+            }
 
-                        // Look through any prefixes we've saved (going backwards through the list)
-                        // and find the one that matches our beginning.
-                        std::string short_name = content_name;
-                        if (cur_deref_count > 0) {
-                            for (auto it = prefixes.rbegin(); it != prefixes.rend(); ++it) {
-                                if (content_name.find(*it) == 0) {
-                                    std::string::size_type additional_offset = it->size() + 1;
-                                    if (content_name[additional_offset - 1] == '-') {
-                                        additional_offset++;
-                                    } else if (content_name[additional_offset - 1] == '[') {
-                                        additional_offset--;
-                                    }
-                                    short_name = content_name.substr(additional_offset);
-                                    break;
-                                }
-                            }
-                        }
+            // Write out the content
+            out << "         <div class='type'>" << content_type << "</div>\n"
+                << "         <div class='var'>" << short_name << "</div>\n";
+            bool value_needs_printing = true;
+            if (content_type.Contains("char")) {
+                if (content_type.Count("*") + content_type.Count("[") < 2) {
+                    out << "         <div class='val'>\"" << content_value << "\"</div>";
+                    value_needs_printing = false;
+                }
+            }
+            if (!content_value.empty() && value_needs_printing) {
+                out << "         <div class='val'>" << content_value << "</div>";
+            }
+            out << "\n";
 
-                        bool writing_summary = false;
-
-                        // If the next item contains this item as a prefix, start the summary.  Otherwise,
-                        // start a <div> marker so that each component lands on its own line.
-                        if (cur_deref_count < next_deref_count) {
-                            text_file << "   <details class='data'>\n"
-                                      << "      <summary>\n";
-                            writing_summary = true;
-                            prefixes.push_back(content_name);
-                        } else {
-                            text_file << "      <div class='data'>\n";
-                        }
+            // Wrap up any summary we may have started.  Otherwise, just wrap up the
+            // <div> marker wrapping this entry.
+            if (writing_summary) {
+                out << "      </summary>\n";
+            } else {
+                out << "      </div>\n";
+            }
 
-                        // Write out the content
-                        text_file << "         <div class='type'>" << content_type << "</div>\n"
-                                  << "         <div class='var'>" << short_name << "</div>\n";
-                        bool value_needs_printing = true;
-                        if (content_type.find("char") != std::string::npos) {
-                            uint64_t star_count = std::count(content_type.begin(), content_type.end(), '*');
-                            uint64_t bracket_count = std::count(content_type.begin(), content_type.end(), '[');
-                            if (star_count + bracket_count < 2) {
-                                text_file << "         <div class='val'>\"" << content_value << "\"</div>";
-                                value_needs_printing = false;
-                            }
-                        }
-                        if (!content_value.empty() && value_needs_printing) {
-                            text_file << "         <div class='val'>" << content_value << "</div>";
-                        }
-                        text_file << "\n";
-
-                        // Wrap up any summary we may have started.  Otherwise, just wrap up the
-                        // <div> marker wrapping this entry.
-                        if (writing_summary) {
-                            text_file << "      </summary>\n";
-                        } else {
-                            text_file << "      </div>\n";
-                        }
+            last_deref_count = cur_deref_count;
+        }
+    }
 
-                        last_deref_count = cur_deref_count;
-                    }
-                }
+    // Wrap up any remaining items
+    if (last_deref_count != 0u) {
+        while ((last_deref_count--) != 0u) {
+            out << "   </details>\n";
+            prefixes.pop_back();
+        }
+    }
+    out << "</details>\n";
+}
 
-                // Wrap up any remaining items
-                if (last_deref_count != 0u) {
-                    while ((last_deref_count--) != 0u) {
-                        text_file << "   </details>\n";
-                        prefixes.pop_back();
+// Function to record all the API dump information
+bool ApiDumpLayerRecordContent(const ApiDumpContents &contents) {
+    bool success = false;
+    ApiDumpLayerChargeFilter(contents.ByteCount());
+    if (g_record_info.initialized) {
+        switch (g_record_info.type) {
+            case RECORD_TEXT_COUT: {
+                std::unique_lock<std::mutex> mlock(g_record_mutex);
+                ApiDumpLayerWriteTextContent(std::cout, contents);
+                success = true;
+                break;
+            }
+            case RECORD_TEXT_FILE:
+            case RECORD_HTML_FILE: {
+                // With the asynchronous writer, only format the record here and leave the file to the writer thread.
+                if (g_async_writer.Running()) {
+                    std::ostringstream record_stream;
+                    if (g_record_info.type == RECORD_TEXT_FILE) {
+                        ApiDumpLayerWriteTextContent(record_stream, contents);
+                    } else {
+                        ApiDumpLayerWriteHtmlContent(record_stream, contents);
+                    }
+                    std::string record = record_stream.str();
+                    ApiDumpAsyncWriter::EnqueueResult queued = g_async_writer.Enqueue(record);
+                    if (queued != ApiDumpAsyncWriter::ENQUEUE_STOPPED) {
+                        success = queued == ApiDumpAsyncWriter::ENQUEUE_QUEUED;
+                        break;
                     }
                 }
-                text_file << "</details>\n";
+                std::unique_lock<std::mutex> mlock(g_record_mutex);
+                std::ofstream text_file;
+                text_file.open(g_record_info.file_name, std::ios::out | std::ios::app);
+                if (g_record_info.type == RECORD_TEXT_FILE) {
+                    ApiDumpLayerWriteTextContent(text_file, contents);
+                    success = true;
+                } else {
+                    ApiDumpLayerWriteHtmlContent(text_file, contents);
+                }
                 break;
             }
             default:
@@ -404,6 +1295,44 @@ bool ApiDumpLayerRecordContent(std::vector<std::tuple<std::string, std::string,
     return success;
 }
 
+// Generate output for xrCreateInstance, which the layer sees as xrCreateApiLayerInstance
+static void ApiDumpLayerCreateInstanceContents(const XrInstanceCreateInfo *info, XrInstance *instance,
+                                               ApiDumpContents &contents) {
+    contents.emplace_back("XrResult", "xrCreateInstance", "");
+    contents.AddBytes("const XrInstanceCreateInfo*", "info", info);
+    if (nullptr != info) {
+        contents.AddDecimal("XrStructureType", "info->type", info->type);
+        // Decode the next chain if it exists
+        if (!ApiDumpDecodeNextChain(nullptr, info->next, "info->next", contents)) {
+            throw std::invalid_argument("Invalid Operation");
+        }
+        contents.AddDecimal("XrInstanceCreateFlags", "info->createFlags", info->createFlags);
+        if (!ApiDumpOutputXrStruct(nullptr, &info->applicationInfo, "info->applicationInfo", "XrApplicationInfo", true, contents)) {
+            throw std::invalid_argument("Invalid Operation");
+        }
+        contents.AddHex("uint32_t", "info->enabledApiLayerCount", info->enabledApiLayerCount, true);
+        contents.AddPointer("const char* const*", "info->enabledApiLayerNames", info->enabledApiLayerNames);
+        for (uint32_t i = 0; i < info->enabledApiLayerCount; ++i) {
+            std::string prefix = "info->enabledApiLayerNames[" + std::to_string(i) + "]";
+            contents.emplace_back("const char* const*", prefix, info->enabledApiLayerNames[i]);
+        }
+        contents.AddHex("uint32_t", "info->enabledExtensionCount", info->enabledExtensionCount, true);
+        contents.AddPointer("const char* const*", "info->enabledExtensionNames", info->enabledExtensionNames);
+        for (uint32_t ii = 0; ii < info->enabledExtensionCount; ++ii) {
+            std::string prefix = "info->enabledExtensionNames[" + std::to_string(ii) + "]";
+            contents.emplace_back("const char* const*", prefix, info->enabledExtensionNames[ii]);
+        }
+    }
+
+    contents.AddBytes("XrInstance*", "instance", instance);
+}
+
+// Generate output for xrDestroyInstance
+static void ApiDumpLayerDestroyInstanceContents(XrInstance instance, ApiDumpContents &contents) {
+    contents.emplace_back("XrResult", "xrDestroyInstance", "");
+    contents.AddBytes("XrInstance", "instance", instance);
+}
+
 XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateInstance(const XrInstanceCreateInfo * /*info*/, XrInstance * /*instance*/) {
     if (!g_record_info.initialized) {
         g_record_info.initialized = true;
@@ -451,9 +1380,40 @@ XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateApiLayerInstance(const XrInst
                 }
             } else if (export_type_lower == "code") {
                 g_record_info.type = RECORD_CODE_FILE;
+            } else if (export_type_lower == "trace") {
+                // Instances created later add to the same trace
+                g_record_info.type = RECORD_TRACE_FILE;
+                if (!ApiDumpLayerWriteTraceHeader()) {
+                    return XR_ERROR_INITIALIZATION_FAILED;
+                }
+            } else if (export_type_lower == "binary" && !g_record_info.file_name.empty()) {
+                // Instances created later add to the same capture
+                g_record_info.type = RECORD_BINARY_FILE;
+                if (!ApiDumpLayerWriteCaptureHeader()) {
+                    return XR_ERROR_INITIALIZATION_FAILED;
+                }
+            } else if (export_type_lower == "stats") {
+                // Instances created later add to the same statistics
+                g_record_info.type = RECORD_STATS;
+                ApiDumpLayerStartStats();
+            } else if (export_type_lower == "ring" && !g_record_info.file_name.empty()) {
+                g_record_info.type = RECORD_RING_FILE;
+                if (!ApiDumpLayerCreateRing()) {
+                    return XR_ERROR_INITIALIZATION_FAILED;
+                }
             }
         }
 
+        // Filter settings are read again for an instance created while no other is alive, since nothing can be
+        // checking the filter then.
+        std::shared_lock<std::shared_timed_mutex> live_lock(g_instance_dispatch_mutex);
+        bool no_live_instances = g_instance_dispatch_map.empty();
+        live_lock.unlock();
+        if (no_live_instances) {
+            ApiDumpLayerConfigureFilter();
+        }
+        ApiDumpLayerStartAsyncWriter();
+
         // Validate the API layer info and next API layer info structures before we try to use them
         if (nullptr == apiLayerInfo || XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO != apiLayerInfo->structType ||
             XR_API_LAYER_CREATE_INFO_STRUCT_VERSION > apiLayerInfo->structVersion ||
@@ -467,61 +1427,23 @@ XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateApiLayerInstance(const XrInst
             return XR_ERROR_INITIALIZATION_FAILED;
         }
 
-        // Generate output for this command as if it were the standard xrCreateInstance
-        std::vector<std::tuple<std::string, std::string, std::string>> contents;
-        contents.emplace_back("XrResult", "xrCreateInstance", "");
-        contents.emplace_back("const XrInstanceCreateInfo*", "info", PointerToHexString(info));
-        if (nullptr != info) {
-            std::string info_prefix = "info->";
-            contents.emplace_back("XrStructureType", "info->type", std::to_string(info->type));
-            std::string next_prefix = info_prefix;
-            next_prefix += "next";
-            // Decode the next chain if it exists
-            if (!ApiDumpDecodeNextChain(nullptr, info->next, next_prefix, contents)) {
-                throw std::invalid_argument("Invalid Operation");
-            }
-            std::string flags_prefix = info_prefix;
-            flags_prefix += "createFlags";
-            contents.emplace_back("XrInstanceCreateFlags", flags_prefix, std::to_string(info->createFlags));
-            std::string applicationinfo_prefix = info_prefix;
-            applicationinfo_prefix += "applicationInfo";
-            if (!ApiDumpOutputXrStruct(nullptr, &info->applicationInfo, applicationinfo_prefix, "XrApplicationInfo", true,
-                                       contents)) {
-                throw std::invalid_argument("Invalid Operation");
-            }
-            std::string enabledapilayercount_prefix = info_prefix;
-            enabledapilayercount_prefix += "enabledApiLayerCount";
-            std::ostringstream oss_enabledApiLayerCount;
-            oss_enabledApiLayerCount << "0x" << std::hex << (info->enabledApiLayerCount);
-            contents.emplace_back("uint32_t", enabledapilayercount_prefix, oss_enabledApiLayerCount.str());
-            std::string enabledapilayernames_prefix = info_prefix;
-            enabledapilayernames_prefix += "enabledApiLayerNames";
-            std::ostringstream oss_enabledApiLayerNames_array;
-            oss_enabledApiLayerNames_array << "0x" << std::hex << (info->enabledApiLayerNames);
-            contents.emplace_back("const char* const*", enabledapilayernames_prefix, oss_enabledApiLayerNames_array.str());
-            for (uint32_t i = 0; i < info->enabledApiLayerCount; ++i) {
-                std::string prefix = enabledapilayernames_prefix + "[" + std::to_string(i) + "]";
-                contents.emplace_back("const char* const*", prefix, info->enabledApiLayerNames[i]);
-            }
-            std::string enabledextensioncount_prefix = info_prefix;
-            enabledextensioncount_prefix += "enabledExtensionCount";
-            std::ostringstream oss_enabledExtensionCount;
-            oss_enabledExtensionCount << "0x" << std::hex << (info->enabledExtensionCount);
-            contents.emplace_back("uint32_t", enabledextensioncount_prefix, oss_enabledExtensionCount.str());
-            std::string enabledextensionnames_prefix = info_prefix;
-            enabledextensionnames_prefix += "enabledExtensionNames";
-            std::ostringstream oss_enabledExtensionNames_array;
-            oss_enabledExtensionNames_array << "0x" << std::hex << (info->enabledExtensionNames);
-            contents.emplace_back("const char* const*", enabledextensionnames_prefix, oss_enabledExtensionNames_array.str());
-            for (uint32_t ii = 0; ii < info->enabledExtensionCount; ++ii) {
-                std::string prefix = enabledextensionnames_prefix + "[" + std::to_string(ii) + "]";
-                contents.emplace_back("const char* const*", prefix, info->enabledExtensionNames[ii]);
-            }
+        // The capture record is finished once the instance has been created.  Nothing can have been named yet, so
+        // the call is never dumped when only calls touching named objects are.
+        bool dumping = ApiDumpLayerShouldDump(API_DUMP_COMMAND_xrCreateInstance) && !ApiDumpLayerFilteringObjects();
+        std::string record;
+        if (dumping && ApiDumpLayerCapturing()) {
+            ApiDumpCaptureBeginRecord(record, "xrCreateInstance");
+            ApiDumpCaptureWrite(record, &info, sizeof(info));
+            ApiDumpCaptureWrite(record, &instance, sizeof(instance));
+            ApiDumpCaptureTypedStruct(record, info, sizeof(XrInstanceCreateInfo));
+        } else if (dumping) {
+            // Generate output for this command as if it were the standard xrCreateInstance
+            ApiDumpScopedContents scoped_contents;
+            ApiDumpContents &contents = scoped_contents.Get();
+            ApiDumpLayerCreateInstanceContents(info, instance, contents);
+            ApiDumpLayerRecordContent(contents);
         }
 
-        contents.emplace_back("XrInstance*", "instance", PointerToHexString(instance));
-        ApiDumpLayerRecordContent(contents);
-
         // Copy the contents of the layer info struct, but then move the next info up by
         // one slot so that the next layer gets information.
         memcpy(&new_api_layer_info, apiLayerInfo, sizeof(XrApiLayerCreateInfo));
@@ -533,15 +1455,23 @@ XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateApiLayerInstance(const XrInst
 
         // Create the instance
         XrInstance returned_instance = *instance;
+        uint64_t trace_begin_ns = dumping ? ApiDumpLayerTraceBegin() : 0;
         XrResult result = next_create_api_layer_instance(info, &new_api_layer_info, &returned_instance);
+        ApiDumpLayerRecordTrace(API_DUMP_COMMAND_xrCreateInstance, MakeHandleGeneric(returned_instance), trace_begin_ns);
         *instance = returned_instance;
+        if (!record.empty()) {
+            ApiDumpCaptureWrite(record, &result, sizeof(result));
+            ApiDumpCaptureWriteBlock(record, XR_SUCCEEDED(result) ? instance : nullptr, sizeof(XrInstance));
+            ApiDumpLayerRecordCapture(std::move(record));
+        }
 
         // Create the dispatch table to the next levels
         auto *next_dispatch = new XrGeneratedDispatchTable();
         GeneratedXrPopulateDispatchTable(next_dispatch, returned_instance, next_get_instance_proc_addr);
 
-        std::unique_lock<std::mutex> mlock(g_instance_dispatch_mutex);
+        std::unique_lock<std::shared_timed_mutex> mlock(g_instance_dispatch_mutex);
         g_instance_dispatch_map[returned_instance] = next_dispatch;
+        g_dispatch_instance_map[next_dispatch] = returned_instance;
 
         return result;
     } catch (...) {
@@ -550,32 +1480,348 @@ XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateApiLayerInstance(const XrInst
 }
 
 XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrDestroyInstance(XrInstance instance) {
-    // Generate output for this command
-    std::vector<std::tuple<std::string, std::string, std::string>> contents;
-    contents.emplace_back("XrResult", "xrDestroyInstance", "");
-    contents.emplace_back("XrInstance", "instance", HandleToHexString(instance));
-    ApiDumpLayerRecordContent(contents);
+    bool dumping = ApiDumpLayerShouldDump(API_DUMP_COMMAND_xrDestroyInstance);
+    if (dumping && ApiDumpLayerFilteringObjects()) {
+        dumping = ApiDumpLayerIsFilteredObject(MakeHandleGeneric(instance), XR_OBJECT_TYPE_INSTANCE);
+    }
+
+    // The capture record is finished once the instance has been destroyed.
+    std::string record;
+    if (dumping && ApiDumpLayerCapturing()) {
+        ApiDumpCaptureBeginRecord(record, "xrDestroyInstance");
+        ApiDumpCaptureWrite(record, &instance, sizeof(instance));
+    } else if (dumping) {
+        // Generate output for this command
+        ApiDumpScopedContents scoped_contents;
+        ApiDumpContents &contents = scoped_contents.Get();
+        ApiDumpLayerDestroyInstanceContents(instance, contents);
+        ApiDumpLayerRecordContent(contents);
+    }
 
-    std::unique_lock<std::mutex> mlock(g_instance_dispatch_mutex);
+    std::unique_lock<std::shared_timed_mutex> mlock(g_instance_dispatch_mutex);
     XrGeneratedDispatchTable *next_dispatch = nullptr;
     auto map_iter = g_instance_dispatch_map.find(instance);
     if (map_iter != g_instance_dispatch_map.end()) {
         next_dispatch = map_iter->second;
+        g_dispatch_instance_map.erase(next_dispatch);
     }
     mlock.unlock();
 
+    XrResult result = XR_ERROR_HANDLE_INVALID;
+    if (nullptr != next_dispatch) {
+        uint64_t trace_begin_ns = dumping ? ApiDumpLayerTraceBegin() : 0;
+        result = next_dispatch->DestroyInstance(instance);
+        ApiDumpLayerRecordTrace(API_DUMP_COMMAND_xrDestroyInstance, MakeHandleGeneric(instance), trace_begin_ns);
+    }
+    if (!record.empty()) {
+        ApiDumpCaptureWrite(record, &result, sizeof(result));
+        ApiDumpLayerRecordCapture(std::move(record));
+    }
     if (nullptr == next_dispatch) {
-        return XR_ERROR_HANDLE_INVALID;
+        return result;
     }
 
-    next_dispatch->DestroyInstance(instance);
     ApiDumpCleanUpMapsForTable(next_dispatch);
+    ApiDumpLayerRemoveObjectName(MakeHandleGeneric(instance), XR_OBJECT_TYPE_INSTANCE);
+
+    std::shared_lock<std::shared_timed_mutex> empty_lock(g_instance_dispatch_mutex);
+    bool last_instance = g_instance_dispatch_map.empty();
+    empty_lock.unlock();
+
+    // Everything queued must be written before the footer
+    if (last_instance) {
+        g_async_writer.Stop();
+    }
 
     // Write out the HTML footer if we destroy the last instance
-    if (g_instance_dispatch_map.empty() && g_record_info.type == RECORD_HTML_FILE) {
+    if (last_instance && g_record_info.type == RECORD_HTML_FILE) {
         ApiDumpLayerWriteHtmlFooter();
     }
-    return XR_SUCCESS;
+
+    // Write out the trace so far.  It is closed when the layer is unloaded.
+    if (last_instance && g_record_info.type == RECORD_TRACE_FILE) {
+        ApiDumpLayerFlushTrace();
+    }
+
+    // And report the statistics so far
+    if (last_instance && g_record_info.type == RECORD_STATS) {
+        ApiDumpLayerWriteStatsReport();
+    }
+    return result;
+}
+
+// Rebuild the parameters of the commands the layer implements by hand.
+static bool ApiDumpLayerDecodeManualCommand(ApiDumpCaptureReader &reader, const std::string &command_name,
+                                            ApiDumpContents &contents) {
+    if (command_name == "xrCreateInstance") {
+        const XrInstanceCreateInfo *info = nullptr;
+        XrInstance *instance = nullptr;
+        reader.Read(&info, sizeof(info));
+        reader.Read(&instance, sizeof(instance));
+        info = reinterpret_cast<const XrInstanceCreateInfo *>(ApiDumpRestoreTypedStruct(reader));
+        ApiDumpLayerCreateInstanceContents(info, instance, contents);
+        return true;
+    }
+    if (command_name == "xrDestroyInstance") {
+        XrInstance instance = XR_NULL_HANDLE;
+        reader.Read(&instance, sizeof(instance));
+        ApiDumpLayerDestroyInstanceContents(instance, contents);
+        return true;
+    }
+    return false;
+}
+
+// Load a binary capture, checking that it was written on a machine like this one.
+static bool ApiDumpLayerLoadCapture(const std::string &capture_file_name, std::string &capture) {
+    std::ifstream capture_file(capture_file_name, std::ios::in | std::ios::binary);
+    if (!capture_file.is_open()) {
+        return false;
+    }
+    capture.assign((std::istreambuf_iterator<char>(capture_file)), std::istreambuf_iterator<char>());
+    ApiDumpCaptureHeader header = {};
+    if (capture.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, capture.data(), sizeof(header));
+    return 0 == memcmp(header.magic, kApiDumpCaptureMagic, sizeof(header.magic)) && header.version == kApiDumpCaptureVersion &&
+           header.pointer_size == sizeof(void *);
+}
+
+// Hand each record of a loaded capture to process_record, along with its command name.  Returns false if any record
+// is cut short, which happens to the last one if the application stopped while it was being written, or if
+// process_record fails or throws for any of them.
+template <typename ProcessRecord>
+static bool ApiDumpLayerProcessCapture(const std::string &capture, ProcessRecord process_record) {
+    bool success = true;
+    size_t offset = sizeof(ApiDumpCaptureHeader);
+    while (offset < capture.size()) {
+        uint32_t record_size = 0;
+        if (capture.size() - offset < sizeof(record_size)) {
+            return false;
+        }
+        memcpy(&record_size, &capture[offset], sizeof(record_size));
+        offset += sizeof(record_size);
+        if (capture.size() - offset < record_size) {
+            return false;
+        }
+        ApiDumpCaptureReader reader(&capture[offset], record_size);
+        offset += record_size;
+        try {
+            std::string command_name = reader.ReadString();
+            if (!process_record(reader, command_name)) {
+                success = false;
+            }
+        } catch (...) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+// Write out the text or HTML for one record of a binary capture or ring.
+static bool ApiDumpLayerDecodeRecord(ApiDumpCaptureReader &reader, const std::string &command_name) {
+    if (command_name.empty()) {
+        uint64_t dropped = 0;
+        reader.Read(&dropped, sizeof(dropped));
+        std::unique_lock<std::mutex> mlock(g_record_mutex);
+        if (g_record_info.type == RECORD_TEXT_COUT) {
+            std::cout << ApiDumpLayerDroppedRecordsNote(g_record_info.type, dropped);
+        } else {
+            std::ofstream output_file(g_record_info.file_name, std::ios::out | std::ios::app);
+            output_file << ApiDumpLayerDroppedRecordsNote(g_record_info.type, dropped);
+        }
+        return true;
+    }
+    ApiDumpScopedContents scoped_contents;
+    ApiDumpContents &contents = scoped_contents.Get();
+    if (!ApiDumpLayerDecodeManualCommand(reader, command_name, contents) &&
+        !ApiDumpDecodeCapturedCommand(reader, command_name, contents)) {
+        // Recorded by a layer that knows about more commands than this one.
+        return false;
+    }
+    ApiDumpLayerRecordContent(contents);
+    return true;
+}
+
+// Decode a binary capture into the text or HTML output the layer would have written while the application ran.
+// Text goes to standard out if no output file is given.  Returns false if the capture can't be read, or if any
+// record in it could not be decoded.
+bool ApiDumpLayerDecodeCapture(const std::string &capture_file_name, const std::string &output_file_name, bool html) {
+    std::string capture;
+    if ((html && output_file_name.empty()) || !ApiDumpLayerLoadCapture(capture_file_name, capture)) {
+        return false;
+    }
+
+    g_record_info.initialized = true;
+    g_record_info.file_name = output_file_name;
+    if (html) {
+        g_record_info.type = RECORD_HTML_FILE;
+        if (!ApiDumpLayerWriteHtmlHeader()) {
+            return false;
+        }
+    } else if (output_file_name.empty()) {
+        g_record_info.type = RECORD_TEXT_COUT;
+    } else {
+        g_record_info.type = RECORD_TEXT_FILE;
+        std::ofstream text_file(output_file_name, std::ios::out | std::ios::trunc);
+        if (!text_file.is_open()) {
+            return false;
+        }
+    }
+
+    bool success = ApiDumpLayerProcessCapture(capture, ApiDumpLayerDecodeRecord);
+
+    if (html) {
+        ApiDumpLayerWriteHtmlFooter();
+    }
+    g_record_info.initialized = false;
+    g_record_info.type = RECORD_NONE;
+    return success;
+}
+
+// Write out the records in a ring file as text on standard out.  If seconds is not 0, only the records from that
+// long before the newest one are shown.  With follow, keeps waiting for new records, like "tail -f".  Records that
+// are overwritten before they can be read are skipped with a note.  Returns false if the ring can't be opened, or
+// if any record in it could not be decoded.
+bool ApiDumpLayerViewRing(const std::string &ring_file_name, double seconds, bool follow) {
+    ApiDumpRing ring;
+    if (!ring.Open(ring_file_name)) {
+        return false;
+    }
+    g_record_info.initialized = true;
+    g_record_info.type = RECORD_TEXT_COUT;
+
+    std::string record;
+    uint64_t timestamp_ns = 0;
+    uint64_t offset = ring.OldestOffset();
+    if (seconds > 0) {
+        // Walk the records already there to find the first one recent enough
+        std::vector<std::pair<uint64_t, uint64_t>> record_times;
+        uint64_t write_offset = ring.WriteOffset();
+        uint64_t read_offset = offset;
+        while (read_offset < write_offset) {
+            uint64_t record_offset = read_offset;
+            if (!ring.Read(read_offset, timestamp_ns, record)) {
+                record_times.clear();
+                read_offset = ring.OldestOffset();
+                continue;
+            }
+            record_times.emplace_back(record_offset, timestamp_ns);
+        }
+        if (!record_times.empty()) {
+            uint64_t window_ns = static_cast<uint64_t>(seconds * 1000000000.0);
+            uint64_t newest_ns = record_times.back().second;
+            offset = record_times.back().first;
+            for (const auto &record_time : record_times) {
+                if (record_time.second + window_ns >= newest_ns) {
+                    offset = record_time.first;
+                    break;
+                }
+            }
+        }
+    }
+
+    bool success = true;
+    for (;;) {
+        uint64_t write_offset = ring.WriteOffset();
+        while (offset < write_offset) {
+            if (!ring.Read(offset, timestamp_ns, record)) {
+                uint64_t oldest_offset = ring.OldestOffset();
+                std::cout << "// " << (oldest_offset - offset) << " bytes of records overwritten before they were read\n";
+                offset = oldest_offset;
+                continue;
+            }
+            try {
+                ApiDumpCaptureReader reader(record.data(), record.size());
+                const char *command_name = reader.ReadString();
+                if (nullptr == command_name || !ApiDumpLayerDecodeRecord(reader, command_name)) {
+                    success = false;
+                }
+            } catch (...) {
+                success = false;
+            }
+        }
+        if (!follow) {
+            break;
+        }
+        std::cout.flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    g_record_info.initialized = false;
+    g_record_info.type = RECORD_NONE;
+    return success;
+}
+
+// Re-issue the commands the layer implements by hand.
+static bool ApiDumpLayerReplayManualCommand(ApiDumpCaptureReader &reader, const std::string &command_name,
+                                            ApiDumpReplayState &replay_state) {
+    if (command_name == "xrCreateInstance") {
+        const XrInstanceCreateInfo *info = nullptr;
+        XrInstance *instance = nullptr;
+        reader.Read(&info, sizeof(info));
+        reader.Read(&instance, sizeof(instance));
+        info = reinterpret_cast<const XrInstanceCreateInfo *>(ApiDumpRestoreTypedStruct(reader));
+        XrResult captured_result = XR_SUCCESS;
+        reader.Read(&captured_result, sizeof(captured_result));
+        size_t captured_instance_size = 0;
+        auto captured_instance = reinterpret_cast<XrInstance *>(reader.ReadBlock(&captured_instance_size));
+
+        PFN_xrCreateInstance create_instance = nullptr;
+        XrResult result = replay_state.GetInstanceProcAddr()(XR_NULL_HANDLE, "xrCreateInstance",
+                                                             reinterpret_cast<PFN_xrVoidFunction *>(&create_instance));
+        if (XR_FAILED(result) || nullptr == create_instance) {
+            return false;
+        }
+        ApiDumpReplayRemapTypedStruct(replay_state, info);
+        XrInstance replay_instance = XR_NULL_HANDLE;
+        uint64_t begin_ns = replay_state.BeginCall();
+        result = create_instance(info, &replay_instance);
+        replay_state.EndCall(begin_ns, result, captured_result);
+        if (XR_SUCCEEDED(result) && nullptr != captured_instance) {
+            ApiDumpCaptureCheckSize(captured_instance_size, sizeof(XrInstance));
+            replay_state.AddInstance(*captured_instance, replay_instance);
+        }
+        return true;
+    }
+    if (command_name == "xrDestroyInstance") {
+        XrInstance instance = XR_NULL_HANDLE;
+        reader.Read(&instance, sizeof(instance));
+        XrResult captured_result = XR_SUCCESS;
+        reader.Read(&captured_result, sizeof(captured_result));
+
+        XrGeneratedDispatchTable *replay_table = replay_state.DispatchTable("XrInstance", instance);
+        if (nullptr == replay_table) {
+            replay_state.Skip();
+            return true;
+        }
+        XrInstance replay_instance = instance;
+        replay_state.Remap("XrInstance", replay_instance);
+        uint64_t begin_ns = replay_state.BeginCall();
+        XrResult result = replay_table->DestroyInstance(replay_instance);
+        replay_state.EndCall(begin_ns, result, captured_result);
+        replay_state.RemoveInstance(instance);
+        return true;
+    }
+    // Function pointers come from the dispatch tables instead
+    return command_name == "xrGetInstanceProcAddr";
+}
+
+// Re-issue the commands in a binary capture, in the order they were recorded, through the xrGetInstanceProcAddr the
+// replay state was created with.  Dropped records are skipped.  Returns false if the capture can't be read, or if
+// any record in it could not be replayed.
+bool ApiDumpLayerReplayCapture(const std::string &capture_file_name, ApiDumpReplayState &replay_state) {
+    std::string capture;
+    if (!ApiDumpLayerLoadCapture(capture_file_name, capture)) {
+        return false;
+    }
+    return ApiDumpLayerProcessCapture(capture, [&replay_state](ApiDumpCaptureReader &reader, const std::string &command_name) {
+        if (command_name.empty()) {
+            return true;
+        }
+        return ApiDumpLayerReplayManualCommand(reader, command_name, replay_state) ||
+               ApiDumpReplayCapturedCommand(reader, command_name, replay_state);
+    });
 }
 
 extern "C" {
@@ -0,0 +1,134 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef API_DUMP_CAPTURE_H_
+#define API_DUMP_CAPTURE_H_ 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Binary capture format -
+// A capture file starts with an ApiDumpCaptureHeader and is followed by one record per command.  A record is a
+// uint32_t byte count and then the record itself: the command name as a string block, the raw bytes of every
+// parameter, and then everything those parameters point to, in parameter and member order.  Memory that is
+// pointed to is written as a block, which is a uint32_t byte count followed by the bytes.  A null pointer is
+// written as a count of kApiDumpCaptureNullBlock with no bytes.  A structure whose type is given by its
+// XrStructureType is written with the size of that type, so it can be rebuilt without knowing the type up front.
+// Except for xrGetInstanceProcAddr, records are written once the command returns, and end with its XrResult and a
+// block for each parameter that returned handles or atoms, so a replay can match them up with the ones it gets back.
+// The capture is raw memory, so it can only be decoded on a machine with the same pointer size and byte order.
+
+struct ApiDumpCaptureHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t pointer_size;
+};
+
+static const char kApiDumpCaptureMagic[8] = {'X', 'R', 'A', 'P', 'I', 'D', 'M', 'P'};
+static const uint32_t kApiDumpCaptureVersion = 2;
+static const uint32_t kApiDumpCaptureNullBlock = UINT32_MAX;
+
+inline void ApiDumpCaptureWrite(std::string &record, const void *data, size_t size) {
+    record.append(reinterpret_cast<const char *>(data), size);
+}
+
+inline void ApiDumpCaptureWriteBlock(std::string &record, const void *data, size_t size) {
+    uint32_t block_size = nullptr == data ? kApiDumpCaptureNullBlock : static_cast<uint32_t>(size);
+    ApiDumpCaptureWrite(record, &block_size, sizeof(block_size));
+    if (nullptr != data) {
+        ApiDumpCaptureWrite(record, data, size);
+    }
+}
+
+inline void ApiDumpCaptureWriteString(std::string &record, const char *value) {
+    ApiDumpCaptureWriteBlock(record, value, nullptr == value ? 0 : strlen(value) + 1);
+}
+
+// Leaves room for the record size, which is filled in by ApiDumpCaptureEndRecord.
+inline void ApiDumpCaptureBeginRecord(std::string &record, const char *command_name) {
+    record.reserve(256);
+    record.assign(sizeof(uint32_t), '\0');
+    ApiDumpCaptureWriteString(record, command_name);
+}
+
+inline void ApiDumpCaptureEndRecord(std::string &record) {
+    uint32_t record_size = static_cast<uint32_t>(record.size() - sizeof(uint32_t));
+    std::memcpy(&record[0], &record_size, sizeof(record_size));
+}
+
+// Throws if a block read back from a capture is smaller than the memory that is about to be read from it.
+inline void ApiDumpCaptureCheckSize(size_t size, size_t expected) {
+    if (size < expected) {
+        throw std::out_of_range("Capture block is too small");
+    }
+}
+
+// ApiDumpCaptureReader class -
+// Reads the parameters back out of one capture record.  Blocks are copied into memory owned by the reader so that
+// the pointers in the rebuilt structures stay valid until the reader is destroyed.
+class ApiDumpCaptureReader {
+   public:
+    ApiDumpCaptureReader(const char *data, size_t size) : _data(data), _size(size) {}
+
+    // Throws std::out_of_range if the record is too short.
+    void Read(void *value, size_t size) {
+        if (_size - _offset < size) {
+            throw std::out_of_range("Capture record is truncated");
+        }
+        std::memcpy(value, _data + _offset, size);
+        _offset += size;
+    }
+
+    // Returns nullptr for a null block.  The copy is always followed by at least one zero byte.
+    void *ReadBlock(size_t *size = nullptr) {
+        uint32_t block_size = 0;
+        Read(&block_size, sizeof(block_size));
+        if (nullptr != size) {
+            *size = 0;
+        }
+        if (block_size == kApiDumpCaptureNullBlock) {
+            return nullptr;
+        }
+        void *block = Allocate(block_size);
+        Read(block, block_size);
+        if (nullptr != size) {
+            *size = block_size;
+        }
+        return block;
+    }
+
+    const char *ReadString() { return static_cast<const char *>(ReadBlock()); }
+
+    // Zero-filled and aligned for any structure.
+    void *Allocate(size_t size) {
+        _storage.emplace_back(new uint64_t[size / sizeof(uint64_t) + 1]());
+        return _storage.back().get();
+    }
+
+   private:
+    const char *_data;
+    size_t _size;
+    size_t _offset = 0;
+    std::vector<std::unique_ptr<uint64_t[]>> _storage;
+};
+
+#endif  // API_DUMP_CAPTURE_H_
@@ -0,0 +1,301 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef API_DUMP_CONTENTS_H_
+#define API_DUMP_CONTENTS_H_ 1
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// ApiDumpContentView struct -
+// A non-owning view of some characters, used both for the pieces handed to ApiDumpContents and for reading each
+// entry back out of it.  The characters are only valid until the next entry is added or the contents are cleared.
+struct ApiDumpContentView {
+    ApiDumpContentView() = default;
+    ApiDumpContentView(const char *value) : data(value), size(nullptr == value ? 0 : strlen(value)) {}
+    ApiDumpContentView(const std::string &value) : data(value.data()), size(value.size()) {}
+    ApiDumpContentView(const char *value, size_t value_size) : data(value), size(value_size) {}
+
+    bool empty() const { return 0 == size; }
+    const char *begin() const { return data; }
+    const char *end() const { return data + size; }
+    bool StartsWith(ApiDumpContentView prefix) const {
+        return prefix.size <= size && 0 == std::memcmp(data, prefix.data, prefix.size);
+    }
+    bool Contains(const char *text) const {
+        size_t text_size = strlen(text);
+        for (size_t offset = 0; offset + text_size <= size; ++offset) {
+            if (0 == std::memcmp(data + offset, text, text_size)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    size_t Count(const char *text) const {
+        size_t text_size = strlen(text);
+        size_t count = 0;
+        for (size_t offset = 0; offset + text_size <= size;) {
+            if (0 == std::memcmp(data + offset, text, text_size)) {
+                ++count;
+                offset += text_size;
+            } else {
+                ++offset;
+            }
+        }
+        return count;
+    }
+    ApiDumpContentView Suffix(size_t offset) const { return {data + offset, offset < size ? size - offset : 0}; }
+
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+inline std::ostream &operator<<(std::ostream &out, ApiDumpContentView view) {
+    return out.write(view.data, static_cast<std::streamsize>(view.size));
+}
+
+// ApiDumpContentName struct -
+// The name of an entry, given as a prefix and the member name so the two are only joined inside the contents.
+struct ApiDumpContentName {
+    ApiDumpContentName(const char *name) : prefix(name) {}
+    ApiDumpContentName(const std::string &name) : prefix(name) {}
+    ApiDumpContentName(ApiDumpContentView name_prefix, ApiDumpContentView name) : prefix(name_prefix), member(name) {}
+
+    ApiDumpContentView prefix;
+    ApiDumpContentView member;
+};
+
+// ApiDumpContents class -
+// The type, name and value of every parameter and member dumped for one command.  All of the characters are
+// formatted straight into one buffer and each entry only records where its pieces are, so once a thread has
+// dumped a few commands, dumping another one does not allocate at all.
+class ApiDumpContents {
+   public:
+    size_t size() const { return _entries.size(); }
+    // Roughly the number of bytes the entries take up once written out.
+    size_t ByteCount() const { return _buffer.size() + 4 * _entries.size(); }
+    void clear() {
+        _buffer.clear();
+        _entries.clear();
+    }
+
+    ApiDumpContentView Type(size_t index) const { return View(_entries[index].type); }
+    ApiDumpContentView Name(size_t index) const { return View(_entries[index].name); }
+    ApiDumpContentView Value(size_t index) const { return View(_entries[index].value); }
+
+    // Adds an entry whose value is already a string.
+    void emplace_back(ApiDumpContentView type, ApiDumpContentName name, ApiDumpContentView value) {
+        Entry &entry = BeginEntry(type, name);
+        Append(value);
+        EndValue(entry);
+    }
+
+    // Adds an entry for a pointer or handle, written the way an std::ostream writes a const void*.
+    void AddPointer(ApiDumpContentView type, ApiDumpContentName name, const void *value) {
+        Entry &entry = BeginEntry(type, name);
+        if (nullptr == value) {
+            Append('0');
+        } else {
+            Append("0x");
+            AppendHex(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+        }
+        EndValue(entry);
+    }
+
+    // Adds an entry for a handle, written like a pointer and followed by the object's name in parentheses if it has one.
+    void AddHandle(ApiDumpContentView type, ApiDumpContentName name, uint64_t handle, ApiDumpContentView object_name) {
+        Entry &entry = BeginEntry(type, name);
+        if (0 == handle) {
+            Append('0');
+        } else {
+            Append("0x");
+            AppendHex(handle);
+        }
+        if (!object_name.empty()) {
+            Append(" (");
+            Append(object_name);
+            Append(')');
+        }
+        EndValue(entry);
+    }
+
+    // Adds an entry for the raw bytes of a value, written the same way as to_hex in hex_and_handles.h.
+    template <typename T>
+    void AddBytes(ApiDumpContentView type, ApiDumpContentName name, const T &value) {
+        static const char hex_digits[] = "0123456789abcdef";
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+        Entry &entry = BeginEntry(type, name);
+        Append("0x");
+        for (size_t index = sizeof(T); index > 0; --index) {
+            Append(hex_digits[(bytes[index - 1] >> 4) & 0xf]);
+            Append(hex_digits[bytes[index - 1] & 0xf]);
+        }
+        EndValue(entry);
+    }
+
+    // Adds an entry for an integer or enum written in hexadecimal, optionally preceded by "0x".  A pointer is
+    // written as a pointer, as it would be by an std::ostream.
+    template <typename T>
+    void AddHex(ApiDumpContentView type, ApiDumpContentName name, T value, bool show_base) {
+        auto promoted = +value;
+        Entry &entry = BeginEntry(type, name);
+        if (show_base) {
+            Append("0x");
+        }
+        AppendHex(static_cast<typename std::make_unsigned<decltype(promoted)>::type>(promoted));
+        EndValue(entry);
+    }
+    template <typename T>
+    void AddHex(ApiDumpContentView type, ApiDumpContentName name, T *value, bool /*show_base*/) {
+        AddPointer(type, name, value);
+    }
+
+    // Adds an entry for an integer or enum written in decimal, as std::to_string would write it.
+    template <typename T>
+    void AddDecimal(ApiDumpContentView type, ApiDumpContentName name, T value) {
+        auto promoted = +value;
+        Entry &entry = BeginEntry(type, name);
+        AppendDecimal(promoted, std::is_signed<decltype(promoted)>());
+        EndValue(entry);
+    }
+
+    // Adds an entry for a floating point value written with the given precision, as an std::ostream would
+    // write it after std::setprecision.  A pointer is written as a pointer.
+    void AddFloat(ApiDumpContentView type, ApiDumpContentName name, double value, int precision) {
+        char digits[128];
+        int length = snprintf(digits, sizeof(digits), "%.*g", precision, value);
+        Entry &entry = BeginEntry(type, name);
+        Append({digits, length < 0 ? 0 : std::min(static_cast<size_t>(length), sizeof(digits) - 1)});
+        EndValue(entry);
+    }
+    template <typename T>
+    void AddFloat(ApiDumpContentView type, ApiDumpContentName name, T *value, int /*precision*/) {
+        AddPointer(type, name, value);
+    }
+
+   private:
+    struct Range {
+        size_t offset;
+        size_t size;
+    };
+    struct Entry {
+        Range type;
+        Range name;
+        Range value;
+    };
+
+    ApiDumpContentView View(const Range &range) const { return {_buffer.data() + range.offset, range.size}; }
+
+    void Append(char value) { _buffer.push_back(value); }
+    void Append(ApiDumpContentView value) { _buffer.append(value.data, value.size); }
+
+    Entry &BeginEntry(ApiDumpContentView type, const ApiDumpContentName &name) {
+        _entries.emplace_back();
+        Entry &entry = _entries.back();
+        entry.type.offset = _buffer.size();
+        Append(type);
+        entry.type.size = _buffer.size() - entry.type.offset;
+        entry.name.offset = _buffer.size();
+        Append(name.prefix);
+        Append(name.member);
+        entry.name.size = _buffer.size() - entry.name.offset;
+        entry.value.offset = _buffer.size();
+        return entry;
+    }
+
+    void EndValue(Entry &entry) { entry.value.size = _buffer.size() - entry.value.offset; }
+
+    void AppendHex(uint64_t value) {
+        static const char hex_digits[] = "0123456789abcdef";
+        char digits[16];
+        size_t count = 0;
+        do {
+            digits[count++] = hex_digits[value & 0xf];
+            value >>= 4;
+        } while (0 != value);
+        while (count > 0) {
+            Append(digits[--count]);
+        }
+    }
+
+    void AppendDecimal(uint64_t value, std::false_type /*is_signed*/) {
+        char digits[20];
+        size_t count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (0 != value);
+        while (count > 0) {
+            Append(digits[--count]);
+        }
+    }
+
+    void AppendDecimal(int64_t value, std::true_type /*is_signed*/) {
+        if (value < 0) {
+            Append('-');
+            AppendDecimal(0 - static_cast<uint64_t>(value), std::false_type());
+        } else {
+            AppendDecimal(static_cast<uint64_t>(value), std::false_type());
+        }
+    }
+
+    std::string _buffer;
+    std::vector<Entry> _entries;
+};
+
+// ApiDumpScopedContents class -
+// Hands out the calling thread's ApiDumpContents, cleared but keeping the memory from earlier commands.  Each
+// nested use on the same thread, such as a layer below calling back into the loader, gets its own contents.
+class ApiDumpScopedContents {
+   public:
+    ApiDumpScopedContents() {
+        ThreadPool &pool = GetThreadPool();
+        if (pool.depth == pool.contents.size()) {
+            pool.contents.emplace_back(new ApiDumpContents());
+        }
+        _contents = pool.contents[pool.depth++].get();
+        _contents->clear();
+    }
+    ~ApiDumpScopedContents() { --GetThreadPool().depth; }
+    ApiDumpScopedContents(const ApiDumpScopedContents &) = delete;
+    ApiDumpScopedContents &operator=(const ApiDumpScopedContents &) = delete;
+
+    ApiDumpContents &Get() { return *_contents; }
+
+   private:
+    struct ThreadPool {
+        size_t depth = 0;
+        std::vector<std::unique_ptr<ApiDumpContents>> contents;
+    };
+
+    static ThreadPool &GetThreadPool() {
+        static thread_local ThreadPool pool;
+        return pool;
+    }
+
+    ApiDumpContents *_contents;
+};
+
+#endif  // API_DUMP_CONTENTS_H_
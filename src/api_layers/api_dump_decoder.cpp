@@ -0,0 +1,54 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Turns a binary capture written by the api_dump layer (XR_API_DUMP_EXPORT_TYPE=binary) into the layer's
+// text or HTML output.
+
+#include "xr_generated_api_dump.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    bool html = false;
+    std::string capture_file_name;
+    std::string output_file_name;
+    for (int arg = 1; arg < argc; ++arg) {
+        if (0 == strcmp(argv[arg], "--html")) {
+            html = true;
+        } else if (capture_file_name.empty()) {
+            capture_file_name = argv[arg];
+        } else if (output_file_name.empty()) {
+            output_file_name = argv[arg];
+        } else {
+            capture_file_name.clear();
+            break;
+        }
+    }
+    if (capture_file_name.empty() || (html && output_file_name.empty())) {
+        std::cerr << "Usage: " << argv[0] << " [--html] <capture file> [output file]" << std::endl
+                  << "    Text is written to standard out if no output file is given." << std::endl;
+        return -1;
+    }
+
+    if (!ApiDumpLayerDecodeCapture(capture_file_name, output_file_name, html)) {
+        std::cerr << "Unable to decode all of " << capture_file_name << std::endl;
+        return -1;
+    }
+    return 0;
+}
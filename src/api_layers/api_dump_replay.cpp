@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Re-issues the commands in a binary capture written by the api_dump layer (XR_API_DUMP_EXPORT_TYPE=binary) through
+// the loader, so that the loader, any enabled API layers and the runtime can be run without the application.
+
+#include "xr_generated_api_dump.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    unsigned long repeat_count = 1;
+    std::string capture_file_name;
+    bool valid_arguments = true;
+    for (int arg = 1; arg < argc && valid_arguments; ++arg) {
+        if (0 == strcmp(argv[arg], "--repeat") && arg + 1 < argc) {
+            repeat_count = strtoul(argv[++arg], nullptr, 10);
+            valid_arguments = repeat_count > 0;
+        } else if (capture_file_name.empty()) {
+            capture_file_name = argv[arg];
+        } else {
+            valid_arguments = false;
+        }
+    }
+    if (!valid_arguments || capture_file_name.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--repeat <count>] <capture file>" << std::endl
+                  << "    Replays the capture through the loader <count> times, from creating the instance on." << std::endl;
+        return -1;
+    }
+
+    int result = 0;
+    for (unsigned long pass = 1; pass <= repeat_count; ++pass) {
+        ApiDumpReplayState replay_state(xrGetInstanceProcAddr);
+        if (!ApiDumpLayerReplayCapture(capture_file_name, replay_state)) {
+            std::cerr << "Unable to replay all of " << capture_file_name << std::endl;
+            result = -1;
+        }
+        std::cout << "Pass " << pass << ": " << replay_state.CommandCount() << " commands in " << std::fixed
+                  << std::setprecision(3) << static_cast<double>(replay_state.CallNanoseconds()) / 1000000.0 << " ms, "
+                  << replay_state.SkippedCount() << " skipped, " << replay_state.MismatchCount() << " results differed, "
+                  << replay_state.UnmappedCount() << " unknown handles" << std::endl;
+        if (0 != result) {
+            break;
+        }
+    }
+    return result;
+}
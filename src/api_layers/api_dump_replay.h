@@ -0,0 +1,189 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef API_DUMP_REPLAY_H_
+#define API_DUMP_REPLAY_H_ 1
+
+#include "xr_generated_dispatch_table.h"
+
+#include <openxr/openxr.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// ApiDumpReplayState class -
+// Tracks what is needed to re-issue the commands in a binary capture: a dispatch table for each instance created
+// during the replay, and the handles and atoms returned during the replay for each value returned during the
+// capture.  Values are kept per type name, because a runtime is free to reuse the same value for different types.
+class ApiDumpReplayState {
+   public:
+    explicit ApiDumpReplayState(PFN_xrGetInstanceProcAddr get_instance_proc_addr)
+        : _get_instance_proc_addr(get_instance_proc_addr) {}
+
+    // Instances the capture never destroyed, for example because the application stopped early, are destroyed so
+    // that another replay in the same process can create its own.
+    ~ApiDumpReplayState() {
+        for (auto &instance_table : _instance_tables) {
+            const Mapping *mapping = FindMapping("XrInstance", instance_table.first);
+            if (nullptr != mapping && nullptr != instance_table.second->DestroyInstance) {
+                XrInstance live = XR_NULL_HANDLE;
+                std::memcpy(&live, &mapping->live, sizeof(live));
+                instance_table.second->DestroyInstance(live);
+            }
+        }
+    }
+    ApiDumpReplayState(const ApiDumpReplayState &) = delete;
+    ApiDumpReplayState &operator=(const ApiDumpReplayState &) = delete;
+
+    PFN_xrGetInstanceProcAddr GetInstanceProcAddr() const { return _get_instance_proc_addr; }
+
+    // Creates the dispatch table used by every handle created from this instance.
+    XrGeneratedDispatchTable *AddInstance(XrInstance captured, XrInstance live) {
+        std::unique_ptr<XrGeneratedDispatchTable> table(new XrGeneratedDispatchTable());
+        GeneratedXrPopulateDispatchTable(table.get(), live, _get_instance_proc_addr);
+        XrGeneratedDispatchTable *table_ptr = table.get();
+        _instance_tables[ToUint64(captured)] = std::move(table);
+        AddMapping("XrInstance", captured, live, table_ptr);
+        return table_ptr;
+    }
+
+    // Forgets the instance along with every handle created from it.
+    void RemoveInstance(XrInstance captured) {
+        auto table_iter = _instance_tables.find(ToUint64(captured));
+        if (table_iter == _instance_tables.end()) {
+            return;
+        }
+        for (auto &type_mappings : _mappings) {
+            for (auto it = type_mappings.second.begin(); it != type_mappings.second.end();) {
+                if (it->second.table == table_iter->second.get()) {
+                    it = type_mappings.second.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        _instance_tables.erase(table_iter);
+    }
+
+    // Returns the table for the instance a captured handle was created from, or nullptr if it is not known.
+    template <typename T>
+    XrGeneratedDispatchTable *DispatchTable(const char *type_name, T captured) const {
+        const Mapping *mapping = FindMapping(type_name, ToUint64(captured));
+        return nullptr == mapping ? nullptr : mapping->table;
+    }
+
+    template <typename T>
+    void AddMapping(const char *type_name, T captured, T live, XrGeneratedDispatchTable *table) {
+        uint64_t captured_value = ToUint64(captured);
+        if (0 != captured_value) {
+            _mappings[type_name][captured_value] = {ToUint64(live), table};
+        }
+    }
+
+    template <typename T>
+    void RemoveMapping(const char *type_name, T captured) {
+        auto type_iter = _mappings.find(type_name);
+        if (type_iter != _mappings.end()) {
+            type_iter->second.erase(ToUint64(captured));
+        }
+    }
+
+    // Replaces a captured handle or atom with the one returned during the replay.  A value that was never returned
+    // during the replay is left alone, since it may have come from a command that was not captured.
+    template <typename T>
+    void Remap(const char *type_name, T &value) {
+        uint64_t captured_value = ToUint64(value);
+        if (0 == captured_value) {
+            return;
+        }
+        const Mapping *mapping = FindMapping(type_name, captured_value);
+        if (nullptr == mapping) {
+            ++_unmapped_count;
+            return;
+        }
+        std::memcpy(&value, &mapping->live, sizeof(value));
+    }
+
+    template <typename T>
+    void RemapArray(const char *type_name, T *values, uint32_t count) {
+        for (uint32_t index = 0; nullptr != values && index < count; ++index) {
+            Remap(type_name, values[index]);
+        }
+    }
+
+    // Timing only covers the calls made through the loader, not reading the capture back in.
+    uint64_t BeginCall() const {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void EndCall(uint64_t begin_ns, XrResult result, XrResult captured_result) {
+        _call_ns += BeginCall() - begin_ns;
+        ++_command_count;
+        if (result != captured_result) {
+            ++_mismatch_count;
+        }
+    }
+
+    // Called for a command whose first handle was not created during the replay.
+    void Skip() { ++_skipped_count; }
+
+    uint64_t CommandCount() const { return _command_count; }
+    uint64_t SkippedCount() const { return _skipped_count; }
+    uint64_t MismatchCount() const { return _mismatch_count; }
+    uint64_t UnmappedCount() const { return _unmapped_count; }
+    uint64_t CallNanoseconds() const { return _call_ns; }
+
+   private:
+    struct Mapping {
+        uint64_t live;
+        XrGeneratedDispatchTable *table;
+    };
+
+    // Handles and atoms are both 64 bits, even where handles are pointers.
+    template <typename T>
+    static uint64_t ToUint64(T value) {
+        static_assert(sizeof(T) == sizeof(uint64_t), "Only handles and atoms can be remapped");
+        uint64_t result = 0;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+
+    const Mapping *FindMapping(const char *type_name, uint64_t captured_value) const {
+        auto type_iter = _mappings.find(type_name);
+        if (type_iter == _mappings.end()) {
+            return nullptr;
+        }
+        auto mapping_iter = type_iter->second.find(captured_value);
+        return mapping_iter == type_iter->second.end() ? nullptr : &mapping_iter->second;
+    }
+
+    PFN_xrGetInstanceProcAddr _get_instance_proc_addr;
+    std::unordered_map<uint64_t, std::unique_ptr<XrGeneratedDispatchTable>> _instance_tables;
+    std::unordered_map<std::string, std::unordered_map<uint64_t, Mapping>> _mappings;
+    uint64_t _command_count = 0;
+    uint64_t _skipped_count = 0;
+    uint64_t _mismatch_count = 0;
+    uint64_t _unmapped_count = 0;
+    uint64_t _call_ns = 0;
+};
+
+#endif  // API_DUMP_REPLAY_H_
@@ -0,0 +1,237 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef API_DUMP_RING_H_
+#define API_DUMP_RING_H_ 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+
+// Ring file format -
+// A ring file starts with an ApiDumpRingHeader and is followed by ring_size bytes that the records wrap around in,
+// so the file never grows.  Each record is an ApiDumpRingRecordHeader followed by a binary capture record (see
+// api_dump_capture.h) without its leading byte count, padded to a multiple of 8 bytes.  write_offset and
+// oldest_offset count every byte ever written, so offset % ring_size is where a byte is in the ring.
+// The writer moves oldest_offset past the records it is about to overwrite before touching any of their bytes,
+// and only moves write_offset past a new record once all of it is in place.  A reader in another process copies a
+// record out and then checks oldest_offset again, throwing the copy away if the record was overwritten meanwhile.
+
+struct ApiDumpRingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t pointer_size;
+    uint64_t ring_size;
+    std::atomic<uint64_t> write_offset;
+    std::atomic<uint64_t> oldest_offset;
+};
+
+struct ApiDumpRingRecordHeader {
+    uint64_t timestamp_ns;
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+static const char kApiDumpRingMagic[8] = {'X', 'R', 'A', 'P', 'I', 'R', 'N', 'G'};
+static const uint32_t kApiDumpRingVersion = 1;
+static const uint64_t kApiDumpRingHeaderSize = 64;
+
+// ApiDumpRing class -
+// A ring file mapped into memory, either created for writing by the layer or opened read-only by a viewer.  Writes
+// must be serialized by the caller.  Only supported where the file can be mapped with mmap.
+class ApiDumpRing {
+   public:
+    ApiDumpRing() = default;
+    ~ApiDumpRing() { Close(); }
+    ApiDumpRing(const ApiDumpRing &) = delete;
+    ApiDumpRing &operator=(const ApiDumpRing &) = delete;
+
+    bool IsOpen() const { return nullptr != _header; }
+    uint64_t RingSize() const { return _header->ring_size; }
+    uint64_t WriteOffset() const { return _header->write_offset.load(std::memory_order_acquire); }
+    uint64_t OldestOffset() const { return _header->oldest_offset.load(std::memory_order_acquire); }
+
+    // Replaces any existing file with an empty ring.  The size is rounded up to a multiple of 8 bytes.
+    bool Create(const std::string &file_name, uint64_t ring_size) {
+        ring_size = (ring_size + 7) & ~static_cast<uint64_t>(7);
+        if (IsOpen() || 0 == ring_size || !Map(file_name, kApiDumpRingHeaderSize + ring_size, true)) {
+            return false;
+        }
+        memcpy(_header->magic, kApiDumpRingMagic, sizeof(_header->magic));
+        _header->version = kApiDumpRingVersion;
+        _header->pointer_size = static_cast<uint32_t>(sizeof(void *));
+        _header->ring_size = ring_size;
+        _header->oldest_offset.store(0, std::memory_order_relaxed);
+        _header->write_offset.store(0, std::memory_order_release);
+        return true;
+    }
+
+    // Maps an existing ring read-only, checking that it was written on a machine like this one.
+    bool Open(const std::string &file_name) {
+        if (IsOpen() || !Map(file_name, 0, false)) {
+            return false;
+        }
+        if (0 != memcmp(_header->magic, kApiDumpRingMagic, sizeof(_header->magic)) || _header->version != kApiDumpRingVersion ||
+            _header->pointer_size != sizeof(void *) || 0 == _header->ring_size ||
+            _mapped_size < kApiDumpRingHeaderSize + _header->ring_size) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        if (nullptr != _header) {
+            munmap(_header, _mapped_size);
+        }
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        _header = nullptr;
+        _data = nullptr;
+        _mapped_size = 0;
+    }
+
+    // Adds a record, overwriting the oldest ones to make room.  Fails if the record could never fit.
+    bool Write(const char *record, size_t record_size, uint64_t timestamp_ns) {
+        uint64_t entry_size = EntrySize(record_size);
+        if (!IsOpen() || entry_size > _header->ring_size) {
+            return false;
+        }
+        uint64_t write_offset = _header->write_offset.load(std::memory_order_relaxed);
+        uint64_t oldest_offset = _header->oldest_offset.load(std::memory_order_relaxed);
+        while (write_offset + entry_size - oldest_offset > _header->ring_size) {
+            ApiDumpRingRecordHeader oldest = {};
+            CopyOut(oldest_offset, &oldest, sizeof(oldest));
+            oldest_offset += EntrySize(oldest.record_size);
+        }
+        _header->oldest_offset.store(oldest_offset, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        ApiDumpRingRecordHeader record_header = {};
+        record_header.timestamp_ns = timestamp_ns;
+        record_header.record_size = static_cast<uint32_t>(record_size);
+        CopyIn(write_offset, &record_header, sizeof(record_header));
+        CopyIn(write_offset + sizeof(record_header), record, record_size);
+        _header->write_offset.store(write_offset + entry_size, std::memory_order_release);
+        return true;
+    }
+
+    // Copies out the record at offset, which must be below WriteOffset(), and moves offset on to the next one.
+    // Returns false, leaving offset alone, if the record has already been overwritten.
+    bool Read(uint64_t &offset, uint64_t &timestamp_ns, std::string &record) const {
+        if (offset < OldestOffset()) {
+            return false;
+        }
+        ApiDumpRingRecordHeader record_header = {};
+        CopyOut(offset, &record_header, sizeof(record_header));
+        if (EntrySize(record_header.record_size) > _header->ring_size) {
+            return false;
+        }
+        record.resize(record_header.record_size);
+        CopyOut(offset + sizeof(record_header), &record[0], record.size());
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (offset < _header->oldest_offset.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        timestamp_ns = record_header.timestamp_ns;
+        offset += EntrySize(record_header.record_size);
+        return true;
+    }
+
+   private:
+    static uint64_t EntrySize(uint64_t record_size) {
+        return (sizeof(ApiDumpRingRecordHeader) + record_size + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    void CopyIn(uint64_t offset, const void *value, size_t size) {
+        size_t position = static_cast<size_t>(offset % _header->ring_size);
+        size_t first = static_cast<size_t>(_header->ring_size) - position;
+        if (first > size) {
+            first = size;
+        }
+        memcpy(_data + position, value, first);
+        memcpy(_data, static_cast<const char *>(value) + first, size - first);
+    }
+
+    void CopyOut(uint64_t offset, void *value, size_t size) const {
+        size_t position = static_cast<size_t>(offset % _header->ring_size);
+        size_t first = static_cast<size_t>(_header->ring_size) - position;
+        if (first > size) {
+            first = size;
+        }
+        memcpy(value, _data + position, first);
+        memcpy(static_cast<char *>(value) + first, _data, size - first);
+    }
+
+    // Creating replaces the file rather than truncating it, so a viewer that still has the old one mapped keeps it.
+    bool Map(const std::string &file_name, uint64_t size, bool create) {
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+        int file = -1;
+        if (create) {
+            unlink(file_name.c_str());
+            file = open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (file < 0 || 0 != ftruncate(file, static_cast<off_t>(size))) {
+                if (file >= 0) {
+                    close(file);
+                }
+                return false;
+            }
+        } else {
+            struct stat file_stat = {};
+            file = open(file_name.c_str(), O_RDONLY);
+            if (file < 0 || 0 != fstat(file, &file_stat) || static_cast<uint64_t>(file_stat.st_size) < kApiDumpRingHeaderSize) {
+                if (file >= 0) {
+                    close(file);
+                }
+                return false;
+            }
+            size = static_cast<uint64_t>(file_stat.st_size);
+        }
+        void *mapped = mmap(nullptr, static_cast<size_t>(size), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+        close(file);
+        if (MAP_FAILED == mapped) {
+            return false;
+        }
+        _header = static_cast<ApiDumpRingHeader *>(mapped);
+        _data = static_cast<char *>(mapped) + kApiDumpRingHeaderSize;
+        _mapped_size = static_cast<size_t>(size);
+        return true;
+#else
+        (void)file_name;
+        (void)size;
+        (void)create;
+        return false;
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+    }
+
+    ApiDumpRingHeader *_header = nullptr;
+    char *_data = nullptr;
+    size_t _mapped_size = 0;
+};
+
+static_assert(sizeof(ApiDumpRingHeader) <= kApiDumpRingHeaderSize, "Ring header must fit before the records");
+
+#endif  // API_DUMP_RING_H_
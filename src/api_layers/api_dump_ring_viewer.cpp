@@ -0,0 +1,57 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Shows the records in a ring file written by the api_dump layer (XR_API_DUMP_EXPORT_TYPE=ring) as the layer's
+// text output, optionally following the ring as the application keeps adding to it.
+
+#include "xr_generated_api_dump.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    bool follow = false;
+    double seconds = 0;
+    std::string ring_file_name;
+    bool valid = true;
+    for (int arg = 1; arg < argc && valid; ++arg) {
+        if (0 == strcmp(argv[arg], "--follow")) {
+            follow = true;
+        } else if (0 == strcmp(argv[arg], "--seconds") && arg + 1 < argc) {
+            seconds = std::strtod(argv[++arg], nullptr);
+            valid = seconds > 0;
+        } else if (ring_file_name.empty()) {
+            ring_file_name = argv[arg];
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid || ring_file_name.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--follow] [--seconds <seconds>] <ring file>" << std::endl
+                  << "    --seconds only shows the records from that long before the newest one." << std::endl
+                  << "    --follow keeps showing new records as they are written, until interrupted." << std::endl;
+        return -1;
+    }
+
+    if (!ApiDumpLayerViewRing(ring_file_name, seconds, follow)) {
+        std::cerr << "Unable to show all of " << ring_file_name << std::endl;
+        return -1;
+    }
+    return 0;
+}
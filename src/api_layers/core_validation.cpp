@@ -31,7 +31,9 @@
 #include <openxr/openxr.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -71,6 +73,22 @@ struct CoreValidationRecordInfo {
 static CoreValidationRecordInfo g_record_info = {};
 static std::mutex g_record_mutex = {};
 
+// Validation level information.  At the frame level, commands called every frame skip their structure and parent
+// checks except on one frame in every g_frame_check_interval, or on no frame at all if the interval is 0.
+static std::atomic<bool> g_frame_validation_level(false);
+static std::atomic<uint32_t> g_frame_check_interval(60);
+static std::atomic<uint64_t> g_frame_count(0);
+
+bool CoreValidationSampleFrameChecks(bool ends_frame) {
+    if (!g_frame_validation_level.load(std::memory_order_relaxed)) {
+        return true;
+    }
+    uint64_t frame = ends_frame ? g_frame_count.fetch_add(1, std::memory_order_relaxed)
+                                : g_frame_count.load(std::memory_order_relaxed);
+    uint32_t interval = g_frame_check_interval.load(std::memory_order_relaxed);
+    return 0 != interval && 0 == frame % interval;
+}
+
 // HTML utilities
 bool CoreValidationWriteHtmlHeader() {
     try {
@@ -211,33 +229,68 @@ bool CoreValidationWriteHtmlFooter() {
     }
 }
 
+static XrDebugUtilsMessageSeverityFlagsEXT CoreValidDebugUtilsSeverity(GenValidUsageDebugSeverity message_severity) {
+    switch (message_severity) {
+        case VALID_USAGE_DEBUG_SEVERITY_DEBUG:
+            return XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+        case VALID_USAGE_DEBUG_SEVERITY_INFO:
+            return XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+        case VALID_USAGE_DEBUG_SEVERITY_WARNING:
+            return XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+        case VALID_USAGE_DEBUG_SEVERITY_ERROR:
+            return XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+        default:
+            return 0;
+    }
+}
+
+// A message is wanted if it is written out, or if any debug messenger takes validation messages of its severity.
+bool CoreValidMessageWanted(GenValidUsageXrInstanceInfo *instance_info, GenValidUsageDebugSeverity message_severity) {
+    if (!g_record_info.initialized) {
+        return false;
+    }
+    if (RECORD_NONE != g_record_info.type) {
+        return true;
+    }
+    if (nullptr == instance_info) {
+        return false;
+    }
+    XrDebugUtilsMessageSeverityFlagsEXT debug_utils_severity = CoreValidDebugUtilsSeverity(message_severity);
+    std::unique_lock<std::mutex> messengers_lock(instance_info->debug_messengers_mutex);
+    for (const auto &debug_messenger : instance_info->debug_messengers) {
+        XrDebugUtilsMessengerCreateInfoEXT *messenger_create_info = debug_messenger->create_info;
+        if (nullptr != messenger_create_info->userCallback &&
+            0 != (messenger_create_info->messageSeverities & debug_utils_severity) &&
+            0 != (messenger_create_info->messageTypes & XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // Function to record all the core validation information
-void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const std::string &message_id,
-                         GenValidUsageDebugSeverity message_severity, const std::string &command_name,
-                         std::vector<GenValidUsageXrObjectInfo> objects_info, const std::string &message) {
+void CoreValidRecordMessage(GenValidUsageXrInstanceInfo *instance_info, const std::string &message_id,
+                            GenValidUsageDebugSeverity message_severity, const std::string &command_name,
+                            const std::vector<GenValidUsageXrObjectInfo> &objects_info, const std::string &message) {
     if (g_record_info.initialized) {
         std::unique_lock<std::mutex> mlock(g_record_mutex);
 
         // Debug Utils items (in case we need them)
-        XrDebugUtilsMessageSeverityFlagsEXT debug_utils_severity = 0;
+        XrDebugUtilsMessageSeverityFlagsEXT debug_utils_severity = CoreValidDebugUtilsSeverity(message_severity);
 
         std::string severity_string;
         switch (message_severity) {
             case VALID_USAGE_DEBUG_SEVERITY_DEBUG:
                 severity_string = "VALID_DEBUG";
-                debug_utils_severity = XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
                 break;
             case VALID_USAGE_DEBUG_SEVERITY_INFO:
                 severity_string = "VALID_INFO";
-                debug_utils_severity = XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
                 break;
             case VALID_USAGE_DEBUG_SEVERITY_WARNING:
                 severity_string = "VALID_WARNING";
-                debug_utils_severity = XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
                 break;
             case VALID_USAGE_DEBUG_SEVERITY_ERROR:
                 severity_string = "VALID_ERROR";
-                debug_utils_severity = XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
                 break;
             default:
                 severity_string = "VALID_UNKNOWN";
@@ -247,7 +300,22 @@ void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const std::
         // If we have instance information, see if we need to log this information out to a debug messenger
         // callback.
         if (nullptr != instance_info) {
-            if (!instance_info->debug_data.Empty() && !instance_info->debug_messengers.empty()) {
+            // Take the callbacks that want this message while holding the messenger lock, but call them after
+            // releasing it, so that a callback cannot deadlock against a messenger being created or destroyed.
+            std::vector<XrDebugUtilsMessengerCreateInfoEXT> messenger_callbacks;
+            if (!instance_info->debug_data.Empty()) {
+                std::unique_lock<std::mutex> messengers_lock(instance_info->debug_messengers_mutex);
+                for (const auto &debug_messenger : instance_info->debug_messengers) {
+                    XrDebugUtilsMessengerCreateInfoEXT *messenger_create_info = debug_messenger->create_info;
+                    // If a callback exists, and the message is of a type this callback cares about, keep it.
+                    if (nullptr != messenger_create_info->userCallback &&
+                        0 != (messenger_create_info->messageSeverities & debug_utils_severity) &&
+                        0 != (messenger_create_info->messageTypes & XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT)) {
+                        messenger_callbacks.push_back(*messenger_create_info);
+                    }
+                }
+            }
+            if (!messenger_callbacks.empty()) {
                 std::vector<XrSdkLogObjectInfo> objects;
                 objects.reserve(objects_info.size());
                 std::transform(objects_info.begin(), objects_info.end(), std::back_inserter(objects),
@@ -263,18 +331,10 @@ void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const std::
                 callback_data.message = message.c_str();
                 names_and_labels.PopulateCallbackData(callback_data);
 
-                // Loop through all active messengers and give each a chance to output information
-                for (const auto &debug_messenger : instance_info->debug_messengers) {
-                    CoreValidationMessengerInfo *validation_messenger_info = debug_messenger.get();
-                    XrDebugUtilsMessengerCreateInfoEXT *messenger_create_info = validation_messenger_info->create_info;
-                    // If a callback exists, and the message is of a type this callback cares about, call it.
-                    if (nullptr != messenger_create_info->userCallback &&
-                        0 != (messenger_create_info->messageSeverities & debug_utils_severity) &&
-                        0 != (messenger_create_info->messageTypes & XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT)) {
-                        XrBool32 ret_val = messenger_create_info->userCallback(debug_utils_severity,
-                                                                               XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT,
-                                                                               &callback_data, messenger_create_info->userData);
-                    }
+                // Give each messenger that wants this message a chance to output information
+                for (const auto &messenger_create_info : messenger_callbacks) {
+                    messenger_create_info.userCallback(debug_utils_severity, XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT,
+                                                       &callback_data, messenger_create_info.userData);
                 }
             }
         }
@@ -411,22 +471,21 @@ void reportInternalError(std::string const &message) {
 void InvalidStructureType(GenValidUsageXrInstanceInfo *instance_info, const std::string &command_name,
                           std::vector<GenValidUsageXrObjectInfo> &objects_info, const char *structure_name, XrStructureType type,
                           const char *vuid, XrStructureType expected, const char *expected_name) {
-    std::ostringstream oss_type;
-    oss_type << structure_name << " has an invalid XrStructureType ";
-    oss_type << Uint32ToHexString(static_cast<uint32_t>(type));
-    if (expected != 0) {
-        oss_type << ", expected " << Uint32ToHexString(static_cast<uint32_t>(type));
-        oss_type << " (" << expected_name << ")";
-    }
-    if (vuid != nullptr) {
-        CoreValidLogMessage(instance_info, vuid, VALID_USAGE_DEBUG_SEVERITY_ERROR, command_name, objects_info, oss_type.str());
-    } else {
-        CoreValidLogMessage(instance_info, "VUID-" + std::string(structure_name) + "-type-type", VALID_USAGE_DEBUG_SEVERITY_ERROR,
-                            command_name, objects_info, oss_type.str());
-    }
+    auto format_vuid = [&]() { return vuid != nullptr ? std::string(vuid) : "VUID-" + std::string(structure_name) + "-type-type"; };
+    auto format_message = [&]() {
+        std::ostringstream oss_type;
+        oss_type << structure_name << " has an invalid XrStructureType ";
+        oss_type << Uint32ToHexString(static_cast<uint32_t>(type));
+        if (expected != 0) {
+            oss_type << ", expected " << Uint32ToHexString(static_cast<uint32_t>(expected));
+            oss_type << " (" << expected_name << ")";
+        }
+        return oss_type.str();
+    };
+    CoreValidLogMessage(instance_info, format_vuid, VALID_USAGE_DEBUG_SEVERITY_ERROR, command_name, objects_info, format_message);
 }
 
-std::string StructTypesToString(GenValidUsageXrInstanceInfo *instance_info, const std::vector<XrStructureType> &structs) {
+std::string StructTypesToString(GenValidUsageXrInstanceInfo *instance_info, const XrStructureType *structs, uint32_t struct_count) {
     char struct_type_buffer[XR_MAX_STRUCTURE_NAME_SIZE];
     std::string error_message;
     if (nullptr == instance_info) {
@@ -434,8 +493,9 @@ std::string StructTypesToString(GenValidUsageXrInstanceInfo *instance_info, cons
         return error_message;
     }
     bool wrote_struct = false;
-    for (auto &s : structs)
-        if (XR_SUCCESS == instance_info->dispatch_table->StructureTypeToString(instance_info->instance, s, struct_type_buffer)) {
+    for (uint32_t i = 0; i < struct_count; ++i)
+        if (XR_SUCCESS ==
+            instance_info->dispatch_table->StructureTypeToString(instance_info->instance, structs[i], struct_type_buffer)) {
             if (wrote_struct) {
                 error_message += ", ";
             }
@@ -490,6 +550,15 @@ XRAPI_ATTR XrResult XRAPI_CALL CoreValidationXrCreateApiLayerInstance(const XrIn
             g_record_info.file_name = file_name;
         }
 
+        std::string validation_level = PlatformUtilsGetEnv("XR_CORE_VALIDATION_LEVEL");
+        std::transform(validation_level.begin(), validation_level.end(), validation_level.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        g_frame_validation_level = (validation_level == "frame");
+        std::string frame_interval = PlatformUtilsGetEnv("XR_CORE_VALIDATION_FRAME_INTERVAL");
+        if (!frame_interval.empty()) {
+            g_frame_check_interval = static_cast<uint32_t>(std::strtoul(frame_interval.c_str(), nullptr, 10));
+        }
+
         if (!export_type.empty()) {
             std::string export_type_lower = export_type;
             std::transform(export_type.begin(), export_type.end(), export_type_lower.begin(),
@@ -587,6 +656,7 @@ XRAPI_ATTR XrResult XRAPI_CALL CoreValidationXrDestroyInstance(XrInstance instan
         auto info_with_lock = g_instance_info.getWithLock(instance);
         GenValidUsageXrInstanceInfo *gen_instance_info = info_with_lock.second;
         if (nullptr != gen_instance_info) {
+            std::unique_lock<std::mutex> messengers_lock(gen_instance_info->debug_messengers_mutex);
             gen_instance_info->debug_messengers.clear();
         }
     }
@@ -741,6 +811,7 @@ XRAPI_ATTR XrResult XRAPI_CALL CoreValidationXrCreateDebugUtilsMessengerEXT(XrIn
             UniqueCoreValidationMessengerInfo new_messenger_info(new CoreValidationMessengerInfo);
             new_messenger_info->messenger = *messenger;
             new_messenger_info->create_info = new_create_info;
+            std::unique_lock<std::mutex> messengers_lock(gen_instance_info->debug_messengers_mutex);
             gen_instance_info->debug_messengers.push_back(std::move(new_messenger_info));
         }
         return result;
@@ -755,22 +826,18 @@ XRAPI_ATTR XrResult XRAPI_CALL CoreValidationXrDestroyDebugUtilsMessengerEXT(XrD
         if (!XR_UNQUALIFIED_SUCCESS(result)) {
             return result;
         }
-        result = GenValidUsageNextXrDestroyDebugUtilsMessengerEXT(messenger);
-        if (!XR_UNQUALIFIED_SUCCESS(result)) {
-            return result;
-        }
         if (XR_NULL_HANDLE == messenger) {
             return XR_ERROR_HANDLE_INVALID;
         }
-        auto info_with_lock = g_debugutilsmessengerext_info.getWithLock(messenger);
-        if (info_with_lock.second != nullptr) {
-            GenValidUsageXrHandleInfo *gen_handle_info = info_with_lock.second;
-            if (nullptr != gen_handle_info) {
-                auto &debug_messengers = gen_handle_info->instance_info->debug_messengers;
-                vector_remove_if_and_erase(
-                    debug_messengers, [=](UniqueCoreValidationMessengerInfo const &msg) { return msg->messenger == messenger; });
-            }
+        // Look the messenger up before the call down, which forgets it.
+        GenValidUsageXrInstanceInfo *gen_instance_info = g_debugutilsmessengerext_info.getWithInstanceInfo(messenger).second;
+        result = GenValidUsageNextXrDestroyDebugUtilsMessengerEXT(messenger);
+        if (!XR_UNQUALIFIED_SUCCESS(result)) {
+            return result;
         }
+        std::unique_lock<std::mutex> messengers_lock(gen_instance_info->debug_messengers_mutex);
+        vector_remove_if_and_erase(gen_instance_info->debug_messengers,
+                                   [=](UniqueCoreValidationMessengerInfo const &msg) { return msg->messenger == messenger; });
         return result;
     } catch (...) {
         return XR_ERROR_VALIDATION_FAILURE;
@@ -32,11 +32,13 @@
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
 
+#include <atomic>
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include <mutex>
 #include <memory>
+#include <shared_mutex>
 
 /// Prints a message to stderr then throws an exception.
 ///
@@ -81,6 +83,9 @@ struct GenValidUsageXrInstanceInfo {
     XrInstance const instance;
     XrGeneratedDispatchTable *dispatch_table;
     std::vector<std::string> enabled_extensions;
+    // Messengers can be created and destroyed while other threads log messages, so debug_messengers is only
+    // touched with debug_messengers_mutex held.  Nothing else is locked while holding it.
+    std::mutex debug_messengers_mutex;
     std::vector<UniqueCoreValidationMessengerInfo> debug_messengers;
     DebugUtilsData debug_data;
 };
@@ -90,6 +95,8 @@ struct GenValidUsageXrHandleInfo {
     GenValidUsageXrInstanceInfo *instance_info;
     XrObjectType direct_parent_type;
     uint64_t direct_parent_handle;
+    // The GenValidUsageXrValidState bits of the states this handle is in, such as a frame having begun.
+    std::atomic<uint32_t> valid_states;
 };
 
 // Structure used for storing session label information
@@ -132,7 +139,10 @@ enum GenValidUsageDebugSeverity {
 // in core_validation.cpp
 void EraseAllInstanceTableMapElements(GenValidUsageXrInstanceInfo *search_value);
 
-typedef std::unique_lock<std::mutex> UniqueLock;
+// Handles are looked up on nearly every call, from any thread, but only created and destroyed now and then, so lookups
+// share the lock and only changes to the map take it exclusively.
+typedef std::unique_lock<std::shared_timed_mutex> UniqueLock;
+typedef std::shared_lock<std::shared_timed_mutex> SharedLock;
 template <typename HandleType, typename InfoType>
 class HandleInfoBase {
    public:
@@ -150,7 +160,7 @@ class HandleInfoBase {
     /// Throws if not found.
     InfoType *get(HandleType handle);
 
-    /// Lookup a handle, returning a pointer (if found) as well as a lock for this object's dispatch mutex.
+    /// Lookup a handle, returning a pointer (if found) as well as an exclusive lock for this object's dispatch mutex.
     std::pair<UniqueLock, InfoType *> getWithLock(HandleType handle);
 
     bool empty() const { return info_map_.empty(); }
@@ -171,7 +181,7 @@ class HandleInfoBase {
 
    protected:
     map_t info_map_;
-    std::mutex dispatch_mutex_;
+    std::shared_timed_mutex dispatch_mutex_;
 };
 
 /// Subclass used exclusively for instances.
@@ -198,17 +208,45 @@ class HandleInfo : public HandleInfoBase<HandleType, GenValidUsageXrHandleInfo>
     void removeHandlesForInstance(GenValidUsageXrInstanceInfo *search_value);
 };
 
-/// Function to record all the core validation information
-void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const std::string &message_id,
-                         GenValidUsageDebugSeverity message_severity, const std::string &command_name,
-                         std::vector<GenValidUsageXrObjectInfo> objects_info, const std::string &message);
+/// Whether a message of this severity would be written out or sent to any of the instance's debug messengers
+bool CoreValidMessageWanted(GenValidUsageXrInstanceInfo *instance_info, GenValidUsageDebugSeverity message_severity);
+
+/// Function to record all the core validation information, once it is known to be wanted
+void CoreValidRecordMessage(GenValidUsageXrInstanceInfo *instance_info, const std::string &message_id,
+                            GenValidUsageDebugSeverity message_severity, const std::string &command_name,
+                            const std::vector<GenValidUsageXrObjectInfo> &objects_info, const std::string &message);
+
+/// Each part of a logged message is either a string or a closure that formats one.
+inline const char *CoreValidFormatMessagePart(const char *part) { return part; }
+inline const std::string &CoreValidFormatMessagePart(const std::string &part) { return part; }
+template <typename FormatPart>
+inline auto CoreValidFormatMessagePart(const FormatPart &format_part) -> decltype(format_part()) {
+    return format_part();
+}
+
+/// Function to record all the core validation information.  Nothing is formatted, not even a string literal
+/// copied into a std::string, unless an output or debug messenger accepts messages of this severity.
+template <typename MessageId, typename CommandName, typename Message>
+void CoreValidLogMessage(GenValidUsageXrInstanceInfo *instance_info, const MessageId &message_id,
+                         GenValidUsageDebugSeverity message_severity, const CommandName &command_name,
+                         const std::vector<GenValidUsageXrObjectInfo> &objects_info, const Message &message) {
+    if (CoreValidMessageWanted(instance_info, message_severity)) {
+        CoreValidRecordMessage(instance_info, CoreValidFormatMessagePart(message_id), message_severity,
+                               CoreValidFormatMessagePart(command_name), objects_info, CoreValidFormatMessagePart(message));
+    }
+}
 
 void InvalidStructureType(GenValidUsageXrInstanceInfo *instance_info, const std::string &command_name,
                           std::vector<GenValidUsageXrObjectInfo> &objects_info, const char *structure_name, XrStructureType type,
                           const char *vuid = nullptr, XrStructureType expected = XrStructureType(0),
                           const char *expected_name = "");
 
-std::string StructTypesToString(GenValidUsageXrInstanceInfo *instance_info, const std::vector<XrStructureType> &structs);
+std::string StructTypesToString(GenValidUsageXrInstanceInfo *instance_info, const XrStructureType *structs, uint32_t struct_count);
+
+/// Whether the structure and parent checks of a command called every frame run during the current frame.  Always true
+/// at the full validation level; at the frame level only one frame in every XR_CORE_VALIDATION_FRAME_INTERVAL is checked.
+/// xrEndFrame passes ends_frame, so that the commands after it count towards the next frame.
+bool CoreValidationSampleFrameChecks(bool ends_frame);
 
 // -- Only implementations of templates follow --//
 
@@ -235,7 +273,7 @@ inline ValidateXrHandleResult HandleInfoBase<HandleType, InfoType>::verifyHandle
         }
 
         // Try to find the handle in the appropriate map
-        UniqueLock lock(dispatch_mutex_);
+        SharedLock lock(dispatch_mutex_);
         auto entry_returned = info_map_.find(*handle_to_check);
         // If it is not a valid handle, it should return the end of the map.
         if (info_map_.end() == entry_returned) {
@@ -253,7 +291,7 @@ inline InfoType *HandleInfoBase<HandleType, InfoType>::get(HandleType handle) {
         reportInternalError("Null handle passed to HandleInfoBase::get()");
     }
     // Try to find the handle in the appropriate map
-    UniqueLock lock(dispatch_mutex_);
+    SharedLock lock(dispatch_mutex_);
     auto entry_returned = info_map_.find(handle);
     if (entry_returned == info_map_.end()) {
         reportInternalError("Handle passed to HandleInfoBase::insert() not inserted");
@@ -309,7 +347,7 @@ inline std::pair<GenValidUsageXrHandleInfo *, GenValidUsageXrInstanceInfo *> Han
         reportInternalError("Null handle passed to HandleInfoBase::getWithInstanceInfo()");
     }
     // Try to find the handle in the appropriate map
-    UniqueLock lock(this->dispatch_mutex_);
+    SharedLock lock(this->dispatch_mutex_);
     auto entry_returned = this->info_map_.find(handle);
     if (entry_returned == this->info_map_.end()) {
         reportInternalError("Handle passed to HandleInfoBase::getWithInstanceInfo() not inserted");
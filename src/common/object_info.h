@@ -19,6 +19,7 @@
 
 #include <openxr/openxr.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -136,8 +137,20 @@ class ObjectInfoCollection {
     bool Empty() const { return object_info_.empty(); }
 
    private:
-    // Object names that have been set for given objects
-    std::vector<XrSdkLogObjectInfo> object_info_;
+    //! Identity of a stored object: its handle value and handle type
+    struct ObjectKey {
+        uint64_t handle;
+        XrObjectType type;
+        bool operator==(ObjectKey const& other) const { return handle == other.handle && type == other.type; }
+    };
+    struct ObjectKeyHash {
+        size_t operator()(ObjectKey const& key) const {
+            return std::hash<uint64_t>()(key.handle ^ (static_cast<uint64_t>(key.type) * 0x9e3779b97f4a7c15ULL));
+        }
+    };
+
+    // Object names that have been set for given objects, hashed so that a lookup does not have to walk every name
+    std::unordered_map<ObjectKey, XrSdkLogObjectInfo, ObjectKeyHash> object_info_;
 };
 
 struct XrSdkSessionLabel;
@@ -26,6 +26,8 @@
 // OpenXR Loader environment variables of interest
 #define OPENXR_RUNTIME_JSON_ENV_VAR "XR_RUNTIME_JSON"
 #define OPENXR_API_LAYER_PATH_ENV_VAR "XR_API_LAYER_PATH"
+#define OPENXR_MANIFEST_CACHE_ENV_VAR "XR_LOADER_MANIFEST_CACHE"
+#define OPENXR_PARALLEL_DISCOVERY_ENV_VAR "XR_LOADER_PARALLEL_DISCOVERY"
 
 // This is a CMake generated file with #defines for any functions/includes
 // that it found present and build-time configuration.
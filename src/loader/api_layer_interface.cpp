@@ -17,6 +17,7 @@
 
 #include <openxr/openxr.h>
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
 #include <sstream>
@@ -25,11 +26,11 @@
 #include <vector>
 
 #define OPENXR_ENABLE_LAYERS_ENV_VAR "XR_ENABLE_API_LAYERS"
+#define OPENXR_LAZY_API_LAYERS_ENV_VAR "XR_LOADER_LAZY_API_LAYERS"
 
 // Add any layers defined in the loader layer environment variable.
-static void AddEnvironmentApiLayers(std::vector<std::string>& enabled_layers) {
-    std::string layers = PlatformUtilsGetEnv(OPENXR_ENABLE_LAYERS_ENV_VAR);
-
+// Append each entry of a list of layer names separated by the path separator.
+static void AddApiLayerNameList(const std::string& layers, std::vector<std::string>& enabled_layers) {
     std::size_t last_found = 0;
     std::size_t found = layers.find_first_of(PATH_SEPARATOR);
     std::string cur_search;
@@ -49,6 +50,10 @@ static void AddEnvironmentApiLayers(std::vector<std::string>& enabled_layers) {
     }
 }
 
+static void AddEnvironmentApiLayers(std::vector<std::string>& enabled_layers) {
+    AddApiLayerNameList(PlatformUtilsGetEnv(OPENXR_ENABLE_LAYERS_ENV_VAR), enabled_layers);
+}
+
 XrResult ApiLayerInterface::GetApiLayerProperties(const std::string& openxr_command, uint32_t incoming_count,
                                                   uint32_t* outgoing_count, XrApiLayerProperties* api_layer_properties) {
     std::vector<std::unique_ptr<ApiLayerManifestFile>> manifest_files;
@@ -181,13 +186,34 @@ XrResult ApiLayerInterface::GetInstanceExtensionProperties(const std::string& op
     return XR_SUCCESS;
 }
 
+// Returns true if any of the extensions in extension_properties is in the enabled extension list.
+static bool AnyExtensionEnabled(const std::vector<XrExtensionProperties>& extension_properties, uint32_t enabled_extension_count,
+                                const char* const* enabled_extension_names) {
+    if (nullptr == enabled_extension_names) {
+        return false;
+    }
+    for (const XrExtensionProperties& ext_prop : extension_properties) {
+        for (uint32_t ext = 0; ext < enabled_extension_count; ++ext) {
+            if (strcmp(ext_prop.extensionName, enabled_extension_names[ext]) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uint32_t enabled_api_layer_count,
-                                          const char* const* enabled_api_layer_names,
+                                          const char* const* enabled_api_layer_names, uint32_t enabled_extension_count,
+                                          const char* const* enabled_extension_names,
                                           std::vector<std::unique_ptr<ApiLayerInterface>>& api_layer_interfaces) {
+    LoaderTimingScope load_timing("ApiLayerInterface::LoadApiLayers");
     XrResult last_error = XR_SUCCESS;
     bool any_loaded = false;
     std::vector<bool> layer_found;
     std::vector<std::unique_ptr<ApiLayerManifestFile>> layer_manifest_files = {};
+    // Explicit layers the user has declared to provide nothing but their instance extensions.
+    std::vector<std::string> lazy_api_layers;
+    AddApiLayerNameList(PlatformUtilsGetSecureEnv(OPENXR_LAZY_API_LAYERS_ENV_VAR), lazy_api_layers);
 
     // Find any implicit layers which we may need to report information for.
     XrResult result = ApiLayerManifestFile::FindManifestFiles(MANIFEST_TYPE_IMPLICIT_API_LAYER, layer_manifest_files);
@@ -240,7 +266,26 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
             continue;
         }
 
+        std::vector<XrExtensionProperties> extension_properties;
+        manifest_file->GetInstanceExtensionProperties(extension_properties);
+
+        // An explicit layer listed as lazy, which provides instance extensions, is only loaded when the application
+        // enables at least one of them.  Explicit layers only get here when the user or application asked for them,
+        // so dropping one is a warning.
+        if (manifest_file->Type() == MANIFEST_TYPE_EXPLICIT_API_LAYER && !extension_properties.empty() &&
+            std::find(lazy_api_layers.begin(), lazy_api_layers.end(), manifest_file->LayerName()) != lazy_api_layers.end() &&
+            !AnyExtensionEnabled(extension_properties, enabled_extension_count, enabled_extension_names)) {
+            std::string warning_message = "ApiLayerInterface::LoadApiLayers skipping layer ";
+            warning_message += manifest_file->LayerName();
+            warning_message += " because none of its instance extensions are enabled and it is listed in " OPENXR_LAZY_API_LAYERS_ENV_VAR;
+            LoaderLogger::LogWarningMessage(openxr_command, warning_message);
+            continue;
+        }
+
+        // Both phases are always measured, for the OpenXR-Loader-ApiLayerLoad message below.
+        LoaderTimingScope open_timing("LoaderPlatformLibraryOpen", manifest_file->LayerName(), true);
         LoaderPlatformLibraryHandle layer_library = LoaderPlatformLibraryOpen(manifest_file->LibraryPath());
+        uint64_t library_open_us = open_timing.Stop() / 1000;
         if (nullptr == layer_library) {
             if (!any_loaded) {
                 last_error = XR_ERROR_FILE_ACCESS_ERROR;
@@ -286,7 +331,9 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
         api_layer_info.structVersion = XR_API_LAYER_INFO_STRUCT_VERSION;
         api_layer_info.structSize = sizeof(XrNegotiateApiLayerRequest);
 
+        LoaderTimingScope negotiate_timing("xrNegotiateLoaderApiLayerInterface", manifest_file->LayerName(), true);
         XrResult res = negotiate(&loader_info, manifest_file->LayerName().c_str(), &api_layer_info);
+        uint64_t negotiate_us = negotiate_timing.Stop() / 1000;
         // If we supposedly succeeded, but got a nullptr for getInstanceProcAddr
         // then something still went wrong, so return with an error.
         if (XR_SUCCEEDED(res) && nullptr == api_layer_info.getInstanceProcAddr) {
@@ -315,12 +362,19 @@ XrResult ApiLayerInterface::LoadApiLayers(const std::string& openxr_command, uin
                 << XR_VERSION_MAJOR(api_layer_info.layerApiVersion) << "." << XR_VERSION_MINOR(api_layer_info.layerApiVersion);
             LoaderLogger::LogInfoMessage(openxr_command, oss.str());
         }
+        {
+            std::ostringstream oss;
+            oss << "ApiLayerInterface::LoadApiLayers loaded layer " << manifest_file->LayerName() << " in "
+                << library_open_us + negotiate_us << " us (library open " << library_open_us << " us, negotiation "
+                << negotiate_us << " us)";
+            LoaderLogger::GetInstance().LogMessage(XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT,
+                                                   XR_LOADER_LOG_MESSAGE_TYPE_PERFORMANCE_BIT, "OpenXR-Loader-ApiLayerLoad",
+                                                   openxr_command, oss.str());
+        }
 
         // Grab the list of extensions this layer supports for easy filtering after the
         // xrCreateInstance call
         std::vector<std::string> supported_extensions;
-        std::vector<XrExtensionProperties> extension_properties;
-        manifest_file->GetInstanceExtensionProperties(extension_properties);
         supported_extensions.reserve(extension_properties.size());
         for (XrExtensionProperties& ext_prop : extension_properties) {
             supported_extensions.emplace_back(ext_prop.extensionName);
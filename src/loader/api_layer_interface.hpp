@@ -24,7 +24,8 @@ class ApiLayerInterface {
    public:
     // Factory method
     static XrResult LoadApiLayers(const std::string& openxr_command, uint32_t enabled_api_layer_count,
-                                  const char* const* enabled_api_layer_names,
+                                  const char* const* enabled_api_layer_names, uint32_t enabled_extension_count,
+                                  const char* const* enabled_extension_names,
                                   std::vector<std::unique_ptr<ApiLayerInterface>>& api_layer_interfaces);
     // Static queries
     static XrResult GetApiLayerProperties(const std::string& openxr_command, uint32_t incoming_count, uint32_t* outgoing_count,
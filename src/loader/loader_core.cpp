@@ -18,6 +18,7 @@
 #include "loader_logger_recorders.hpp"
 #include "loader_logger.hpp"
 #include "loader_platform.hpp"
+#include "manifest_cache.hpp"
 #include "runtime_interface.hpp"
 #include "xr_generated_dispatch_table.h"
 #include "xr_generated_loader.hpp"
@@ -86,6 +87,7 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrEnumerateApiLayerProperties(uint32_t prop
     // Make sure only one thread is attempting to read the JSON files at a time.
     std::unique_lock<std::mutex> json_lock(GetLoaderJsonMutex());
 
+    LoaderTimingScope enumerate_timing("xrEnumerateApiLayerProperties");
     XrResult result = ApiLayerInterface::GetApiLayerProperties("xrEnumerateApiLayerProperties", propertyCapacityInput,
                                                                propertyCountOutput, properties);
     if (XR_FAILED(result)) {
@@ -119,6 +121,7 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrEnumerateInstanceExtensionProperties(cons
     {
         // Make sure only one thread is attempting to read the JSON files at a time.
         std::unique_lock<std::mutex> json_lock(GetLoaderJsonMutex());
+        LoaderTimingScope enumerate_timing("xrEnumerateInstanceExtensionProperties");
 
         // Get the layer extension properties
         result = ApiLayerInterface::GetInstanceExtensionProperties("xrEnumerateInstanceExtensionProperties", layerName,
@@ -243,6 +246,7 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrCreateInstance(const XrInstanceCreateInfo
         return XR_ERROR_LIMIT_REACHED;
     }
 
+    LoaderTimingScope create_timing("xrCreateInstance");
     std::vector<std::unique_ptr<ApiLayerInterface>> api_layer_interfaces;
     XrResult result;
 
@@ -256,6 +260,7 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrCreateInstance(const XrInstanceCreateInfo
         } else {
             // Load the appropriate layers
             result = ApiLayerInterface::LoadApiLayers("xrCreateInstance", info->enabledApiLayerCount, info->enabledApiLayerNames,
+                                                      info->enabledExtensionCount, info->enabledExtensionNames,
                                                       api_layer_interfaces);
             if (XR_FAILED(result)) {
                 LoaderLogger::LogErrorMessage("xrCreateInstance", "Failed loading layer information");
@@ -306,6 +311,10 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrCreateInstance(const XrInstanceCreateInfo
         LoaderLogger::LogVerboseMessage("xrCreateInstance", "Completed loader trampoline");
     }
 
+    // Startup is done, so write out everything timed up to this point, including any earlier enumeration calls.
+    create_timing.Stop();
+    LoaderLogger::GetInstance().ReportTimings();
+
     return result;
 }
 XRLOADER_ABI_CATCH_FALLBACK
@@ -339,6 +348,9 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrDestroyInstance(XrInstance instance) XRLO
         LoaderLogger::LogErrorMessage("xrDestroyInstance", "Unknown error occurred calling down chain");
     }
 
+    // Function pointers resolved for this instance are no longer valid.
+    loader_instance->ClearInstanceProcAddrCache();
+
     // Get rid of the loader instance. This will make it possible to create another instance in the future.
     ActiveLoaderInstance::Remove();
 
@@ -348,6 +360,9 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrDestroyInstance(XrInstance instance) XRLO
     // Finally, unload the runtime if necessary
     RuntimeInterface::UnloadRuntime("xrDestroyInstance");
 
+    // Manifests parsed for this instance are re-read for the next one.
+    ManifestFileRegistry::GetInstance().AdvanceGeneration();
+
     return XR_SUCCESS;
 }
 XRLOADER_ABI_CATCH_FALLBACK
@@ -721,10 +736,12 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrGetInstanceProcAddr(XrInstance instance,
         return XR_ERROR_VALIDATION_FAILURE;
     }
 
+    // Every command known at build time is described by the generated command table.
+    const LoaderCommandInfo *command_info = GeneratedLoaderFindCommand(name);
+
     if (instance == XR_NULL_HANDLE) {
         // Null instance is allowed for a few specific API entry points, otherwise return error
-        if (strcmp(name, "xrCreateInstance") != 0 && strcmp(name, "xrEnumerateApiLayerProperties") != 0 &&
-            strcmp(name, "xrEnumerateInstanceExtensionProperties") != 0 && strcmp(name, "xrInitializeLoaderKHR") != 0) {
+        if (command_info == nullptr || !command_info->null_instance_allowed) {
             // TODO why is xrGetInstanceProcAddr not listed in here?
             std::string error_str = "XR_NULL_HANDLE for instance but query for ";
             error_str += name;
@@ -736,27 +753,12 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrGetInstanceProcAddr(XrInstance instance,
     }
 
     // These functions must always go through the loader's implementation (trampoline).
-    if (strcmp(name, "xrGetInstanceProcAddr") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrGetInstanceProcAddr);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrInitializeLoaderKHR") == 0) {
-#ifdef XR_KHR_LOADER_INIT_SUPPORT
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrInitializeLoaderKHR);
-        return XR_SUCCESS;
-#else
-        return XR_ERROR_FUNCTION_UNSUPPORTED;
-#endif
-    } else if (strcmp(name, "xrEnumerateApiLayerProperties") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrEnumerateApiLayerProperties);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrEnumerateInstanceExtensionProperties") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrEnumerateInstanceExtensionProperties);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrCreateInstance") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrCreateInstance);
-        return XR_SUCCESS;
-    } else if (strcmp(name, "xrDestroyInstance") == 0) {
-        *function = reinterpret_cast<PFN_xrVoidFunction>(LoaderXrDestroyInstance);
+    if (command_info != nullptr && command_info->instance_independent) {
+        if (command_info->loader_function == nullptr) {
+            // The loader implementation is not built for this platform (e.g. xrInitializeLoaderKHR).
+            return XR_ERROR_FUNCTION_UNSUPPORTED;
+        }
+        *function = command_info->loader_function;
         return XR_SUCCESS;
     }
 
@@ -767,39 +769,22 @@ XRAPI_ATTR XrResult XRAPI_CALL LoaderXrGetInstanceProcAddr(XrInstance instance,
         return result;
     }
 
-    // XR_EXT_debug_utils is built into the loader and handled partly through the xrGetInstanceProcAddress terminator,
-    // but the check to see if the extension is enabled must be done here where ActiveLoaderInstance is safe to use.
-    if (*function == nullptr) {
-        if (strcmp(name, "xrCreateDebugUtilsMessengerEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrCreateDebugUtilsMessengerEXT);
-        } else if (strcmp(name, "xrDestroyDebugUtilsMessengerEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrDestroyDebugUtilsMessengerEXT);
-        } else if (strcmp(name, "xrSessionBeginDebugUtilsLabelRegionEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionBeginDebugUtilsLabelRegionEXT);
-        } else if (strcmp(name, "xrSessionEndDebugUtilsLabelRegionEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionEndDebugUtilsLabelRegionEXT);
-        } else if (strcmp(name, "xrSessionInsertDebugUtilsLabelEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSessionInsertDebugUtilsLabelEXT);
-        } else if (strcmp(name, "xrSetDebugUtilsObjectNameEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSetDebugUtilsObjectNameEXT);
-        } else if (strcmp(name, "xrSubmitDebugUtilsMessageEXT") == 0) {
-            *function = reinterpret_cast<PFN_xrVoidFunction>(xrSubmitDebugUtilsMessageEXT);
-        }
-
-        if (*function != nullptr && !loader_instance->ExtensionIsEnabled("XR_EXT_debug_utils")) {
-            // The function matches one of the XR_EXT_debug_utils functions but the extension is not enabled.
-            *function = nullptr;
+    if (command_info != nullptr) {
+        if (command_info->required_extension != nullptr && !loader_instance->ExtensionIsEnabled(command_info->required_extension)) {
+            // The function belongs to an extension that is not enabled, so nothing down the chain may provide it.
             return XR_ERROR_FUNCTION_UNSUPPORTED;
         }
-    }
 
-    if (*function != nullptr) {
-        // The loader has a trampoline or implementation of this function.
-        return XR_SUCCESS;
+        // XR_EXT_debug_utils is built into the loader and handled partly through the xrGetInstanceProcAddress terminator,
+        // so the table provides the loader trampoline once the extension is known to be enabled.
+        if (command_info->loader_function != nullptr) {
+            *function = command_info->loader_function;
+            return XR_SUCCESS;
+        }
     }
 
     // If the function is not supported by the loader, call down to the next layer.
-    return loader_instance->GetInstanceProcAddr(name, function);
+    return loader_instance->GetInstanceProcAddr(command_info, name, function);
 }
 XRLOADER_ABI_CATCH_FALLBACK
 
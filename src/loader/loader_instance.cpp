@@ -38,6 +38,8 @@ std::unique_ptr<LoaderInstance>& GetSetCurrentLoaderInstance() {
 }  // namespace
 
 namespace ActiveLoaderInstance {
+std::atomic<const XrGeneratedDispatchTable*> g_published_dispatch_table{nullptr};
+
 XrResult Set(std::unique_ptr<LoaderInstance> loader_instance, const char* log_function_name) {
     if (GetSetCurrentLoaderInstance() != nullptr) {
         LoaderLogger::LogErrorMessage(log_function_name, "Active XrInstance handle already exists");
@@ -45,22 +47,30 @@ XrResult Set(std::unique_ptr<LoaderInstance> loader_instance, const char* log_fu
     }
 
     GetSetCurrentLoaderInstance() = std::move(loader_instance);
+    g_published_dispatch_table.store(GetSetCurrentLoaderInstance()->DispatchTable().get(), std::memory_order_release);
     return XR_SUCCESS;
 }
 
 XrResult Get(LoaderInstance** loader_instance, const char* log_function_name) {
     *loader_instance = GetSetCurrentLoaderInstance().get();
     if (*loader_instance == nullptr) {
-        LoaderLogger::LogErrorMessage(log_function_name, "No active XrInstance handle.");
-        return XR_ERROR_HANDLE_INVALID;
+        return ReportNotAvailable(log_function_name);
     }
 
     return XR_SUCCESS;
 }
 
+XrResult ReportNotAvailable(const char* log_function_name) {
+    LoaderLogger::LogErrorMessage(log_function_name, "No active XrInstance handle.");
+    return XR_ERROR_HANDLE_INVALID;
+}
+
 bool IsAvailable() { return GetSetCurrentLoaderInstance() != nullptr; }
 
-void Remove() { GetSetCurrentLoaderInstance().release(); }
+void Remove() {
+    g_published_dispatch_table.store(nullptr, std::memory_order_release);
+    GetSetCurrentLoaderInstance().reset();
+}
 }  // namespace ActiveLoaderInstance
 
 // Extensions that are supported by the loader, but may not be supported
@@ -140,6 +150,7 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
                                         std::vector<std::unique_ptr<ApiLayerInterface>> api_layer_interfaces,
                                         const XrInstanceCreateInfo* info, std::unique_ptr<LoaderInstance>* loader_instance) {
     LoaderLogger::LogVerboseMessage("xrCreateInstance", "Entering LoaderInstance::CreateInstance");
+    LoaderTimingScope create_timing("LoaderInstance::CreateInstance");
 
     // Check the list of enabled extensions to make sure something supports them, and, if we do,
     // add it to the list of enabled extensions
@@ -243,6 +254,8 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
             api_layer_ci.nextInfo = next_info_list.get();
             //! @todo do we filter our create info extension list here?
             //! Think that actually each layer might need to filter...
+            // Each layer's own work is not separable from the rest of the chain, so it is timed as a whole.
+            LoaderTimingScope chain_timing("xrCreateApiLayerInstance chain");
             last_error = topmost_cali_fp(modified_create_info, &api_layer_ci, &instance);
 
         } else {
@@ -269,8 +282,30 @@ XrResult LoaderInstance::CreateInstance(PFN_xrGetInstanceProcAddr get_instance_p
     return last_error;
 }
 
-XrResult LoaderInstance::GetInstanceProcAddr(const char* name, PFN_xrVoidFunction* function) {
-    return _topmost_gipa(_runtime_instance, name, function);
+XrResult LoaderInstance::GetInstanceProcAddr(const LoaderCommandInfo* command_info, const char* name,
+                                             PFN_xrVoidFunction* function) {
+    if (command_info == nullptr) {
+        return _topmost_gipa(_runtime_instance, name, function);
+    }
+
+    std::atomic<PFN_xrVoidFunction>& cached_function = _proc_addr_cache[command_info->index];
+    *function = cached_function.load(std::memory_order_acquire);
+    if (*function != nullptr) {
+        return XR_SUCCESS;
+    }
+
+    // Failures are not cached so that the error returned by the chain is preserved.
+    XrResult result = _topmost_gipa(_runtime_instance, name, function);
+    if (XR_SUCCEEDED(result) && *function != nullptr) {
+        cached_function.store(*function, std::memory_order_release);
+    }
+    return result;
+}
+
+void LoaderInstance::ClearInstanceProcAddrCache() {
+    for (uint32_t index = 0; index < kLoaderCommandCount; ++index) {
+        _proc_addr_cache[index].store(nullptr, std::memory_order_release);
+    }
 }
 
 LoaderInstance::LoaderInstance(XrInstance instance, const XrInstanceCreateInfo* create_info, PFN_xrGetInstanceProcAddr topmost_gipa,
@@ -278,7 +313,8 @@ LoaderInstance::LoaderInstance(XrInstance instance, const XrInstanceCreateInfo*
     : _runtime_instance(instance),
       _topmost_gipa(topmost_gipa),
       _api_layer_interfaces(std::move(api_layer_interfaces)),
-      _dispatch_table(new XrGeneratedDispatchTable{}) {
+      _dispatch_table(new XrGeneratedDispatchTable{}),
+      _proc_addr_cache(new std::atomic<PFN_xrVoidFunction>[kLoaderCommandCount]()) {
     for (uint32_t ext = 0; ext < create_info->enabledExtensionCount; ++ext) {
         _enabled_extensions.push_back(create_info->enabledExtensionNames[ext]);
     }
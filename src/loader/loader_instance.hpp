@@ -15,6 +15,7 @@
 #include <openxr/openxr.h>
 
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <mutex>
@@ -24,6 +25,7 @@
 
 class ApiLayerInterface;
 struct XrGeneratedDispatchTable;
+struct LoaderCommandInfo;
 class LoaderInstance;
 
 // Manage the single loader instance that is available.
@@ -39,6 +41,18 @@ XrResult Get(LoaderInstance** loader_instance, const char* log_function_name);
 
 // Destroy the currently active LoaderInstance if there is one. This will make the loader able to create a new XrInstance if needed.
 void Remove();
+
+// Dispatch table of the active LoaderInstance, published by Set() and cleared by Remove().
+// The table is fully populated before it is published and never modified afterwards.
+// Calls that race xrDestroyInstance are undefined behavior, as the specification requires external synchronization.
+extern std::atomic<const XrGeneratedDispatchTable*> g_published_dispatch_table;
+
+// Get the dispatch table of the active LoaderInstance without locking, or nullptr if there is none.
+// This is the fast path used by the generated trampolines.
+inline const XrGeneratedDispatchTable* GetDispatchTable() { return g_published_dispatch_table.load(std::memory_order_acquire); }
+
+// Log that there is no active LoaderInstance and return the matching error.
+XrResult ReportNotAvailable(const char* log_function_name);
 };  // namespace ActiveLoaderInstance
 
 // Manages information needed by the loader for an XrInstance, such as what extensions are available and the dispatch table.
@@ -59,7 +73,11 @@ class LoaderInstance {
     bool ExtensionIsEnabled(const std::string& extension);
     XrDebugUtilsMessengerEXT DefaultDebugUtilsMessenger() { return _messenger; }
     void SetDefaultDebugUtilsMessenger(XrDebugUtilsMessengerEXT messenger) { _messenger = messenger; }
-    XrResult GetInstanceProcAddr(const char* name, PFN_xrVoidFunction* function);
+    // Resolve a command through the layer chain. Results for commands in the generated command table
+    // (command_info is non-null) are cached, so later queries for the same command skip the chain.
+    XrResult GetInstanceProcAddr(const LoaderCommandInfo* command_info, const char* name, PFN_xrVoidFunction* function);
+    // Forget all cached xrGetInstanceProcAddr results.
+    void ClearInstanceProcAddrCache();
 
    private:
     LoaderInstance(XrInstance instance, const XrInstanceCreateInfo* createInfo, PFN_xrGetInstanceProcAddr topmost_gipa,
@@ -72,6 +90,8 @@ class LoaderInstance {
     std::vector<std::unique_ptr<ApiLayerInterface>> _api_layer_interfaces;
 
     std::unique_ptr<XrGeneratedDispatchTable> _dispatch_table;
+    // Resolved function pointers indexed by LoaderCommandInfo::index, nullptr until first resolved.
+    std::unique_ptr<std::atomic<PFN_xrVoidFunction>[]> _proc_addr_cache;
     // Internal debug messenger created during xrCreateInstance
     XrDebugUtilsMessengerEXT _messenger{XR_NULL_HANDLE};
 };
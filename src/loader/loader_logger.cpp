@@ -17,6 +17,7 @@
 #include <openxr/openxr.h>
 
 #include <algorithm>
+#include <chrono>
 #include <iterator>
 #include <memory>
 #include <mutex>
@@ -32,6 +33,10 @@ bool LoaderLogRecorder::LogDebugUtilsMessage(XrDebugUtilsMessageSeverityFlagsEXT
     return false;
 }
 
+void LoaderLogRecorder::LogTimingEvent(const XrLoaderTimingEvent& /*event*/) {}
+
+void LoaderLogRecorder::ReportTimings() {}
+
 // Utility functions for converting to/from XR_EXT_debug_utils values
 
 XrLoaderLogMessageSeverityFlags DebugUtilsSeveritiesToLoaderLogMessageSeverities(
@@ -134,6 +139,14 @@ LoaderLogger::LoaderLogger() {
         }
         AddLogRecorder(MakeStdOutLoaderLogRecorder(nullptr, debug_flags));
     }
+
+    // If the environment variable to enable loader timing is set, then record the time spent in each phase of
+    // loader work and write it to the file it names.
+    std::string timing_filename = PlatformUtilsGetSecureEnv("XR_LOADER_TIMING");
+    if (!timing_filename.empty()) {
+        AddLogRecorder(MakeTimingLoaderLogRecorder(timing_filename));
+        _timing_enabled = true;
+    }
 }
 
 void LoaderLogger::AddLogRecorder(std::unique_ptr<LoaderLogRecorder>&& recorder) { _recorders.push_back(std::move(recorder)); }
@@ -214,6 +227,55 @@ bool LoaderLogger::LogDebugUtilsMessage(XrDebugUtilsMessageSeverityFlagsEXT mess
     return exit_app;
 }
 
+// Timing functions
+void LoaderLogger::LogTimingEvent(const XrLoaderTimingEvent& event) {
+    for (std::unique_ptr<LoaderLogRecorder>& recorder : _recorders) {
+        recorder->LogTimingEvent(event);
+    }
+}
+
+void LoaderLogger::ReportTimings() {
+    for (std::unique_ptr<LoaderLogRecorder>& recorder : _recorders) {
+        recorder->ReportTimings();
+    }
+}
+
+static uint64_t GetTimingClockNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+LoaderTimingScope::LoaderTimingScope(const char* phase, const std::string& detail, bool measure_always)
+    : _phase(phase),
+      _start_ns(0),
+      _duration_ns(0),
+      _recording(LoaderLogger::GetInstance().TimingEnabled()),
+      _running(_recording || measure_always) {
+    if (_recording) {
+        _detail = detail;
+    }
+    if (_running) {
+        _start_ns = GetTimingClockNs();
+    }
+}
+
+uint64_t LoaderTimingScope::Stop() {
+    if (!_running) {
+        return _duration_ns;
+    }
+    _running = false;
+    _duration_ns = GetTimingClockNs() - _start_ns;
+    if (_recording) {
+        XrLoaderTimingEvent event = {};
+        event.phase = _phase;
+        event.detail = _detail.c_str();
+        event.start_ns = _start_ns;
+        event.duration_ns = _duration_ns;
+        LoaderLogger::GetInstance().LogTimingEvent(event);
+    }
+    return _duration_ns;
+}
+
 void LoaderLogger::AddObjectName(uint64_t object_handle, XrObjectType object_type, const std::string& object_name) {
     data_.AddObjectName(object_handle, object_type, object_name);
 }
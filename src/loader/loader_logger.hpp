@@ -58,6 +58,15 @@ enum XrLoaderLogType {
     XR_LOADER_LOG_DEBUG_UTILS,
     XR_LOADER_LOG_DEBUGGER,
     XR_LOADER_LOG_LOGCAT,
+    XR_LOADER_LOG_TIMING,
+};
+
+// One timed phase of loader work, such as searching for manifests or opening a library.
+struct XrLoaderTimingEvent {
+    const char* phase;
+    const char* detail;  // the file, library or layer the phase worked on, or empty
+    uint64_t start_ns;   // steady clock
+    uint64_t duration_ns;
 };
 
 class LoaderLogRecorder {
@@ -99,6 +108,10 @@ class LoaderLogRecorder {
                                       XrDebugUtilsMessageTypeFlagsEXT message_type,
                                       const XrDebugUtilsMessengerCallbackDataEXT* callback_data);
 
+    // Timing functions - defaults to do nothing.
+    virtual void LogTimingEvent(const XrLoaderTimingEvent& event);
+    virtual void ReportTimings();
+
    protected:
     bool _active;
     XrLoaderLogType _type;
@@ -166,6 +179,12 @@ class LoaderLogger {
     bool LogDebugUtilsMessage(XrDebugUtilsMessageSeverityFlagsEXT message_severity, XrDebugUtilsMessageTypeFlagsEXT message_type,
                               const XrDebugUtilsMessengerCallbackDataEXT* callback_data);
 
+    // Timing functions, used when XR_LOADER_TIMING is set.  Phases are recorded through LoaderTimingScope, and
+    // ReportTimings asks the recorders to write out everything recorded since the previous report.
+    bool TimingEnabled() const { return _timing_enabled; }
+    void LogTimingEvent(const XrLoaderTimingEvent& event);
+    void ReportTimings();
+
     // Non-copyable
     LoaderLogger(const LoaderLogger&) = delete;
     LoaderLogger& operator=(const LoaderLogger&) = delete;
@@ -180,6 +199,33 @@ class LoaderLogger {
     std::unordered_map<XrInstance, std::unordered_set<uint64_t>> _recordersByInstance;
 
     DebugUtilsData data_;
+
+    bool _timing_enabled = false;
+};
+
+// LoaderTimingScope class -
+// Times the enclosing scope, or up to an earlier call to Stop, as one phase of loader work.  Does nothing
+// unless XR_LOADER_TIMING is set, or measure_always is true, in which case the phase is still only recorded
+// when XR_LOADER_TIMING is set but Stop returns how long it took, so that it can be reported in other ways.
+class LoaderTimingScope {
+   public:
+    explicit LoaderTimingScope(const char* phase, const std::string& detail = {}, bool measure_always = false);
+    ~LoaderTimingScope() { Stop(); }
+
+    // Returns the duration in nanoseconds, or 0 if nothing was measured.
+    uint64_t Stop();
+
+    // Non-copyable
+    LoaderTimingScope(const LoaderTimingScope&) = delete;
+    LoaderTimingScope& operator=(const LoaderTimingScope&) = delete;
+
+   private:
+    const char* _phase;
+    std::string _detail;
+    uint64_t _start_ns;
+    uint64_t _duration_ns;
+    bool _recording;
+    bool _running;
 };
 
 // Utility functions for converting to/from XR_EXT_debug_utils values
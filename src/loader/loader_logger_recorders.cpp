@@ -12,10 +12,16 @@
 #include "hex_and_handles.h"
 #include "loader_logger.hpp"
 
+#include <json/json.h>
 #include <openxr/openxr.h>
 
+#include <algorithm>
+#include <fstream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <iostream>
 #include <sstream>
@@ -96,6 +102,33 @@ class DebugUtilsLogRecorder : public LoaderLogRecorder {
    private:
     PFN_xrDebugUtilsMessengerCallbackEXT _user_callback;
 };
+
+// Timing logger used with XR_LOADER_TIMING
+class TimingLoaderLogRecorder : public LoaderLogRecorder {
+   public:
+    explicit TimingLoaderLogRecorder(const std::string& filename);
+
+    bool LogMessage(XrLoaderLogMessageSeverityFlagBits message_severity, XrLoaderLogMessageTypeFlags message_type,
+                    const XrLoaderLogMessengerCallbackData* callback_data) override;
+
+    void LogTimingEvent(const XrLoaderTimingEvent& event) override;
+    void ReportTimings() override;
+
+   private:
+    struct TimingEvent {
+        std::string phase;
+        std::string detail;
+        uint64_t start_ns;
+        uint64_t duration_ns;
+        uint32_t thread_index;
+    };
+
+    std::mutex _mutex;
+    std::string _filename;
+    std::vector<TimingEvent> _events;
+    std::unordered_map<std::thread::id, uint32_t> _thread_indices;
+};
+
 #ifdef __ANDROID__
 
 class LogcatLoaderLogRecorder : public LoaderLogRecorder {
@@ -195,6 +228,73 @@ bool DebugUtilsLogRecorder::LogDebugUtilsMessage(XrDebugUtilsMessageSeverityFlag
     return (_user_callback(message_severity, message_type, callback_data, _user_data) == XR_TRUE);
 }
 
+// A logger that collects timed phases of loader work and writes them out as Chrome trace events, which can be
+// viewed in chrome://tracing or Perfetto.
+
+TimingLoaderLogRecorder::TimingLoaderLogRecorder(const std::string& filename)
+    : LoaderLogRecorder(XR_LOADER_LOG_TIMING, nullptr, 0, 0), _filename(filename) {
+    // Automatically start
+    Start();
+}
+
+bool TimingLoaderLogRecorder::LogMessage(XrLoaderLogMessageSeverityFlagBits /*message_severity*/,
+                                         XrLoaderLogMessageTypeFlags /*message_type*/,
+                                         const XrLoaderLogMessengerCallbackData* /*callback_data*/) {
+    // Only timing events are recorded.
+    return false;
+}
+
+void TimingLoaderLogRecorder::LogTimingEvent(const XrLoaderTimingEvent& event) {
+    if (!_active) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto thread_index = _thread_indices.emplace(std::this_thread::get_id(), static_cast<uint32_t>(_thread_indices.size() + 1));
+    _events.push_back({event.phase, event.detail, event.start_ns, event.duration_ns, thread_index.first->second});
+}
+
+void TimingLoaderLogRecorder::ReportTimings() {
+    std::vector<TimingEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        events.swap(_events);
+    }
+    if (events.empty()) {
+        return;
+    }
+
+    // Phases are recorded as they finish, so nested phases come before the phases containing them.
+    std::stable_sort(events.begin(), events.end(),
+                     [](const TimingEvent& a, const TimingEvent& b) { return a.start_ns < b.start_ns; });
+    const uint64_t base_ns = events.front().start_ns;
+
+    Json::Value root(Json::objectValue);
+    Json::Value& trace_events = root["traceEvents"] = Json::Value(Json::arrayValue);
+    for (const TimingEvent& event : events) {
+        Json::Value trace_event(Json::objectValue);
+        trace_event["name"] = event.phase;
+        trace_event["cat"] = "loader";
+        trace_event["ph"] = "X";
+        trace_event["ts"] = static_cast<double>(event.start_ns - base_ns) / 1000.0;
+        trace_event["dur"] = static_cast<double>(event.duration_ns) / 1000.0;
+        trace_event["pid"] = 1;
+        trace_event["tid"] = event.thread_index;
+        if (!event.detail.empty()) {
+            trace_event["args"]["detail"] = event.detail;
+        }
+        trace_events.append(trace_event);
+    }
+    root["displayTimeUnit"] = "ms";
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::ofstream out_stream(_filename, std::ofstream::out | std::ofstream::trunc);
+    out_stream << Json::writeString(builder, root) << std::endl;
+    if (!out_stream.good()) {
+        LoaderLogger::LogWarningMessage("", "TimingLoaderLogRecorder - failed to write timing report to " + _filename);
+    }
+}
+
 #ifdef __ANDROID__
 
 static inline android_LogPriority LoaderToAndroidLogPriority(XrLoaderLogMessageSeverityFlags message_severity) {
@@ -276,6 +376,11 @@ std::unique_ptr<LoaderLogRecorder> MakeDebugUtilsLoaderLogRecorder(const XrDebug
     return recorder;
 }
 
+std::unique_ptr<LoaderLogRecorder> MakeTimingLoaderLogRecorder(const std::string& filename) {
+    std::unique_ptr<LoaderLogRecorder> recorder(new TimingLoaderLogRecorder(filename));
+    return recorder;
+}
+
 #ifdef __ANDROID__
 std::unique_ptr<LoaderLogRecorder> MakeLogcatLoaderLogRecorder() {
     std::unique_ptr<LoaderLogRecorder> recorder(new LogcatLoaderLogRecorder());
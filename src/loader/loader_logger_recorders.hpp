@@ -14,6 +14,7 @@
 #include <openxr/openxr.h>
 
 #include <memory>
+#include <string>
 
 //! Standard Error logger, on by default. Disabled with environment variable XR_LOADER_DEBUG = "none".
 std::unique_ptr<LoaderLogRecorder> MakeStdErrLoaderLogRecorder(void* user_data);
@@ -30,6 +31,10 @@ std::unique_ptr<LoaderLogRecorder> MakeLogcatLoaderLogRecorder();
 std::unique_ptr<LoaderLogRecorder> MakeDebugUtilsLoaderLogRecorder(const XrDebugUtilsMessengerCreateInfoEXT* create_info,
                                                                    XrDebugUtilsMessengerEXT debug_messenger);
 
+//! Timing logger used with the XR_LOADER_TIMING environment variable.  Writes the phases recorded since the previous
+//! report to filename, in Chrome trace event format, each time a report is requested.
+std::unique_ptr<LoaderLogRecorder> MakeTimingLoaderLogRecorder(const std::string& filename);
+
 #ifdef _WIN32
 //! Win32 debugger output
 std::unique_ptr<LoaderLogRecorder> MakeDebuggerLoaderLogRecorder(void* user_data);
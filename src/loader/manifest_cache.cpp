@@ -0,0 +1,511 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#define _CRT_SECURE_NO_WARNINGS
+#endif  // defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+
+#include "manifest_cache.hpp"
+
+#include "filesystem_utils.hpp"
+#include "loader_platform.hpp"
+#include "platform_utils.hpp"
+#include "loader_logger.hpp"
+#include "manifest_parser.hpp"
+
+#include <json/json.h>
+#include <openxr/openxr.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// Bump this whenever the layout of the cache file changes; mismatching files are ignored and rewritten.
+static const uint32_t kManifestCacheVersion = 1;
+
+#ifdef XR_OS_LINUX
+
+// Create each missing directory along path.
+static bool CreateDirectories(const std::string &path) {
+    std::string::size_type found = path.find(DIRECTORY_SYMBOL, 1);
+    while (true) {
+        std::string partial = path.substr(0, found);
+        if (mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (found == std::string::npos) {
+            return true;
+        }
+        found = path.find(DIRECTORY_SYMBOL, found + 1);
+    }
+}
+
+// Get the directory to place the cache file in, following the XDG base directory specification.
+static std::string GetCacheDirectory() {
+    std::string cache_home = PlatformUtilsGetSecureEnv("XDG_CACHE_HOME");
+    if (cache_home.empty()) {
+        std::string home = PlatformUtilsGetSecureEnv("HOME");
+        if (home.empty()) {
+            return home;
+        }
+        cache_home = home + "/.cache";
+    }
+    return cache_home + "/" OPENXR_RELATIVE_PATH + std::to_string(XR_VERSION_MAJOR(XR_CURRENT_API_VERSION));
+}
+
+static bool ReadCacheFile(const std::string &filename, Json::Value &root_node) {
+    std::ifstream json_stream(filename, std::ifstream::in);
+    if (!json_stream.is_open()) {
+        return false;
+    }
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    if (!Json::parseFromStream(builder, json_stream, &root_node, &errors) || !root_node.isObject() ||
+        !root_node["cache_version"].isUInt() || root_node["cache_version"].asUInt() != kManifestCacheVersion) {
+        LoaderLogger::LogInfoMessage("", "ManifestDiscoveryCache - ignoring unusable cache file " + filename);
+        root_node = Json::Value(Json::objectValue);
+        return false;
+    }
+    return true;
+}
+
+#endif  // XR_OS_LINUX
+
+// Stamps recorded less than this long after the file was modified may not reflect a later modification made
+// within the same coarse filesystem timestamp tick, so they are not trusted.
+static const uint64_t kRacyStampWindowNs = 1000000000ULL;
+
+static uint64_t GetCurrentTimeNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// On Windows, the file index stands in for the inode, and the modification time is moved from the FILETIME epoch
+// (1601) to the Unix epoch, so that it can be compared with GetCurrentTimeNs.
+static bool GetManifestFileStamp(const std::string &path, ManifestFileStamp &stamp) {
+#if defined(XR_OS_LINUX) || defined(XR_OS_ANDROID)
+    struct stat path_stat;
+    if (stat(path.c_str(), &path_stat) != 0) {
+        return false;
+    }
+    stamp.mtime_ns =
+        static_cast<uint64_t>(path_stat.st_mtim.tv_sec) * 1000000000ULL + static_cast<uint64_t>(path_stat.st_mtim.tv_nsec);
+    stamp.size = static_cast<uint64_t>(path_stat.st_size);
+    stamp.inode = static_cast<uint64_t>(path_stat.st_ino);
+    return true;
+#elif defined(XR_OS_APPLE)
+    struct stat path_stat;
+    if (stat(path.c_str(), &path_stat) != 0) {
+        return false;
+    }
+    stamp.mtime_ns = static_cast<uint64_t>(path_stat.st_mtimespec.tv_sec) * 1000000000ULL +
+                     static_cast<uint64_t>(path_stat.st_mtimespec.tv_nsec);
+    stamp.size = static_cast<uint64_t>(path_stat.st_size);
+    stamp.inode = static_cast<uint64_t>(path_stat.st_ino);
+    return true;
+#elif defined(XR_OS_WINDOWS)
+    // Directories can only be opened with FILE_FLAG_BACKUP_SEMANTICS.
+    HANDLE file_handle = CreateFileW(utf8_to_wide(path).c_str(), FILE_READ_ATTRIBUTES,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                     FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    BY_HANDLE_FILE_INFORMATION file_info;
+    BOOL got_info = GetFileInformationByHandle(file_handle, &file_info);
+    CloseHandle(file_handle);
+    if (!got_info) {
+        return false;
+    }
+    const uint64_t kFileTimeToUnixEpoch = 116444736000000000ULL;
+    uint64_t file_time = (static_cast<uint64_t>(file_info.ftLastWriteTime.dwHighDateTime) << 32) |
+                         static_cast<uint64_t>(file_info.ftLastWriteTime.dwLowDateTime);
+    stamp.mtime_ns = file_time > kFileTimeToUnixEpoch ? (file_time - kFileTimeToUnixEpoch) * 100ULL : 0;
+    stamp.size = (static_cast<uint64_t>(file_info.nFileSizeHigh) << 32) | static_cast<uint64_t>(file_info.nFileSizeLow);
+    stamp.inode = (static_cast<uint64_t>(file_info.nFileIndexHigh) << 32) | static_cast<uint64_t>(file_info.nFileIndexLow);
+    return true;
+#else
+    // Without a stamp, nothing is memoized or cached.
+    (void)path;
+    (void)stamp;
+    return false;
+#endif
+}
+
+// Worker threads used when XR_LOADER_PARALLEL_DISCOVERY is set to something other than a thread count.
+static const size_t kDefaultDiscoveryThreadCount = 4;
+static const size_t kMaxDiscoveryThreadCount = 16;
+
+static size_t GetDiscoveryThreadCount() {
+    std::string value = PlatformUtilsGetEnv(OPENXR_PARALLEL_DISCOVERY_ENV_VAR);
+    if (value.empty()) {
+        return 1;
+    }
+    char *end = nullptr;
+    unsigned long requested = strtoul(value.c_str(), &end, 10);
+    if (end == value.c_str() || *end != '\0') {
+        size_t hardware_threads = std::thread::hardware_concurrency();
+        return hardware_threads == 0 ? kDefaultDiscoveryThreadCount : std::min(hardware_threads, kDefaultDiscoveryThreadCount);
+    }
+    return std::max<size_t>(1, std::min<size_t>(requested, kMaxDiscoveryThreadCount));
+}
+
+static void WriteStamp(const ManifestFileStamp &stamp, Json::Value &entry) {
+    entry["mtime"] = Json::Value(static_cast<Json::UInt64>(stamp.mtime_ns));
+    entry["size"] = Json::Value(static_cast<Json::UInt64>(stamp.size));
+    entry["inode"] = Json::Value(static_cast<Json::UInt64>(stamp.inode));
+}
+
+ManifestFileRegistry &ManifestFileRegistry::GetInstance() {
+    static ManifestFileRegistry instance;
+    return instance;
+}
+
+bool ManifestFileRegistry::Lookup(const std::string &filename, const ManifestFileStamp &stamp, Json::Value &root_node,
+                                  std::string &errors) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _entries.find(filename);
+    if (found == _entries.end()) {
+        return false;
+    }
+    const Entry &entry = found->second;
+    if (entry.generation != _generation || entry.stamp.mtime_ns != stamp.mtime_ns || entry.stamp.size != stamp.size ||
+        entry.stamp.inode != stamp.inode || entry.stamp.mtime_ns + kRacyStampWindowNs > entry.recorded_ns) {
+        _entries.erase(found);
+        return false;
+    }
+    root_node = entry.root_node;
+    errors = entry.errors;
+    return true;
+}
+
+void ManifestFileRegistry::Store(const std::string &filename, const ManifestFileStamp &stamp, const Json::Value &root_node,
+                                 const std::string &errors) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Entry &entry = _entries[filename];
+    entry.stamp = stamp;
+    entry.generation = _generation;
+    entry.recorded_ns = GetCurrentTimeNs();
+    entry.root_node = root_node;
+    entry.errors = errors;
+}
+
+void ManifestFileRegistry::RecordParse(const std::string &filename) {
+    uint64_t parse_count;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        parse_count = ++_parse_count;
+    }
+    LoaderLogger::GetInstance().LogMessage(
+        XR_LOADER_LOG_MESSAGE_SEVERITY_INFO_BIT, XR_LOADER_LOG_MESSAGE_TYPE_PERFORMANCE_BIT, "OpenXR-Loader-ManifestParse", "",
+        "ManifestFileRegistry - parsing " + filename + " (manifest parse " + std::to_string(parse_count) + ")");
+}
+
+void ManifestFileRegistry::AdvanceGeneration() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    _entries.clear();
+}
+
+uint64_t ManifestFileRegistry::Generation() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _generation;
+}
+
+uint64_t ManifestFileRegistry::ParseCount() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _parse_count;
+}
+
+ManifestDiscoveryCache::ManifestDiscoveryCache(const std::string &section)
+    : _enabled(false),
+      _dirty(false),
+      _thread_count(GetDiscoveryThreadCount()),
+      _cache_mtime_ns(0),
+      _section(section),
+      _previous(Json::objectValue),
+      _current(Json::objectValue) {
+#ifdef XR_OS_LINUX
+    if (PlatformUtilsGetSecureEnv(OPENXR_MANIFEST_CACHE_ENV_VAR).empty()) {
+        return;
+    }
+    std::string cache_directory = GetCacheDirectory();
+    if (cache_directory.empty()) {
+        return;
+    }
+    _cache_filename = cache_directory + "/manifest_cache.json";
+    _enabled = true;
+    Load();
+#endif  // XR_OS_LINUX
+}
+
+void ManifestDiscoveryCache::Load() {
+#ifdef XR_OS_LINUX
+    Json::Value root_node;
+    ManifestFileStamp cache_stamp = {};
+    if (GetManifestFileStamp(_cache_filename, cache_stamp) && ReadCacheFile(_cache_filename, root_node) &&
+        root_node[_section].isObject()) {
+        _previous = root_node[_section];
+        _cache_mtime_ns = cache_stamp.mtime_ns;
+    }
+#endif  // XR_OS_LINUX
+    _current["directories"] = Json::Value(Json::objectValue);
+    _current["manifests"] = Json::Value(Json::objectValue);
+}
+
+bool ManifestDiscoveryCache::StampMatches(const Json::Value &entry, const ManifestFileStamp &stamp) const {
+    // Filesystem timestamps are coarse, so a path modified in the same tick as the cache file was written may
+    // still carry the stamp recorded for it.  Only trust stamps strictly older than the cache file itself.
+    if (stamp.mtime_ns >= _cache_mtime_ns) {
+        return false;
+    }
+    return entry.isObject() && entry["mtime"].isUInt64() && entry["mtime"].asUInt64() == stamp.mtime_ns &&
+           entry["size"].isUInt64() && entry["size"].asUInt64() == stamp.size && entry["inode"].isUInt64() &&
+           entry["inode"].asUInt64() == stamp.inode;
+}
+
+void ManifestDiscoveryCache::ForEach(size_t count, const std::function<void(size_t)> &func) {
+    size_t thread_count = std::min(_thread_count, count);
+    if (thread_count <= 1) {
+        for (size_t index = 0; index < count; ++index) {
+            func(index);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_index(0);
+    std::mutex exception_mutex;
+    std::exception_ptr first_exception;
+    auto worker = [&]() {
+        for (size_t index = next_index++; index < count; index = next_index++) {
+            try {
+                func(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!first_exception) {
+                    first_exception = std::current_exception();
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    try {
+        for (size_t thread = 1; thread < thread_count; ++thread) {
+            threads.emplace_back(worker);
+        }
+    } catch (const std::system_error &) {
+        // Carry on with however many threads could be started; this thread works through the rest.
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (first_exception) {
+        std::rethrow_exception(first_exception);
+    }
+}
+
+bool ManifestDiscoveryCache::FindFilesInPath(const std::string &path, std::vector<std::string> &files) {
+    ManifestFileStamp stamp = {};
+    if (!_enabled || !GetManifestFileStamp(path, stamp)) {
+        return FileSysUtilsFindFilesInPath(path, files);
+    }
+
+    const Json::Value &previous = _previous;
+    const Json::Value &previous_entry = previous["directories"][path];
+    if (StampMatches(previous_entry, stamp) && previous_entry["files"].isArray()) {
+        for (const auto &file : previous_entry["files"]) {
+            files.push_back(file.asString());
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _current["directories"][path] = previous_entry;
+        return true;
+    }
+
+    std::vector<std::string> found_files;
+    if (!FileSysUtilsFindFilesInPath(path, found_files)) {
+        return false;
+    }
+    Json::Value entry(Json::objectValue);
+    WriteStamp(stamp, entry);
+    Json::Value &entry_files = entry["files"] = Json::Value(Json::arrayValue);
+    for (const auto &file : found_files) {
+        entry_files.append(file);
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _current["directories"][path] = entry;
+        _dirty = true;
+    }
+    files.insert(files.end(), found_files.begin(), found_files.end());
+    return true;
+}
+
+bool ManifestDiscoveryCache::LookupManifest(const std::string &filename, Json::Value &root_node, std::string &errors) {
+    ManifestFileStamp stamp = {};
+    if (!GetManifestFileStamp(filename, stamp)) {
+        return false;
+    }
+
+    ManifestFileRegistry &registry = ManifestFileRegistry::GetInstance();
+    bool found = registry.Lookup(filename, stamp, root_node, errors);
+    if (_enabled) {
+        const Json::Value &previous = _previous;
+        const Json::Value &previous_entry = previous["manifests"][filename];
+        if (StampMatches(previous_entry, stamp) && previous_entry["contents"].isObject()) {
+            if (!found) {
+                root_node = previous_entry["contents"];
+                errors.clear();
+                registry.Store(filename, stamp, root_node, errors);
+                found = true;
+                LoaderLogger::LogInfoMessage("", "ManifestDiscoveryCache - using cached contents of " + filename);
+            }
+            _current["manifests"][filename] = previous_entry;
+        } else if (found && root_node.isObject()) {
+            RecordManifest(filename, stamp, root_node);
+        }
+    }
+    if (!found) {
+        // Remember the stamp from before the file is read, so a change made while parsing is not masked.
+        _pending_manifests[filename] = stamp;
+    }
+    return found;
+}
+
+void ManifestDiscoveryCache::StoreManifest(const std::string &filename, const Json::Value &root_node, const std::string &errors) {
+    auto pending = _pending_manifests.find(filename);
+    if (pending == _pending_manifests.end()) {
+        return;
+    }
+    ManifestFileRegistry::GetInstance().Store(filename, pending->second, root_node, errors);
+    if (_enabled && root_node.isObject()) {
+        RecordManifest(filename, pending->second, root_node);
+    }
+    _pending_manifests.erase(pending);
+}
+
+void ManifestDiscoveryCache::PrefetchManifests(const std::vector<std::string> &filenames) {
+    if (_thread_count <= 1 || filenames.size() <= 1) {
+        return;
+    }
+
+    struct PrefetchedManifest {
+        bool parsed = false;
+        ManifestFileStamp stamp = {};
+        Json::Value root_node;
+        std::string errors;
+    };
+    std::vector<PrefetchedManifest> prefetched(filenames.size());
+    ManifestFileRegistry &registry = ManifestFileRegistry::GetInstance();
+    const Json::Value &previous = _previous;
+    uint64_t now_ns = GetCurrentTimeNs();
+    ForEach(filenames.size(), [&](size_t index) {
+        const std::string &filename = filenames[index];
+        PrefetchedManifest &manifest = prefetched[index];
+        // Leave anything already known, or too recently modified for the registry to keep, to LookupManifest.
+        if (!GetManifestFileStamp(filename, manifest.stamp) || manifest.stamp.mtime_ns + kRacyStampWindowNs > now_ns) {
+            return;
+        }
+        Json::Value known_root_node;
+        std::string known_errors;
+        if (registry.Lookup(filename, manifest.stamp, known_root_node, known_errors) ||
+            (_enabled && StampMatches(previous["manifests"][filename], manifest.stamp))) {
+            return;
+        }
+        // Failures to open are reported when CreateIfValid tries again.
+        LoaderTimingScope parse_timing("Parse manifest", filename);
+        ManifestFileMapping mapping;
+        if (!mapping.Open(filename)) {
+            return;
+        }
+        if (!ParseManifestJson(mapping.Data(), mapping.Size(), manifest.root_node, manifest.errors) ||
+            !manifest.root_node.isObject()) {
+            manifest.root_node = Json::nullValue;
+        }
+        manifest.parsed = true;
+    });
+
+    // Report and publish the results on this thread, in search order.
+    for (size_t index = 0; index < filenames.size(); ++index) {
+        PrefetchedManifest &manifest = prefetched[index];
+        if (manifest.parsed) {
+            registry.RecordParse(filenames[index]);
+            registry.Store(filenames[index], manifest.stamp, manifest.root_node, manifest.errors);
+        }
+    }
+}
+
+void ManifestDiscoveryCache::RecordManifest(const std::string &filename, const ManifestFileStamp &stamp,
+                                            const Json::Value &root_node) {
+    Json::Value entry(Json::objectValue);
+    WriteStamp(stamp, entry);
+    entry["contents"] = root_node;
+    _current["manifests"][filename] = entry;
+    _dirty = true;
+}
+
+void ManifestDiscoveryCache::Save() {
+    if (!_enabled) {
+        return;
+    }
+    // Entries that were not visited by this search are dropped, which also counts as a change.
+    const Json::Value &previous = _previous;
+    if (!_dirty && _current["directories"].size() == previous["directories"].size() &&
+        _current["manifests"].size() == previous["manifests"].size()) {
+        return;
+    }
+#ifdef XR_OS_LINUX
+    // Re-read the file so that sections written by other searches since Load() are preserved, and
+    // serialize writers within this process.  Writers in other processes are handled by the rename.
+    static std::mutex save_mutex;
+    std::lock_guard<std::mutex> lock(save_mutex);
+
+    std::string cache_directory = _cache_filename.substr(0, _cache_filename.find_last_of(DIRECTORY_SYMBOL));
+    if (!CreateDirectories(cache_directory)) {
+        LoaderLogger::LogWarningMessage("", "ManifestDiscoveryCache - failed to create cache directory " + cache_directory);
+        return;
+    }
+
+    Json::Value root_node(Json::objectValue);
+    ReadCacheFile(_cache_filename, root_node);
+    root_node["cache_version"] = Json::Value(kManifestCacheVersion);
+    root_node[_section] = _current;
+
+    std::string temp_filename = _cache_filename + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out_stream(temp_filename, std::ofstream::out | std::ofstream::trunc);
+        if (!out_stream.is_open()) {
+            LoaderLogger::LogWarningMessage("", "ManifestDiscoveryCache - failed to write cache file " + temp_filename);
+            return;
+        }
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        out_stream << Json::writeString(builder, root_node);
+        if (!out_stream.good()) {
+            out_stream.close();
+            remove(temp_filename.c_str());
+            LoaderLogger::LogWarningMessage("", "ManifestDiscoveryCache - failed to write cache file " + temp_filename);
+            return;
+        }
+    }
+    if (rename(temp_filename.c_str(), _cache_filename.c_str()) != 0) {
+        remove(temp_filename.c_str());
+        LoaderLogger::LogWarningMessage("", "ManifestDiscoveryCache - failed to replace cache file " + _cache_filename);
+        return;
+    }
+    _previous = _current;
+    _dirty = false;
+#endif  // XR_OS_LINUX
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include <json/json.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Identifies one version of a file or directory: if any of these change, cached contents are stale.
+struct ManifestFileStamp {
+    uint64_t mtime_ns;
+    uint64_t size;
+    uint64_t inode;
+};
+
+// ManifestFileRegistry class -
+// Process-wide memo of parsed manifest files, so that the searches repeated while an application enumerates
+// API layers and extensions and then creates an instance parse each manifest file only once.  An entry is
+// reused while the file stamp is unchanged and the entry belongs to the current generation.  The generation
+// advances whenever an instance is destroyed, which forgets everything parsed for the previous instance.
+class ManifestFileRegistry {
+   public:
+    static ManifestFileRegistry &GetInstance();
+
+    // Returns true if filename was already parsed in this generation.  root_node is null and errors is set if
+    // that parse failed.
+    bool Lookup(const std::string &filename, const ManifestFileStamp &stamp, Json::Value &root_node, std::string &errors);
+    void Store(const std::string &filename, const ManifestFileStamp &stamp, const Json::Value &root_node,
+               const std::string &errors);
+
+    // Called whenever a manifest file is actually read and parsed.  Each call is reported through the loader
+    // logger as a performance message carrying the running count.
+    void RecordParse(const std::string &filename);
+
+    void AdvanceGeneration();
+    uint64_t Generation();
+    uint64_t ParseCount();
+
+    // Non-copyable
+    ManifestFileRegistry(const ManifestFileRegistry &) = delete;
+    ManifestFileRegistry &operator=(const ManifestFileRegistry &) = delete;
+
+   private:
+    ManifestFileRegistry() = default;
+
+    struct Entry {
+        ManifestFileStamp stamp;
+        uint64_t generation;
+        uint64_t recorded_ns;
+        Json::Value root_node;
+        std::string errors;
+    };
+
+    std::mutex _mutex;
+    uint64_t _generation = 0;
+    uint64_t _parse_count = 0;
+    std::unordered_map<std::string, Entry> _entries;
+};
+
+// ManifestDiscoveryCache class -
+// Front end used by a single manifest search.  Manifest contents are always looked up in the
+// ManifestFileRegistry first.  Setting XR_LOADER_MANIFEST_CACHE also enables a persistent cache of
+// directory listings and manifest file contents under $XDG_CACHE_HOME (or $HOME/.cache), whose entries
+// are only reused while the path, mtime, size and inode of the directory or file are unchanged.  Only the
+// raw JSON is cached, so manifest validation (library existence, implicit layer environment variables)
+// still runs on every lookup.  On platforms other than Linux every call falls through to the filesystem.
+// Setting XR_LOADER_PARALLEL_DISCOVERY lets the search list directories and parse manifests on a few worker
+// threads; results are always consumed in search order, so the outcome matches a serial search.
+class ManifestDiscoveryCache {
+   public:
+    // Each manifest type keeps its entries in its own section of the cache file so that only the
+    // entries visited by the most recent search of that type are retained.
+    explicit ManifestDiscoveryCache(const std::string &section);
+
+    bool IsEnabled() const { return _enabled; }
+
+    // Call func(0) ... func(count - 1), spread over the worker threads if parallel discovery is enabled.
+    // Returns once every call has finished; the first exception thrown by func is rethrown here.
+    void ForEach(size_t count, const std::function<void(size_t)> &func);
+
+    // Equivalent to FileSysUtilsFindFilesInPath, answered from the cache when the directory is unchanged.
+    // Safe to call from ForEach.
+    bool FindFilesInPath(const std::string &path, std::vector<std::string> &files);
+
+    // Returns true and fills in root_node if an unchanged copy of filename is cached.  root_node is null
+    // and errors is set if filename previously failed to parse.
+    bool LookupManifest(const std::string &filename, Json::Value &root_node, std::string &errors);
+    // Record the result of parsing a manifest that missed in LookupManifest.
+    void StoreManifest(const std::string &filename, const Json::Value &root_node, const std::string &errors);
+
+    // With parallel discovery enabled, parse the manifests in filenames that are not already known on the
+    // worker threads, so that the LookupManifest calls that follow find them in the ManifestFileRegistry.
+    void PrefetchManifests(const std::vector<std::string> &filenames);
+
+    // Write the cache file back if its contents for this section changed.
+    void Save();
+
+   private:
+    bool StampMatches(const Json::Value &entry, const ManifestFileStamp &stamp) const;
+    void RecordManifest(const std::string &filename, const ManifestFileStamp &stamp, const Json::Value &root_node);
+    void Load();
+
+    bool _enabled;
+    bool _dirty;
+    size_t _thread_count;
+    // Guards _current and _dirty while FindFilesInPath runs on worker threads.
+    std::mutex _mutex;
+    uint64_t _cache_mtime_ns;
+    std::string _section;
+    std::string _cache_filename;
+    Json::Value _previous;
+    Json::Value _current;
+    std::unordered_map<std::string, ManifestFileStamp> _pending_manifests;
+};
@@ -12,6 +12,8 @@
 #endif  // defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
 
 #include "manifest_file.hpp"
+#include "manifest_cache.hpp"
+#include "manifest_parser.hpp"
 
 #ifdef OPENXR_HAVE_COMMON_CONFIG
 #include "common_config.h"
@@ -27,7 +29,6 @@
 
 #include <algorithm>
 #include <cstring>
-#include <fstream>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
@@ -77,7 +78,7 @@ static void AddIfJson(const std::string &full_file, std::vector<std::string> &ma
 // Check the current path for any manifest files.  If the provided search_path is a directory, look for
 // all included JSON files in that directory.  Otherwise, just check the provided search_path which should
 // be a single filename.
-static void CheckAllFilesInThePath(const std::string &search_path, bool is_directory_list,
+static void CheckAllFilesInThePath(const std::string &search_path, bool is_directory_list, ManifestDiscoveryCache &cache,
                                    std::vector<std::string> &manifest_files) {
     if (FileSysUtilsPathExists(search_path)) {
         std::string absolute_path;
@@ -89,7 +90,7 @@ static void CheckAllFilesInThePath(const std::string &search_path, bool is_direc
             }
         } else {
             std::vector<std::string> files;
-            if (FileSysUtilsFindFilesInPath(search_path, files)) {
+            if (cache.FindFilesInPath(search_path, files)) {
                 for (std::string &cur_file : files) {
                     std::string relative_path;
                     FileSysUtilsCombinePaths(search_path, cur_file, relative_path);
@@ -106,18 +107,17 @@ static void CheckAllFilesInThePath(const std::string &search_path, bool is_direc
 // Add all manifest files in the provided paths to the manifest_files list.  If search_path
 // is made up of directory listings (versus direct manifest file names) search each path for
 // any manifest files.
-static void AddFilesInPath(const std::string &search_path, bool is_directory_list, std::vector<std::string> &manifest_files) {
+static void AddFilesInPath(const std::string &search_path, bool is_directory_list, ManifestDiscoveryCache &cache,
+                           std::vector<std::string> &manifest_files) {
     std::size_t last_found = 0;
     std::size_t found = search_path.find_first_of(PATH_SEPARATOR);
-    std::string cur_search;
+    std::vector<std::string> cur_searches;
 
     // Handle any path listings in the string (separated by the appropriate path separator)
     while (found != std::string::npos) {
         // substr takes a start index and length.
         std::size_t length = found - last_found;
-        cur_search = search_path.substr(last_found, length);
-
-        CheckAllFilesInThePath(cur_search, is_directory_list, manifest_files);
+        cur_searches.push_back(search_path.substr(last_found, length));
 
         // This works around issue if multiple path separator follow each other directly.
         last_found = found;
@@ -129,8 +129,15 @@ static void AddFilesInPath(const std::string &search_path, bool is_directory_lis
 
     // If there's something remaining in the string, copy it over
     if (last_found < search_path.size()) {
-        cur_search = search_path.substr(last_found);
-        CheckAllFilesInThePath(cur_search, is_directory_list, manifest_files);
+        cur_searches.push_back(search_path.substr(last_found));
+    }
+
+    // The paths may be searched concurrently, but their results are added in search path order.
+    std::vector<std::vector<std::string>> found_files(cur_searches.size());
+    cache.ForEach(cur_searches.size(),
+                  [&](size_t index) { CheckAllFilesInThePath(cur_searches[index], is_directory_list, cache, found_files[index]); });
+    for (auto &files : found_files) {
+        manifest_files.insert(manifest_files.end(), files.begin(), files.end());
     }
 }
 
@@ -170,7 +177,8 @@ static void CopyIncludedPaths(bool is_directory_list, const std::string &cur_pat
 
 // Look for data files in the provided paths, but first check the environment override to determine if we should use that instead.
 static void ReadDataFilesInSearchPaths(ManifestFileType type, const std::string &override_env_var, const std::string &relative_path,
-                                       bool &override_active, std::vector<std::string> &manifest_files) {
+                                       ManifestDiscoveryCache &cache, bool &override_active,
+                                       std::vector<std::string> &manifest_files) {
     bool is_directory_list = true;
     bool is_runtime = (type == MANIFEST_TYPE_RUNTIME);
     std::string override_path;
@@ -240,7 +248,7 @@ static void ReadDataFilesInSearchPaths(ManifestFileType type, const std::string
     }
 
     // Now, parse the paths and add any manifest files found in them.
-    AddFilesInPath(search_path, is_directory_list, manifest_files);
+    AddFilesInPath(search_path, is_directory_list, cache, manifest_files);
 }
 
 #ifdef XR_OS_LINUX
@@ -327,7 +335,7 @@ static bool FindXDGConfigFile(const std::string &relative_path, std::string &out
 // Look for runtime data files in the provided paths, but first check the environment override to determine
 // if we should use that instead.
 static void ReadRuntimeDataFilesInRegistry(const std::string &runtime_registry_location,
-                                           const std::string &default_runtime_value_name,
+                                           const std::string &default_runtime_value_name, ManifestDiscoveryCache &cache,
                                            std::vector<std::string> &manifest_files) {
     HKEY hkey;
     DWORD access_flags;
@@ -355,13 +363,14 @@ static void ReadRuntimeDataFilesInRegistry(const std::string &runtime_registry_l
         LoaderLogger::LogWarningMessage(
             "", "ReadRuntimeDataFilesInRegistry - failed to read registry value " + default_runtime_value_name);
     } else {
-        AddFilesInPath(wide_to_utf8(value_w), false, manifest_files);
+        AddFilesInPath(wide_to_utf8(value_w), false, cache, manifest_files);
     }
 }
 
 // Look for layer data files in the provided paths, but first check the environment override to determine
 // if we should use that instead.
-static void ReadLayerDataFilesInRegistry(const std::string &registry_location, std::vector<std::string> &manifest_files) {
+static void ReadLayerDataFilesInRegistry(const std::string &registry_location, ManifestDiscoveryCache &cache,
+                                         std::vector<std::string> &manifest_files) {
     const std::wstring full_registry_location_w =
         utf8_to_wide(OPENXR_REGISTRY_LOCATION + std::to_string(XR_VERSION_MAJOR(XR_CURRENT_API_VERSION)) + registry_location);
 
@@ -382,7 +391,7 @@ static void ReadLayerDataFilesInRegistry(const std::string &registry_location, s
                (rtn_value = RegEnumValueW(hkey, key_index++, name_w, &name_size, NULL, NULL, (LPBYTE)&value, &value_size))) {
             if (value_size == sizeof(value) && value == 0) {
                 const std::string filename = wide_to_utf8(name_w);
-                AddFilesInPath(filename, false, manifest_files);
+                AddFilesInPath(filename, false, cache, manifest_files);
             }
             // Reset some items for the next loop
             name_size = 1023;
@@ -513,21 +522,27 @@ void ManifestFile::ParseCommon(Json::Value const &root_node) {
     }
 }
 
-void RuntimeManifestFile::CreateIfValid(std::string const &filename,
+void RuntimeManifestFile::CreateIfValid(std::string const &filename, ManifestDiscoveryCache &cache,
                                         std::vector<std::unique_ptr<RuntimeManifestFile>> &manifest_files) {
-    std::ifstream json_stream(filename, std::ifstream::in);
-
     LoaderLogger::LogInfoMessage("", "RuntimeManifestFile::CreateIfValid - attempting to load " + filename);
     std::ostringstream error_ss("RuntimeManifestFile::CreateIfValid ");
-    if (!json_stream.is_open()) {
-        error_ss << "failed to open " << filename << ".  Does it exist?";
-        LoaderLogger::LogErrorMessage("", error_ss.str());
-        return;
-    }
-    Json::CharReaderBuilder builder;
-    std::string errors;
     Json::Value root_node = Json::nullValue;
-    if (!Json::parseFromStream(builder, json_stream, &root_node, &errors) || !root_node.isObject()) {
+    std::string errors;
+    if (!cache.LookupManifest(filename, root_node, errors)) {
+        LoaderTimingScope parse_timing("Parse manifest", filename);
+        ManifestFileMapping mapping;
+        if (!mapping.Open(filename)) {
+            error_ss << "failed to open " << filename << ".  Does it exist?";
+            LoaderLogger::LogErrorMessage("", error_ss.str());
+            return;
+        }
+        ManifestFileRegistry::GetInstance().RecordParse(filename);
+        if (!ParseManifestJson(mapping.Data(), mapping.Size(), root_node, errors) || !root_node.isObject()) {
+            root_node = Json::nullValue;
+        }
+        cache.StoreManifest(filename, root_node, errors);
+    }
+    if (!root_node.isObject()) {
         error_ss << "failed to parse " << filename << ".";
         if (!errors.empty()) {
             error_ss << " (Error message: " << errors << ")";
@@ -600,6 +615,8 @@ XrResult RuntimeManifestFile::FindManifestFiles(ManifestFileType type,
         LoaderLogger::LogErrorMessage("", "RuntimeManifestFile::FindManifestFiles - unknown manifest file requested");
         return XR_ERROR_FILE_ACCESS_ERROR;
     }
+    LoaderTimingScope find_timing("RuntimeManifestFile::FindManifestFiles");
+    ManifestDiscoveryCache cache("runtime");
     std::string filename = PlatformUtilsGetSecureEnv(OPENXR_RUNTIME_JSON_ENV_VAR);
     if (!filename.empty()) {
         LoaderLogger::LogInfoMessage(
@@ -607,7 +624,7 @@ XrResult RuntimeManifestFile::FindManifestFiles(ManifestFileType type,
     } else {
 #ifdef XR_OS_WINDOWS
         std::vector<std::string> filenames;
-        ReadRuntimeDataFilesInRegistry("", "ActiveRuntime", filenames);
+        ReadRuntimeDataFilesInRegistry("", "ActiveRuntime", cache, filenames);
         if (filenames.size() == 0) {
             LoaderLogger::LogErrorMessage(
                 "", "RuntimeManifestFile::FindManifestFiles - failed to find active runtime file in registry");
@@ -637,7 +654,8 @@ XrResult RuntimeManifestFile::FindManifestFiles(ManifestFileType type,
 #endif
         LoaderLogger::LogInfoMessage("", "RuntimeManifestFile::FindManifestFiles - using global runtime file " + filename);
     }
-    RuntimeManifestFile::CreateIfValid(filename, manifest_files);
+    RuntimeManifestFile::CreateIfValid(filename, cache, manifest_files);
+    cache.Save();
     return result;
 }
 
@@ -650,21 +668,26 @@ ApiLayerManifestFile::ApiLayerManifestFile(ManifestFileType type, const std::str
       _description(description),
       _implementation_version(implementation_version) {}
 
-void ApiLayerManifestFile::CreateIfValid(ManifestFileType type, const std::string &filename,
+void ApiLayerManifestFile::CreateIfValid(ManifestFileType type, const std::string &filename, ManifestDiscoveryCache &cache,
                                          std::vector<std::unique_ptr<ApiLayerManifestFile>> &manifest_files) {
-    std::ifstream json_stream(filename, std::ifstream::in);
-
     std::ostringstream error_ss("ApiLayerManifestFile::CreateIfValid ");
-    if (!json_stream.is_open()) {
-        error_ss << "failed to open " << filename << ".  Does it exist?";
-        LoaderLogger::LogErrorMessage("", error_ss.str());
-        return;
-    }
-
-    Json::CharReaderBuilder builder;
-    std::string errors;
     Json::Value root_node = Json::nullValue;
-    if (!Json::parseFromStream(builder, json_stream, &root_node, &errors) || !root_node.isObject()) {
+    std::string errors;
+    if (!cache.LookupManifest(filename, root_node, errors)) {
+        LoaderTimingScope parse_timing("Parse manifest", filename);
+        ManifestFileMapping mapping;
+        if (!mapping.Open(filename)) {
+            error_ss << "failed to open " << filename << ".  Does it exist?";
+            LoaderLogger::LogErrorMessage("", error_ss.str());
+            return;
+        }
+        ManifestFileRegistry::GetInstance().RecordParse(filename);
+        if (!ParseManifestJson(mapping.Data(), mapping.Size(), root_node, errors) || !root_node.isObject()) {
+            root_node = Json::nullValue;
+        }
+        cache.StoreManifest(filename, root_node, errors);
+    }
+    if (!root_node.isObject()) {
         error_ss << "failed to parse " << filename << ".";
         if (!errors.empty()) {
             error_ss << " (Error message: " << errors << ")";
@@ -791,9 +814,12 @@ void ApiLayerManifestFile::PopulateApiLayerProperties(XrApiLayerProperties &prop
 // Find all layer manifest files in the appropriate search paths/registries for the given type.
 XrResult ApiLayerManifestFile::FindManifestFiles(ManifestFileType type,
                                                  std::vector<std::unique_ptr<ApiLayerManifestFile>> &manifest_files) {
+    LoaderTimingScope find_timing("ApiLayerManifestFile::FindManifestFiles",
+                                  type == MANIFEST_TYPE_IMPLICIT_API_LAYER ? "implicit" : "explicit");
     std::string relative_path;
     std::string override_env_var;
     std::string registry_location;
+    std::string cache_section;
 
     // Add the appropriate top-level folders for the relative path.  These should be
     // the string "openxr/" followed by the API major version as a string.
@@ -804,6 +830,7 @@ XrResult ApiLayerManifestFile::FindManifestFiles(ManifestFileType type,
         case MANIFEST_TYPE_IMPLICIT_API_LAYER:
             relative_path += OPENXR_IMPLICIT_API_LAYER_RELATIVE_PATH;
             override_env_var = "";
+            cache_section = "implicit_api_layers";
 #ifdef XR_OS_WINDOWS
             registry_location = OPENXR_IMPLICIT_API_LAYER_REGISTRY_LOCATION;
 #endif
@@ -811,6 +838,7 @@ XrResult ApiLayerManifestFile::FindManifestFiles(ManifestFileType type,
         case MANIFEST_TYPE_EXPLICIT_API_LAYER:
             relative_path += OPENXR_EXPLICIT_API_LAYER_RELATIVE_PATH;
             override_env_var = OPENXR_API_LAYER_PATH_ENV_VAR;
+            cache_section = "explicit_api_layers";
 #ifdef XR_OS_WINDOWS
             registry_location = OPENXR_EXPLICIT_API_LAYER_REGISTRY_LOCATION;
 #endif
@@ -820,27 +848,31 @@ XrResult ApiLayerManifestFile::FindManifestFiles(ManifestFileType type,
             return XR_ERROR_FILE_ACCESS_ERROR;
     }
 
+    ManifestDiscoveryCache cache(cache_section);
     bool override_active = false;
     std::vector<std::string> filenames;
-    ReadDataFilesInSearchPaths(type, override_env_var, relative_path, override_active, filenames);
+    ReadDataFilesInSearchPaths(type, override_env_var, relative_path, cache, override_active, filenames);
 
 #ifdef XR_OS_WINDOWS
     // Read the registry if the override wasn't active.
     if (!override_active) {
-        ReadLayerDataFilesInRegistry(registry_location, filenames);
+        ReadLayerDataFilesInRegistry(registry_location, cache, filenames);
     }
 #endif
 
+    cache.PrefetchManifests(filenames);
+
     switch (type) {
         case MANIFEST_TYPE_IMPLICIT_API_LAYER:
         case MANIFEST_TYPE_EXPLICIT_API_LAYER:
             for (std::string &cur_file : filenames) {
-                ApiLayerManifestFile::CreateIfValid(type, cur_file, manifest_files);
+                ApiLayerManifestFile::CreateIfValid(type, cur_file, cache, manifest_files);
             }
             break;
         default:
             break;
     }
+    cache.Save();
 
     return XR_SUCCESS;
 }
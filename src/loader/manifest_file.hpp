@@ -20,6 +20,8 @@ namespace Json {
 class Value;
 }
 
+class ManifestDiscoveryCache;
+
 enum ManifestFileType {
     MANIFEST_TYPE_UNDEFINED = 0,
     MANIFEST_TYPE_RUNTIME,
@@ -74,7 +76,8 @@ class RuntimeManifestFile : public ManifestFile {
 
    private:
     RuntimeManifestFile(const std::string &filename, const std::string &library_path);
-    static void CreateIfValid(const std::string &filename, std::vector<std::unique_ptr<RuntimeManifestFile>> &manifest_files);
+    static void CreateIfValid(const std::string &filename, ManifestDiscoveryCache &cache,
+                              std::vector<std::unique_ptr<RuntimeManifestFile>> &manifest_files);
 };
 
 // ApiLayerManifestFile class -
@@ -91,7 +94,7 @@ class ApiLayerManifestFile : public ManifestFile {
     ApiLayerManifestFile(ManifestFileType type, const std::string &filename, const std::string &layer_name,
                          const std::string &description, const JsonVersion &api_version, const uint32_t &implementation_version,
                          const std::string &library_path);
-    static void CreateIfValid(ManifestFileType type, const std::string &filename,
+    static void CreateIfValid(ManifestFileType type, const std::string &filename, ManifestDiscoveryCache &cache,
                               std::vector<std::unique_ptr<ApiLayerManifestFile>> &manifest_files);
 
     JsonVersion _api_version;
@@ -0,0 +1,545 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#define _CRT_SECURE_NO_WARNINGS
+#endif  // defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+
+#include "manifest_parser.hpp"
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <locale>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#if defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define XR_MANIFEST_USE_MMAP 1
+#endif  // defined(XR_OS_LINUX) || defined(XR_OS_APPLE)
+
+ManifestFileMapping::~ManifestFileMapping() {
+#ifdef XR_MANIFEST_USE_MMAP
+    if (_mapped) {
+        munmap(const_cast<char *>(_data), _size);
+    }
+#endif  // XR_MANIFEST_USE_MMAP
+}
+
+bool ManifestFileMapping::Open(const std::string &filename) {
+#ifdef XR_MANIFEST_USE_MMAP
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+        void *mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            close(fd);
+            _data = static_cast<const char *>(mapping);
+            _size = static_cast<size_t>(file_stat.st_size);
+            _mapped = true;
+            return true;
+        }
+    }
+    close(fd);
+#endif  // XR_MANIFEST_USE_MMAP
+
+    // Empty files, and anything that cannot be mapped, are read into memory instead.
+    std::ifstream file_stream(filename, std::ifstream::in | std::ifstream::binary);
+    if (!file_stream.is_open()) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file_stream.rdbuf();
+    _contents = contents.str();
+    _data = _contents.data();
+    _size = _contents.size();
+    return true;
+}
+
+namespace {
+
+// Pointer and length into the manifest buffer, standing in for std::string_view.
+struct StringRef {
+    const char *data;
+    size_t size;
+
+    bool Equals(const char *literal) const { return strlen(literal) == size && memcmp(literal, data, size) == 0; }
+};
+
+// How much of a value to copy into the Json::Value being built.
+enum class MemberScope {
+    Skip,          // scan only
+    Root,          // the top-level object: keep "file_format_version", "runtime" and "api_layer"
+    ManifestBody,  // the "runtime" or "api_layer" object: keep the members ManifestFile reads
+    KeepAll,       // copy the whole value
+};
+
+const char *const kManifestBodyMembers[] = {
+    "name",        "api_version",         "library_path",       "implementation_version", "description",
+    "functions",   "instance_extensions", "enable_environment", "disable_environment",
+};
+
+// Matches the default jsoncpp stack limit.
+const size_t kMaxDepth = 1000;
+
+MemberScope GetMemberScope(MemberScope parent_scope, const StringRef &key) {
+    switch (parent_scope) {
+        case MemberScope::Root:
+            if (key.Equals("file_format_version")) {
+                return MemberScope::KeepAll;
+            }
+            if (key.Equals("runtime") || key.Equals("api_layer")) {
+                return MemberScope::ManifestBody;
+            }
+            return MemberScope::Skip;
+        case MemberScope::ManifestBody:
+            for (const char *member : kManifestBodyMembers) {
+                if (key.Equals(member)) {
+                    return MemberScope::KeepAll;
+                }
+            }
+            return MemberScope::Skip;
+        case MemberScope::KeepAll:
+            return MemberScope::KeepAll;
+        case MemberScope::Skip:
+        default:
+            return MemberScope::Skip;
+    }
+}
+
+int HexDigitValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+void AppendUtf8(uint32_t code_point, std::string &out) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+// Recursive descent parser for plain JSON plus the comments jsoncpp accepts.  It rejects anything else,
+// leaving jsoncpp to handle (or report) the more unusual input it tolerates.
+class StreamingManifestParser {
+   public:
+    StreamingManifestParser(const char *data, size_t size) : _cur(data), _end(data + size) {}
+
+    bool Parse(Json::Value &root_node) {
+        if (!SkipWhitespace() || _cur == _end || *_cur != '{') {
+            return false;
+        }
+        // jsoncpp ignores anything after the root value by default, so do the same.
+        return ParseObject(&root_node, MemberScope::Root, 1);
+    }
+
+   private:
+    bool SkipWhitespace() {
+        while (_cur != _end) {
+            char c = *_cur;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                ++_cur;
+            } else if (c == '/' && _end - _cur > 1 && _cur[1] == '/') {
+                while (_cur != _end && *_cur != '\n' && *_cur != '\r') {
+                    ++_cur;
+                }
+            } else if (c == '/' && _end - _cur > 1 && _cur[1] == '*') {
+                _cur += 2;
+                while (true) {
+                    if (_end - _cur < 2) {
+                        return false;
+                    }
+                    if (_cur[0] == '*' && _cur[1] == '/') {
+                        _cur += 2;
+                        break;
+                    }
+                    ++_cur;
+                }
+            } else {
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool Expect(char c) {
+        if (!SkipWhitespace() || _cur == _end || *_cur != c) {
+            return false;
+        }
+        ++_cur;
+        return true;
+    }
+
+    bool ParseValue(Json::Value *out, MemberScope scope, size_t depth) {
+        if (depth > kMaxDepth || !SkipWhitespace() || _cur == _end) {
+            return false;
+        }
+        switch (*_cur) {
+            case '{':
+                return ParseObject(out, scope, depth + 1);
+            case '[':
+                return ParseArray(out, depth + 1);
+            case '"': {
+                StringRef raw = {};
+                bool has_escapes = false;
+                if (!ScanString(raw, has_escapes)) {
+                    return false;
+                }
+                if (out != nullptr) {
+                    if (!has_escapes) {
+                        *out = Json::Value(raw.data, raw.data + raw.size);
+                    } else {
+                        std::string decoded;
+                        if (!DecodeString(raw, decoded)) {
+                            return false;
+                        }
+                        *out = Json::Value(decoded);
+                    }
+                }
+                return true;
+            }
+            case 't':
+                return ParseLiteral("true", out, Json::Value(true));
+            case 'f':
+                return ParseLiteral("false", out, Json::Value(false));
+            case 'n':
+                return ParseLiteral("null", out, Json::Value());
+            default:
+                return ParseNumber(out);
+        }
+    }
+
+    bool ParseObject(Json::Value *out, MemberScope scope, size_t depth) {
+        ++_cur;  // '{'
+        if (out != nullptr) {
+            *out = Json::Value(Json::objectValue);
+        }
+        if (!SkipWhitespace() || _cur == _end) {
+            return false;
+        }
+        if (*_cur == '}') {
+            ++_cur;
+            return true;
+        }
+        while (true) {
+            StringRef raw_key = {};
+            bool key_has_escapes = false;
+            if (!SkipWhitespace() || _cur == _end || *_cur != '"' || !ScanString(raw_key, key_has_escapes) || !Expect(':')) {
+                return false;
+            }
+
+            std::string decoded_key;
+            StringRef key = raw_key;
+            if (key_has_escapes) {
+                if (!DecodeString(raw_key, decoded_key)) {
+                    return false;
+                }
+                key = StringRef{decoded_key.data(), decoded_key.size()};
+            }
+            MemberScope member_scope = (out == nullptr) ? MemberScope::Skip : GetMemberScope(scope, key);
+            Json::Value *member = nullptr;
+            if (member_scope != MemberScope::Skip) {
+                member = &out->operator[](std::string(key.data, key.size));
+            }
+            if (!ParseValue(member, member_scope, depth)) {
+                return false;
+            }
+
+            if (!SkipWhitespace() || _cur == _end) {
+                return false;
+            }
+            if (*_cur == ',') {
+                ++_cur;
+            } else if (*_cur == '}') {
+                ++_cur;
+                return true;
+            } else {
+                return false;
+            }
+        }
+    }
+
+    bool ParseArray(Json::Value *out, size_t depth) {
+        ++_cur;  // '['
+        if (out != nullptr) {
+            *out = Json::Value(Json::arrayValue);
+        }
+        if (!SkipWhitespace() || _cur == _end) {
+            return false;
+        }
+        if (*_cur == ']') {
+            ++_cur;
+            return true;
+        }
+        while (true) {
+            Json::Value *element = nullptr;
+            if (out != nullptr) {
+                element = &out->append(Json::Value());
+            }
+            if (!ParseValue(element, out != nullptr ? MemberScope::KeepAll : MemberScope::Skip, depth)) {
+                return false;
+            }
+            if (!SkipWhitespace() || _cur == _end) {
+                return false;
+            }
+            if (*_cur == ',') {
+                ++_cur;
+            } else if (*_cur == ']') {
+                ++_cur;
+                return true;
+            } else {
+                return false;
+            }
+        }
+    }
+
+    // Find the extent of the string starting at the current '"', checking escapes without decoding them.
+    bool ScanString(StringRef &raw, bool &has_escapes) {
+        ++_cur;  // '"'
+        const char *start = _cur;
+        has_escapes = false;
+        while (_cur != _end) {
+            char c = *_cur;
+            if (c == '"') {
+                raw = StringRef{start, static_cast<size_t>(_cur - start)};
+                ++_cur;
+                return true;
+            }
+            if (c == '\\') {
+                has_escapes = true;
+                if (_end - _cur < 2) {
+                    return false;
+                }
+                _cur += 2;
+                continue;
+            }
+            ++_cur;
+        }
+        return false;
+    }
+
+    static bool ReadHex4(const char *&cur, const char *end, uint32_t &value) {
+        if (end - cur < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            int digit = HexDigitValue(*cur++);
+            if (digit < 0) {
+                return false;
+            }
+            value = (value << 4) | static_cast<uint32_t>(digit);
+        }
+        return true;
+    }
+
+    static bool DecodeString(const StringRef &raw, std::string &out) {
+        out.clear();
+        out.reserve(raw.size);
+        const char *cur = raw.data;
+        const char *end = raw.data + raw.size;
+        while (cur != end) {
+            char c = *cur++;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            char escape = *cur++;
+            switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    out += escape;
+                    break;
+                case 'b':
+                    out += '\b';
+                    break;
+                case 'f':
+                    out += '\f';
+                    break;
+                case 'n':
+                    out += '\n';
+                    break;
+                case 'r':
+                    out += '\r';
+                    break;
+                case 't':
+                    out += '\t';
+                    break;
+                case 'u': {
+                    uint32_t code_point = 0;
+                    if (!ReadHex4(cur, end, code_point)) {
+                        return false;
+                    }
+                    if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                        uint32_t low_surrogate = 0;
+                        if (end - cur < 2 || cur[0] != '\\' || cur[1] != 'u') {
+                            return false;
+                        }
+                        cur += 2;
+                        if (!ReadHex4(cur, end, low_surrogate) || low_surrogate < 0xDC00 || low_surrogate > 0xDFFF) {
+                            return false;
+                        }
+                        code_point = 0x10000 + ((code_point & 0x3FF) << 10) + (low_surrogate & 0x3FF);
+                    } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                        return false;
+                    }
+                    AppendUtf8(code_point, out);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParseLiteral(const char *literal, Json::Value *out, const Json::Value &value) {
+        size_t length = strlen(literal);
+        if (static_cast<size_t>(_end - _cur) < length || memcmp(_cur, literal, length) != 0) {
+            return false;
+        }
+        _cur += length;
+        if (out != nullptr) {
+            *out = value;
+        }
+        return true;
+    }
+
+    bool ParseNumber(Json::Value *out) {
+        const char *start = _cur;
+        bool negative = false;
+        bool integral = true;
+        if (*_cur == '-') {
+            negative = true;
+            ++_cur;
+        }
+        if (_cur == _end || *_cur < '0' || *_cur > '9') {
+            return false;
+        }
+        if (*_cur == '0') {
+            ++_cur;
+        } else {
+            while (_cur != _end && *_cur >= '0' && *_cur <= '9') {
+                ++_cur;
+            }
+        }
+        if (_cur != _end && *_cur == '.') {
+            integral = false;
+            ++_cur;
+            if (_cur == _end || *_cur < '0' || *_cur > '9') {
+                return false;
+            }
+            while (_cur != _end && *_cur >= '0' && *_cur <= '9') {
+                ++_cur;
+            }
+        }
+        if (_cur != _end && (*_cur == 'e' || *_cur == 'E')) {
+            integral = false;
+            ++_cur;
+            if (_cur != _end && (*_cur == '+' || *_cur == '-')) {
+                ++_cur;
+            }
+            if (_cur == _end || *_cur < '0' || *_cur > '9') {
+                return false;
+            }
+            while (_cur != _end && *_cur >= '0' && *_cur <= '9') {
+                ++_cur;
+            }
+        }
+        if (out == nullptr) {
+            return true;
+        }
+
+        // Follow jsoncpp: integers that fit are stored as integers, everything else as a double.
+        if (integral) {
+            const uint64_t max_magnitude =
+                negative ? static_cast<uint64_t>(INT64_MAX) + 1 : static_cast<uint64_t>(UINT64_MAX);
+            uint64_t magnitude = 0;
+            bool overflow = false;
+            for (const char *digit = negative ? start + 1 : start; digit != _cur; ++digit) {
+                auto digit_value = static_cast<uint64_t>(*digit - '0');
+                if (magnitude > (max_magnitude - digit_value) / 10) {
+                    overflow = true;
+                    break;
+                }
+                magnitude = magnitude * 10 + digit_value;
+            }
+            if (!overflow) {
+                if (negative) {
+                    *out = Json::Value(static_cast<Json::Int64>(0 - magnitude));
+                } else if (magnitude <= static_cast<uint64_t>(INT64_MAX)) {
+                    *out = Json::Value(static_cast<Json::Int64>(magnitude));
+                } else {
+                    *out = Json::Value(static_cast<Json::UInt64>(magnitude));
+                }
+                return true;
+            }
+        }
+        std::istringstream number_stream(std::string(start, _cur));
+        number_stream.imbue(std::locale::classic());
+        double value = 0.0;
+        if (!(number_stream >> value)) {
+            return false;
+        }
+        *out = Json::Value(value);
+        return true;
+    }
+
+    const char *_cur;
+    const char *_end;
+};
+
+}  // namespace
+
+bool ParseManifestJson(const char *data, size_t size, Json::Value &root_node, std::string &errors) {
+    static const char empty[] = "";
+    if (data == nullptr) {
+        data = empty;
+        size = 0;
+    }
+
+    StreamingManifestParser parser(data, size);
+    root_node = Json::Value();
+    if (parser.Parse(root_node)) {
+        return true;
+    }
+
+    // Not plain JSON: let jsoncpp decide, so that anything it tolerates still loads and its error
+    // messages are reported unchanged.
+    root_node = Json::Value();
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    return reader->parse(data, data + size, &root_node, &errors);
+}
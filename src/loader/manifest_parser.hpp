@@ -0,0 +1,45 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0 OR MIT
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Json {
+class Value;
+}
+
+// ManifestFileMapping class -
+// Read-only view of a whole manifest file.  The file is memory-mapped where the platform allows it and
+// read into memory otherwise.
+class ManifestFileMapping {
+   public:
+    ManifestFileMapping() = default;
+    ~ManifestFileMapping();
+
+    // Returns false if the file could not be opened.
+    bool Open(const std::string &filename);
+
+    const char *Data() const { return _data; }
+    size_t Size() const { return _size; }
+
+    // Non-copyable
+    ManifestFileMapping(const ManifestFileMapping &) = delete;
+    ManifestFileMapping &operator=(const ManifestFileMapping &) = delete;
+
+   private:
+    const char *_data = nullptr;
+    size_t _size = 0;
+    bool _mapped = false;
+    std::string _contents;
+};
+
+// Parse the runtime or API layer manifest in [data, data + size) into root_node.  Only the members that the
+// loader reads are copied out of the buffer: "file_format_version", and the fields of the "runtime" or
+// "api_layer" object that ManifestFile validates and keeps.  Everything else is scanned in place without
+// allocating.  If the text is not plain JSON (with optional comments), it is handed to jsoncpp instead, so
+// the result and any error message match what jsoncpp produces for the same file.
+bool ParseManifestJson(const char *data, size_t size, Json::Value &root_node, std::string &errors);
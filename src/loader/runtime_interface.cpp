@@ -108,7 +108,9 @@ XrResult InitializeLoader(const XrLoaderInitInfoBaseHeaderKHR* loaderInitInfo) {
 void RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_command,
                                                std::unique_ptr<RuntimeManifestFile>& manifest_file, bool& any_loaded,
                                                XrResult& last_error) {
+    LoaderTimingScope open_timing("LoaderPlatformLibraryOpen", manifest_file->LibraryPath());
     LoaderPlatformLibraryHandle runtime_library = LoaderPlatformLibraryOpen(manifest_file->LibraryPath());
+    open_timing.Stop();
     if (nullptr == runtime_library) {
         if (!any_loaded) {
             last_error = XR_ERROR_INSTANCE_LOST;
@@ -170,6 +172,7 @@ void RuntimeInterface::TryLoadingSingleRuntime(const std::string& openxr_command
     // could not get loaded
     XrResult res = XR_ERROR_RUNTIME_FAILURE;
     if (nullptr != negotiate) {
+        LoaderTimingScope negotiate_timing("xrNegotiateLoaderRuntimeInterface", manifest_file->LibraryPath());
         res = negotiate(&loader_info, &runtime_info);
     }
     // If we supposedly succeeded, but got a nullptr for GetInstanceProcAddr
@@ -255,6 +258,7 @@ XrResult RuntimeInterface::LoadRuntime(const std::string& openxr_command) {
     }
 #endif  // XR_KHR_LOADER_INIT_SUPPORT
 
+    LoaderTimingScope load_timing("RuntimeInterface::LoadRuntime");
     std::vector<std::unique_ptr<RuntimeManifestFile>> runtime_manifest_files = {};
     bool any_loaded = false;
 
@@ -370,11 +374,16 @@ XrResult RuntimeInterface::CreateInstance(const XrInstanceCreateInfo* info, XrIn
     bool create_succeeded = false;
     PFN_xrCreateInstance rt_xrCreateInstance;
     _get_instance_proc_addr(XR_NULL_HANDLE, "xrCreateInstance", reinterpret_cast<PFN_xrVoidFunction*>(&rt_xrCreateInstance));
-    res = rt_xrCreateInstance(info, instance);
+    {
+        LoaderTimingScope create_timing("Runtime xrCreateInstance");
+        res = rt_xrCreateInstance(info, instance);
+    }
     if (XR_SUCCEEDED(res)) {
         create_succeeded = true;
+        LoaderTimingScope populate_timing("GeneratedXrPopulateDispatchTable");
         std::unique_ptr<XrGeneratedDispatchTable> dispatch_table(new XrGeneratedDispatchTable());
         GeneratedXrPopulateDispatchTable(dispatch_table.get(), *instance, _get_instance_proc_addr);
+        populate_timing.Stop();
         std::lock_guard<std::mutex> mlock(_dispatch_table_mutex);
         _dispatch_table_map[*instance] = std::move(dispatch_table);
     }
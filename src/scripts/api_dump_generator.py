@@ -34,6 +34,21 @@ MANUALLY_DEFINED_IN_LAYER = set((
     'xrDestroyInstance',
 ))
 
+# Plain C types a replay can give new memory to, along with the OpenXR types
+REPLAY_ALLOCATABLE_TYPES = set((
+    'char',
+    'float',
+    'double',
+    'int8_t',
+    'uint8_t',
+    'int16_t',
+    'uint16_t',
+    'int32_t',
+    'uint32_t',
+    'int64_t',
+    'uint64_t',
+))
+
 # ApiDumpOutputGenerator - subclass of AutomaticSourceOutputGenerator.
 
 
@@ -55,15 +70,21 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
     #   gen_opts        the ApiDumpGeneratorOptions object
     def beginFile(self, genOpts):
         AutomaticSourceOutputGenerator.beginFile(self, genOpts)
+        self.replay_remap_structs = {}
+        self.replay_prepare_structs = {}
         preamble = ''
         if self.genOpts.filename == 'xr_generated_api_dump.hpp':
             preamble += '#pragma once\n\n'
             preamble += '#include "api_layer_platform_defines.h"\n'
+            preamble += '#include "api_dump_capture.h"\n'
+            preamble += '#include "api_dump_contents.h"\n'
+            preamble += '#include "api_dump_replay.h"\n'
             preamble += '#include <openxr/openxr.h>\n'
             preamble += '#include <openxr/openxr_platform.h>\n\n'
+            preamble += '#include <cstdint>\n'
             preamble += '#include <mutex>\n'
+            preamble += '#include <shared_mutex>\n'
             preamble += '#include <string>\n'
-            preamble += '#include <tuple>\n'
             preamble += '#include <unordered_map>\n'
             preamble += '#include <vector>\n\n'
             preamble += 'struct XrGeneratedDispatchTable;\n\n'
@@ -73,6 +94,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             preamble += '#include "hex_and_handles.h"\n\n'
             preamble += '#include <cstring>\n'
             preamble += '#include <mutex>\n'
+            preamble += '#include <shared_mutex>\n'
             preamble += '#include <sstream>\n'
             preamble += '#include <iomanip>\n'
             preamble += '#include <unordered_map>\n\n'
@@ -83,20 +105,56 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
     #   self            the ApiDumpOutputGenerator object
     def endFile(self):
         file_data = ''
+        self.replay_structure_types = dict((xr_struct.name, structure_type)
+                                           for structure_type, xr_struct in self.getTypedStructs())
         if self.genOpts.filename == 'xr_generated_api_dump.hpp':
+            file_data += self.outputApiDumpCommandIds()
             file_data += self.outputLayerHeaderPrototypes()
             file_data += self.outputApiDumpExterns()
 
         elif self.genOpts.filename == 'xr_generated_api_dump.cpp':
             file_data += self.outputApiDumpMapMutexItems()
+            file_data += self.outputApiDumpCommandNames()
             file_data += self.writeApiDumpUnionStructFuncs()
+            file_data += self.writeApiDumpCaptureFuncs()
+            file_data += self.writeApiDumpReplayFuncs()
             file_data += self.outputLayerCommands()
+            file_data += self.outputCaptureDecoder()
+            file_data += self.outputCaptureReplay()
 
         write(file_data, file=self.outFile)
 
         # Finish processing in superclass
         AutomaticSourceOutputGenerator.endFile(self)
 
+    # Every command the layer could dump, in the order they are numbered for filtering.  Commands that are only
+    # available on some platforms are still numbered everywhere, so the numbers never depend on the build.
+    #   self            the ApiDumpOutputGenerator object
+    def getDumpableCommands(self):
+        return [cur_cmd for cur_cmd in self.core_commands + self.ext_commands
+                if cur_cmd.name not in self.no_trampoline_or_terminator]
+
+    # Output the number used to filter each command.
+    #   self            the ApiDumpOutputGenerator object
+    def outputApiDumpCommandIds(self):
+        command_ids = '// Identifies each command for filtering, see ApiDumpLayerShouldDump\n'
+        command_ids += 'enum ApiDumpCommandId {\n'
+        for cur_cmd in self.getDumpableCommands():
+            command_ids += '    API_DUMP_COMMAND_%s,\n' % cur_cmd.name
+        command_ids += '    API_DUMP_COMMAND_COUNT\n'
+        command_ids += '};\n\n'
+        command_ids += 'extern const char* const g_api_dump_command_names[API_DUMP_COMMAND_COUNT];\n\n'
+        return command_ids
+
+    # Output the name of each command, indexed by its ApiDumpCommandId.
+    #   self            the ApiDumpOutputGenerator object
+    def outputApiDumpCommandNames(self):
+        command_names = '\nconst char* const g_api_dump_command_names[API_DUMP_COMMAND_COUNT] = {\n'
+        for cur_cmd in self.getDumpableCommands():
+            command_names += '    "%s",\n' % cur_cmd.name
+        command_names += '};\n\n'
+        return command_names
+
     # Output the externs required by the manual code to work with the API Dump
     # gnerated code.
     #   self            the ApiDumpOutputGenerator object
@@ -108,10 +166,20 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 externs += '#if %s\n' % handle.protect_string
             externs += 'extern std::unordered_map<%s, XrGeneratedDispatchTable*> g_%s_dispatch_map;\n' % (
                 handle.name, base_handle_name)
-            externs += 'extern std::mutex g_%s_dispatch_mutex;\n' % base_handle_name
+            externs += 'extern std::shared_timed_mutex g_%s_dispatch_mutex;\n' % base_handle_name
             if handle.protect_value is not None:
                 externs += '#endif // %s\n' % handle.protect_string
         externs += 'void ApiDumpCleanUpMapsForTable(XrGeneratedDispatchTable *table);\n'
+        externs += '\n'
+        externs += '// Find the dispatch table for a handle, only taking the map\'s mutex for reading, so that\n'
+        externs += '// threads calling through the layer at the same time do not wait on each other.\n'
+        externs += 'template <typename MapType>\n'
+        externs += 'XrGeneratedDispatchTable *findTableMapElement(const MapType &search_map, std::shared_timed_mutex &mutex,\n'
+        externs += '                                              typename MapType::key_type search_key) {\n'
+        externs += '    std::shared_lock<std::shared_timed_mutex> lock(mutex);\n'
+        externs += '    auto map_iter = search_map.find(search_key);\n'
+        externs += '    return map_iter == search_map.end() ? nullptr : map_iter->second;\n'
+        externs += '}\n'
         return externs
 
     # Output the externs manually implemented by the API Dump layer so that the generated code
@@ -122,7 +190,26 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         generated_prototypes += 'XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrGetInstanceProcAddr(XrInstance instance,\n'
         generated_prototypes += '                                          const char* name, PFN_xrVoidFunction* function);\n\n'
         generated_prototypes += '// Api Dump Log Command\n'
-        generated_prototypes += 'bool ApiDumpLayerRecordContent(std::vector<std::tuple<std::string, std::string, std::string>> contents);\n\n'
+        generated_prototypes += 'bool ApiDumpLayerRecordContent(const ApiDumpContents &contents);\n\n'
+        generated_prototypes += '// Api Dump Filtering\n'
+        generated_prototypes += 'bool ApiDumpLayerShouldDump(ApiDumpCommandId command);\n'
+        generated_prototypes += 'bool ApiDumpLayerFilteringObjects();\n'
+        generated_prototypes += 'bool ApiDumpLayerIsFilteredObject(uint64_t handle, XrObjectType object_type);\n\n'
+        generated_prototypes += '// Api Dump Object Names\n'
+        generated_prototypes += 'void ApiDumpLayerSetObjectName(const XrDebugUtilsObjectNameInfoEXT *name_info);\n'
+        generated_prototypes += 'void ApiDumpLayerRemoveObjectName(uint64_t handle, XrObjectType object_type);\n'
+        generated_prototypes += 'void ApiDumpLayerAddHandle(ApiDumpContents &contents, ApiDumpContentView type, ApiDumpContentName name,\n'
+        generated_prototypes += '                           uint64_t handle, XrObjectType object_type);\n\n'
+        generated_prototypes += '// Api Dump Trace Commands\n'
+        generated_prototypes += 'bool ApiDumpLayerTracing();\n'
+        generated_prototypes += 'uint64_t ApiDumpLayerTraceBegin();\n'
+        generated_prototypes += 'void ApiDumpLayerRecordTrace(ApiDumpCommandId command, uint64_t handle, uint64_t begin_ns);\n\n'
+        generated_prototypes += '// Api Dump Binary Capture Commands\n'
+        generated_prototypes += 'bool ApiDumpLayerCapturing();\n'
+        generated_prototypes += 'bool ApiDumpLayerRecordCapture(std::string record);\n'
+        generated_prototypes += 'bool ApiDumpLayerDecodeCapture(const std::string& capture_file_name, const std::string& output_file_name, bool html);\n'
+        generated_prototypes += 'bool ApiDumpLayerReplayCapture(const std::string& capture_file_name, ApiDumpReplayState& replay_state);\n'
+        generated_prototypes += 'bool ApiDumpLayerViewRing(const std::string& ring_file_name, double seconds, bool follow);\n\n'
         generated_prototypes += '// Api Dump Manual Functions\n'
         generated_prototypes += 'XrInstance FindInstanceFromDispatchTable(XrGeneratedDispatchTable* dispatch_table);\n'
         generated_prototypes += 'XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrCreateInstance(const XrInstanceCreateInfo *info,\n'
@@ -130,22 +217,54 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         generated_prototypes += 'XRAPI_ATTR XrResult XRAPI_CALL ApiDumpLayerXrDestroyInstance(XrInstance instance);\n'
         generated_prototypes += '\n//Dump utility functions\n'
         generated_prototypes += 'bool ApiDumpDecodeNextChain(XrGeneratedDispatchTable* gen_dispatch_table, const void* value, std::string prefix,\n'
-        generated_prototypes += '                            std::vector<std::tuple<std::string, std::string, std::string>> &contents);\n'
+        generated_prototypes += '                            ApiDumpContents &contents);\n'
         generated_prototypes += '\n// Union/Structure Output Helper function prototypes\n'
         for xr_union in self.api_unions:
             if xr_union.protect_value:
                 generated_prototypes += '#if %s\n' % xr_union.protect_string
             generated_prototypes += 'bool ApiDumpOutputXrUnion(XrGeneratedDispatchTable* gen_dispatch_table, const %s* value,\n' % xr_union.name
-            generated_prototypes += '                          std::string prefix, std::string type_string, bool is_pointer,\n'
-            generated_prototypes += '                          std::vector<std::tuple<std::string, std::string, std::string>> &contents);\n'
+            generated_prototypes += '                          std::string prefix, const char* type_string, bool is_pointer,\n'
+            generated_prototypes += '                          ApiDumpContents &contents);\n'
             if xr_union.protect_value:
                 generated_prototypes += '#endif // %s\n' % xr_union.protect_string
         for xr_struct in self.api_structures:
             if xr_struct.protect_value:
                 generated_prototypes += '#if %s\n' % xr_struct.protect_string
             generated_prototypes += 'bool ApiDumpOutputXrStruct(XrGeneratedDispatchTable* gen_dispatch_table, const %s* value,\n' % xr_struct.name
-            generated_prototypes += '                           std::string prefix, std::string type_string, bool is_pointer,\n'
-            generated_prototypes += '                           std::vector<std::tuple<std::string, std::string, std::string>> &contents);\n'
+            generated_prototypes += '                           std::string prefix, const char* type_string, bool is_pointer,\n'
+            generated_prototypes += '                           ApiDumpContents &contents);\n'
+            if xr_struct.protect_value:
+                generated_prototypes += '#endif // %s\n' % xr_struct.protect_string
+        generated_prototypes += '\n// Binary capture function prototypes\n'
+        generated_prototypes += 'void ApiDumpCaptureTypedStruct(std::string& record, const void* value, size_t fallback_size);\n'
+        generated_prototypes += 'void* ApiDumpRestoreTypedStruct(ApiDumpCaptureReader& reader);\n'
+        generated_prototypes += 'size_t ApiDumpTypedStructSize(const void* value, size_t fallback_size);\n'
+        generated_prototypes += 'void ApiDumpCaptureOutputStruct(std::string& record, const void* value, size_t fallback_size);\n'
+        generated_prototypes += 'void* ApiDumpRestoreOutputStruct(ApiDumpCaptureReader& reader);\n'
+        generated_prototypes += 'bool ApiDumpDecodeCapturedCommand(ApiDumpCaptureReader& reader, const std::string& command_name,\n'
+        generated_prototypes += '                                  ApiDumpContents &contents);\n'
+        generated_prototypes += 'void ApiDumpReplayRemapTypedStruct(ApiDumpReplayState& replay_state, const void* value);\n'
+        generated_prototypes += 'void ApiDumpReplayPrepareTypedStruct(ApiDumpCaptureReader& reader, void* value);\n'
+        generated_prototypes += 'bool ApiDumpReplayCapturedCommand(ApiDumpCaptureReader& reader, const std::string& command_name,\n'
+        generated_prototypes += '                                  ApiDumpReplayState& replay_state);\n'
+        for xr_struct in self.api_structures:
+            if not self.hasCapturePointees(xr_struct):
+                continue
+            if xr_struct.protect_value:
+                generated_prototypes += '#if %s\n' % xr_struct.protect_string
+            generated_prototypes += 'void ApiDumpCaptureXrStruct(std::string& record, const %s* value);\n' % xr_struct.name
+            generated_prototypes += 'void ApiDumpRestoreXrStruct(ApiDumpCaptureReader& reader, %s* value);\n' % xr_struct.name
+            if xr_struct.protect_value:
+                generated_prototypes += '#endif // %s\n' % xr_struct.protect_string
+        for xr_struct in self.api_structures:
+            if not self.hasReplayRemap(xr_struct) and not self.hasReplayPrepare(xr_struct):
+                continue
+            if xr_struct.protect_value:
+                generated_prototypes += '#if %s\n' % xr_struct.protect_string
+            if self.hasReplayRemap(xr_struct):
+                generated_prototypes += 'void ApiDumpReplayRemapXrStruct(ApiDumpReplayState& replay_state, %s* value);\n' % xr_struct.name
+            if self.hasReplayPrepare(xr_struct):
+                generated_prototypes += 'void ApiDumpReplayPrepareXrStruct(ApiDumpCaptureReader& reader, %s* value);\n' % xr_struct.name
             if xr_struct.protect_value:
                 generated_prototypes += '#endif // %s\n' % xr_struct.protect_string
         return generated_prototypes
@@ -163,14 +282,15 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 maps_mutexes += '#if %s\n' % handle.protect_string
             maps_mutexes += 'std::unordered_map<%s, XrGeneratedDispatchTable*> g_%s_dispatch_map;\n' % (
                 handle.name, base_handle_name)
-            maps_mutexes += 'std::mutex g_%s_dispatch_mutex;\n' % base_handle_name
+            maps_mutexes += 'std::shared_timed_mutex g_%s_dispatch_mutex;\n' % base_handle_name
             if handle.protect_value:
                 maps_mutexes += '#endif // %s\n' % handle.protect_string
         maps_mutexes += '\n'
         maps_mutexes += '// Template function to reduce duplicating the map locking, searching, and deleting.`\n'
         maps_mutexes += 'template <typename MapType>\n'
-        maps_mutexes += 'void eraseAllTableMapElements(MapType &search_map, std::mutex &mutex, XrGeneratedDispatchTable *search_value) {\n'
-        maps_mutexes += '    std::unique_lock<std::mutex> lock(mutex);\n'
+        maps_mutexes += 'void eraseAllTableMapElements(MapType &search_map, std::shared_timed_mutex &mutex,\n'
+        maps_mutexes += '                              XrGeneratedDispatchTable *search_value) {\n'
+        maps_mutexes += '    std::unique_lock<std::shared_timed_mutex> lock(mutex);\n'
         maps_mutexes += '    for (auto it = search_map.begin(); it != search_map.end();) {\n'
         maps_mutexes += '        if (it->second == search_value) {\n'
         maps_mutexes += '            search_map.erase(it++);\n'
@@ -398,16 +518,10 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         elif base_type == 'LARGE_INTEGER':
             # Unbeknownst to XR, this is actually a union. Append '.QuadPart' to get the entirety
             write_string += self.writeIndent(indent)
-            write_string += 'std::ostringstream oss_%s;\n' % int_short_param_name
-            write_string += self.writeIndent(indent)
-            write_string += 'oss_%s << ' % int_short_param_name
-            write_string += 'std::hex << reinterpret_cast<const void*>( ('
+            write_string += 'contents.AddPointer("%s", %s, reinterpret_cast<const void*>( (' % (full_type, description)
             if pointer_count > 0:   # Ignore can_dereference, must deref to access union member
                 write_string += '*' * pointer_count
-            write_string += '%s).QuadPart );\n' % full_name
-            write_string += self.writeIndent(indent)
-            write_string += 'contents.emplace_back("%s", %s' % (full_type, description)
-            write_string += ', oss_%s.str());\n' % int_short_param_name
+            write_string += '%s).QuadPart ));\n' % full_name
         elif base_type == 'timespec':
             # Unbeknownst to XR, this is actually a struct.
             write_string += self.writeIndent(indent)
@@ -462,61 +576,66 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 write_string += '} else {\n'
                 write_string += self.writeIndent(indent)
 
-            # If we're outputting using a string stream, determine the type of information
-            # we're generating and format it appropriately.
+            # Format the value straight into the contents, as hex for pointers, handles and unsigned values,
+            # and the same way std::to_string would for everything else.
+            value_string = ''
+            if can_dereference and pointer_count > 0:
+                value_string += '*' * pointer_count
+            if full_type == 'char*' and not member_param.is_static_array and not use_stream:
+                value_string += '(%s ? %s : "(nullptr)")' % (full_name, full_name)
+            else:
+                value_string += full_name
+            write_string += self.writeIndent(indent)
             if use_stream:
-                write_string += self.writeIndent(indent)
-                write_string += 'std::ostringstream oss_%s;\n' % int_short_param_name
-                write_string += self.writeIndent(indent)
                 # Output the standard type information if we can, except for characters because the
                 # hex converter will try to use the string value in the char.
                 if is_standard_type and not is_char:
-                    if 'float' in base_type:
+                    if 'float' in base_type or 'double' in base_type:
                         precision = '32'
-                        if '64' in base_type:
+                        if '64' in base_type or 'double' in base_type:
                             precision = '64'
                         elif '16' in base_type:
                             precision = '16'
-                        write_string += 'oss_%s << std::setprecision(%s) << (' % (int_short_param_name, precision)
-                    elif 'double' in base_type:
-                        write_string += 'oss_%s << std::setprecision(64) << (' % int_short_param_name
+                        write_string += 'contents.AddFloat("%s", %s, (%s), %s);\n' % (full_type, description,
+                                                                                    value_string, precision)
                     else:
-                        write_string += 'oss_%s << ' % int_short_param_name
-                        if member_param.pointer_count == 0:
-                            write_string += '"0x" << '
-                        write_string += 'std::hex << ('
+                        show_base = 'true' if member_param.pointer_count == 0 else 'false'
+                        write_string += 'contents.AddHex("%s", %s, (%s), %s);\n' % (full_type, description,
+                                                                                  value_string, show_base)
+                elif self.isHandle(base_type) and pointer_count == 0:
+                    # Handles are written along with any name the application gave them.
+                    write_string += 'ApiDumpLayerAddHandle(contents, "%s", %s, MakeHandleGeneric(%s), %s);\n' % (
+                        full_type, description, value_string, self.genXrObjectType(base_type))
                 else:
-                    write_string += 'oss_%s << ' % int_short_param_name
-                    write_string += 'std::hex << reinterpret_cast<const void*>('
-                if can_dereference and pointer_count > 0:
-                    write_string += '*' * pointer_count
-                write_string += '%s);\n' % full_name
-                write_string += self.writeIndent(indent)
-                write_string += 'contents.emplace_back("%s", %s' % (full_type, description)
-                write_string += ', oss_%s.str());\n' % int_short_param_name
-
+                    write_string += 'contents.AddPointer("%s", %s, reinterpret_cast<const void*>(%s));\n' % (
+                        full_type, description, value_string)
+            elif is_char:
+                write_string += 'contents.emplace_back("%s", %s, %s);\n' % (full_type, description, value_string)
             else:
-                write_string += self.writeIndent(indent)
-                write_string += 'contents.emplace_back("%s", %s, ' % (full_type, description)
-                if not is_char:
-                    write_string += 'std::to_string('
-                if can_dereference:
-                    write_string += '*' * pointer_count
-                if full_type == 'char*' and not member_param.is_static_array:
-                    write_string += '(%s ? %s : "(nullptr)")' % (full_name, full_name)
-                else:
-                    write_string += '%s' % full_name
-                # Close std::to_string
-                if not is_char:
-                    write_string += ')'
-                write_string += ');\n'
-
+                write_string += 'contents.AddDecimal("%s", %s, %s);\n' % (full_type, description, value_string)
             if base_type in ('XrResult', 'XrStructureType'):
                 indent = indent - 1
                 write_string += self.writeIndent(indent)
                 write_string += '}\n'
         return write_string
 
+    # When only calls touching named objects are dumped, a call is kept if any of its handle parameters
+    # has one of the names.
+    #   self            the ApiDumpOutputGenerator object
+    #   cur_cmd         the command to write the filter for
+    def writeObjectFilter(self, cur_cmd):
+        handle_checks = []
+        for param in cur_cmd.params:
+            if param.is_handle and param.pointer_count == 0:
+                handle_checks.append('ApiDumpLayerIsFilteredObject(MakeHandleGeneric(%s), %s)' % (
+                    param.name, self.genXrObjectType(param.type)))
+        if not handle_checks:
+            return ''
+        filter_string = '        if (dumping && ApiDumpLayerFilteringObjects()) {\n'
+        filter_string += '            dumping = %s;\n' % ' ||\n                      '.join(handle_checks)
+        filter_string += '        }\n'
+        return filter_string
+
     # Output a single parameter/member.
     #   self                The ApiDumpOutputGenerator object
     #   base_type           The base type of the parameter
@@ -530,7 +649,8 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
     #   prefix_string1      The second prefix string to add prior to writing out the variable information
     #   expand              Boolean indicates whether or not to try to expand/dereference the contents of this parameter
     #   indent              the number of "tabs" to space in for the resulting C+ code.
-    def writeExpandedMember(self, base_type, is_pointer, pointer_count, member_param, member_param_prefix, member_param_name, has_prefix, prefix_string1, prefix_string2, expand, indent):
+    #   leaf_name           If not None, the name to use instead of the prefix when the member is output as a single entry
+    def writeExpandedMember(self, base_type, is_pointer, pointer_count, member_param, member_param_prefix, member_param_name, has_prefix, prefix_string1, prefix_string2, expand, indent, leaf_name=None):
         member_string = ''
         derefernce_str = ''
         if not is_pointer:
@@ -602,7 +722,11 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             valid_extension_structs = None
             if member_param_struct or member_param_union:
                 valid_extension_structs = member_param.valid_extension_structs
-            member_string += prefix_string
+            # A single entry can take its name in pieces, so there is no need to build the prefixed name first.
+            if leaf_name is not None:
+                member_param_prefix = leaf_name
+            else:
+                member_string += prefix_string
 
             tmp_member_param = self.MemberOrParam(type=member_param.type,
                                                   name=member_param.name,
@@ -858,8 +982,12 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 member_param_string += self.writeIndent(indent)
                 member_param_string += '}\n'
         else:
+            leaf_name = None
+            if has_prefix:
+                leaf_name = 'ApiDumpContentName(prefix, "%s")' % member_param.name
             member_param_string += self.writeExpandedMember(base_type, is_pointer, pointer_count, member_param,
-                                                            member_param_prefix, member_param_name, has_prefix, prefix_string1, prefix_string2, can_expand, indent)
+                                                            member_param_prefix, member_param_name, has_prefix, prefix_string1, prefix_string2, can_expand, indent,
+                                                            leaf_name)
         return member_param_string
 
     # Generate the C++ output code for each member of a union or structure.
@@ -881,14 +1009,14 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             if xr_union.protect_value:
                 struct_union_check += '#if %s\n' % xr_union.protect_string
             struct_union_check += 'bool ApiDumpOutputXrUnion(XrGeneratedDispatchTable* gen_dispatch_table, const %s* value,\n' % xr_union.name
-            struct_union_check += '                          std::string prefix, std::string type_string, bool is_pointer,\n'
-            struct_union_check += '                          std::vector<std::tuple<std::string, std::string, std::string>> &contents) {\n'
+            struct_union_check += '                          std::string prefix, const char* type_string, bool is_pointer,\n'
+            struct_union_check += '                          ApiDumpContents &contents) {\n'
             struct_union_check += self.writeIndent(1)
             struct_union_check += '(void)gen_dispatch_table;  // silence warning\n'
             struct_union_check += self.writeIndent(1)
             struct_union_check += 'try {\n'
             struct_union_check += self.writeIndent(2)
-            struct_union_check += 'contents.emplace_back(type_string, prefix, PointerToHexString(value));\n'
+            struct_union_check += 'contents.AddBytes(type_string, prefix, value);\n'
             struct_union_check += self.writeIndent(2)
             struct_union_check += 'if (is_pointer) {\n'
             struct_union_check += self.writeIndent(3)
@@ -915,8 +1043,8 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
             if xr_struct.protect_value:
                 struct_union_check += '#if %s\n' % xr_struct.protect_string
             struct_union_check += 'bool ApiDumpOutputXrStruct(XrGeneratedDispatchTable* gen_dispatch_table, const %s* value,\n' % xr_struct.name
-            struct_union_check += '                           std::string prefix, std::string type_string, bool is_pointer,\n'
-            struct_union_check += '                           std::vector<std::tuple<std::string, std::string, std::string>> &contents) {\n'
+            struct_union_check += '                           std::string prefix, const char* type_string, bool is_pointer,\n'
+            struct_union_check += '                           ApiDumpContents &contents) {\n'
             indent = 1
             struct_union_check += self.writeIndent(indent)
             struct_union_check += '(void)gen_dispatch_table;  // silence warning\n'
@@ -949,7 +1077,7 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 struct_union_check += self.writeIndent(indent)
                 struct_union_check += '// Fallback path - Just output generic information about the base struct\n'
             struct_union_check += self.writeIndent(indent)
-            struct_union_check += 'contents.emplace_back(type_string, prefix, PointerToHexString(value));\n'
+            struct_union_check += 'contents.AddBytes(type_string, prefix, value);\n'
             struct_union_check += self.writeIndent(indent)
             struct_union_check += 'if (is_pointer) {\n'
             struct_union_check += self.writeIndent(indent + 1)
@@ -976,11 +1104,11 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                 struct_union_check += '#endif // %s\n' % xr_struct.protect_string
             struct_union_check += '\n'
         struct_union_check += 'bool ApiDumpDecodeNextChain(XrGeneratedDispatchTable* gen_dispatch_table, const void* value, std::string prefix,\n'
-        struct_union_check += '                            std::vector<std::tuple<std::string, std::string, std::string>> &contents) {\n'
+        struct_union_check += '                            ApiDumpContents &contents) {\n'
         struct_union_check += self.writeIndent(1)
         struct_union_check += '(void)gen_dispatch_table;  // silence warning\n'
         struct_union_check += '    try {\n'
-        struct_union_check += '        contents.emplace_back("const void *", prefix, PointerToHexString(value));\n'
+        struct_union_check += '        contents.AddBytes("const void *", prefix, value);\n'
         struct_union_check += '        if (nullptr == value) {\n'
         struct_union_check += '            return true;\n'
         struct_union_check += '        }\n'
@@ -1034,6 +1162,857 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         struct_union_check += '}\n\n'
         return struct_union_check
 
+    # Determine if a structure has a XrStructureType as its first member, so that its real type (and size) can
+    # be read from the structure itself.
+    #   self            the ApiDumpOutputGenerator object
+    #   xr_struct       the structure from automatic_source_generator
+    def isTypedStruct(self, xr_struct):
+        return xr_struct is not None and len(xr_struct.members) > 0 and xr_struct.members[0].name == 'type'
+
+    # Determine how a binary capture has to follow a member or parameter to record the memory it points to.  Only
+    # the memory the text output reads is followed, which is const pointers and the next chain.
+    #   self            the ApiDumpOutputGenerator object
+    #   member_param    the structure from automatic_source_generator for the member or parameter.
+    def getCaptureKind(self, member_param):
+        if member_param.name == 'next':
+            return 'next'
+        member_param_struct = self.getStruct(member_param.type)
+        if member_param.pointer_count == 0:
+            if member_param_struct and not member_param.is_static_array and self.hasCapturePointees(member_param_struct):
+                return 'struct'
+            return None
+        if not member_param.is_const or member_param.type == 'void':
+            return None
+        if member_param.pointer_count_var:
+            element_pointer_count = member_param.pointer_count - 1
+            if element_pointer_count == 0:
+                return 'array'
+            if element_pointer_count == 1 and member_param.type == 'char':
+                return 'string_array'
+            if element_pointer_count == 1 and self.isTypedStruct(member_param_struct):
+                return 'typed_array'
+            return None
+        if member_param.pointer_count != 1 or self.isExternalGraphicsApiHandle(member_param.type):
+            return None
+        if member_param.type == 'char':
+            return 'string'
+        if self.isTypedStruct(member_param_struct):
+            return 'typed'
+        return 'block'
+
+    # Get the C++ expression for the number of elements a member or parameter points to, or '' if it is not an array.
+    #   self            the ApiDumpOutputGenerator object
+    #   member_param    the structure from automatic_source_generator for the member or parameter.
+    #   value_prefix    the C++ prefix to access members of the same structure ('value->' or '')
+    def getCaptureCount(self, member_param, value_prefix):
+        if not member_param.pointer_count_var:
+            return ''
+        if self.isAllNumbers(member_param.pointer_count_var) or self.isAllUpperCase(member_param.pointer_count_var):
+            return member_param.pointer_count_var
+        return value_prefix + member_param.pointer_count_var
+
+    # Get every structure that can be identified by its XrStructureType, along with that type.  Aliases are
+    # skipped because they share the value of the type they alias.
+    #   self            the ApiDumpOutputGenerator object
+    def getTypedStructs(self):
+        typed_structs = []
+        enum_tuple = [x for x in self.api_enums if x.name == 'XrStructureType'][0]
+        for cur_value in enum_tuple.values:
+            struct_define_name = self.genXrStructureName(cur_value.name)
+            if struct_define_name and not cur_value.alias:
+                typed_structs.append((cur_value.name, self.getStruct(struct_define_name)))
+        return typed_structs
+
+    # Determine if a binary capture has to follow any pointers out of this structure.
+    #   self            the ApiDumpOutputGenerator object
+    #   xr_struct       the structure from automatic_source_generator
+    def hasCapturePointees(self, xr_struct):
+        for member in xr_struct.members:
+            if self.getCaptureKind(member) is not None:
+                return True
+        return False
+
+    # Generate the code that captures the memory a member or parameter points to, and the matching code that
+    # rebuilds it when decoding.  The raw bytes of the member or parameter itself have already been written.
+    #   self            the ApiDumpOutputGenerator object
+    #   member_param    the structure from automatic_source_generator for the member or parameter.
+    #   value_prefix    the C++ prefix to access members of the same structure ('value->' or '')
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeCaptureMember(self, member_param, value_prefix, indent):
+        capture_kind = self.getCaptureKind(member_param)
+        if capture_kind is None:
+            return '', ''
+        name = value_prefix + member_param.name
+        local_name = member_param.name.lower()
+        base_type = member_param.type
+        count = self.getCaptureCount(member_param, value_prefix)
+        member_param_struct = self.getStruct(base_type)
+        has_pointees = member_param_struct is not None and self.hasCapturePointees(member_param_struct)
+
+        capture = ''
+        restore = ''
+        if capture_kind == 'next':
+            capture += self.writeIndent(indent)
+            capture += 'ApiDumpCaptureTypedStruct(record, %s, sizeof(XrBaseInStructure));\n' % name
+            restore += self.writeIndent(indent)
+            if base_type == 'void':
+                restore += '%s = ApiDumpRestoreTypedStruct(reader);\n' % name
+            else:
+                next_type = base_type + '*'
+                if member_param.is_const:
+                    next_type = 'const ' + next_type
+                restore += '%s = reinterpret_cast<%s>(ApiDumpRestoreTypedStruct(reader));\n' % (name, next_type)
+        elif capture_kind == 'struct':
+            capture += self.writeIndent(indent)
+            capture += 'ApiDumpCaptureXrStruct(record, &%s);\n' % name
+            restore += self.writeIndent(indent)
+            restore += 'ApiDumpRestoreXrStruct(reader, &%s);\n' % name
+        elif capture_kind == 'string':
+            capture += self.writeIndent(indent)
+            capture += 'ApiDumpCaptureWriteString(record, %s);\n' % name
+            restore += self.writeIndent(indent)
+            restore += '%s = reader.ReadString();\n' % name
+        elif capture_kind == 'block' or capture_kind == 'typed':
+            if capture_kind == 'typed':
+                capture += self.writeIndent(indent)
+                capture += 'ApiDumpCaptureTypedStruct(record, %s, sizeof(%s));\n' % (name, base_type)
+                restore += self.writeIndent(indent)
+                restore += '%s = reinterpret_cast<const %s*>(ApiDumpRestoreTypedStruct(reader));\n' % (name, base_type)
+            else:
+                capture += self.writeIndent(indent)
+                capture += 'ApiDumpCaptureWriteBlock(record, %s, sizeof(%s));\n' % (name, base_type)
+                restore += self.writeIndent(indent)
+                restore += 'size_t %s_size = 0;\n' % local_name
+                restore += self.writeIndent(indent)
+                restore += 'auto %s_block = reinterpret_cast<%s*>(reader.ReadBlock(&%s_size));\n' % (local_name, base_type, local_name)
+                restore += self.writeIndent(indent)
+                restore += 'if (nullptr != %s_block) {\n' % local_name
+                restore += self.writeIndent(indent + 1)
+                restore += 'ApiDumpCaptureCheckSize(%s_size, sizeof(%s));\n' % (local_name, base_type)
+                if has_pointees:
+                    capture += self.writeIndent(indent)
+                    capture += 'if (nullptr != %s) {\n' % name
+                    capture += self.writeIndent(indent + 1)
+                    capture += 'ApiDumpCaptureXrStruct(record, %s);\n' % name
+                    capture += self.writeIndent(indent)
+                    capture += '}\n'
+                    restore += self.writeIndent(indent + 1)
+                    restore += 'ApiDumpRestoreXrStruct(reader, %s_block);\n' % local_name
+                restore += self.writeIndent(indent)
+                restore += '}\n'
+                restore += self.writeIndent(indent)
+                restore += '%s = %s_block;\n' % (name, local_name)
+        else:
+            # Arrays are written as a single block, followed by what each element points to.  An array of pointers
+            # is written as a block of the pointers, which is only used to tell the count and a null array apart.
+            if capture_kind == 'array':
+                element_type = base_type
+                restore_type = base_type
+            elif capture_kind == 'string_array':
+                element_type = 'const char*'
+                restore_type = 'const char*'
+            else:
+                element_type = 'const %s*' % base_type
+                restore_type = 'const %s*' % base_type
+            index_name = '%s_index' % local_name
+            capture += self.writeIndent(indent)
+            capture += 'ApiDumpCaptureWriteBlock(record, %s, sizeof(%s) * %s);\n' % (name, element_type, count)
+            restore += self.writeIndent(indent)
+            restore += 'size_t %s_size = 0;\n' % local_name
+            restore += self.writeIndent(indent)
+            restore += 'auto %s_array = reinterpret_cast<%s*>(reader.ReadBlock(&%s_size));\n' % (local_name, restore_type, local_name)
+            restore += self.writeIndent(indent)
+            restore += 'if (nullptr != %s_array) {\n' % local_name
+            restore += self.writeIndent(indent + 1)
+            restore += 'ApiDumpCaptureCheckSize(%s_size, sizeof(%s) * %s);\n' % (local_name, element_type, count)
+            element_capture = ''
+            element_restore = ''
+            if capture_kind == 'array' and has_pointees:
+                element_capture = 'ApiDumpCaptureXrStruct(record, &%s[%s]);\n' % (name, index_name)
+                element_restore = 'ApiDumpRestoreXrStruct(reader, &%s_array[%s]);\n' % (local_name, index_name)
+            elif capture_kind == 'string_array':
+                element_capture = 'ApiDumpCaptureWriteString(record, %s[%s]);\n' % (name, index_name)
+                element_restore = '%s_array[%s] = reader.ReadString();\n' % (local_name, index_name)
+            elif capture_kind == 'typed_array':
+                element_capture = 'ApiDumpCaptureTypedStruct(record, %s[%s], sizeof(%s));\n' % (name, index_name, base_type)
+                element_restore = '%s_array[%s] = reinterpret_cast<const %s*>(ApiDumpRestoreTypedStruct(reader));\n' % (
+                    local_name, index_name, base_type)
+            if element_capture:
+                capture += self.writeIndent(indent)
+                capture += 'if (nullptr != %s) {\n' % name
+                capture += self.writeIndent(indent + 1)
+                capture += 'for (uint32_t %s = 0; %s < %s; ++%s) {\n' % (index_name, index_name, count, index_name)
+                capture += self.writeIndent(indent + 2)
+                capture += element_capture
+                capture += self.writeIndent(indent + 1)
+                capture += '}\n'
+                capture += self.writeIndent(indent)
+                capture += '}\n'
+                restore += self.writeIndent(indent + 1)
+                restore += 'for (uint32_t %s = 0; %s < %s; ++%s) {\n' % (index_name, index_name, count, index_name)
+                restore += self.writeIndent(indent + 2)
+                restore += element_restore
+                restore += self.writeIndent(indent + 1)
+                restore += '}\n'
+            restore += self.writeIndent(indent)
+            restore += '}\n'
+            restore += self.writeIndent(indent)
+            restore += '%s = %s_array;\n' % (name, local_name)
+        return capture, restore
+
+    # Determine if a type is an atom, which like a handle is a value the runtime hands out.
+    #   self            the ApiDumpOutputGenerator object
+    #   type_name       the name of the type
+    def isAtom(self, type_name):
+        base_type = self.getBaseType(type_name)
+        return base_type is not None and base_type.type == 'XR_DEFINE_ATOM'
+
+    # Determine how a command parameter the runtime writes to is treated by a binary capture and its replay.
+    # Typed structures are captured, since their types, capacities and next chain are set by the caller.  Any other
+    # output is only given new memory by the replay.
+    #   self            the ApiDumpOutputGenerator object
+    #   param           the structure from automatic_source_generator for the parameter.
+    def getOutputKind(self, param):
+        if param.is_const or param.pointer_count == 0 or param.is_static_array:
+            return None
+        if param.pointer_count == 1 and self.isTypedStruct(self.getStruct(param.type)):
+            if param.pointer_count_var:
+                return 'typed_array'
+            return 'typed'
+        return 'buffer'
+
+    # Determine if a command parameter returns handles or atoms, which a replay has to map to the ones it gets back.
+    #   self            the ApiDumpOutputGenerator object
+    #   param           the structure from automatic_source_generator for the parameter.
+    def isReturnedHandle(self, param):
+        return (not param.is_const and param.pointer_count == 1 and not param.is_static_array and
+                (param.is_handle or self.isAtom(param.type)))
+
+    # Write the C++ functions used to capture structures into a binary record, and to rebuild them from one.
+    #   self            the ApiDumpOutputGenerator object
+    def writeApiDumpCaptureFuncs(self):
+        capture_funcs = '\n// Binary capture helper functions\n'
+        for xr_struct in self.api_structures:
+            if not self.hasCapturePointees(xr_struct):
+                continue
+            capture = ''
+            restore = ''
+            for member in xr_struct.members:
+                member_capture, member_restore = self.writeCaptureMember(member, 'value->', 1)
+                capture += member_capture
+                restore += member_restore
+            if xr_struct.protect_value:
+                capture_funcs += '#if %s\n' % xr_struct.protect_string
+            capture_funcs += 'void ApiDumpCaptureXrStruct(std::string& record, const %s* value) {\n' % xr_struct.name
+            capture_funcs += capture
+            capture_funcs += '}\n\n'
+            capture_funcs += 'void ApiDumpRestoreXrStruct(ApiDumpCaptureReader& reader, %s* value) {\n' % xr_struct.name
+            capture_funcs += restore
+            capture_funcs += '}\n'
+            if xr_struct.protect_value:
+                capture_funcs += '#endif // %s\n' % xr_struct.protect_string
+            capture_funcs += '\n'
+
+        # Structures with a XrStructureType are captured as the type they say they are.  A type that isn't known
+        # is captured as its header, so that the rest of a next chain is still captured.
+        typed_structs = self.getTypedStructs()
+        capture_funcs += 'void ApiDumpCaptureTypedStruct(std::string& record, const void* value, size_t fallback_size) {\n'
+        capture_funcs += '    if (nullptr == value) {\n'
+        capture_funcs += '        ApiDumpCaptureWriteBlock(record, nullptr, 0);\n'
+        capture_funcs += '        return;\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '    const XrBaseInStructure* header = reinterpret_cast<const XrBaseInStructure*>(value);\n'
+        capture_funcs += '    switch (header->type) {\n'
+        for structure_type, xr_struct in typed_structs:
+            if xr_struct.protect_value:
+                capture_funcs += '#if %s\n' % xr_struct.protect_string
+            capture_funcs += '        case %s:\n' % structure_type
+            capture_funcs += '            ApiDumpCaptureWriteBlock(record, value, sizeof(%s));\n' % xr_struct.name
+            capture_funcs += '            ApiDumpCaptureXrStruct(record, reinterpret_cast<const %s*>(value));\n' % xr_struct.name
+            capture_funcs += '            return;\n'
+            if xr_struct.protect_value:
+                capture_funcs += '#endif // %s\n' % xr_struct.protect_string
+        capture_funcs += '        default:\n'
+        capture_funcs += '            ApiDumpCaptureWriteBlock(record, value, fallback_size);\n'
+        capture_funcs += '            ApiDumpCaptureTypedStruct(record, header->next, sizeof(XrBaseInStructure));\n'
+        capture_funcs += '            return;\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '}\n\n'
+        capture_funcs += 'void* ApiDumpRestoreTypedStruct(ApiDumpCaptureReader& reader) {\n'
+        capture_funcs += '    size_t size = 0;\n'
+        capture_funcs += '    void* value = reader.ReadBlock(&size);\n'
+        capture_funcs += '    if (nullptr == value) {\n'
+        capture_funcs += '        return nullptr;\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '    ApiDumpCaptureCheckSize(size, sizeof(XrBaseInStructure));\n'
+        capture_funcs += '    XrBaseInStructure* header = reinterpret_cast<XrBaseInStructure*>(value);\n'
+        capture_funcs += '    switch (header->type) {\n'
+        for structure_type, xr_struct in typed_structs:
+            if xr_struct.protect_value:
+                capture_funcs += '#if %s\n' % xr_struct.protect_string
+            capture_funcs += '        case %s:\n' % structure_type
+            capture_funcs += '            ApiDumpCaptureCheckSize(size, sizeof(%s));\n' % xr_struct.name
+            capture_funcs += '            ApiDumpRestoreXrStruct(reader, reinterpret_cast<%s*>(value));\n' % xr_struct.name
+            capture_funcs += '            return value;\n'
+            if xr_struct.protect_value:
+                capture_funcs += '#endif // %s\n' % xr_struct.protect_string
+        capture_funcs += '        default:\n'
+        capture_funcs += '            header->next = reinterpret_cast<XrBaseInStructure*>(ApiDumpRestoreTypedStruct(reader));\n'
+        capture_funcs += '            return value;\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '}\n\n'
+
+        # Output structures are only captured so that a replay can pass the same types, capacities and next chain
+        # down again.  What they point to has not been filled in yet, so only the structures themselves are written.
+        capture_funcs += 'size_t ApiDumpTypedStructSize(const void* value, size_t fallback_size) {\n'
+        capture_funcs += '    if (nullptr == value) {\n'
+        capture_funcs += '        return fallback_size;\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '    switch (reinterpret_cast<const XrBaseOutStructure*>(value)->type) {\n'
+        for structure_type, xr_struct in typed_structs:
+            if xr_struct.protect_value:
+                capture_funcs += '#if %s\n' % xr_struct.protect_string
+            capture_funcs += '        case %s:\n' % structure_type
+            capture_funcs += '            return sizeof(%s);\n' % xr_struct.name
+            if xr_struct.protect_value:
+                capture_funcs += '#endif // %s\n' % xr_struct.protect_string
+        capture_funcs += '        default:\n'
+        capture_funcs += '            return fallback_size;\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '}\n\n'
+        capture_funcs += 'void ApiDumpCaptureOutputStruct(std::string& record, const void* value, size_t fallback_size) {\n'
+        capture_funcs += '    ApiDumpCaptureWriteBlock(record, value, ApiDumpTypedStructSize(value, fallback_size));\n'
+        capture_funcs += '    if (nullptr != value) {\n'
+        capture_funcs += '        ApiDumpCaptureOutputStruct(record, reinterpret_cast<const XrBaseOutStructure*>(value)->next,\n'
+        capture_funcs += '                                   sizeof(XrBaseOutStructure));\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '}\n\n'
+        capture_funcs += 'void* ApiDumpRestoreOutputStruct(ApiDumpCaptureReader& reader) {\n'
+        capture_funcs += '    size_t size = 0;\n'
+        capture_funcs += '    void* value = reader.ReadBlock(&size);\n'
+        capture_funcs += '    if (nullptr != value) {\n'
+        capture_funcs += '        ApiDumpCaptureCheckSize(size, ApiDumpTypedStructSize(value, sizeof(XrBaseOutStructure)));\n'
+        capture_funcs += '        reinterpret_cast<XrBaseOutStructure*>(value)->next =\n'
+        capture_funcs += '            reinterpret_cast<XrBaseOutStructure*>(ApiDumpRestoreOutputStruct(reader));\n'
+        capture_funcs += '    }\n'
+        capture_funcs += '    return value;\n'
+        capture_funcs += '}\n\n'
+        return capture_funcs
+
+    # Write the code that captures a command's parameters into a binary record.  The raw parameters are written
+    # first, so that any counts are known before the arrays they size are rebuilt.  The record is finished by
+    # writeCommandCaptureResult once the command returns.
+    #   self            the ApiDumpOutputGenerator object
+    #   cur_cmd         the command from automatic_source_generator
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeCommandCapture(self, cur_cmd, indent):
+        command_capture = self.writeIndent(indent)
+        command_capture += 'ApiDumpCaptureBeginRecord(record, "%s");\n' % cur_cmd.name
+        for param in cur_cmd.params:
+            if not param.is_static_array:
+                command_capture += self.writeIndent(indent)
+                command_capture += 'ApiDumpCaptureWrite(record, &%s, sizeof(%s));\n' % (param.name, param.name)
+        for param in cur_cmd.params:
+            if param.is_static_array:
+                # An array parameter is only a pointer, so capture what it points to
+                command_capture += self.writeIndent(indent)
+                command_capture += 'ApiDumpCaptureWriteBlock(record, %s, sizeof(%s) * %s);\n' % (
+                    param.name, param.type, param.static_array_sizes[0])
+            elif self.getOutputKind(param) == 'typed':
+                command_capture += self.writeIndent(indent)
+                command_capture += 'ApiDumpCaptureOutputStruct(record, %s, sizeof(%s));\n' % (param.name, param.type)
+            elif self.getOutputKind(param) == 'typed_array':
+                command_capture += self.writeIndent(indent)
+                command_capture += 'ApiDumpCaptureWriteBlock(record, %s, ApiDumpTypedStructSize(%s, sizeof(%s)) * %s);\n' % (
+                    param.name, param.name, param.type, self.getCaptureCount(param, ''))
+            else:
+                command_capture += self.writeCaptureMember(param, '', indent)[0]
+        return command_capture
+
+    # Write the code that finishes a command's capture record once the command has returned, by adding the result
+    # and any handles or atoms it returned.
+    #   self            the ApiDumpOutputGenerator object
+    #   cur_cmd         the command from automatic_source_generator
+    #   has_return      Boolean indicating the command returns a value
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeCommandCaptureResult(self, cur_cmd, has_return, indent):
+        command_capture = ''
+        if has_return:
+            command_capture += self.writeIndent(indent)
+            command_capture += 'ApiDumpCaptureWrite(record, &result, sizeof(result));\n'
+        for param in cur_cmd.params:
+            if not self.isReturnedHandle(param):
+                continue
+            size = 'sizeof(%s)' % param.type
+            if param.pointer_count_var:
+                size += ' * %s' % self.getCaptureCount(param, '')
+            returned = param.name
+            if has_return:
+                returned = 'XR_SUCCEEDED(result) ? %s : nullptr' % param.name
+            command_capture += self.writeIndent(indent)
+            command_capture += 'ApiDumpCaptureWriteBlock(record, %s, %s);\n' % (returned, size)
+        command_capture += self.writeIndent(indent)
+        command_capture += 'ApiDumpLayerRecordCapture(std::move(record));\n'
+        return command_capture
+
+    # Write the output content for a command, which both the layer commands and the capture decoder use.
+    #   self            the ApiDumpOutputGenerator object
+    #   cur_cmd         the command from automatic_source_generator
+    #   has_return      Boolean indicating the command returns a value
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeCommandContents(self, cur_cmd, has_return, indent):
+        # Print out a tuple for the header
+        command_contents = self.writeIndent(indent)
+        if has_return:
+            command_contents += 'contents.emplace_back("%s", "%s", "");\n' % (
+                cur_cmd.return_type.text, cur_cmd.name)
+        else:
+            command_contents += 'contents.emplace_back("void", "%s", "");\n' % cur_cmd.name
+        # Print out information for each parameter
+        for param in cur_cmd.params:
+            can_expand = False
+            # TODO handle array of handles here?
+            if ((self.isStruct(param.type) or self.isUnion(param.type)) and
+                    (param.is_const or param.pointer_count == 0)):
+                can_expand = True
+            command_contents += self.writeParamMember(
+                param, False, can_expand, indent)
+        return command_contents
+
+    # Find the xrGetInstanceProcAddr command, which the layer writes out by hand.
+    #   self            the ApiDumpOutputGenerator object
+    def getGetInstanceProcAddrCommand(self):
+        return [x for x in self.core_commands if x.name == 'xrGetInstanceProcAddr'][0]
+
+    # Write the output content for xrGetInstanceProcAddr.
+    #   self            the ApiDumpOutputGenerator object
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeGetInstanceProcAddrContents(self, indent):
+        gipa_contents = self.writeIndent(indent)
+        gipa_contents += 'contents.emplace_back("XrResult", "xrGetInstanceProcAddr", "");\n'
+        gipa_contents += self.writeIndent(indent)
+        gipa_contents += 'contents.AddBytes("XrInstance", "instance", instance);\n'
+        gipa_contents += self.writeIndent(indent)
+        gipa_contents += 'contents.emplace_back("const char*", "name", name);\n'
+        gipa_contents += self.writeIndent(indent)
+        gipa_contents += 'contents.AddBytes("PFN_xrVoidFunction*", "function", reinterpret_cast<const void*>(function));\n'
+        return gipa_contents
+
+    # Write the code that rebuilds a command's parameters from a binary capture record.
+    #   self            the ApiDumpOutputGenerator object
+    #   cur_cmd         the command from automatic_source_generator
+    #   replay          Boolean indicating the output structures are needed, which only a replay uses
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeCommandRestore(self, cur_cmd, replay, indent):
+        command_restore = ''
+        for param in cur_cmd.params:
+            if param.is_static_array:
+                command_restore += self.writeIndent(indent)
+                command_restore += '%s* %s = nullptr;\n' % (param.type, param.name)
+                continue
+            param_decl = ' '.join(param.cdecl.split())
+            if param.pointer_count == 0 and param_decl.startswith('const '):
+                param_decl = param_decl[len('const '):]
+            command_restore += self.writeIndent(indent)
+            command_restore += '%s;\n' % param_decl
+            command_restore += self.writeIndent(indent)
+            command_restore += 'reader.Read(&%s, sizeof(%s));\n' % (param.name, param.name)
+        for param in cur_cmd.params:
+            output_kind = self.getOutputKind(param)
+            if param.is_static_array:
+                command_restore += self.writeIndent(indent)
+                command_restore += '%s = reinterpret_cast<%s*>(reader.ReadBlock());\n' % (param.name, param.type)
+            elif output_kind == 'typed':
+                command_restore += self.writeIndent(indent)
+                if replay:
+                    command_restore += '%s = reinterpret_cast<%s*>(ApiDumpRestoreOutputStruct(reader));\n' % (
+                        param.name, param.type)
+                else:
+                    command_restore += 'ApiDumpRestoreOutputStruct(reader);\n'
+            elif output_kind == 'typed_array':
+                command_restore += self.writeIndent(indent)
+                if replay:
+                    command_restore += 'size_t %s_size = 0;\n' % param.name.lower()
+                    command_restore += self.writeIndent(indent)
+                    command_restore += '%s = reinterpret_cast<%s*>(reader.ReadBlock(&%s_size));\n' % (
+                        param.name, param.type, param.name.lower())
+                else:
+                    command_restore += 'reader.ReadBlock();\n'
+            else:
+                command_restore += self.writeCaptureMember(param, '', indent)[1]
+        return command_restore
+
+    # Write the function that decodes one binary capture record back into output content.  Each command's
+    # parameters are rebuilt in memory and then run through the same output code as the layer commands, without a
+    # dispatch table, so results and structure types are written as numbers.
+    #   self            the ApiDumpOutputGenerator object
+    def outputCaptureDecoder(self):
+        decoder = '\n// Binary capture decoder\n'
+        decoder += 'bool ApiDumpDecodeCapturedCommand(ApiDumpCaptureReader& reader, const std::string& command_name,\n'
+        decoder += '                                  ApiDumpContents &contents) {\n'
+        decoder += '    XrGeneratedDispatchTable *gen_dispatch_table = nullptr;\n'
+        decoder += '    (void)gen_dispatch_table;  // silence warning\n'
+        for x in range(0, 2):
+            if x == 0:
+                commands = self.core_commands
+            else:
+                commands = self.ext_commands
+
+            for cur_cmd in commands:
+                if cur_cmd.name in self.no_trampoline_or_terminator or cur_cmd.name in MANUALLY_DEFINED_IN_LAYER:
+                    continue
+                if cur_cmd.name == 'xrInitializeLoaderKHR':
+                    continue
+
+                if cur_cmd.protect_value:
+                    decoder += '#if %s\n' % cur_cmd.protect_string
+                decoder += '    if (command_name == "%s") {\n' % cur_cmd.name
+                decoder += self.writeCommandRestore(cur_cmd, False, 2)
+                if cur_cmd.name == 'xrGetInstanceProcAddr':
+                    decoder += self.writeGetInstanceProcAddrContents(2)
+                else:
+                    decoder += self.writeCommandContents(cur_cmd, cur_cmd.return_type is not None, 2)
+                decoder += '        return true;\n'
+                decoder += '    }\n'
+                if cur_cmd.protect_value:
+                    decoder += '#endif // %s\n' % cur_cmd.protect_string
+        decoder += '    return false;\n'
+        decoder += '}\n'
+        return decoder
+
+    # Determine if a value of this type is handed out by the runtime, so a replay has to swap it for its own.
+    #   self            the ApiDumpOutputGenerator object
+    #   type_name       the name of the type
+    def isReplayRemapped(self, type_name):
+        return self.isHandle(type_name) or self.isAtom(type_name)
+
+    # Determine if a replay has to swap any handles or atoms inside this structure.  What a next chain holds is
+    # only known while replaying, so next chains are walked by ApiDumpReplayRemapTypedStruct instead.
+    #   self            the ApiDumpOutputGenerator object
+    #   xr_struct       the structure from automatic_source_generator
+    def hasReplayRemap(self, xr_struct):
+        if xr_struct.name not in self.replay_remap_structs:
+            # Assume nothing while checking, in case a structure points back to itself
+            self.replay_remap_structs[xr_struct.name] = False
+            has_remap = False
+            for member in xr_struct.members:
+                if self.writeReplayRemapMember(member, 'value->', 0):
+                    has_remap = True
+                    break
+            self.replay_remap_structs[xr_struct.name] = has_remap
+        return self.replay_remap_structs[xr_struct.name]
+
+    # Generate the code that swaps the handles and atoms in a member or parameter for the ones returned during a
+    # replay.  Only memory a binary capture follows can be reached.  Captured memory belongs to the replay, so
+    # const is cast away.
+    #   self            the ApiDumpOutputGenerator object
+    #   member_param    the structure from automatic_source_generator for the member or parameter.
+    #   value_prefix    the C++ prefix to access members of the same structure ('value->' or '')
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeReplayRemapMember(self, member_param, value_prefix, indent):
+        if member_param.name == 'next':
+            return ''
+        name = value_prefix + member_param.name
+        base_type = member_param.type
+        index_name = '%s_index' % member_param.name.lower()
+        capture_kind = self.getCaptureKind(member_param)
+        member_param_struct = self.getStruct(base_type)
+        remapped = self.isReplayRemapped(base_type)
+        has_remap = member_param_struct is not None and self.hasReplayRemap(member_param_struct)
+
+        element_remap = ''
+        element_count = ''
+        remap = ''
+        if member_param.pointer_count == 0:
+            if member_param.is_static_array:
+                if remapped:
+                    remap = 'replay_state.RemapArray("%s", %s, %s);\n' % (base_type, name, member_param.static_array_sizes[0])
+                elif has_remap:
+                    element_remap = 'ApiDumpReplayRemapXrStruct(replay_state, &%s[%s]);\n' % (name, index_name)
+                    element_count = member_param.static_array_sizes[0]
+            elif remapped:
+                remap = 'replay_state.Remap("%s", %s);\n' % (base_type, name)
+            elif has_remap:
+                remap = 'ApiDumpReplayRemapXrStruct(replay_state, &%s);\n' % name
+        elif capture_kind == 'typed':
+            remap = 'ApiDumpReplayRemapTypedStruct(replay_state, %s);\n' % name
+        elif capture_kind == 'block':
+            if remapped:
+                remap = 'replay_state.Remap("%s", *const_cast<%s*>(%s));\n' % (base_type, base_type, name)
+            elif has_remap:
+                remap = 'ApiDumpReplayRemapXrStruct(replay_state, const_cast<%s*>(%s));\n' % (base_type, name)
+            if remap:
+                remap = 'if (nullptr != %s) {\n%s%s}\n' % (name, self.writeIndent(indent + 1) + remap, self.writeIndent(indent))
+        elif capture_kind == 'array':
+            count = self.getCaptureCount(member_param, value_prefix)
+            if remapped:
+                remap = 'replay_state.RemapArray("%s", const_cast<%s*>(%s), %s);\n' % (base_type, base_type, name, count)
+            elif has_remap:
+                element_remap = 'ApiDumpReplayRemapXrStruct(replay_state, const_cast<%s*>(&%s[%s]));\n' % (
+                    base_type, name, index_name)
+                element_count = count
+        elif capture_kind == 'typed_array':
+            element_remap = 'ApiDumpReplayRemapTypedStruct(replay_state, %s[%s]);\n' % (name, index_name)
+            element_count = self.getCaptureCount(member_param, value_prefix)
+
+        if element_remap:
+            loop_indent = indent
+            if not member_param.is_static_array:
+                remap = 'if (nullptr != %s) {\n' % name
+                loop_indent = indent + 1
+                remap += self.writeIndent(loop_indent)
+            remap += 'for (uint32_t %s = 0; %s < %s; ++%s) {\n' % (index_name, index_name, element_count, index_name)
+            remap += self.writeIndent(loop_indent + 1)
+            remap += element_remap
+            remap += self.writeIndent(loop_indent)
+            remap += '}\n'
+            if not member_param.is_static_array:
+                remap += self.writeIndent(indent)
+                remap += '}\n'
+        if remap:
+            remap = self.writeIndent(indent) + remap
+        return remap
+
+    # Determine if a replay can give new memory to a member of an output structure.  Platform types are left alone,
+    # since they may not be complete types.
+    #   self            the ApiDumpOutputGenerator object
+    #   type_name       the name of the type
+    def isReplayAllocatable(self, type_name):
+        return (type_name in REPLAY_ALLOCATABLE_TYPES or self.isStruct(type_name) or self.isEnumType(type_name) or
+                self.isFlagType(type_name) or self.isHandle(type_name) or self.getBaseType(type_name) is not None)
+
+    # Determine if a replay has to give new memory to anything this output structure points to.
+    #   self            the ApiDumpOutputGenerator object
+    #   xr_struct       the structure from automatic_source_generator
+    def hasReplayPrepare(self, xr_struct):
+        if xr_struct.name not in self.replay_prepare_structs:
+            # Assume nothing while checking, in case a structure contains itself
+            self.replay_prepare_structs[xr_struct.name] = False
+            has_prepare = False
+            for member in xr_struct.members:
+                if self.writeReplayPrepareMember(member, 0):
+                    has_prepare = True
+                    break
+            self.replay_prepare_structs[xr_struct.name] = has_prepare
+        return self.replay_prepare_structs[xr_struct.name]
+
+    # Generate the code that gives new memory to a member of an output structure that the runtime writes through.
+    # The captured pointer is only kept to tell whether the caller passed one.
+    #   self            the ApiDumpOutputGenerator object
+    #   member_param    the structure from automatic_source_generator for the member.
+    #   indent          the number of "tabs" to space in for the resulting C+ code.
+    def writeReplayPrepareMember(self, member_param, indent):
+        if member_param.name == 'next' or member_param.is_static_array:
+            return ''
+        name = 'value->' + member_param.name
+        member_param_struct = self.getStruct(member_param.type)
+        prepare = ''
+        if member_param.pointer_count == 0:
+            if member_param_struct is not None and self.hasReplayPrepare(member_param_struct):
+                prepare += self.writeIndent(indent)
+                prepare += 'ApiDumpReplayPrepareXrStruct(reader, &%s);\n' % name
+        elif not member_param.is_const and self.isReplayAllocatable(member_param.type):
+            count = self.getCaptureCount(member_param, 'value->')
+            if not count:
+                count = '1'
+            prepare += self.writeIndent(indent)
+            prepare += 'if (nullptr != %s) {\n' % name
+            prepare += self.writeIndent(indent + 1)
+            prepare += '%s = reinterpret_cast<decltype(%s)>(reader.Allocate(sizeof(*%s) * %s));\n' % (name, name, name, count)
+            structure_type = self.replay_structure_types.get(member_param.type)
+            if member_param.pointer_count == 1 and structure_type is not None:
+                index_name = '%s_index' % member_param.name.lower()
+                prepare += self.writeIndent(indent + 1)
+                prepare += 'for (uint32_t %s = 0; %s < %s; ++%s) {\n' % (index_name, index_name, count, index_name)
+                prepare += self.writeIndent(indent + 2)
+                prepare += '%s[%s].type = %s;\n' % (name, index_name, structure_type)
+                prepare += self.writeIndent(indent + 1)
+                prepare += '}\n'
+            prepare += self.writeIndent(indent)
+            prepare += '}\n'
+        return prepare
+
+    # Write the C++ functions a replay uses to swap handles and atoms in captured structures, and to give new
+    # memory to output structures.
+    #   self            the ApiDumpOutputGenerator object
+    def writeApiDumpReplayFuncs(self):
+        replay_funcs = '\n// Binary capture replay helper functions\n'
+        for xr_struct in self.api_structures:
+            if xr_struct.protect_value and (self.hasReplayRemap(xr_struct) or self.hasReplayPrepare(xr_struct)):
+                replay_funcs += '#if %s\n' % xr_struct.protect_string
+            if self.hasReplayRemap(xr_struct):
+                replay_funcs += 'void ApiDumpReplayRemapXrStruct(ApiDumpReplayState& replay_state, %s* value) {\n' % xr_struct.name
+                for member in xr_struct.members:
+                    replay_funcs += self.writeReplayRemapMember(member, 'value->', 1)
+                replay_funcs += '}\n\n'
+            if self.hasReplayPrepare(xr_struct):
+                replay_funcs += 'void ApiDumpReplayPrepareXrStruct(ApiDumpCaptureReader& reader, %s* value) {\n' % xr_struct.name
+                for member in xr_struct.members:
+                    replay_funcs += self.writeReplayPrepareMember(member, 1)
+                replay_funcs += '}\n\n'
+            if xr_struct.protect_value and (self.hasReplayRemap(xr_struct) or self.hasReplayPrepare(xr_struct)):
+                replay_funcs += '#endif // %s\n\n' % xr_struct.protect_string
+
+        typed_structs = self.getTypedStructs()
+        for function_name, param_name, value_type, needs_function in (
+                ('ApiDumpReplayRemapTypedStruct', 'ApiDumpReplayState& replay_state', 'const void*', self.hasReplayRemap),
+                ('ApiDumpReplayPrepareTypedStruct', 'ApiDumpCaptureReader& reader', 'void*', self.hasReplayPrepare)):
+            is_remap = function_name == 'ApiDumpReplayRemapTypedStruct'
+            replay_funcs += 'void %s(%s, %s value) {\n' % (function_name, param_name, value_type)
+            replay_funcs += '    while (nullptr != value) {\n'
+            if is_remap:
+                replay_funcs += '        const XrBaseInStructure* header = reinterpret_cast<const XrBaseInStructure*>(value);\n'
+            else:
+                replay_funcs += '        XrBaseOutStructure* header = reinterpret_cast<XrBaseOutStructure*>(value);\n'
+            replay_funcs += '        switch (header->type) {\n'
+            for structure_type, xr_struct in typed_structs:
+                if not needs_function(xr_struct):
+                    continue
+                if xr_struct.protect_value:
+                    replay_funcs += '#if %s\n' % xr_struct.protect_string
+                replay_funcs += '            case %s:\n' % structure_type
+                if is_remap:
+                    replay_funcs += '                ApiDumpReplayRemapXrStruct(replay_state, const_cast<%s*>(reinterpret_cast<const %s*>(value)));\n' % (
+                        xr_struct.name, xr_struct.name)
+                else:
+                    replay_funcs += '                ApiDumpReplayPrepareXrStruct(reader, reinterpret_cast<%s*>(value));\n' % xr_struct.name
+                replay_funcs += '                break;\n'
+                if xr_struct.protect_value:
+                    replay_funcs += '#endif // %s\n' % xr_struct.protect_string
+            replay_funcs += '            default:\n'
+            replay_funcs += '                break;\n'
+            replay_funcs += '        }\n'
+            replay_funcs += '        value = header->next;\n'
+            replay_funcs += '    }\n'
+            replay_funcs += '}\n\n'
+        return replay_funcs
+
+    # Write the function that re-issues one binary capture record through the dispatch table of the instance it
+    # belongs to.  Handles and atoms returned during the capture are swapped for the ones returned during the
+    # replay, and anything the runtime writes to is given new memory.
+    #   self            the ApiDumpOutputGenerator object
+    def outputCaptureReplay(self):
+        replay = '\n// Binary capture replay\n'
+        replay += 'bool ApiDumpReplayCapturedCommand(ApiDumpCaptureReader& reader, const std::string& command_name,\n'
+        replay += '                                  ApiDumpReplayState& replay_state) {\n'
+        for x in range(0, 2):
+            if x == 0:
+                commands = self.core_commands
+            else:
+                commands = self.ext_commands
+
+            for cur_cmd in commands:
+                if cur_cmd.name in self.no_trampoline_or_terminator or cur_cmd.name in MANUALLY_DEFINED_IN_LAYER:
+                    continue
+                if cur_cmd.name == 'xrInitializeLoaderKHR' or cur_cmd.name == 'xrGetInstanceProcAddr':
+                    continue
+
+                has_return = cur_cmd.return_type is not None
+                is_destroy = (('xrDestroy' in cur_cmd.name or 'xrDisconnect' in cur_cmd.name) and
+                              cur_cmd.params[-1].is_handle)
+                returned_handles = [param for param in cur_cmd.params if self.isReturnedHandle(param)]
+                first_param = cur_cmd.params[0]
+
+                if cur_cmd.protect_value:
+                    replay += '#if %s\n' % cur_cmd.protect_string
+                replay += '    if (command_name == "%s") {\n' % cur_cmd.name
+                replay += self.writeCommandRestore(cur_cmd, True, 2)
+
+                # What the command returned during the capture
+                if has_return:
+                    replay += '        %s captured_result = {};\n' % cur_cmd.return_type.text
+                    replay += '        reader.Read(&captured_result, sizeof(captured_result));\n'
+                for param in returned_handles:
+                    replay += '        size_t captured_%s_size = 0;\n' % param.name.lower()
+                    replay += '        auto captured_%s = reinterpret_cast<%s*>(reader.ReadBlock(&captured_%s_size));\n' % (
+                        param.name.lower(), param.type, param.name.lower())
+
+                replay += '        XrGeneratedDispatchTable* replay_table = replay_state.DispatchTable("%s", %s);\n' % (
+                    first_param.type, first_param.name)
+                replay += '        if (nullptr == replay_table) {\n'
+                replay += '            replay_state.Skip();\n'
+                replay += '            return true;\n'
+                replay += '        }\n'
+                if is_destroy:
+                    replay += '        const %s destroyed_handle = %s;\n' % (cur_cmd.params[-1].type, cur_cmd.params[-1].name)
+
+                for param in cur_cmd.params:
+                    if not param.is_static_array and self.getOutputKind(param) is None:
+                        replay += self.writeReplayRemapMember(param, '', 2)
+                for param in cur_cmd.params:
+                    output_kind = self.getOutputKind(param)
+                    if output_kind == 'typed':
+                        replay += '        ApiDumpReplayPrepareTypedStruct(reader, %s);\n' % param.name
+                    elif output_kind == 'typed_array':
+                        # Only the first element's type is known to match the others
+                        local_name = param.name.lower()
+                        count = self.getCaptureCount(param, '')
+                        replay += '        if (nullptr != %s) {\n' % param.name
+                        replay += '            size_t %s_stride = ApiDumpTypedStructSize(%s, sizeof(%s));\n' % (
+                            local_name, param.name, param.type)
+                        replay += '            ApiDumpCaptureCheckSize(%s_size, %s_stride * %s);\n' % (local_name, local_name, count)
+                        replay += '            for (uint32_t %s_index = 0; %s_index < %s; ++%s_index) {\n' % (
+                            local_name, local_name, count, local_name)
+                        replay += '                auto %s_element = reinterpret_cast<XrBaseOutStructure*>(\n' % local_name
+                        replay += '                    reinterpret_cast<uint8_t*>(%s) + %s_stride * %s_index);\n' % (
+                            param.name, local_name, local_name)
+                        replay += '                %s_element->next = nullptr;\n' % local_name
+                        replay += '                ApiDumpReplayPrepareTypedStruct(reader, %s_element);\n' % local_name
+                        replay += '            }\n'
+                        replay += '        }\n'
+                    elif output_kind == 'buffer':
+                        count = self.getCaptureCount(param, '').split(',')[0]
+                        if not count:
+                            count = '1'
+                        replay += '        if (nullptr != %s) {\n' % param.name
+                        replay += '            %s = reinterpret_cast<decltype(%s)>(reader.Allocate(sizeof(*%s) * %s));\n' % (
+                            param.name, param.name, param.name, count)
+                        replay += '        }\n'
+
+                replay += '        uint64_t begin_ns = replay_state.BeginCall();\n'
+                replay += '        '
+                if has_return:
+                    replay += '%s result = ' % cur_cmd.return_type.text
+                replay += 'replay_table->%s(%s);\n' % (cur_cmd.name[2:], ', '.join(param.name for param in cur_cmd.params))
+                if has_return:
+                    replay += '        replay_state.EndCall(begin_ns, result, captured_result);\n'
+                else:
+                    replay += '        replay_state.EndCall(begin_ns, XR_SUCCESS, XR_SUCCESS);\n'
+
+                for param in returned_handles:
+                    local_name = param.name.lower()
+                    count = self.getCaptureCount(param, '')
+                    replay += '        if (%snullptr != captured_%s && nullptr != %s) {\n' % (
+                        'XR_SUCCEEDED(result) && ' if has_return else '', local_name, param.name)
+                    if count:
+                        replay += '            ApiDumpCaptureCheckSize(captured_%s_size, sizeof(%s) * %s);\n' % (
+                            local_name, param.type, count)
+                        replay += '            for (uint32_t %s_index = 0; %s_index < %s; ++%s_index) {\n' % (
+                            local_name, local_name, count, local_name)
+                        replay += '                replay_state.AddMapping("%s", captured_%s[%s_index], %s[%s_index], replay_table);\n' % (
+                            param.type, local_name, local_name, param.name, local_name)
+                        replay += '            }\n'
+                    else:
+                        replay += '            ApiDumpCaptureCheckSize(captured_%s_size, sizeof(%s));\n' % (local_name, param.type)
+                        replay += '            replay_state.AddMapping("%s", *captured_%s, *%s, replay_table);\n' % (
+                            param.type, local_name, param.name)
+                    replay += '        }\n'
+                if is_destroy:
+                    if has_return:
+                        replay += '        if (XR_SUCCEEDED(result)) {\n'
+                        replay += '            replay_state.RemoveMapping("%s", destroyed_handle);\n' % cur_cmd.params[-1].type
+                        replay += '        }\n'
+                    else:
+                        replay += '        replay_state.RemoveMapping("%s", destroyed_handle);\n' % cur_cmd.params[-1].type
+                replay += '        return true;\n'
+                replay += '    }\n'
+                if cur_cmd.protect_value:
+                    replay += '#endif // %s\n' % cur_cmd.protect_string
+        replay += '    return false;\n'
+        replay += '}\n'
+        return replay
+
+
     # Write the C++ Api Dump function for every command we know about
     #   self            the ApiDumpOutputGenerator object
     def outputLayerCommands(self):
@@ -1098,8 +2077,6 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                     generated_commands += return_prefix
 
                 generated_commands += '    try {\n'
-                generated_commands += '        // Generate output for this command\n'
-                generated_commands += '        std::vector<std::tuple<std::string, std::string, std::string>> contents;\n'
 
                 # Next, we have to call down to the next implementation of this command in the call chain.
                 # Before we can do that, we have to figure out what the dispatch table is
@@ -1107,35 +2084,34 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                     handle_param = cur_cmd.params[0]
                     base_handle_name = undecorate(handle_param.type)
                     first_handle_name = self.getFirstHandleName(handle_param)
-                    generated_commands += '        std::unique_lock<std::mutex> mlock(g_%s_dispatch_mutex);\n' % base_handle_name
-                    generated_commands += '        auto map_iter = g_%s_dispatch_map.find(%s);\n' % (base_handle_name, first_handle_name)
-                    generated_commands += '        mlock.unlock();\n\n'
-                    generated_commands += '        if (map_iter == g_%s_dispatch_map.end()) return XR_ERROR_VALIDATION_FAILURE;\n' % base_handle_name
-                    generated_commands += '        XrGeneratedDispatchTable *gen_dispatch_table = map_iter->second;\n'
+                    generated_commands += '        XrGeneratedDispatchTable *gen_dispatch_table =\n'
+                    generated_commands += '            findTableMapElement(g_%s_dispatch_map, g_%s_dispatch_mutex, %s);\n' % (
+                        base_handle_name, base_handle_name, first_handle_name)
+                    generated_commands += '        if (nullptr == gen_dispatch_table) return XR_ERROR_VALIDATION_FAILURE;\n'
                 else:
                     generated_commands += self.printCodeGenErrorMessage(
                         'Command %s does not have an OpenXR Object handle as the first parameter.' % cur_cmd.name)
 
-                # Print out a tuple for the header
-                if has_return:
-                    generated_commands += '        contents.emplace_back("%s", "%s", "");\n' % (
-                        cur_cmd.return_type.text, cur_cmd.name)
-                else:
-                    generated_commands += '        contents.emplace_back("void", "%s", "");\n' % cur_cmd.name
-                # Print out information for each parameter
-                for param in cur_cmd.params:
-                    can_expand = False
-                    # TODO handle array of handles here?
-                    if ((self.isStruct(param.type) or self.isUnion(param.type)) and
-                            (param.is_const or param.pointer_count == 0)):
-                        can_expand = True
-                    generated_commands += self.writeParamMember(
-                        param, False, can_expand, 2)
+                # A binary capture only copies the parameters, and they are decoded later.  The record is finished
+                # once the command returns.  The parameters are not needed at all when only recording a trace.
+                # Filtered out calls skip all of it.
+                generated_commands += '        bool dumping = ApiDumpLayerShouldDump(API_DUMP_COMMAND_%s);\n' % cur_cmd.name
+                generated_commands += self.writeObjectFilter(cur_cmd)
+                generated_commands += '        std::string record;\n'
+                generated_commands += '        if (dumping && ApiDumpLayerCapturing()) {\n'
+                generated_commands += self.writeCommandCapture(cur_cmd, 3)
+                generated_commands += '        } else if (dumping && !ApiDumpLayerTracing()) {\n'
+                generated_commands += '            // Generate output for this command\n'
+                generated_commands += '            ApiDumpScopedContents scoped_contents;\n'
+                generated_commands += '            ApiDumpContents &contents = scoped_contents.Get();\n'
+                generated_commands += self.writeCommandContents(cur_cmd, has_return, 3)
 
                 # Now record the information
-                generated_commands += '        ApiDumpLayerRecordContent(contents);\n\n'
+                generated_commands += '            ApiDumpLayerRecordContent(contents);\n'
+                generated_commands += '        }\n\n'
 
-                # Call down, looking for the returned result if required.
+                # Call down, looking for the returned result if required, and time the call when tracing.
+                generated_commands += '        uint64_t trace_begin_ns = dumping ? ApiDumpLayerTraceBegin() : 0;\n'
                 generated_commands += '        '
                 if has_return:
                     generated_commands += 'result = '
@@ -1148,32 +2124,40 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
                     generated_commands += param.name
                     count = count + 1
                 generated_commands += ');\n'
+                if cur_cmd.params[0].is_handle:
+                    generated_commands += '        ApiDumpLayerRecordTrace(API_DUMP_COMMAND_%s, MakeHandleGeneric(%s), trace_begin_ns);\n' % (
+                        cur_cmd.name, self.getFirstHandleName(cur_cmd.params[0]))
+                generated_commands += '        if (!record.empty()) {\n'
+                generated_commands += self.writeCommandCaptureResult(cur_cmd, has_return, 3)
+                generated_commands += '        }\n'
 
                 # If this is a create command, we have to create an entry in the appropriate
                 # unordered_map pointing to the correct dispatch table for the newly created
                 # object.  Likewise, if it's a delete command, we have to remove the entry
                 # for the dispatch table from the unordered_map
                 second_base_handle_name = ''
+                if cur_cmd.name == 'xrSetDebugUtilsObjectNameEXT':
+                    generated_commands += '        if (XR_SUCCESS == result) {\n'
+                    generated_commands += '            ApiDumpLayerSetObjectName(nameInfo);\n'
+                    generated_commands += '        }\n'
                 if cur_cmd.params[-1].is_handle and (is_create or is_destroy):
                     second_base_handle_name = undecorate(cur_cmd.params[-1].type)
                     if is_create:
                         generated_commands += '        if (XR_SUCCESS == result && nullptr != %s) {\n' % cur_cmd.params[-1].name
-                        generated_commands += '            auto exists = g_%s_dispatch_map.find(*%s);\n' % (
+                        generated_commands += '            std::unique_lock<std::shared_timed_mutex> lock(g_%s_dispatch_mutex);\n' % (
+                            second_base_handle_name)
+                        generated_commands += '            g_%s_dispatch_map.emplace(*%s, gen_dispatch_table);\n' % (
                             second_base_handle_name, cur_cmd.params[-1].name)
-                        generated_commands += '            if (exists == g_%s_dispatch_map.end()) {\n' % second_base_handle_name
-                        generated_commands += '                std::unique_lock<std::mutex> lock(g_%s_dispatch_mutex);\n' % second_base_handle_name
-                        generated_commands += '                g_%s_dispatch_map[*%s] = gen_dispatch_table;\n' % (
-                            second_base_handle_name, cur_cmd.params[-1].name)
-                        generated_commands += '            }\n'
                         generated_commands += '        }\n'
                     elif is_destroy:
-                        generated_commands += '        auto exists = g_%s_dispatch_map.find(%s);\n' % (
-                            second_base_handle_name, cur_cmd.params[-1].name)
-                        generated_commands += '        if (exists != g_%s_dispatch_map.end()) {\n' % second_base_handle_name
-                        generated_commands += '            std::unique_lock<std::mutex> lock(g_%s_dispatch_mutex);\n' % second_base_handle_name
+                        generated_commands += '        {\n'
+                        generated_commands += '            std::unique_lock<std::shared_timed_mutex> lock(g_%s_dispatch_mutex);\n' % (
+                            second_base_handle_name)
                         generated_commands += '            g_%s_dispatch_map.erase(%s);\n' % (
                             second_base_handle_name, cur_cmd.params[-1].name)
                         generated_commands += '        }\n'
+                        generated_commands += '        ApiDumpLayerRemoveObjectName(MakeHandleGeneric(%s), %s);\n' % (
+                            cur_cmd.params[-1].name, self.genXrObjectType(cur_cmd.params[-1].type))
 
                 # Catch any exceptions that may have occurred.  If any occurred between any of the
                 # valid mutex lock/unlock statements, perform the unlock now.
@@ -1197,13 +2181,19 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         generated_commands += '    PFN_xrVoidFunction*                         function) {\n'
         generated_commands += '    try {\n'
         generated_commands += '        std::string func_name = name;\n\n'
-        generated_commands += '        // Generate output for this command\n'
-        generated_commands += '        std::vector<std::tuple<std::string, std::string, std::string>> contents;\n'
-        generated_commands += '        contents.emplace_back("XrResult", "xrGetInstanceProcAddr", "");\n'
-        generated_commands += '        contents.emplace_back("XrInstance", "instance", HandleToHexString(instance));\n'
-        generated_commands += '        contents.emplace_back("const char*", "name", name);\n'
-        generated_commands += '        contents.emplace_back("PFN_xrVoidFunction*", "function", PointerToHexString(reinterpret_cast<const void*>(function)));\n'
-        generated_commands += '        ApiDumpLayerRecordContent(contents);\n'
+        generated_commands += '        bool dumping = ApiDumpLayerShouldDump(API_DUMP_COMMAND_xrGetInstanceProcAddr);\n'
+        generated_commands += self.writeObjectFilter(self.getGetInstanceProcAddrCommand())
+        generated_commands += '        if (dumping && ApiDumpLayerCapturing()) {\n'
+        generated_commands += '            std::string record;\n'
+        generated_commands += self.writeCommandCapture(self.getGetInstanceProcAddrCommand(), 3)
+        generated_commands += '            ApiDumpLayerRecordCapture(std::move(record));\n'
+        generated_commands += '        } else if (dumping) {\n'
+        generated_commands += '            // Generate output for this command\n'
+        generated_commands += '            ApiDumpScopedContents scoped_contents;\n'
+        generated_commands += '            ApiDumpContents &contents = scoped_contents.Get();\n'
+        generated_commands += self.writeGetInstanceProcAddrContents(3)
+        generated_commands += '            ApiDumpLayerRecordContent(contents);\n'
+        generated_commands += '        }\n'
 
         generated_commands += '        // Set the function pointer to NULL so that the fall-through below actually works:\n'
         generated_commands += '        *function = nullptr;\n\n'
@@ -1254,13 +2244,8 @@ class ApiDumpOutputGenerator(AutomaticSourceOutputGenerator):
         generated_commands += '            return XR_SUCCESS;\n'
         generated_commands += '        }\n\n'
         generated_commands += '        // We have not found it, so pass it down to the next layer/runtime\n'
-        generated_commands += '        std::unique_lock<std::mutex> mlock(g_instance_dispatch_mutex);\n'
-        generated_commands += '        auto map_iter = g_instance_dispatch_map.find(instance);\n'
-        generated_commands += '        mlock.unlock();\n\n'
-        generated_commands += '        if (map_iter == g_instance_dispatch_map.end()) {\n'
-        generated_commands += '            return XR_ERROR_HANDLE_INVALID;\n'
-        generated_commands += '        }\n\n'
-        generated_commands += '        XrGeneratedDispatchTable *gen_dispatch_table = map_iter->second;\n'
+        generated_commands += '        XrGeneratedDispatchTable *gen_dispatch_table =\n'
+        generated_commands += '            findTableMapElement(g_instance_dispatch_map, g_instance_dispatch_mutex, instance);\n'
         generated_commands += '        if (nullptr == gen_dispatch_table) {\n'
         generated_commands += '            return XR_ERROR_HANDLE_INVALID;\n'
         generated_commands += '        }\n\n'
@@ -1101,11 +1101,11 @@ class AutomaticSourceOutputGenerator(OutputGenerator):
             self.updateArrayLengthsForMember(arraylengthparams, param)
 
         # See if this command adjusts any state
-        begin_valid_state = cmd_info.elem.get('beginvalidstate')
+        begin_valid_state = self.getCommandValidStates(cmd_info, name, 'beginvalidstate')
         begins_state = (begin_valid_state is not None)
-        end_valid_state = cmd_info.elem.get('endvalidstate')
+        end_valid_state = self.getCommandValidStates(cmd_info, name, 'endvalidstate')
         ends_state = (end_valid_state is not None)
-        check_valid_state = cmd_info.elem.get('checkvalidstate')
+        check_valid_state = self.getCommandValidStates(cmd_info, name, 'checkvalidstate')
         checks_state = (check_valid_state is not None)
 
         # This will capture the core return values, but not any added by extension.
@@ -1246,6 +1246,14 @@ class AutomaticSourceOutputGenerator(OutputGenerator):
                                  checks_state=checks_state,
                                  cdecl=self.makeCDecls(cmd_info.elem)[0]))
 
+    # Get the comma-delimited list of states a command begins, ends or checks (used for validation)
+    #   self              the AutomaticSourceOutputGenerator object
+    #   cmd_info          the XML information for the command
+    #   name              the name of the command
+    #   attribute         the registry attribute listing the states
+    def getCommandValidStates(self, cmd_info, name, attribute):
+        return cmd_info.elem.get(attribute)
+
     def findState(self, state):
         for api_state in self.api_states:
             if api_state.state == state:
@@ -39,6 +39,92 @@ MANUAL_LOADER_FUNCS = set((
     'xrInitializeLoaderKHR',
 ))
 
+# Commands that xrGetInstanceProcAddr resolves to a loader implementation
+# without consulting the active instance, mapped to that implementation.
+LOADER_GLOBAL_FUNCS = {
+    'xrGetInstanceProcAddr': 'LoaderXrGetInstanceProcAddr',
+    'xrEnumerateApiLayerProperties': 'LoaderXrEnumerateApiLayerProperties',
+    'xrEnumerateInstanceExtensionProperties': 'LoaderXrEnumerateInstanceExtensionProperties',
+    'xrCreateInstance': 'LoaderXrCreateInstance',
+    'xrDestroyInstance': 'LoaderXrDestroyInstance',
+    'xrInitializeLoaderKHR': 'LoaderXrInitializeLoaderKHR',
+}
+
+# Commands that xrGetInstanceProcAddr resolves to a loader implementation once
+# the owning extension has been verified as enabled on the active instance.
+LOADER_INSTANCE_FUNCS = {
+    'xrCreateDebugUtilsMessengerEXT': 'xrCreateDebugUtilsMessengerEXT',
+    'xrDestroyDebugUtilsMessengerEXT': 'xrDestroyDebugUtilsMessengerEXT',
+    'xrSessionBeginDebugUtilsLabelRegionEXT': 'xrSessionBeginDebugUtilsLabelRegionEXT',
+    'xrSessionEndDebugUtilsLabelRegionEXT': 'xrSessionEndDebugUtilsLabelRegionEXT',
+    'xrSessionInsertDebugUtilsLabelEXT': 'xrSessionInsertDebugUtilsLabelEXT',
+    'xrSetDebugUtilsObjectNameEXT': 'xrSetDebugUtilsObjectNameEXT',
+    'xrSubmitDebugUtilsMessageEXT': 'xrSubmitDebugUtilsMessageEXT',
+}
+
+# Loader implementations that are only compiled in under a preprocessor define.
+LOADER_FUNC_PROTECT = {
+    'LoaderXrInitializeLoaderKHR': 'XR_KHR_LOADER_INIT_SUPPORT',
+}
+
+# Commands that may be queried through xrGetInstanceProcAddr with XR_NULL_HANDLE.
+NULL_INSTANCE_FUNCS = set((
+    'xrCreateInstance',
+    'xrEnumerateApiLayerProperties',
+    'xrEnumerateInstanceExtensionProperties',
+    'xrInitializeLoaderKHR',
+))
+
+FNV_OFFSET_BASIS = 2166136261
+FNV_PRIME = 16777619
+
+
+# Must match LoaderCommandNameHash in the generated loader source.
+def commandNameHash(seed, name):
+    value = FNV_OFFSET_BASIS ^ seed
+    for char in name.encode('ascii'):
+        value ^= char
+        value = (value * FNV_PRIME) & 0xFFFFFFFF
+    return value
+
+
+# Build a minimal perfect hash over the given names using "hash and displace":
+# every name is first bucketed with seed 0, then each bucket gets either a seed
+# that moves all of its names into free slots, or (for single-name buckets) a
+# direct slot index encoded as a negative value.
+# Returns (displacements, slot_names) where both lists have len(names) entries.
+def buildPerfectHash(names):
+    size = len(names)
+    buckets = [[] for _ in range(size)]
+    for name in names:
+        buckets[commandNameHash(0, name) % size].append(name)
+
+    displacements = [0] * size
+    slot_names = [None] * size
+    for bucket_index in sorted(range(size), key=lambda b: len(buckets[b]), reverse=True):
+        bucket = buckets[bucket_index]
+        if len(bucket) <= 1:
+            break
+        seed = 1
+        while True:
+            slots = [commandNameHash(seed, name) % size for name in bucket]
+            if len(set(slots)) == len(slots) and all(slot_names[slot] is None for slot in slots):
+                break
+            seed += 1
+        displacements[bucket_index] = seed
+        for name, slot in zip(bucket, slots):
+            slot_names[slot] = name
+
+    free_slots = [slot for slot in range(size) if slot_names[slot] is None]
+    for bucket_index in range(size):
+        bucket = buckets[bucket_index]
+        if len(bucket) == 1:
+            slot = free_slots.pop()
+            displacements[bucket_index] = -slot - 1
+            slot_names[slot] = bucket[0]
+    return displacements, slot_names
+
+
 # This is a list of extensions that the loader implements.  This means that
 # the runtime underneath may not support these extensions and the terminators
 # need to check before they call
@@ -102,6 +188,7 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
 
         if self.genOpts.filename == 'xr_generated_loader.hpp':
             preamble += '#pragma once\n'
+            preamble += '#include <cstdint>\n'
             preamble += '#include <unordered_map>\n'
             preamble += '#include <thread>\n'
             preamble += '#include <mutex>\n\n'
@@ -127,6 +214,7 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
             preamble += '#include <openxr/openxr.h>\n'
             preamble += '#include <openxr/openxr_platform.h>\n\n'
 
+            preamble += '#include <cstdint>\n'
             preamble += '#include <cstring>\n'
             preamble += '#include <memory>\n'
             preamble += '#include <new>\n'
@@ -149,9 +237,11 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
             file_data += '#ifdef __cplusplus\n'
             file_data += '} // extern "C"\n'
             file_data += '#endif\n'
+            file_data += self.outputLoaderCommandInfoDecls()
 
         elif self.genOpts.filename == 'xr_generated_loader.cpp':
             file_data += self.outputLoaderGeneratedFuncs()
+            file_data += self.outputLoaderCommandTable()
 
         write(file_data, file=self.outFile)
 
@@ -228,9 +318,11 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
                         base_handle_name = undecorate(param.type)
                         first_handle_name = self.getFirstHandleName(param)
 
-                        tramp_variable_defines += '    LoaderInstance* loader_instance;\n'
-                        tramp_variable_defines += '    XrResult result = ActiveLoaderInstance::Get(&loader_instance, "%s");\n' % (cur_cmd.name)
-                        tramp_variable_defines += '    if (XR_SUCCEEDED(result)) {\n'
+                        # Fast path: a single acquire load of the published dispatch table.
+                        tramp_variable_defines += '    const XrGeneratedDispatchTable* dispatch_table = ActiveLoaderInstance::GetDispatchTable();\n'
+                        tramp_variable_defines += '    if (nullptr == dispatch_table) {\n'
+                        tramp_variable_defines += '        return ActiveLoaderInstance::ReportNotAvailable("%s");\n' % (cur_cmd.name)
+                        tramp_variable_defines += '    }\n'
 
                         # These should be mutually exclusive - verify it.
                         assert((not cur_cmd.is_destroy_disconnect) or
@@ -269,11 +361,11 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
             generated_funcs += tramp_variable_defines
 
             if has_return:
-                generated_funcs += '        result = '
+                generated_funcs += '    return '
             else:
-                generated_funcs += '        '
+                generated_funcs += '    '
 
-            generated_funcs += 'loader_instance->DispatchTable()->'
+            generated_funcs += 'dispatch_table->'
             generated_funcs += base_name
             generated_funcs += '('
             count = 0
@@ -283,16 +375,106 @@ class LoaderSourceOutputGenerator(AutomaticSourceOutputGenerator):
                 generated_funcs += param.name
                 count = count + 1
             generated_funcs += ');\n'
-
-            generated_funcs += '    }\n'
-
-
-            if has_return:
-                generated_funcs += '    return result;\n'
-
             generated_funcs += '}\nXRLOADER_ABI_CATCH_FALLBACK\n'
 
             if cur_cmd.protect_value:
                 generated_funcs += '#endif // %s\n' % cur_cmd.protect_string
             generated_funcs += '\n'
         return generated_funcs
+
+    # Declare the loader-implemented entry points referenced by the command table
+    # along with the table lookup used by xrGetInstanceProcAddr.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderCommandInfoDecls(self):
+        decls = '\n// Loader implementations returned directly from xrGetInstanceProcAddr\n'
+        for cur_cmd in self.core_commands + self.ext_commands:
+            impl_name = LOADER_GLOBAL_FUNCS.get(cur_cmd.name)
+            if impl_name is None or impl_name == cur_cmd.name:
+                continue
+            decls += cur_cmd.cdecl.replace(cur_cmd.name, impl_name)
+            decls += '\n'
+
+        decls += '\n// Build-time information about an OpenXR command, used by xrGetInstanceProcAddr.\n'
+        decls += 'struct LoaderCommandInfo {\n'
+        decls += '    // Name of the command, such as "xrCreateSession".\n'
+        decls += '    const char* name;\n'
+        decls += '    // Position of this entry in the command table, in the range [0, kLoaderCommandCount).\n'
+        decls += '    uint32_t index;\n'
+        decls += '    // Loader implementation to return, or nullptr if the call must go down the layer chain.\n'
+        decls += '    PFN_xrVoidFunction loader_function;\n'
+        decls += '    // Extension that must be enabled on the instance, or nullptr for core commands.\n'
+        decls += '    const char* required_extension;\n'
+        decls += '    // True if the command may be queried with an XR_NULL_HANDLE instance.\n'
+        decls += '    bool null_instance_allowed;\n'
+        decls += '    // True if the loader always handles the command itself without needing an active instance.\n'
+        decls += '    bool instance_independent;\n'
+        decls += '};\n\n'
+        decls += '// Number of entries in the generated command table.\n'
+        decls += 'constexpr uint32_t kLoaderCommandCount = %d;\n\n' % len(self.core_commands + self.ext_commands)
+        decls += '// Find a core or extension command by name, returning nullptr if the loader does not know it.\n'
+        decls += 'const LoaderCommandInfo* GeneratedLoaderFindCommand(const char* name);\n'
+        return decls
+
+    # Output a perfect-hash table of every command known at build time so that
+    # xrGetInstanceProcAddr needs a single hash and string compare per lookup.
+    #   self            the LoaderSourceOutputGenerator object
+    def outputLoaderCommandTable(self):
+        all_commands = self.core_commands + self.ext_commands
+        commands_by_name = dict((cur_cmd.name, cur_cmd) for cur_cmd in all_commands)
+        displacements, slot_names = buildPerfectHash([cur_cmd.name for cur_cmd in all_commands])
+
+        table = '\n// Perfect-hash table of all commands known to the loader at build time\n'
+        table += 'namespace {\n'
+        table += '// 32-bit FNV-1a, with the seed folded into the offset basis.\n'
+        table += 'constexpr uint32_t LoaderCommandNameHash(uint32_t seed, const char* name) {\n'
+        table += '    uint32_t hash = %du ^ seed;\n' % FNV_OFFSET_BASIS
+        table += '    for (; *name != \'\\0\'; ++name) {\n'
+        table += '        hash ^= static_cast<uint8_t>(*name);\n'
+        table += '        hash *= %du;\n' % FNV_PRIME
+        table += '    }\n'
+        table += '    return hash;\n'
+        table += '}\n\n'
+        first_name = all_commands[0].name
+        table += 'static_assert(LoaderCommandNameHash(0, "%s") == %du,\n' % (first_name, commandNameHash(0, first_name))
+        table += '              "Loader command hash does not match loader_source_generator.py");\n\n'
+
+        table += '// Per-bucket seed, or -(slot + 1) for buckets holding a single command.\n'
+        table += 'constexpr int32_t kLoaderCommandDisplacements[kLoaderCommandCount] = {\n'
+        for start in range(0, len(displacements), 16):
+            table += '    %s,\n' % ', '.join(str(value) for value in displacements[start:start + 16])
+        table += '};\n\n'
+
+        table += 'const LoaderCommandInfo kLoaderCommands[kLoaderCommandCount] = {\n'
+        for slot, name in enumerate(slot_names):
+            cur_cmd = commands_by_name[name]
+            impl_name = LOADER_GLOBAL_FUNCS.get(name, LOADER_INSTANCE_FUNCS.get(name))
+            loader_function = 'nullptr'
+            if impl_name is not None:
+                loader_function = 'reinterpret_cast<PFN_xrVoidFunction>(%s)' % impl_name
+            required_extension = 'nullptr'
+            if cur_cmd.required_exts and name not in LOADER_GLOBAL_FUNCS:
+                required_extension = '"%s"' % cur_cmd.required_exts[0]
+            entry_fmt = '    {"%s", %d, %s, %s, %s, %s},\n'
+            entry_args = (required_extension,
+                          'true' if name in NULL_INSTANCE_FUNCS else 'false',
+                          'true' if name in LOADER_GLOBAL_FUNCS else 'false')
+            protect = LOADER_FUNC_PROTECT.get(impl_name)
+            if protect is not None:
+                table += '#ifdef %s\n' % protect
+                table += entry_fmt % ((name, slot, loader_function) + entry_args)
+                table += '#else\n'
+                table += entry_fmt % ((name, slot, 'nullptr') + entry_args)
+                table += '#endif  // %s\n' % protect
+            else:
+                table += entry_fmt % ((name, slot, loader_function) + entry_args)
+        table += '};\n'
+        table += '}  // namespace\n\n'
+
+        table += 'const LoaderCommandInfo* GeneratedLoaderFindCommand(const char* name) {\n'
+        table += '    const int32_t displacement = kLoaderCommandDisplacements[LoaderCommandNameHash(0, name) % kLoaderCommandCount];\n'
+        table += '    const uint32_t slot = displacement < 0 ? static_cast<uint32_t>(-displacement - 1)\n'
+        table += '                                           : LoaderCommandNameHash(static_cast<uint32_t>(displacement), name) % kLoaderCommandCount;\n'
+        table += '    const LoaderCommandInfo* info = &kLoaderCommands[slot];\n'
+        table += '    return (0 == strcmp(info->name, name)) ? info : nullptr;\n'
+        table += '}\n'
+        return table
@@ -42,6 +42,46 @@ VALID_USAGE_MANUALLY_DEFINED = set((
     'xrSessionInsertDebugUtilsLabelEXT',
 ))
 
+# The registry does not mark which commands begin, end or check a state yet, so the states tracked for the frame
+# loop and swapchain images are listed here.  Each state is named after the handle type it is tracked on, followed by
+# an underscore and the name of the state, and is always tracked on the first parameter of its commands.
+VALID_USAGE_COMMAND_STATES = {
+    'xrWaitFrame': {'beginvalidstate': 'XrSession_frame_waited'},
+    'xrBeginFrame': {'endvalidstate': 'XrSession_frame_waited', 'beginvalidstate': 'XrSession_frame_begun'},
+    'xrEndFrame': {'endvalidstate': 'XrSession_frame_begun'},
+    'xrWaitSwapchainImage': {'beginvalidstate': 'XrSwapchain_image_waited'},
+    'xrReleaseSwapchainImage': {'endvalidstate': 'XrSwapchain_image_waited'},
+}
+
+# Commands that, once they succeed, end the listed states without needing them to have begun, such as a session
+# beginning or ending part way through a frame.
+VALID_USAGE_RESET_STATES = {
+    'xrBeginSession': ('XrSession_frame_waited', 'XrSession_frame_begun'),
+    'xrEndSession': ('XrSession_frame_waited', 'XrSession_frame_begun'),
+}
+
+# States whose begin commands may be called again before one of their end commands, such as xrBeginFrame
+# discarding the frame already begun.
+VALID_USAGE_REPEATABLE_STATES = set((
+    'XrSession_frame_waited',
+    'XrSession_frame_begun',
+))
+
+# The following commands are called every frame.  At the frame validation level, their structure and parent
+# checks only run on sampled frames, while their null pointer, handle and state checks always run.
+VALID_USAGE_FRAME_COMMANDS = set((
+    'xrWaitFrame',
+    'xrBeginFrame',
+    'xrEndFrame',
+    'xrLocateSpace',
+    'xrLocateViews',
+    'xrSyncActions',
+    'xrGetActionStateBoolean',
+    'xrGetActionStateFloat',
+    'xrGetActionStateVector2f',
+    'xrGetActionStatePose',
+))
+
 
 # ValidationSourceOutputGenerator - subclass of AutomaticSourceOutputGenerator.
 
@@ -49,6 +89,9 @@ VALID_USAGE_MANUALLY_DEFINED = set((
 class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
     """Generate core validation layer source using XML element attributes from registry"""
 
+    # Name of the variable deciding whether the sampled checks run, while generating a frame command's input checks.
+    deep_checks_variable = None
+
     # Override the base class header warning so the comment indicates this file.
     #   self            the ValidationSourceOutputGenerator object
     def outputGeneratedHeaderWarning(self):
@@ -157,29 +200,77 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         common_validation_types += '};\n\n'
         return common_validation_types
 
-    # Generate C++ structures and maps used for validating the states identified
-    # in the specification.
+    # Use the states listed in VALID_USAGE_COMMAND_STATES for any command the registry gives none for.
+    #   self            the ValidationSourceOutputGenerator object
+    #   cmd_info        the XML information for the command
+    #   name            the name of the command
+    #   attribute       the registry attribute listing the states
+    def getCommandValidStates(self, cmd_info, name, attribute):
+        valid_states = AutomaticSourceOutputGenerator.getCommandValidStates(self, cmd_info, name, attribute)
+        if valid_states is None:
+            valid_states = VALID_USAGE_COMMAND_STATES.get(name, {}).get(attribute)
+        return valid_states
+
+    # Get the name of the bit in GenValidUsageXrHandleInfo::valid_states for a state
+    #   self            the ValidationSourceOutputGenerator object
+    #   cur_state       the state to get the bit for
+    def genValidStateBit(self, cur_state):
+        return 'VALID_STATE_%s_%s' % (undecorate(cur_state.type).upper(), cur_state.variable.upper())
+
+    # Get the handle info variable the states of a command are tracked in, which is that of its first parameter
+    #   self            the ValidationSourceOutputGenerator object
+    #   cur_command     the command generated in automatic_source_generator.py
+    #   cur_state       the state being tracked
+    def getValidStateHandleInfoName(self, cur_command, cur_state):
+        first_param = cur_command.params[0]
+        if first_param.type != cur_state.type or first_param.type == 'XrInstance':
+            raise Exception('State %s must be tracked on the first parameter of %s' % (cur_state.state, cur_command.name))
+        return 'gen_%s_info' % undecorate(first_param.type)
+
+    # Generate the bits used for validating the states identified in the specification.  Each handle keeps the
+    # bits of the states it is in, so checking or changing a state never needs more than the handle lookup every
+    # command already does.
     #   self            the ValidationSourceOutputGenerator object
     def outputValidationStateCheckStructs(self):
-        validation_state_checks = '// Structure used for state validation.\n'
-        active_structures = dict()
-        for cur_state in self.api_states:
-            type_name = '%s' % cur_state.type
-            cur_list = []
-            if active_structures.get(type_name) is not None:
-                cur_list = active_structures.get(type_name)
-            cur_list.append(cur_state.variable)
-            active_structures[type_name] = cur_list
-        for type_name, variable_list in active_structures.items():
-            validation_state_checks += 'struct %sValidationStates {\n' % type_name
-            for variable in variable_list:
-                validation_state_checks += '    bool %s;\n' % variable
-            validation_state_checks += '};\n'
-            validation_state_checks += 'std::unordered_map<%s, %sValidationStates*> g_%s_valid_states;\n' % (
-                type_name, type_name, undecorate(type_name))
-        validation_state_checks += '\n'
+        if not self.api_states:
+            return ''
+        validation_state_checks = '// Bits of GenValidUsageXrHandleInfo::valid_states used for state validation.\n'
+        validation_state_checks += 'enum GenValidUsageXrValidState : uint32_t {\n'
+        for bit, cur_state in enumerate(self.api_states):
+            validation_state_checks += '    %s = 0x%08x,\n' % (self.genValidStateBit(cur_state), 1 << bit)
+        validation_state_checks += '};\n\n'
         return validation_state_checks
 
+    # Write an inline check that the state a command is called in is valid
+    #   self                    the ValidationSourceOutputGenerator object
+    #   cur_command             the command generated in automatic_source_generator.py to validate
+    #   cur_state               the state to check
+    #   must_be_active          whether the state must be active, rather than inactive, for the command
+    #   vuid_suffix             the suffix of the message ID to associate this check with
+    #   error_message           the message to log if the check fails
+    #   instance_info_variable  string used to identify the variable associated with the instance information struct
+    #   indent                  the number of tab-stops to indent the current inline strings
+    def writeInlineValidStateCheck(self, cur_command, cur_state, must_be_active, vuid_suffix, error_message,
+                                   instance_info_variable, indent):
+        state_check = self.writeIndent(indent)
+        state_check += 'if (%s (%s->valid_states.load(std::memory_order_relaxed) & %s)) {\n' % (
+            '0 ==' if must_be_active else '0 !=',
+            self.getValidStateHandleInfoName(cur_command, cur_state),
+            self.genValidStateBit(cur_state))
+        state_check += self.writeIndent(indent + 1)
+        # The specification has no VUIDs for the order of these commands, so the message ID is this layer's own.
+        state_check += 'CoreValidLogMessage(%s, "CoreValidation-%s-%s-%s",\n' % (
+            instance_info_variable, cur_command.name, cur_state.state, vuid_suffix)
+        state_check += self.writeIndent(indent + 1)
+        state_check += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, "%s", objects_info,\n' % cur_command.name
+        state_check += self.writeIndent(indent + 1)
+        state_check += '                    "%s");\n' % error_message
+        state_check += self.writeIndent(indent + 1)
+        state_check += 'return XR_ERROR_VALIDATION_FAILURE;\n'
+        state_check += self.writeIndent(indent)
+        state_check += '}\n'
+        return state_check
+
     # Generate C++ structure and utility function prototypes for validating
     # the 'next' chains in structures.
     #   self            the ValidationSourceOutputGenerator object
@@ -191,14 +282,35 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         next_chain_info += '    NEXT_CHAIN_RESULT_ERROR = -1,\n'
         next_chain_info += '    NEXT_CHAIN_RESULT_DUPLICATE_STRUCT = -2,\n'
         next_chain_info += '};\n\n'
+        # A type is only recorded once it is known to be valid for the chain, so no chain can record more types
+        # than the longest list of valid extension structures.
+        max_valid_ext_structs = 1
+        for xr_struct in self.api_structures:
+            for member in xr_struct.members:
+                if member.name == 'next' and member.valid_extension_structs:
+                    max_valid_ext_structs = max(max_valid_ext_structs, len(member.valid_extension_structs))
+        next_chain_info += '// Structure types recorded while walking a single next chain, kept on the stack so that validating\n'
+        next_chain_info += '// a chain does not allocate.\n'
+        next_chain_info += 'struct NextChainStructTypes {\n'
+        next_chain_info += '    static const uint32_t kCapacity = %d;\n' % max_valid_ext_structs
+        next_chain_info += '    XrStructureType types[kCapacity];\n'
+        next_chain_info += '    uint32_t count = 0;\n\n'
+        next_chain_info += '    bool Contains(XrStructureType type) const { return std::find(types, types + count, type) != types + count; }\n'
+        next_chain_info += '    void Add(XrStructureType type) {\n'
+        next_chain_info += '        if (count < kCapacity && !Contains(type)) {\n'
+        next_chain_info += '            types[count++] = type;\n'
+        next_chain_info += '        }\n'
+        next_chain_info += '    }\n'
+        next_chain_info += '};\n\n'
         next_chain_info += '// Prototype for validateNextChain command (it uses the validate structure commands so add it after\n'
         next_chain_info += 'NextChainResult ValidateNextChain(GenValidUsageXrInstanceInfo *instance_info,\n'
         next_chain_info += '                                  const std::string &command_name,\n'
         next_chain_info += '                                  std::vector<GenValidUsageXrObjectInfo>& objects_info,\n'
         next_chain_info += '                                  const void* next,\n'
-        next_chain_info += '                                  std::vector<XrStructureType>& valid_ext_structs,\n'
-        next_chain_info += '                                  std::vector<XrStructureType>& encountered_structs,\n'
-        next_chain_info += '                                  std::vector<XrStructureType>& duplicate_structs);\n\n'
+        next_chain_info += '                                  const XrStructureType* valid_ext_structs,\n'
+        next_chain_info += '                                  uint32_t valid_ext_struct_count,\n'
+        next_chain_info += '                                  NextChainStructTypes& encountered_structs,\n'
+        next_chain_info += '                                  NextChainStructTypes& duplicate_structs);\n\n'
         return next_chain_info
 
     # Generate C++ enum and utility function prototypes for validating
@@ -282,25 +394,13 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                 enum_value_validate += 'if (nullptr != instance_info && !ExtensionEnabled(instance_info->enabled_extensions, "%s")) {\n' % enum_tuple.ext_name
                 indent += 1
                 enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += 'std::string vuid = "VUID-";\n'
-                enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += 'vuid += validation_name;\n'
-                enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += 'vuid += "-";\n'
+                enum_value_validate += 'CoreValidLogMessage(instance_info, %s,\n' % self.writeMessageClosure(
+                    ['return "VUID-" + validation_name + "-" + item_name + "-parameter";'], indent)
                 enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += 'vuid += item_name;\n'
+                enum_value_validate += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, command_name, objects_info,\n'
                 enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += 'vuid += "-parameter";\n'
-                enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += 'std::string error_str = "%s requires extension ";\n' % enum_tuple.name
-                enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += 'error_str += " \\"%s\\" to be enabled, but it is not enabled";\n' % enum_tuple.ext_name
-                enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += 'CoreValidLogMessage(instance_info, vuid,\n'
-                enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, command_name,\n'
-                enum_value_validate += self.writeIndent(indent)
-                enum_value_validate += '                    objects_info, error_str);\n'
+                enum_value_validate += '                    "%s requires extension \\"%s\\" to be enabled, but it is not enabled");\n' % (
+                    enum_tuple.name, enum_tuple.ext_name)
                 enum_value_validate += self.writeIndent(indent)
                 enum_value_validate += 'return false;\n'
                 indent -= 1
@@ -336,28 +436,14 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                     enum_value_validate += 'if (nullptr != instance_info && !ExtensionEnabled(instance_info->enabled_extensions, "%s")) {\n' % cur_value.ext_name
                     indent += 1
                     enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'std::string vuid = "VUID-";\n'
-                    enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'vuid += validation_name;\n'
-                    enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'vuid += "-";\n'
+                    enum_value_validate += 'CoreValidLogMessage(instance_info, %s,\n' % self.writeMessageClosure(
+                        ['return "VUID-" + validation_name + "-" + item_name + "-parameter";'], indent)
                     enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'vuid += item_name;\n'
+                    enum_value_validate += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, command_name, objects_info,\n'
                     enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'vuid += "-parameter";\n'
-                    enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'std::string error_str = "%s value \\"%s\\"";\n' % (
+                    enum_value_validate += '                    "%s value \\"%s\\" being used, which requires extension '  % (
                         enum_tuple.name, cur_value.name)
-                    enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'error_str += " being used, which requires extension ";\n'
-                    enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'error_str += " \\"%s\\" to be enabled, but it is not enabled";\n' % cur_value.ext_name
-                    enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += 'CoreValidLogMessage(instance_info, vuid,\n'
-                    enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, command_name,\n'
-                    enum_value_validate += self.writeIndent(indent)
-                    enum_value_validate += '                    objects_info, error_str);\n'
+                    enum_value_validate += '\\"%s\\" to be enabled, but it is not enabled");\n' % cur_value.ext_name
                     enum_value_validate += self.writeIndent(indent)
                     enum_value_validate += 'return false;\n'
                     indent -= 1
@@ -424,9 +510,10 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         next_chain_info += '                                  const std::string &command_name,\n'
         next_chain_info += '                                  std::vector<GenValidUsageXrObjectInfo>& objects_info,\n'
         next_chain_info += '                                  const void* next,\n'
-        next_chain_info += '                                  std::vector<XrStructureType>& valid_ext_structs,\n'
-        next_chain_info += '                                  std::vector<XrStructureType>& encountered_structs,\n'
-        next_chain_info += '                                  std::vector<XrStructureType>& duplicate_structs) {\n'
+        next_chain_info += '                                  const XrStructureType* valid_ext_structs,\n'
+        next_chain_info += '                                  uint32_t valid_ext_struct_count,\n'
+        next_chain_info += '                                  NextChainStructTypes& encountered_structs,\n'
+        next_chain_info += '                                  NextChainStructTypes& duplicate_structs) {\n'
         next_chain_info += self.writeIndent(1)
         next_chain_info += 'NextChainResult return_result = NEXT_CHAIN_RESULT_VALID;\n'
         next_chain_info += self.writeIndent(1)
@@ -440,7 +527,7 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         next_chain_info += self.writeIndent(1)
         next_chain_info += '// Non-NULL is not valid if there is no valid extension structs\n'
         next_chain_info += self.writeIndent(1)
-        next_chain_info += 'if (nullptr != next && 0 == valid_ext_structs.size()) {\n'
+        next_chain_info += 'if (nullptr != next && 0 == valid_ext_struct_count) {\n'
         next_chain_info += self.writeIndent(2)
         next_chain_info += 'return NEXT_CHAIN_RESULT_ERROR;\n'
         next_chain_info += self.writeIndent(1)
@@ -448,9 +535,9 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         next_chain_info += self.writeIndent(1)
         next_chain_info += 'const XrBaseInStructure* next_header = reinterpret_cast<const XrBaseInStructure*>(next);\n'
         next_chain_info += self.writeIndent(1)
-        next_chain_info += 'auto valid_ext = std::find(valid_ext_structs.begin(), valid_ext_structs.end(), next_header->type);\n'
+        next_chain_info += 'const XrStructureType* valid_ext_structs_end = valid_ext_structs + valid_ext_struct_count;\n'
         next_chain_info += self.writeIndent(1)
-        next_chain_info += 'if (valid_ext == valid_ext_structs.end()) {\n'
+        next_chain_info += 'if (std::find(valid_ext_structs, valid_ext_structs_end, next_header->type) == valid_ext_structs_end) {\n'
         next_chain_info += self.writeIndent(2)
         next_chain_info += '// Not a valid extension structure type for this next chain.\n'
         next_chain_info += self.writeIndent(2)
@@ -460,78 +547,29 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         next_chain_info += self.writeIndent(2)
         next_chain_info += '// Check to see if we\'ve already encountered this structure.\n'
         next_chain_info += self.writeIndent(2)
-        next_chain_info += 'auto already_encountered_ext = std::find(encountered_structs.begin(), encountered_structs.end(), next_header->type);\n'
-        next_chain_info += self.writeIndent(2)
-        next_chain_info += 'if (already_encountered_ext != encountered_structs.end()) {\n'
+        next_chain_info += 'if (encountered_structs.Contains(next_header->type)) {\n'
         next_chain_info += self.writeIndent(3)
-        next_chain_info += '// Make sure we only put in unique types into our duplicate list.\n'
+        next_chain_info += '// The duplicate list only holds each type once.\n'
         next_chain_info += self.writeIndent(3)
-        next_chain_info += 'auto already_duplicate = std::find(duplicate_structs.begin(), duplicate_structs.end(), next_header->type);\n'
-        next_chain_info += self.writeIndent(3)
-        next_chain_info += 'if (already_duplicate == duplicate_structs.end()) {\n'
-        next_chain_info += self.writeIndent(4)
-        next_chain_info += 'duplicate_structs.push_back(next_header->type);\n'
-        next_chain_info += self.writeIndent(3)
-        next_chain_info += '}\n'
+        next_chain_info += 'duplicate_structs.Add(next_header->type);\n'
         next_chain_info += self.writeIndent(3)
         next_chain_info += 'return_result = NEXT_CHAIN_RESULT_DUPLICATE_STRUCT;\n'
         next_chain_info += self.writeIndent(2)
-        next_chain_info += '}\n'
-        next_chain_info += self.writeIndent(1)
-        next_chain_info += '}\n'
-        # Validate the rest of this struct
-        next_chain_info += self.writeIndent(1)
-        next_chain_info += 'switch (next_header->type) {\n'
-        enum_tuple = [x for x in self.api_enums if x.name == 'XrStructureType'][0]
-        for cur_value in enum_tuple.values:
-            struct_define_name = self.genXrStructureName(
-                cur_value.name)
-            if not struct_define_name:
-                continue
-
-            struct_tuple = self.getStruct(struct_define_name)
-            avoid_dupe = None
-            if cur_value.alias:
-                aliased_value = [x for x in enum_tuple.values if x.name == cur_value.alias][0]
-                if aliased_value.protect_value and aliased_value.protect_value != cur_value.protect_value and aliased_value.protect_value != struct_tuple.protect_value:
-                    avoid_dupe = aliased_value.protect_string
-                    next_chain_info += '#if !(%s)\n' % avoid_dupe
-                else:
-                    # This would unconditionally cause a duplicate case
-                    continue
-            if struct_tuple.protect_value:
-                next_chain_info += '#if %s\n' % struct_tuple.protect_string
-                
-            next_chain_info += self.writeIndent(2)
-            next_chain_info += 'case %s:\n' % cur_value.name
-            next_chain_info += self.writeIndent(3)
-            next_chain_info += 'if (XR_SUCCESS != ValidateXrStruct(instance_info, command_name, objects_info, false,\n'
-            next_chain_info += self.writeIndent(3)
-            next_chain_info += '                                   reinterpret_cast<const %s*>(next))) {\n' % struct_define_name
-            next_chain_info += self.writeIndent(4)
-            next_chain_info += 'return NEXT_CHAIN_RESULT_ERROR;\n'
-            next_chain_info += self.writeIndent(3)
-            next_chain_info += '}\n'
-            next_chain_info += self.writeIndent(3)
-            next_chain_info += 'break;\n'
-            if struct_tuple.protect_value:
-                next_chain_info += '#endif // %s\n' % struct_tuple.protect_string
-            if avoid_dupe:
-                next_chain_info += '#endif // !(%s)\n' % avoid_dupe
-
-        next_chain_info += self.writeIndent(2)
-        next_chain_info += 'default:\n'
+        next_chain_info += '} else {\n'
         next_chain_info += self.writeIndent(3)
-        next_chain_info += 'return NEXT_CHAIN_RESULT_ERROR;\n'
+        next_chain_info += 'encountered_structs.Add(next_header->type);\n'
+        next_chain_info += self.writeIndent(2)
+        next_chain_info += '}\n'
         next_chain_info += self.writeIndent(1)
         next_chain_info += '}\n'
-        # Validate any chained structs
+        # Validate any chained structs.  Every structure in the chain extends the base structure, so they are all
+        # checked against its list of valid extension structures rather than against their own.
         next_chain_info += self.writeIndent(1)
         next_chain_info += 'NextChainResult next_result = ValidateNextChain(instance_info, command_name,\n'
         next_chain_info += self.writeIndent(1)
         next_chain_info += '                                                objects_info, next_header->next,\n'
         next_chain_info += self.writeIndent(1)
-        next_chain_info += '                                                valid_ext_structs,\n'
+        next_chain_info += '                                                valid_ext_structs, valid_ext_struct_count,\n'
         next_chain_info += self.writeIndent(1)
         next_chain_info += '                                                encountered_structs,\n'
         next_chain_info += self.writeIndent(1)
@@ -991,22 +1029,28 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
     #   member          the member generated in automatic_source_generator.py to validate
     #   indent          the number of "tabs" to space in for the resulting C+ code.
     def writeValidateStructNextCheck(self, struct_type, struct_name, member, indent):
-        validate_struct_next = self.writeIndent(indent)
-        validate_struct_next += 'std::vector<XrStructureType> valid_ext_structs;\n'
-        validate_struct_next += self.writeIndent(indent)
-        validate_struct_next += 'std::vector<XrStructureType> duplicate_ext_structs;\n'
-        validate_struct_next += self.writeIndent(indent)
-        validate_struct_next += 'std::vector<XrStructureType> encountered_structs;\n'
+        validate_struct_next = ''
+        valid_ext_structs = 'nullptr'
+        valid_ext_struct_count = 0
         if member.valid_extension_structs:
+            validate_struct_next += self.writeIndent(indent)
+            validate_struct_next += 'static const XrStructureType valid_ext_structs[] = {\n'
             for valid_struct in member.valid_extension_structs:
-                validate_struct_next += self.writeIndent(indent)
-                validate_struct_next += 'valid_ext_structs.push_back(%s);\n' % self.genXrStructureType(
-                    valid_struct)
+                validate_struct_next += self.writeIndent(indent + 1)
+                validate_struct_next += '%s,\n' % self.genXrStructureType(valid_struct)
+            validate_struct_next += self.writeIndent(indent)
+            validate_struct_next += '};\n'
+            valid_ext_structs = 'valid_ext_structs'
+            valid_ext_struct_count = len(member.valid_extension_structs)
+        validate_struct_next += self.writeIndent(indent)
+        validate_struct_next += 'NextChainStructTypes duplicate_ext_structs;\n'
+        validate_struct_next += self.writeIndent(indent)
+        validate_struct_next += 'NextChainStructTypes encountered_structs;\n'
         validate_struct_next += self.writeIndent(indent)
         validate_struct_next += 'NextChainResult next_result = ValidateNextChain(instance_info, command_name, objects_info,\n'
         validate_struct_next += self.writeIndent(indent)
-        validate_struct_next += '                                                 %s->%s, valid_ext_structs,\n' % (
-            struct_name, member.name)
+        validate_struct_next += '                                                 %s->%s, %s, %d,\n' % (
+            struct_name, member.name, valid_ext_structs, valid_ext_struct_count)
         validate_struct_next += self.writeIndent(indent)
         validate_struct_next += '                                                 encountered_structs,\n'
         validate_struct_next += self.writeIndent(indent)
@@ -1030,19 +1074,15 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         validate_struct_next += self.writeIndent(indent)
         validate_struct_next += '} else if (NEXT_CHAIN_RESULT_DUPLICATE_STRUCT == next_result) {\n'
         validate_struct_next += self.writeIndent(indent + 1)
-        validate_struct_next += 'std::string error_message = "Multiple structures of the same type(s) in \\"next\\" chain for ";\n'
-        validate_struct_next += self.writeIndent(indent + 1)
-        validate_struct_next += 'error_message += "%s : ";\n' % struct_type
-        validate_struct_next += self.writeIndent(indent + 1)
-        validate_struct_next += 'error_message += StructTypesToString(instance_info, duplicate_ext_structs);\n'
-        validate_struct_next += self.writeIndent(indent + 1)
         validate_struct_next += 'CoreValidLogMessage(instance_info, "VUID-%s-next-unique",\n' % struct_type
         validate_struct_next += self.writeIndent(indent + 1)
         validate_struct_next += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, command_name,\n'
         validate_struct_next += self.writeIndent(indent + 1)
-        validate_struct_next += '                    objects_info,\n'
-        validate_struct_next += self.writeIndent(indent + 1)
-        validate_struct_next += '"Multiple structures of the same type(s) in \\"next\\" chain for %s struct");\n' %  struct_type
+        validate_struct_next += '                    objects_info, %s);\n' % self.writeMessageClosure(
+            ['std::string error_message = "Multiple structures of the same type(s) in \\"next\\" chain for ";',
+             'error_message += "%s struct : ";' % struct_type,
+             'error_message += StructTypesToString(instance_info, duplicate_ext_structs.types, duplicate_ext_structs.count);',
+             'return error_message;'], indent + 1)
         validate_struct_next += self.writeIndent(indent + 1)
         validate_struct_next += 'xr_result = XR_ERROR_VALIDATION_FAILURE;\n'
         validate_struct_next += self.writeIndent(indent)
@@ -1155,22 +1195,17 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
             instance_info_string, cmd_name_param, cmd_struct_name, param_name, pointer_string, full_param_name)
         int_indent = int_indent + 1
         inline_enum_str += self.writeIndent(int_indent)
-        inline_enum_str += 'std::ostringstream oss_enum;\n'
-        inline_enum_str += self.writeIndent(int_indent)
-        inline_enum_str += 'oss_enum << "%s %s \\"%s\\" enum value ";\n' % (error_prefix,
-                                                                            param_type,
-                                                                            param_name)
-        inline_enum_str += self.writeIndent(int_indent)
-        inline_enum_str += 'oss_enum << Uint32ToHexString(static_cast<uint32_t>(%s%s));\n' % (pointer_string,
-                                                                                              full_param_name)
-        inline_enum_str += self.writeIndent(int_indent)
         inline_enum_str += 'CoreValidLogMessage(%s, "VUID-%s-%s-parameter",\n' % (instance_info_string,
                                                                                   cmd_struct_name,
                                                                                   param_name)
         inline_enum_str += self.writeIndent(int_indent)
         inline_enum_str += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, %s,\n' % cmd_name_param
         inline_enum_str += self.writeIndent(int_indent)
-        inline_enum_str += '                    objects_info, oss_enum.str());\n'
+        inline_enum_str += '                    objects_info, %s);\n' % self.writeMessageClosure(
+            ['std::ostringstream oss_enum;',
+             'oss_enum << "%s %s \\"%s\\" enum value ";' % (error_prefix, param_type, param_name),
+             'oss_enum << Uint32ToHexString(static_cast<uint32_t>(%s%s));' % (pointer_string, full_param_name),
+             'return oss_enum.str();'], int_indent)
         inline_enum_str += self.writeIndent(int_indent)
         inline_enum_str += 'return XR_ERROR_VALIDATION_FAILURE;\n'
         int_indent = int_indent - 1
@@ -1247,24 +1282,18 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
             inline_flag_str += self.writeIndent(int_indent)
             inline_flag_str += '// Otherwise, flags must be valid.\n'
             inline_flag_str += self.writeIndent(int_indent)
-            inline_flag_str += 'std::ostringstream oss_enum;\n'
-            inline_flag_str += self.writeIndent(int_indent)
-            inline_flag_str += 'oss_enum << "%s %s \\"%s\\" flag value ";\n' % (error_prefix,
-                                                                                param_type,
-                                                                                param_name)
-            inline_flag_str += self.writeIndent(int_indent)
-            inline_flag_str += 'oss_enum << Uint32ToHexString(static_cast<uint32_t>(%s%s));\n' % (pointer_string,
-                                                                                                  full_param_name)
-            inline_flag_str += self.writeIndent(int_indent)
-            inline_flag_str += 'oss_enum <<" contains illegal bit";\n'
-            inline_flag_str += self.writeIndent(int_indent)
             inline_flag_str += 'CoreValidLogMessage(%s, "VUID-%s-%s-parameter",\n' % (instance_info_string,
                                                                                       cmd_struct_name,
                                                                                       param_name)
             inline_flag_str += self.writeIndent(int_indent)
             inline_flag_str += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, %s,\n' % cmd_name_param
             inline_flag_str += self.writeIndent(int_indent)
-            inline_flag_str += '                    objects_info, oss_enum.str());\n'
+            inline_flag_str += '                    objects_info, %s);\n' % self.writeMessageClosure(
+                ['std::ostringstream oss_enum;',
+                 'oss_enum << "%s %s \\"%s\\" flag value ";' % (error_prefix, param_type, param_name),
+                 'oss_enum << Uint32ToHexString(static_cast<uint32_t>(%s%s));' % (pointer_string, full_param_name),
+                 'oss_enum << " contains illegal bit";',
+                 'return oss_enum.str();'], int_indent)
             inline_flag_str += self.writeIndent(int_indent)
             inline_flag_str += 'return XR_ERROR_VALIDATION_FAILURE;\n'
             int_indent = int_indent - 1
@@ -1348,20 +1377,17 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                 inline_validate_handle += self.writeIndent(indent)
                 inline_validate_handle += '// Not a valid handle or NULL (which is not valid in this case)\n'
             inline_validate_handle += self.writeIndent(indent)
-            inline_validate_handle += 'std::ostringstream oss;\n'
-            inline_validate_handle += self.writeIndent(indent)
-            inline_validate_handle += 'oss << "Invalid %s handle \\"%s\\" ";\n' % (member_param.type,
-                                                                                   member_param.name)
-            inline_validate_handle += self.writeIndent(indent)
-            inline_validate_handle += 'oss << HandleToHexString(%s);\n' % mem_par_desc_name
-            inline_validate_handle += self.writeIndent(indent)
             inline_validate_handle += 'CoreValidLogMessage(%s, "VUID-%s-%s-parameter",\n' % (instance_info_name,
                                                                                              vuid_name,
                                                                                              member_param.name)
             inline_validate_handle += self.writeIndent(indent)
             inline_validate_handle += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, %s,\n' % cmd_name
             inline_validate_handle += self.writeIndent(indent)
-            inline_validate_handle += '                    objects_info, oss.str());\n'
+            inline_validate_handle += '                    objects_info, %s);\n' % self.writeMessageClosure(
+                ['std::ostringstream oss;',
+                 'oss << "Invalid %s handle \\"%s\\" ";' % (member_param.type, member_param.name),
+                 'oss << HandleToHexString(%s);' % mem_par_desc_name,
+                 'return oss.str();'], indent)
             inline_validate_handle += self.writeIndent(indent)
             inline_validate_handle += 'return XR_ERROR_HANDLE_INVALID;\n'
             indent = indent - 1
@@ -1385,6 +1411,7 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         check_pointer_array_null = False
         loop_string = ''
         wrote_loop = False
+        deep_checks_start = None
         prefixed_param_member_name = param_member_prefix
         prefixed_param_member_name += param_member.name
         pre_loop_prefixed_param_member_name = prefixed_param_member_name
@@ -1554,6 +1581,8 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                                                                                   True,
                                                                                   indent)
         elif self.isStruct(param_member.type) and not self.isStructAlwaysValid(param_member.type):
+            if is_command and self.deep_checks_variable:
+                deep_checks_start = len(param_member_contents)
             param_member_contents += loop_string
             wrote_loop = True
             # Check to see if this struct is the base of a relation group
@@ -1645,23 +1674,15 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                     param_member_contents += self.writeIndent(indent)
                     param_member_contents += 'if (XR_SUCCESS != xr_result) {\n'
                     indent = indent + 1
-                    param_member_contents += self.writeIndent(indent)
-                    param_member_contents += 'std::string error_message = "'
                     if is_command:
-                        param_member_contents += 'Command %s param %s";\n' % (
-                            struct_command_name, param_member.name)
+                        error_message = 'Command %s param %s' % (struct_command_name, param_member.name)
                     else:
-                        param_member_contents += 'Structure %s member %s";\n' % (
-                            struct_command_name, param_member.name)
+                        error_message = 'Structure %s member %s' % (struct_command_name, param_member.name)
                     if is_array:
-                        param_member_contents += self.writeIndent(indent)
-                        param_member_contents += 'error_message += "[";\n'
-                        param_member_contents += self.writeIndent(indent)
-                        param_member_contents += 'error_message += std::to_string(%s);\n' % loop_param_name
-                        param_member_contents += self.writeIndent(indent)
-                        param_member_contents += 'error_message += "]";\n'
-                    param_member_contents += self.writeIndent(indent)
-                    param_member_contents += 'error_message += " is invalid";\n'
+                        error_message = self.writeMessageClosure(
+                            ['return "%s[" + std::to_string(%s) + "] is invalid";' % (error_message, loop_param_name)], indent)
+                    else:
+                        error_message = '"%s is invalid"' % error_message
 
                     param_member_contents += self.writeIndent(indent)
                     param_member_contents += 'CoreValidLogMessage(%s, "VUID-%s-%s-parameter",\n' % (
@@ -1671,7 +1692,7 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                     param_member_contents += self.writeIndent(indent)
                     param_member_contents += '                    objects_info,\n'
                     param_member_contents += self.writeIndent(indent)
-                    param_member_contents += '                    error_message);\n'
+                    param_member_contents += '                    %s);\n' % error_message
                     param_member_contents += self.writeIndent(indent)
                     param_member_contents += 'return XR_ERROR_VALIDATION_FAILURE;\n'
                     if is_array:
@@ -1844,9 +1865,40 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                 param_member_contents += '}\n'
                 param_member_contents += self.writeIndent(indent)
                 param_member_contents += '}\n'
+        if deep_checks_start is not None:
+            param_member_contents = (param_member_contents[:deep_checks_start] +
+                                     self.writeDeepChecksOnly(param_member_contents[deep_checks_start:], indent))
 
         return param_member_contents
 
+    # Write a closure for CoreValidLogMessage that formats a message, so it is only built if the message is wanted
+    #   self            the ValidationSourceOutputGenerator object
+    #   statements      the C++ statements that build the message, the last of which returns it
+    #   indent          the number of tab-stops the CoreValidLogMessage call is indented by
+    def writeMessageClosure(self, statements, indent):
+        closure = '[&]() {\n'
+        for statement in statements:
+            closure += self.writeIndent(indent)
+            closure += '                        %s\n' % statement
+        closure += self.writeIndent(indent)
+        closure += '                    }'
+        return closure
+
+    # Wrap already generated checks so that they only run when the sampled checks are enabled
+    #   self            the ValidationSourceOutputGenerator object
+    #   checks          the generated checks, indented for the current tab-stop
+    #   indent          the number of tab-stops to indent the current inline strings
+    def writeDeepChecksOnly(self, checks, indent):
+        deep_checks = self.writeIndent(indent)
+        deep_checks += 'if (%s) {\n' % self.deep_checks_variable
+        for line in checks.splitlines(True):
+            if line.strip() and not line.startswith('#'):
+                deep_checks += self.writeIndent(1)
+            deep_checks += line
+        deep_checks += self.writeIndent(indent)
+        deep_checks += '}\n'
+        return deep_checks
+
 
 
     # Write the validation function for every struct we know about.
@@ -1902,19 +1954,14 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                         struct_check += 'if (nullptr != instance_info && !ExtensionEnabled(instance_info->enabled_extensions, "%s")) {\n' % child_struct.ext_name
                         indent += 1
                         struct_check += self.writeIndent(indent)
-                        struct_check += 'std::string error_str = "%s being used with child struct type ";\n' % xr_struct.name
-                        struct_check += self.writeIndent(indent)
-                        struct_check += 'error_str += "\\"%s\\"";\n' % self.genXrStructureType(
-                            child)
-                        struct_check += self.writeIndent(indent)
-                        struct_check += 'error_str += " which requires extension \\"%s\\" to be enabled, but it is not enabled";\n' % child_struct.ext_name
-                        struct_check += self.writeIndent(indent)
                         struct_check += 'CoreValidLogMessage(instance_info, "VUID-%s-type-type",\n' % (
                             xr_struct.name)
                         struct_check += self.writeIndent(indent)
                         struct_check += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, command_name,\n'
                         struct_check += self.writeIndent(indent)
-                        struct_check += '                    objects_info, error_str);\n'
+                        struct_check += '                    objects_info, "%s being used with child struct type \\"%s\\" which requires '  % (
+                            xr_struct.name, self.genXrStructureType(child))
+                        struct_check += 'extension \\"%s\\" to be enabled, but it is not enabled");\n' % child_struct.ext_name
                         struct_check += self.writeIndent(indent)
                         struct_check += 'return XR_ERROR_VALIDATION_FAILURE;\n'
                         indent -= 1
@@ -2061,12 +2108,16 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         compare_flag = 'true'
         if first_handle_mem_param.type == cur_handle_mem_param.type:
             compare_flag = 'false'
+        deep_checks_condition = ''
+        if self.deep_checks_variable:
+            deep_checks_condition = '%s && ' % self.deep_checks_variable
         if cur_handle_mem_param.is_optional:
             parent_check_string += '// If the second handle is optional, only check for a common parent if\n'
             parent_check_string += self.writeIndent(indent)
             parent_check_string += '// it is not XR_NULL_HANDLE\n'
             parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'if (!IsIntegerNullHandle(%s) && !VerifyXrParent(%s, MakeHandleGeneric(%s),\n' % (
+            parent_check_string += 'if (%s!IsIntegerNullHandle(%s) && !VerifyXrParent(%s, MakeHandleGeneric(%s),\n' % (
+                deep_checks_condition,
                 cur_handle_desc_name,
                 self.genXrObjectType(first_handle_mem_param.type),
                 first_handle_desc_name)
@@ -2078,33 +2129,24 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         else:
             parent_check_string += '// Verify that the handles share a common ancestry\n'
             parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'if (!VerifyXrParent(%s,  MakeHandleGeneric(%s),\n' % (
-                self.genXrObjectType(first_handle_mem_param.type), first_handle_desc_name)
+            parent_check_string += 'if (%s!VerifyXrParent(%s,  MakeHandleGeneric(%s),\n' % (
+                deep_checks_condition, self.genXrObjectType(first_handle_mem_param.type), first_handle_desc_name)
             parent_check_string += '                    %s,  MakeHandleGeneric(%s%s), %s)) {\n' % (
                 self.genXrObjectType(cur_handle_mem_param.type), pointer_deref, cur_handle_desc_name, compare_flag)
         indent = indent + 1
-        parent_check_string += self.writeIndent(indent)
-        parent_check_string += 'std::ostringstream oss_error;\n'
-        parent_check_string += self.writeIndent(indent)
-        parent_check_string += 'oss_error << "%s " << HandleToHexString(%s);\n' % (
-            first_handle_mem_param.type, first_handle_desc_name)
+        error_statements = ['std::ostringstream oss_error;',
+                            'oss_error << "%s " << HandleToHexString(%s);' % (first_handle_mem_param.type, first_handle_desc_name)]
         if first_handle_tuple.name == cur_handle_tuple.parent:
-            parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'oss_error << " must be a parent to %s ";\n' % cur_handle_mem_param.type
-            parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'oss_error << HandleToHexString(%s);\n' % cur_handle_desc_name
+            error_statements.append('oss_error << " must be a parent to %s ";' % cur_handle_mem_param.type)
+            error_statements.append('oss_error << HandleToHexString(%s);' % cur_handle_desc_name)
         elif cur_handle_tuple.name == first_handle_tuple.parent:
-            parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'oss_error << " must be a child of %s ";\n' % cur_handle_mem_param.type
-            parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'oss_error << HandleToHexString(%s);\n' % cur_handle_desc_name
+            error_statements.append('oss_error << " must be a child of %s ";' % cur_handle_mem_param.type)
+            error_statements.append('oss_error << HandleToHexString(%s);' % cur_handle_desc_name)
         else:
-            parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'oss_error <<  " and %s ";\n' % cur_handle_mem_param.type
-            parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'oss_error << HandleToHexString(%s);\n' % cur_handle_desc_name
-            parent_check_string += self.writeIndent(indent)
-            parent_check_string += 'oss_error <<  " must share a parent";\n'
+            error_statements.append('oss_error << " and %s ";' % cur_handle_mem_param.type)
+            error_statements.append('oss_error << HandleToHexString(%s);' % cur_handle_desc_name)
+            error_statements.append('oss_error << " must share a parent";')
+        error_statements.append('return oss_error.str();')
         parent_check_string += self.writeIndent(indent)
         parent_check_string += 'CoreValidLogMessage(%s, "VUID-%s-%s",\n' % (instance_info_string,
                                                                             vuid_name,
@@ -2112,7 +2154,7 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         parent_check_string += self.writeIndent(indent)
         parent_check_string += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, %s,\n' % cmd_name_param
         parent_check_string += self.writeIndent(indent)
-        parent_check_string += '                    objects_info, oss_error.str());\n'
+        parent_check_string += '                    objects_info, %s);\n' % self.writeMessageClosure(error_statements, indent)
         parent_check_string += self.writeIndent(indent)
         parent_check_string += 'return XR_ERROR_VALIDATION_FAILURE;\n'
         indent = indent - 1
@@ -2145,6 +2187,11 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         pre_validate_func += 'XrResult xr_result = XR_SUCCESS;\n'
         pre_validate_func += self.writeIndent(indent)
         pre_validate_func += 'std::vector<GenValidUsageXrObjectInfo> objects_info;\n'
+        if cur_command.name in VALID_USAGE_FRAME_COMMANDS:
+            self.deep_checks_variable = 'deep_checks'
+            pre_validate_func += self.writeIndent(indent)
+            pre_validate_func += 'bool deep_checks = CoreValidationSampleFrameChecks(%s);\n' % (
+                'true' if cur_command.name == 'xrEndFrame' else 'false')
         first_param = cur_command.params[0]
         first_param_tuple = self.getHandle(first_param.type)
         if first_param_tuple is not None:
@@ -2184,23 +2231,7 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
             pre_validate_func += self.writeIndent(indent)
             pre_validate_func += '(void)gen_instance_info;  // quiet warnings\n'
 
-        # If any of the associated handles has validation state tracking, get the
-        # appropriate struct setup for validation later in the function
-        valid_type_list = []
         if cur_command.checks_state:
-            for cur_state in self.api_states:
-                if cur_command.name in cur_state.check_commands:
-                    command_param_of_type = ''
-                    for param in cur_command.params:
-                        if param.type == cur_state.type:
-                            command_param_of_type = param.name
-                            break
-                    if command_param_of_type and cur_state.type not in valid_type_list:
-                        valid_type_list.append(cur_state.type)
-                        pre_validate_func += self.writeIndent(2)
-                        pre_validate_func += 'auto %s_valid = g_%s_valid_states[%s];\n' % (
-                            undecorate(cur_state.type), undecorate(cur_state.type), command_param_of_type)
-
             for additional_ext in cur_command.required_exts:
                 pre_validate_func += self.writeIndent(indent)
                 pre_validate_func += '// Check to make sure that the extension this command is in has been enabled\n'
@@ -2238,136 +2269,44 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
 
         # If this command needs to be checked to ensure that it is executing between
         # a "begin" and an "end" command, do so.
-        if cur_command.checks_state:
-            for cur_state in self.api_states:
-                if cur_command.name in cur_state.check_commands:
-                    for param in cur_command.params:
-                        if param.type == cur_state.type:
-                            break
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '// Validate that this command is called at the proper time between the\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '// appropriate commands\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += 'if (!%s_valid->%s) {\n' % (
-                        undecorate(cur_state.type), cur_state.variable)
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'std::string error_msg = "%s is required to be called between successful calls to ";\n' % cur_command.name
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'error_msg += "'
-                    cur_count = 0
-                    for begin_command in cur_state.begin_commands:
-                        if cur_count > 0:
-                            pre_validate_func += '/'
-                        cur_count += 1
-                        pre_validate_func += '%s' % begin_command
-                    pre_validate_func += ' and '
-                    cur_count = 0
-                    for end_command in cur_state.end_commands:
-                        if cur_count > 0:
-                            pre_validate_func += '/'
-                        cur_count += 1
-                        pre_validate_func += '%s' % end_command
-                    pre_validate_func += ' commands";\n'
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'CoreValidLogMessage(%s, "VUID-%s-%s-checkstate",\n' % (
-                        instance_info_variable, cur_command.name, cur_state.state)
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, "%s", objects_info,\n' % cur_command.name
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += '                    error_msg);\n'
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'return XR_ERROR_VALIDATION_FAILURE;\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '}\n'
-
-        # If this command needs to indicate that a validation state has begun, do so.
-        if cur_command.begins_state:
-            for cur_state in self.api_states:
-                if cur_command.name in cur_state.check_commands:
-                    for param in cur_command.params:
-                        if param.type == cur_state.type:
-                            break
-                    # First, make sure we're not calling two (or more) "begins" in a row
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '// Validate that this command is called first or only after the corresponding\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '// "completion" commands\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += 'if (%s_valid->%s) {\n' % (
-                        undecorate(cur_state.type), cur_state.variable)
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'std::string error_msg = "%s is called again without first successfully calling ";\n' % cur_command.name
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'error_msg += "'
-                    cur_count = 0
-                    for end_command in cur_state.end_commands:
-                        if cur_count > 0:
-                            pre_validate_func += '/'
-                        cur_count += 1
-                        pre_validate_func += '%s' % end_command
-                    pre_validate_func += '";\n'
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'CoreValidLogMessage(%s, "VUID-%s-%s-beginstate",\n' % (
-                        instance_info_variable, cur_command.name, cur_state.state)
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, "%s", objects_info,\n' % cur_command.name
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += '                    error_msg);\n'
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'return XR_ERROR_VALIDATION_FAILURE;\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '}\n'
-                    # Begin the appropriate state
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '// Begin the %s state\n' % cur_state.state
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '%s_valid->%s = true;\n' % (
-                        undecorate(cur_state.type), cur_state.variable)
-
-        # If this command needs to indicate an end of a validation state, do so.
-        if cur_command.ends_state:
-            for cur_state in self.api_states:
-                if cur_command.name in cur_state.check_commands:
-                    for param in cur_command.params:
-                        if param.type == cur_state.type:
-                            break
-                    # First, make sure we're not calling two (or more) "ends" in a row (or before a "begin")
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '// Validate that this command is called after the corresponding\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '// "begin" commands\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += 'if (!%s_valid->%s) {\n' % (
-                        undecorate(cur_state.type), cur_state.variable)
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'std::string error_msg = "%s is called again without first successfully calling ";\n' % cur_command.name
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'error_msg += "'
-                    cur_count = 0
-                    for begin_command in cur_state.begin_commands:
-                        if cur_count > 0:
-                            pre_validate_func += '/'
-                        cur_count += 1
-                        pre_validate_func += '%s' % begin_command
-                    pre_validate_func += '";\n'
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'CoreValidLogMessage(%s, "VUID-%s-%s-endstate",\n' % (
-                        instance_info_variable, cur_command.name, cur_state.state)
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += '                    VALID_USAGE_DEBUG_SEVERITY_ERROR, "%s", objects_info,\n' % cur_command.name
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += '                    error_msg);\n'
-                    pre_validate_func += self.writeIndent(3)
-                    pre_validate_func += 'return XR_ERROR_VALIDATION_FAILURE;\n'
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '}\n'
-                    # End the appropriate state
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '// End the %s state\n' % cur_state.state
-                    pre_validate_func += self.writeIndent(2)
-                    pre_validate_func += '%s_valid->%s = false;\n' % (
-                        undecorate(cur_state.type), cur_state.variable)
+        for cur_state in self.api_states:
+            if cur_command.name in cur_state.check_commands:
+                pre_validate_func += self.writeIndent(indent)
+                pre_validate_func += '// Validate that this command is called at the proper time between the\n'
+                pre_validate_func += self.writeIndent(indent)
+                pre_validate_func += '// appropriate commands\n'
+                pre_validate_func += self.writeInlineValidStateCheck(
+                    cur_command, cur_state, True, 'checkstate',
+                    '%s is required to be called between successful calls to %s and %s commands' % (
+                        cur_command.name, '/'.join(cur_state.begin_commands), '/'.join(cur_state.end_commands)),
+                    instance_info_variable, indent)
+
+        # If this command begins a validation state that must end before it begins again, make sure we're not
+        # calling two (or more) "begins" in a row.  The state itself begins once the command succeeds.
+        for cur_state in self.api_states:
+            if cur_command.name in cur_state.begin_commands and cur_state.state not in VALID_USAGE_REPEATABLE_STATES:
+                pre_validate_func += self.writeIndent(indent)
+                pre_validate_func += '// Validate that this command is called first or only after the corresponding\n'
+                pre_validate_func += self.writeIndent(indent)
+                pre_validate_func += '// "completion" commands\n'
+                pre_validate_func += self.writeInlineValidStateCheck(
+                    cur_command, cur_state, False, 'beginstate',
+                    '%s is called again without first successfully calling %s' % (
+                        cur_command.name, '/'.join(cur_state.end_commands)),
+                    instance_info_variable, indent)
+
+        # If this command ends a validation state, make sure that state has begun.
+        for cur_state in self.api_states:
+            if cur_command.name in cur_state.end_commands:
+                pre_validate_func += self.writeIndent(indent)
+                pre_validate_func += '// Validate that this command is called after the corresponding\n'
+                pre_validate_func += self.writeIndent(indent)
+                pre_validate_func += '// "begin" commands\n'
+                pre_validate_func += self.writeInlineValidStateCheck(
+                    cur_command, cur_state, True, 'endstate',
+                    '%s is called without first successfully calling %s' % (
+                        cur_command.name, '/'.join(cur_state.begin_commands)),
+                    instance_info_variable, indent)
 
         pre_validate_func += self.writeIndent(indent)
         pre_validate_func += 'return xr_result;\n'
@@ -2379,6 +2318,7 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
         pre_validate_func += self.writeIndent(indent)
         pre_validate_func += '}\n'
         pre_validate_func += '}\n\n'
+        self.deep_checks_variable = None
         return pre_validate_func
 
     # Generate C++ code to call down to the next layer/loader terminator/runtime
@@ -2427,6 +2367,26 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                 next_validate_func += '        GenValidUsageXrInstanceInfo *gen_instance_info = info_with_instance.second;\n'
         else:
             next_validate_func += '#error("Bug")\n'
+
+        # End any validation states this command ends before calling down, so that a command it unblocks on
+        # another thread can begin them again, and begin any states it begins once it has succeeded.
+        begin_state_bits = [self.genValidStateBit(cur_state) for cur_state in self.api_states
+                            if cur_command.name in cur_state.begin_commands]
+        end_state_bits = [self.genValidStateBit(cur_state) for cur_state in self.api_states
+                          if cur_command.name in cur_state.end_commands]
+        reset_state_bits = [self.genValidStateBit(cur_state) for cur_state in self.api_states
+                            if cur_state.state in VALID_USAGE_RESET_STATES.get(cur_command.name, ())]
+        valid_states_info_name = None
+        for cur_state in self.api_states:
+            if (cur_command.name in cur_state.begin_commands or cur_command.name in cur_state.end_commands or
+                    cur_state.state in VALID_USAGE_RESET_STATES.get(cur_command.name, ())):
+                valid_states_info_name = self.getValidStateHandleInfoName(cur_command, cur_state)
+        if end_state_bits:
+            next_validate_func += '        // End the states this command ends, restoring them below if it fails\n'
+            next_validate_func += '        uint32_t ended_valid_states = %s->valid_states.fetch_and(~(%s), std::memory_order_relaxed) &\n' % (
+                valid_states_info_name, ' | '.join(end_state_bits))
+            next_validate_func += '                                      (%s);\n' % ' | '.join(end_state_bits)
+
         # Call down, looking for the returned result if required.
         next_validate_func += '        '
         if has_return:
@@ -2441,6 +2401,26 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
             count = count + 1
         next_validate_func += ');\n'
 
+        # A command that timed out did not do anything, so it neither begins nor ends a state.
+        if begin_state_bits:
+            next_validate_func += '        if (XR_SUCCEEDED(result) && XR_TIMEOUT_EXPIRED != result) {\n'
+            next_validate_func += '            %s->valid_states.fetch_or(%s, std::memory_order_relaxed);\n' % (
+                valid_states_info_name, ' | '.join(begin_state_bits))
+            if end_state_bits:
+                next_validate_func += '        } else {\n'
+        elif end_state_bits:
+            next_validate_func += '        if (XR_FAILED(result) || XR_TIMEOUT_EXPIRED == result) {\n'
+        if end_state_bits:
+            next_validate_func += '            %s->valid_states.fetch_or(ended_valid_states, std::memory_order_relaxed);\n' % (
+                valid_states_info_name)
+        if begin_state_bits or end_state_bits:
+            next_validate_func += '        }\n'
+        if reset_state_bits:
+            next_validate_func += '        if (XR_SUCCEEDED(result)) {\n'
+            next_validate_func += '            %s->valid_states.fetch_and(~(%s), std::memory_order_relaxed);\n' % (
+                valid_states_info_name, ' | '.join(reset_state_bits))
+            next_validate_func += '        }\n'
+
         # If this is a create command, we have to create an entry in the appropriate
         # unordered_map pointing to the correct dispatch table for the newly created
         # object.  Likewise, if it's a delete command, we have to remove the entry
@@ -2461,24 +2441,6 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                 next_validate_func += '            handle_info->direct_parent_handle = MakeHandleGeneric(%s);\n' % first_param.name
                 next_validate_func += '            %s.insert(*%s, std::move(handle_info));\n' % (self.makeInfoName(last_handle_tuple), last_handle_name)
 
-                # If this object contains a state that needs tracking, allocate it
-                valid_type_list = []
-                for cur_state in self.api_states:
-                    if last_handle_tuple.name == cur_state.type and cur_state.type not in valid_type_list:
-                        valid_type_list.append(cur_state.type)
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += '// Check to see if this object that has been created has a validation\n'
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += '// state structure that needs to be created as well.\n'
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += '%sValidationStates *%s_valid_state = new %sValidationStates;\n' % (
-                            cur_state.type, undecorate(cur_state.type), cur_state.type)
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += '(*%s_valid_state) = {};\n' % undecorate(cur_state.type)
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += 'g_%s_valid_states[(*%s)] = %s_valid_state;\n' % (
-                            undecorate(cur_state.type), last_handle_name, undecorate(cur_state.type))
-
                 next_validate_func += '        }\n'
             elif is_destroy:
                 if last_param.type == 'XrSession':
@@ -2487,30 +2449,6 @@ class ValidationSourceOutputGenerator(AutomaticSourceOutputGenerator):
                 # Only remove the handle from our map if the runtime returned success
                 next_validate_func += '        if (XR_SUCCEEDED(result)) {\n'
 
-                # If this object contains a state that needs tracking, free it
-                valid_type_list = []
-                for cur_state in self.api_states:
-                    if last_handle_tuple.name == cur_state.type and cur_state.type not in valid_type_list:
-                        valid_type_list.append(cur_state.type)
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += '// Check to see if this object that is about to be destroyed has a\n'
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += '// validation state structure that needs to be cleaned up.\n'
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += '%sValidationStates *%s_valid_state = g_%s_valid_states[%s];\n' % (
-                            cur_state.type, undecorate(cur_state.type), undecorate(cur_state.type), last_handle_name)
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += 'if (nullptr != %s_valid_state) {\n' % cur_state.type[2:].lower(
-                        )
-                        next_validate_func += self.writeIndent(4)
-                        next_validate_func += 'delete %s_valid_state;\n' % cur_state.type[2:].lower(
-                        )
-                        next_validate_func += self.writeIndent(4)
-                        next_validate_func += 'g_%s_valid_states.erase(%s);\n' % (
-                            undecorate(cur_state.type), last_handle_name)
-                        next_validate_func += self.writeIndent(3)
-                        next_validate_func += '}\n'
-
                 next_validate_func += '            %s.erase(%s);\n' % (self.makeInfoName(handle_type=last_handle_tuple), last_handle_name)
                 next_validate_func += '        }\n'
                 if 'xrDestroyInstance' in cur_command.name:
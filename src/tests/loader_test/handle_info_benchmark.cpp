@@ -0,0 +1,159 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Stresses the core validation layer's handle info maps the way a multithreaded application does every frame: many
+// threads looking up the same spaces, as xrLocateSpace validation does, while one thread keeps creating and destroying
+// other spaces.  Reports the lookup rate for each thread count, so that scaling across cores can be compared.
+
+#include "validation_utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+// Normally defined in core_validation.cpp.
+void reportInternalError(std::string const& message) { throw std::runtime_error(message); }
+
+namespace {
+
+const uint64_t kLookedUpSpaceCount = 64;
+const uint64_t kFirstChurnedSpace = 0x10000;
+
+std::unique_ptr<GenValidUsageXrHandleInfo> MakeSpaceInfo(uint64_t session) {
+    std::unique_ptr<GenValidUsageXrHandleInfo> info(new GenValidUsageXrHandleInfo());
+    info->instance_info = nullptr;
+    info->direct_parent_type = XR_OBJECT_TYPE_SESSION;
+    info->direct_parent_handle = session;
+    return info;
+}
+
+// Looks up spaces the same way the generated xrLocateSpace validation does, until told to stop.
+uint64_t LookUpSpaces(HandleInfo<XrSpace>& space_info, const std::atomic<bool>& stop, uint64_t seed, uint64_t& failures) {
+    uint64_t lookups = 0;
+    uint64_t index = seed;
+    while (!stop.load(std::memory_order_relaxed)) {
+        XrSpace space = TreatIntegerAsHandle<XrSpace>(1 + index % kLookedUpSpaceCount);
+        XrSpace base_space = TreatIntegerAsHandle<XrSpace>(1 + (index + 1) % kLookedUpSpaceCount);
+        if (VALIDATE_XR_HANDLE_SUCCESS != space_info.verifyHandle(&space) ||
+            VALIDATE_XR_HANDLE_SUCCESS != space_info.verifyHandle(&base_space) ||
+            space_info.getWithInstanceInfo(space).first->direct_parent_handle != 1) {
+            ++failures;
+        }
+        lookups += 3;
+        index = index * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return lookups;
+}
+
+// Creates and destroys spaces that nothing looks up, so that lookups keep meeting a writer.
+uint64_t ChurnSpaces(HandleInfo<XrSpace>& space_info, const std::atomic<bool>& stop) {
+    uint64_t changes = 0;
+    uint64_t next_space = kFirstChurnedSpace;
+    while (!stop.load(std::memory_order_relaxed)) {
+        XrSpace space = TreatIntegerAsHandle<XrSpace>(next_space++);
+        space_info.insert(space, MakeSpaceInfo(1));
+        space_info.erase(space);
+        changes += 2;
+        std::this_thread::yield();
+    }
+    return changes;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    double seconds_per_run = 1.0;
+    uint32_t max_threads = std::thread::hardware_concurrency();
+    if (argc > 1) {
+        seconds_per_run = std::strtod(argv[1], nullptr);
+    }
+    if (argc > 2) {
+        max_threads = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+    }
+    if (seconds_per_run <= 0.0) {
+        cout << "Usage: " << argv[0] << " [seconds per run] [max lookup threads]" << endl;
+        return -1;
+    }
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+
+    HandleInfo<XrSpace> space_info;
+    for (uint64_t space = 1; space <= kLookedUpSpaceCount; ++space) {
+        space_info.insert(TreatIntegerAsHandle<XrSpace>(space), MakeSpaceInfo(1));
+    }
+
+    cout << "Handle lookups with one thread creating and destroying handles (" << std::thread::hardware_concurrency()
+         << " hardware threads)" << endl;
+    cout << "    " << std::setw(8) << "Threads" << std::setw(16) << "Lookups/s" << std::setw(10) << "Scaling" << std::setw(16)
+         << "Changes/s" << endl;
+
+    double single_thread_rate = 0.0;
+    uint64_t total_failures = 0;
+    for (uint32_t thread_count = 1; thread_count <= max_threads; thread_count *= 2) {
+        std::atomic<bool> stop(false);
+        std::vector<uint64_t> lookups(thread_count, 0);
+        std::vector<uint64_t> failures(thread_count, 0);
+        uint64_t changes = 0;
+
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 0; thread < thread_count; ++thread) {
+            threads.emplace_back([&, thread]() { lookups[thread] = LookUpSpaces(space_info, stop, thread, failures[thread]); });
+        }
+        std::thread writer([&]() { changes = ChurnSpaces(space_info, stop); });
+
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds_per_run));
+        stop = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        writer.join();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t total_lookups = 0;
+        for (uint32_t thread = 0; thread < thread_count; ++thread) {
+            total_lookups += lookups[thread];
+            total_failures += failures[thread];
+        }
+        double rate = static_cast<double>(total_lookups) / elapsed;
+        if (thread_count == 1) {
+            single_thread_rate = rate;
+        }
+        cout << "    " << std::setw(8) << thread_count << std::setw(16) << std::fixed << std::setprecision(0) << rate
+             << std::setw(9) << std::setprecision(2) << rate / single_thread_rate << "x" << std::setw(16) << std::setprecision(0)
+             << static_cast<double>(changes) / elapsed << endl;
+    }
+
+    if (total_failures != 0 || space_info.getWithLock(TreatIntegerAsHandle<XrSpace>(kFirstChurnedSpace)).second != nullptr) {
+        cout << "FAILED: " << total_failures << " lookups did not find the expected handle info" << endl;
+        return 1;
+    }
+    return 0;
+}
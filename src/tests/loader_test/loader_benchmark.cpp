@@ -0,0 +1,137 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Micro-benchmarks for the loader, run against the test runtime.  Must be run from the
+// loader_test build directory so that the test runtime manifest can be found.
+
+#include "filesystem_utils.hpp"
+#include "loader_test_utils.hpp"
+
+#include "xr_dependencies.h"
+#include <openxr/openxr.h>
+#include <openxr/openxr_platform.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using std::cout;
+using std::endl;
+
+namespace {
+
+// Time `iterations` calls of `func` and return the average cost of one call in nanoseconds.
+template <typename Func>
+double MeasureNanosecondsPerCall(uint64_t iterations, Func&& func) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(end - start);
+    return elapsed.count() / static_cast<double>(iterations);
+}
+
+void ReportResult(const std::string& name, double ns_per_call) {
+    cout << "    " << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(2) << std::setw(10)
+         << ns_per_call << " ns/call" << endl;
+}
+
+// Compare calling through the loader's exported trampoline with calling the function pointer
+// returned by xrGetInstanceProcAddr, which bypasses the loader.
+bool BenchmarkTrampolines(uint64_t iterations) {
+    XrInstanceCreateInfo instance_create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+    strcpy(instance_create_info.applicationInfo.applicationName, "Loader Benchmark");
+    instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+    XrInstance instance = XR_NULL_HANDLE;
+    if (XR_FAILED(xrCreateInstance(&instance_create_info, &instance))) {
+        cout << "Failed to create an instance against the test runtime" << endl;
+        return false;
+    }
+
+    XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+    system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+    XrSystemId system_id = XR_NULL_SYSTEM_ID;
+    if (XR_FAILED(xrGetSystem(instance, &system_get_info, &system_id))) {
+        cout << "Failed to get a system from the test runtime" << endl;
+        xrDestroyInstance(instance);
+        return false;
+    }
+
+    PFN_xrGetSystemProperties runtime_get_system_properties = nullptr;
+    xrGetInstanceProcAddr(instance, "xrGetSystemProperties", reinterpret_cast<PFN_xrVoidFunction*>(&runtime_get_system_properties));
+    if (runtime_get_system_properties == nullptr) {
+        cout << "Failed to get xrGetSystemProperties from the test runtime" << endl;
+        xrDestroyInstance(instance);
+        return false;
+    }
+
+    XrSystemProperties system_properties{XR_TYPE_SYSTEM_PROPERTIES};
+    volatile XrResult sink = XR_SUCCESS;
+
+    cout << "Trampolines (" << iterations << " iterations):" << endl;
+    double direct_ns = MeasureNanosecondsPerCall(
+        iterations, [&]() { sink = runtime_get_system_properties(instance, system_id, &system_properties); });
+    ReportResult("xrGetSystemProperties (runtime, direct)", direct_ns);
+    double trampoline_ns =
+        MeasureNanosecondsPerCall(iterations, [&]() { sink = xrGetSystemProperties(instance, system_id, &system_properties); });
+    ReportResult("xrGetSystemProperties (loader trampoline)", trampoline_ns);
+    ReportResult("Trampoline overhead", trampoline_ns - direct_ns);
+
+    PFN_xrVoidFunction function = nullptr;
+    double gipa_ns = MeasureNanosecondsPerCall(
+        iterations, [&]() { sink = xrGetInstanceProcAddr(instance, "xrGetSystemProperties", &function); });
+    ReportResult("xrGetInstanceProcAddr(xrGetSystemProperties)", gipa_ns);
+    (void)sink;
+
+    xrDestroyInstance(instance);
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t iterations = 10000000;
+    if (argc > 1) {
+        iterations = std::strtoull(argv[1], nullptr, 10);
+        if (iterations == 0) {
+            cout << "Usage: " << argv[0] << " [iterations]" << endl;
+            return -1;
+        }
+    }
+
+    std::string current_path;
+    std::string runtime_json;
+    if (!FileSysUtilsGetCurrentPath(current_path) ||
+        !FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json) ||
+        !FileSysUtilsPathExists(runtime_json)) {
+        cout << "Unable to find the test runtime manifest; run from the loader_test build directory" << endl;
+        return -1;
+    }
+    LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+    LoaderTestUnsetEnvironmentVariable("XR_ENABLE_API_LAYERS");
+
+    bool success = BenchmarkTrampolines(iterations);
+
+    LoaderTestUnsetEnvironmentVariable("XR_RUNTIME_JSON");
+    return success ? 0 : -1;
+}
@@ -20,9 +20,14 @@
 // Author: Dave Houlton <daveh@lunarg.com>
 //
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <cstring>
+#include <thread>
 #include <vector>
 
 #include "filesystem_utils.hpp"
@@ -33,12 +38,24 @@
 #include "xr_dependencies.h"
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
+#include "loader_interfaces.h"
+#include "validation_utils.h"
 
 #ifdef XR_USE_GRAPHICS_API_D3D11
 #include "d3d11.h"
 #endif
 
+#if defined(XR_OS_LINUX)
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "api_dump_ring.h"
+#endif  // defined(XR_OS_LINUX)
+
 #include <type_traits>
+
+// Normally defined in core_validation.cpp, for the handle maps tested below.
+void reportInternalError(std::string const& message) { throw std::runtime_error(message); }
 static_assert(sizeof(XrStructureType) == 4, "This should be a 32-bit enum");
 
 // Add some judicious char savers
@@ -738,6 +755,1955 @@ DEFINE_TEST(TestGetSystem) {
     TEST_REPORT(TestGetSystem)
 }
 
+// Test xrGetInstanceProcAddr lookups of loader, core, extension and unknown commands.
+DEFINE_TEST(TestGetInstanceProcAddr) {
+    INIT_TEST(TestGetInstanceProcAddr)
+
+    try {
+        PFN_xrVoidFunction function = nullptr;
+
+        // Only a few commands may be queried without an instance.
+        TEST_EQUAL(xrGetInstanceProcAddr(XR_NULL_HANDLE, "xrCreateInstance", &function), XR_SUCCESS,
+                   "xrGetInstanceProcAddr(XR_NULL_HANDLE, xrCreateInstance)")
+        TEST_NOT_EQUAL(function, nullptr, "xrGetInstanceProcAddr(XR_NULL_HANDLE, xrCreateInstance) function")
+        TEST_EQUAL(xrGetInstanceProcAddr(XR_NULL_HANDLE, "xrEnumerateApiLayerProperties", &function), XR_SUCCESS,
+                   "xrGetInstanceProcAddr(XR_NULL_HANDLE, xrEnumerateApiLayerProperties)")
+        TEST_EQUAL(xrGetInstanceProcAddr(XR_NULL_HANDLE, "xrGetSystem", &function), XR_ERROR_HANDLE_INVALID,
+                   "xrGetInstanceProcAddr(XR_NULL_HANDLE, xrGetSystem)")
+        TEST_EQUAL(xrGetInstanceProcAddr(XR_NULL_HANDLE, "xrNotARealFunction", &function), XR_ERROR_HANDLE_INVALID,
+                   "xrGetInstanceProcAddr(XR_NULL_HANDLE, unknown function)")
+
+        std::string current_path;
+        std::string layer_path;
+        if (!FileSysUtilsGetCurrentPath(current_path) || !FileSysUtilsCombinePaths(current_path, "../../api_layers", layer_path)) {
+            TEST_FAIL("Unable to set API layer path")
+            TEST_REPORT(TestGetInstanceProcAddr)
+            return;
+        }
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+
+        XrInstance instance = XR_NULL_HANDLE;
+        XrInstanceCreateInfo instance_create_info = {};
+        instance_create_info.type = XR_TYPE_INSTANCE_CREATE_INFO;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.applicationVersion = 688;
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+        TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Creating instance")
+
+        function = nullptr;
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrGetSystem", &function), XR_SUCCESS, "xrGetInstanceProcAddr(xrGetSystem)")
+        TEST_NOT_EQUAL(function, nullptr, "xrGetInstanceProcAddr(xrGetSystem) function")
+
+        // Repeated queries must resolve to the same function.
+        PFN_xrVoidFunction repeated_function = nullptr;
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrGetSystem", &repeated_function), XR_SUCCESS,
+                   "Repeated xrGetInstanceProcAddr(xrGetSystem)")
+        TEST_EQUAL(repeated_function, function, "Repeated xrGetInstanceProcAddr(xrGetSystem) function")
+
+        // Extension commands must not resolve unless the extension was enabled.
+        function = nullptr;
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrCreateDebugUtilsMessengerEXT", &function), XR_ERROR_FUNCTION_UNSUPPORTED,
+                   "xrGetInstanceProcAddr(xrCreateDebugUtilsMessengerEXT) without XR_EXT_debug_utils")
+        TEST_EQUAL(function, nullptr, "xrGetInstanceProcAddr(xrCreateDebugUtilsMessengerEXT) function")
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrGetVisibilityMaskKHR", &function), XR_ERROR_FUNCTION_UNSUPPORTED,
+                   "xrGetInstanceProcAddr(xrGetVisibilityMaskKHR) without XR_KHR_visibility_mask")
+
+        // Unknown commands go down to the runtime, which does not know them either.
+        TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrNotARealFunction", &function), XR_ERROR_FUNCTION_UNSUPPORTED,
+                   "xrGetInstanceProcAddr(unknown function)")
+
+        TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestGetInstanceProcAddr)
+}
+
+// Test the lock on core validation's handle maps under contention.  Readers keep looking up handles that stay in the
+// map and handles that a writer keeps adding and removing, and must always find the ones that stay, with the info they
+// were added with.  The writer must be able to finish its changes while the readers keep going.
+DEFINE_TEST(TestHandleInfoLock) {
+    INIT_TEST(TestHandleInfoLock)
+
+    try {
+        const uint64_t stable_count = 64;
+        const uint64_t first_churned = 0x10000;
+        const uint64_t churned_count = 2000;
+        const uint32_t reader_count = 4;
+        // Each handle's parent is the handle's own value, so a lookup can tell whether it got the right info.
+        auto make_info = [](uint64_t handle) {
+            std::unique_ptr<GenValidUsageXrHandleInfo> info(new GenValidUsageXrHandleInfo());
+            info->instance_info = nullptr;
+            info->direct_parent_type = XR_OBJECT_TYPE_SESSION;
+            info->direct_parent_handle = handle;
+            return info;
+        };
+        HandleInfo<XrSpace> space_info;
+        for (uint64_t space = 1; space <= stable_count; ++space) {
+            space_info.insert(TreatIntegerAsHandle<XrSpace>(space), make_info(space));
+        }
+
+        std::atomic<bool> writer_done(false);
+        std::vector<uint64_t> lookups(reader_count, 0);
+        std::vector<uint64_t> failures(reader_count, 0);
+        std::vector<std::thread> readers;
+        for (uint32_t reader = 0; reader < reader_count; ++reader) {
+            readers.emplace_back([&, reader]() {
+                uint64_t index = reader;
+                while (!writer_done.load(std::memory_order_acquire)) {
+                    for (uint32_t lookup = 0; lookup < 64; ++lookup) {
+                        index = index * 6364136223846793005ULL + 1442695040888963407ULL;
+                        uint64_t stable = 1 + (index >> 32) % stable_count;
+                        XrSpace space = TreatIntegerAsHandle<XrSpace>(stable);
+                        XrSpace churned = TreatIntegerAsHandle<XrSpace>(first_churned + (index >> 40) % churned_count);
+                        ValidateXrHandleResult churned_result = space_info.verifyHandle(&churned);
+                        if (VALIDATE_XR_HANDLE_SUCCESS != space_info.verifyHandle(&space) ||
+                            space_info.get(space)->direct_parent_handle != stable ||
+                            (VALIDATE_XR_HANDLE_SUCCESS != churned_result && VALIDATE_XR_HANDLE_INVALID != churned_result)) {
+                            ++failures[reader];
+                        }
+                        ++lookups[reader];
+                    }
+                    std::this_thread::yield();
+                }
+            });
+        }
+        // Adds each churned handle and removes the one before it, so one is in the map most of the time.
+        std::thread writer([&]() {
+            for (uint64_t churned = first_churned; churned < first_churned + churned_count; ++churned) {
+                space_info.insert(TreatIntegerAsHandle<XrSpace>(churned), make_info(churned));
+                if (churned != first_churned) {
+                    space_info.erase(TreatIntegerAsHandle<XrSpace>(churned - 1));
+                }
+            }
+            writer_done.store(true, std::memory_order_release);
+        });
+        writer.join();
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+
+        uint64_t total_failures = 0;
+        bool every_reader_looked_up = true;
+        for (uint32_t reader = 0; reader < reader_count; ++reader) {
+            total_failures += failures[reader];
+            every_reader_looked_up = every_reader_looked_up && lookups[reader] > 0;
+        }
+        TEST_EQUAL(total_failures, 0, "Lookups find the right info")
+        TEST_EQUAL(every_reader_looked_up, true, "Every reader made lookups")
+        XrSpace last_churned = TreatIntegerAsHandle<XrSpace>(first_churned + churned_count - 1);
+        XrSpace first_removed = TreatIntegerAsHandle<XrSpace>(first_churned);
+        TEST_EQUAL(space_info.verifyHandle(&last_churned), VALIDATE_XR_HANDLE_SUCCESS, "Last handle added is kept")
+        TEST_EQUAL(space_info.verifyHandle(&first_removed), VALIDATE_XR_HANDLE_INVALID, "Removed handles are gone")
+        TEST_EQUAL(space_info.lockMapConst().second.size(), stable_count + 1, "Every change made")
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Output results for this test
+    TEST_REPORT(TestHandleInfoLock)
+}
+
+#if defined(XR_OS_LINUX)
+// Return the names of the API layers currently reported by the loader.
+static std::vector<std::string> GetApiLayerNames() {
+    std::vector<std::string> names;
+    uint32_t count = 0;
+    if (XR_FAILED(xrEnumerateApiLayerProperties(0, &count, nullptr))) {
+        return names;
+    }
+    std::vector<XrApiLayerProperties> layer_props(count, {XR_TYPE_API_LAYER_PROPERTIES, nullptr, {0}, 0, 0, {0}});
+    if (XR_FAILED(xrEnumerateApiLayerProperties(count, &count, layer_props.data()))) {
+        return names;
+    }
+    for (uint32_t layer = 0; layer < count; ++layer) {
+        names.emplace_back(layer_props[layer].layerName);
+    }
+    return names;
+}
+
+// Write contents to filename, replacing any existing file.
+static bool WriteTestFile(const std::string& filename, const std::string& contents) {
+    std::ofstream out_stream(filename, std::ofstream::out | std::ofstream::trunc);
+    out_stream << contents;
+    return out_stream.good();
+}
+
+// Test that the opt-in manifest cache returns the same layers as a normal search and notices changed
+// directories and files.
+DEFINE_TEST(TestManifestCache) {
+    INIT_TEST(TestManifestCache)
+
+    try {
+        std::string current_path;
+        std::string cache_home;
+        std::string layer_dir;
+        std::string source_manifest;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "manifest_cache_test", cache_home) ||
+            !FileSysUtilsCombinePaths(current_path, "manifest_cache_test_layers", layer_dir) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/layers/XrApiLayer_test.json", source_manifest)) {
+            TEST_FAIL("Unable to set up manifest cache paths")
+            TEST_REPORT(TestManifestCache)
+            return;
+        }
+        const std::string cache_file = cache_home + "/openxr/1/manifest_cache.json";
+        const std::string first_manifest = layer_dir + "/first.json";
+        const std::string second_manifest = layer_dir + "/second.json";
+        remove(cache_file.c_str());
+        remove(first_manifest.c_str());
+        remove(second_manifest.c_str());
+        mkdir(layer_dir.c_str(), 0755);
+
+        std::ifstream source_stream(source_manifest);
+        std::stringstream source_contents;
+        source_contents << source_stream.rdbuf();
+        std::string manifest_contents = source_contents.str();
+        std::string renamed_contents = manifest_contents;
+        const std::string layer_name = "XR_APILAYER_test";
+        renamed_contents.replace(renamed_contents.find(layer_name), layer_name.size(), "XR_APILAYER_test_cache_copy");
+        TEST_EQUAL(WriteTestFile(first_manifest, manifest_contents), true, "Writing first layer manifest")
+
+        LoaderTestSetEnvironmentVariable("XR_LOADER_MANIFEST_CACHE", "1");
+        LoaderTestSetEnvironmentVariable("XDG_CACHE_HOME", cache_home);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_dir);
+
+        std::vector<std::string> uncached_names = GetApiLayerNames();
+        TEST_EQUAL(uncached_names.size(), 1, "Layer count with an empty cache")
+        TEST_EQUAL(FileSysUtilsPathExists(cache_file), true, "Cache file written")
+        TEST_EQUAL(GetApiLayerNames() == uncached_names, true, "Layers reported from the cache")
+
+        // A new file changes the directory, which must be listed again.
+        TEST_EQUAL(WriteTestFile(second_manifest, renamed_contents), true, "Writing second layer manifest")
+        TEST_EQUAL(GetApiLayerNames().size(), 2, "Layer count after adding a manifest")
+
+        // Changed contents must be re-read rather than served from the cache.
+        TEST_EQUAL(WriteTestFile(first_manifest, renamed_contents), true, "Rewriting first layer manifest")
+        std::vector<std::string> rewritten_names = GetApiLayerNames();
+        TEST_EQUAL(rewritten_names.size(), 2, "Layer count after rewriting a manifest")
+        TEST_EQUAL(std::count(rewritten_names.begin(), rewritten_names.end(), layer_name), 0,
+                   "Rewritten manifest not served from the cache")
+
+        remove(first_manifest.c_str());
+        remove(second_manifest.c_str());
+        rmdir(layer_dir.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_MANIFEST_CACHE");
+    LoaderTestUnsetEnvironmentVariable("XDG_CACHE_HOME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestManifestCache)
+}
+
+// Test that parallel manifest discovery reports the same API layers, in the same order, as a serial search.
+DEFINE_TEST(TestParallelManifestDiscovery) {
+    INIT_TEST(TestParallelManifestDiscovery)
+
+    try {
+        std::string current_path;
+        std::string source_manifest;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/layers/XrApiLayer_test.json", source_manifest)) {
+            TEST_FAIL("Unable to set up parallel discovery paths")
+            TEST_REPORT(TestParallelManifestDiscovery)
+            return;
+        }
+        std::ifstream source_stream(source_manifest);
+        std::stringstream source_contents;
+        source_contents << source_stream.rdbuf();
+        const std::string manifest_contents = source_contents.str();
+        const std::string layer_name = "XR_APILAYER_test";
+
+        // Spread a number of layers over several directories, so that both the directory listings and the
+        // manifest parsing are split between threads.
+        const char* const layer_dir_names[] = {"parallel_discovery_test_a", "parallel_discovery_test_b",
+                                               "parallel_discovery_test_c"};
+        const size_t layers_per_dir = 4;
+        std::vector<std::string> layer_dirs;
+        std::vector<std::string> manifests;
+        std::string layer_path;
+        bool all_written = true;
+        for (const char* layer_dir_name : layer_dir_names) {
+            std::string layer_dir;
+            FileSysUtilsCombinePaths(current_path, layer_dir_name, layer_dir);
+            mkdir(layer_dir.c_str(), 0755);
+            layer_dirs.push_back(layer_dir);
+            if (!layer_path.empty()) {
+                layer_path += TEST_PATH_SEPARATOR;
+            }
+            layer_path += layer_dir;
+            for (size_t layer = 0; layer < layers_per_dir; ++layer) {
+                std::string manifest = layer_dir + "/layer_" + std::to_string(layer) + ".json";
+                std::string contents = manifest_contents;
+                contents.replace(contents.find(layer_name), layer_name.size(),
+                                 layer_name + "_" + layer_dir_name + "_" + std::to_string(layer));
+                all_written = WriteTestFile(manifest, contents) && all_written;
+                // Back-date the file so that the loader trusts its timestamp and parses it on a worker thread.
+                struct timeval times[2] = {};
+                times[0].tv_sec = times[1].tv_sec = time(nullptr) - 60;
+                utimes(manifest.c_str(), times);
+                manifests.push_back(manifest);
+            }
+        }
+        TEST_EQUAL(all_written, true, "Writing layer manifests")
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_path);
+
+        LoaderTestSetEnvironmentVariable("XR_LOADER_PARALLEL_DISCOVERY", "4");
+        std::vector<std::string> parallel_names = GetApiLayerNames();
+        LoaderTestUnsetEnvironmentVariable("XR_LOADER_PARALLEL_DISCOVERY");
+        std::vector<std::string> serial_names = GetApiLayerNames();
+
+        TEST_EQUAL(parallel_names.size(), manifests.size(), "Layer count with parallel discovery")
+        TEST_EQUAL(parallel_names == serial_names, true, "Layer order with parallel discovery")
+
+        for (const auto& manifest : manifests) {
+            remove(manifest.c_str());
+        }
+        for (const auto& layer_dir : layer_dirs) {
+            rmdir(layer_dir.c_str());
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_PARALLEL_DISCOVERY");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestParallelManifestDiscovery)
+}
+
+// Count the loader's reports of manifest files being read and parsed.
+static XrBool32 XRAPI_PTR ManifestParseCallback(XrDebugUtilsMessageSeverityFlagsEXT /*messageSeverity*/,
+                                                XrDebugUtilsMessageTypeFlagsEXT /*messageType*/,
+                                                const XrDebugUtilsMessengerCallbackDataEXT* callbackData, void* userData) {
+    if (strcmp(callbackData->messageId, "OpenXR-Loader-ManifestParse") == 0) {
+        ++*reinterpret_cast<uint32_t*>(userData);
+    }
+    return XR_FALSE;
+}
+
+// Test that the loader answers repeated xrGetInstanceProcAddr queries for a command provided down the chain without
+// asking the API layers again, and that it asks again for an instance created after the last one was destroyed.
+DEFINE_TEST(TestGetInstanceProcAddrCache) {
+    INIT_TEST(TestGetInstanceProcAddrCache)
+
+    // Loading the test layer here keeps it, and the number of lookups it has seen, for the whole test.
+    void* layer_library = dlopen("test_layers/libXrApiLayer_test.so", RTLD_NOW | RTLD_LOCAL);
+    typedef uint32_t (*PFN_TestLayerGetInstanceProcAddrCallCount)();
+    auto call_count = nullptr == layer_library ? nullptr
+                                               : reinterpret_cast<PFN_TestLayerGetInstanceProcAddrCallCount>(
+                                                     dlsym(layer_library, "TestLayerGetInstanceProcAddrCallCount"));
+    TEST_NOT_EQUAL(call_count, nullptr, "Finding the test layer's lookup count")
+    try {
+        if (nullptr != call_count) {
+            LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", "resources/layers");
+            const char* layers[] = {"XR_APILAYER_test"};
+            XrInstanceCreateInfo instance_create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+            strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+            instance_create_info.applicationInfo.applicationVersion = 688;
+            instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+            instance_create_info.enabledApiLayerCount = 1;
+            instance_create_info.enabledApiLayerNames = layers;
+
+            for (uint32_t pass = 0; pass < 2; ++pass) {
+                std::string message = pass == 0 ? "First instance" : "Instance created after destroying the first";
+                XrInstance instance = XR_NULL_HANDLE;
+                TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, message + " - xrCreateInstance")
+                if (XR_NULL_HANDLE == instance) {
+                    continue;
+                }
+
+                // The first lookup goes down the chain, through the layer.
+                uint32_t calls_before = call_count();
+                PFN_xrVoidFunction function = nullptr;
+                TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrGetSystem", &function), XR_SUCCESS,
+                           message + " - xrGetInstanceProcAddr(xrGetSystem)")
+                TEST_NOT_EQUAL(function, nullptr, message + " - xrGetSystem function")
+                TEST_EQUAL(call_count(), calls_before + 1, message + " - first lookup reaches the layer")
+
+                // Later lookups are answered by the loader.
+                PFN_xrVoidFunction repeated_function = nullptr;
+                TEST_EQUAL(xrGetInstanceProcAddr(instance, "xrGetSystem", &repeated_function), XR_SUCCESS,
+                           message + " - repeated xrGetInstanceProcAddr(xrGetSystem)")
+                TEST_EQUAL(repeated_function, function, message + " - repeated lookup returns the same function")
+                TEST_EQUAL(call_count(), calls_before + 1, message + " - repeated lookup does not reach the layer")
+
+                // And the function found works for this instance.
+                if (nullptr != function) {
+                    XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+                    system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+                    XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                    TEST_EQUAL(reinterpret_cast<PFN_xrGetSystem>(function)(instance, &system_get_info, &system_id), XR_SUCCESS,
+                               message + " - calling xrGetSystem")
+                }
+
+                TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, message + " - xrDestroyInstance")
+            }
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestGetInstanceProcAddrCache)
+}
+
+// Test that the loader parses each manifest file only once per instance lifetime, no matter how many
+// enumerate calls need it, and still picks up manifests added later.
+DEFINE_TEST(TestManifestRegistry) {
+    INIT_TEST(TestManifestRegistry)
+
+    try {
+        std::string current_path;
+        std::string layer_dir;
+        std::string source_manifest;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "manifest_registry_test_layers", layer_dir) ||
+            !FileSysUtilsCombinePaths(current_path, "resources/layers/XrApiLayer_test.json", source_manifest)) {
+            TEST_FAIL("Unable to set up manifest registry paths")
+            TEST_REPORT(TestManifestRegistry)
+            return;
+        }
+        const std::string new_manifest = layer_dir + "/new_layer.json";
+        remove(new_manifest.c_str());
+        mkdir(layer_dir.c_str(), 0755);
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", std::string("resources/layers") + TEST_PATH_SEPARATOR + layer_dir);
+
+        uint32_t parse_count = 0;
+        XrDebugUtilsMessengerCreateInfoEXT dbg_msg_ci{XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT};
+        dbg_msg_ci.messageSeverities =
+            XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+            XR_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | XR_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+        dbg_msg_ci.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        dbg_msg_ci.userCallback = ManifestParseCallback;
+        dbg_msg_ci.userData = &parse_count;
+
+        const char* extensions[] = {XR_EXT_DEBUG_UTILS_EXTENSION_NAME};
+        XrInstanceCreateInfo instance_create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+        instance_create_info.next = &dbg_msg_ci;
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.applicationVersion = 688;
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        instance_create_info.enabledExtensionCount = 1;
+        instance_create_info.enabledExtensionNames = extensions;
+
+        XrInstance instance = XR_NULL_HANDLE;
+        TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Creating instance with a messenger")
+        if (instance != XR_NULL_HANDLE) {
+            // Instance creation already parsed every manifest, so enumerating must not parse any again.
+            parse_count = 0;
+            size_t layer_count = GetApiLayerNames().size();
+            uint32_t extension_count = 0;
+            xrEnumerateInstanceExtensionProperties("XR_APILAYER_test", 0, &extension_count, nullptr);
+            TEST_NOT_EQUAL(layer_count, 0, "Layers found")
+            TEST_EQUAL(parse_count, 0, "Manifest parses while enumerating")
+
+            // A manifest added later is still found, and is the only file parsed.
+            std::ifstream source_stream(source_manifest);
+            std::stringstream source_contents;
+            source_contents << source_stream.rdbuf();
+            std::string manifest_contents = source_contents.str();
+            const std::string layer_name = "XR_APILAYER_test";
+            manifest_contents.replace(manifest_contents.find(layer_name), layer_name.size(), "XR_APILAYER_test_registry_copy");
+            TEST_EQUAL(WriteTestFile(new_manifest, manifest_contents), true, "Writing new layer manifest")
+            // Back-date the new file so that the loader trusts its timestamp straight away.
+            struct timeval times[2] = {};
+            times[0].tv_sec = times[1].tv_sec = time(nullptr) - 60;
+            utimes(new_manifest.c_str(), times);
+
+            parse_count = 0;
+            TEST_EQUAL(GetApiLayerNames().size(), layer_count + 1, "Layer count after adding a manifest")
+            TEST_EQUAL(parse_count, 1, "Manifest parses after adding a manifest")
+            parse_count = 0;
+            TEST_EQUAL(GetApiLayerNames().size(), layer_count + 1, "Layer count when enumerating again")
+            TEST_EQUAL(parse_count, 0, "Manifest parses when enumerating again")
+
+            TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance")
+        }
+
+        remove(new_manifest.c_str());
+        rmdir(layer_dir.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestManifestRegistry)
+}
+
+// Test that XR_LOADER_LAZY_API_LAYERS skips loading an explicit layer it names whose instance extensions are not
+// enabled.  The layer's "library" is not a loadable library, so every attempt to load it fails instance creation.
+DEFINE_TEST(TestLazyApiLayers) {
+    INIT_TEST(TestLazyApiLayers)
+
+    try {
+        std::string current_path;
+        std::string layer_dir;
+        if (!FileSysUtilsGetCurrentPath(current_path) ||
+            !FileSysUtilsCombinePaths(current_path, "lazy_api_layer_test_layers", layer_dir)) {
+            TEST_FAIL("Unable to set up lazy API layer paths")
+            TEST_REPORT(TestLazyApiLayers)
+            return;
+        }
+        const std::string manifest = layer_dir + "/lazy_layer.json";
+        mkdir(layer_dir.c_str(), 0755);
+        TEST_EQUAL(WriteTestFile(manifest,
+                                 "{\n"
+                                 "    \"file_format_version\": \"1.0.0\",\n"
+                                 "    \"api_layer\": {\n"
+                                 "        \"name\": \"XR_APILAYER_test_lazy\",\n"
+                                 "        \"library_path\": \"./lazy_layer.json\",\n"
+                                 "        \"api_version\": \"1.0\",\n"
+                                 "        \"implementation_version\": \"1\",\n"
+                                 "        \"description\": \"Layer that can never be loaded\",\n"
+                                 "        \"instance_extensions\": [\n"
+                                 "            {\"name\": \"XR_KHR_fake_lazy_ext\", \"extension_version\": \"1\"}\n"
+                                 "        ]\n"
+                                 "    }\n"
+                                 "}\n"),
+                   true, "Writing lazy layer manifest")
+        LoaderTestSetEnvironmentVariable("XR_API_LAYER_PATH", layer_dir);
+
+        const char* layers[] = {"XR_APILAYER_test_lazy"};
+        const char* extensions[] = {"XR_KHR_fake_lazy_ext"};
+        XrInstanceCreateInfo instance_create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+        strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+        instance_create_info.applicationInfo.applicationVersion = 688;
+        instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+        instance_create_info.enabledApiLayerCount = 1;
+        instance_create_info.enabledApiLayerNames = layers;
+
+        XrInstance instance = XR_NULL_HANDLE;
+        TEST_NOT_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Layer loaded without lazy loading")
+        if (instance != XR_NULL_HANDLE) {
+            xrDestroyInstance(instance);
+            instance = XR_NULL_HANDLE;
+        }
+
+        // Layers that are not named are loaded as usual.
+        LoaderTestSetEnvironmentVariable("XR_LOADER_LAZY_API_LAYERS", std::string("1") + TEST_PATH_SEPARATOR + "XR_APILAYER_test");
+        TEST_NOT_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Layer loaded when not listed as lazy")
+        if (instance != XR_NULL_HANDLE) {
+            xrDestroyInstance(instance);
+            instance = XR_NULL_HANDLE;
+        }
+
+        LoaderTestSetEnvironmentVariable("XR_LOADER_LAZY_API_LAYERS",
+                                         std::string("XR_APILAYER_test") + TEST_PATH_SEPARATOR + "XR_APILAYER_test_lazy");
+        TEST_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Layer skipped with its extension disabled")
+        if (instance != XR_NULL_HANDLE) {
+            TEST_EQUAL(xrDestroyInstance(instance), XR_SUCCESS, "Destroying instance")
+            instance = XR_NULL_HANDLE;
+        }
+
+        instance_create_info.enabledExtensionCount = 1;
+        instance_create_info.enabledExtensionNames = extensions;
+        TEST_NOT_EQUAL(xrCreateInstance(&instance_create_info, &instance), XR_SUCCESS, "Layer loaded with its extension enabled")
+        if (instance != XR_NULL_HANDLE) {
+            xrDestroyInstance(instance);
+        }
+
+        remove(manifest.c_str());
+        rmdir(layer_dir.c_str());
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_LOADER_LAZY_API_LAYERS");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestLazyApiLayers)
+}
+
+// Stand-in for everything below the api_dump layer, handing out a new handle for every instance and remembering
+// which instance the layer asked to name a structure type for.
+static uint64_t g_fake_next_instance_count = 0;
+static XrInstance g_fake_next_string_instance = XR_NULL_HANDLE;
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextCreateApiLayerInstance(const XrInstanceCreateInfo* /* info */,
+                                                                     const XrApiLayerCreateInfo* /* apiLayerInfo */,
+                                                                     XrInstance* instance) {
+    *instance = reinterpret_cast<XrInstance>(static_cast<uintptr_t>(0x1000 + ++g_fake_next_instance_count));
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextDestroyInstance(XrInstance /* instance */) { return XR_SUCCESS; }
+
+// Each instance gets its own system, so a capture shows which instance a system id came from.
+static XrSystemId FakeNextSystemId(XrInstance instance) { return 0x5000 + reinterpret_cast<uintptr_t>(instance); }
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextGetSystem(XrInstance instance, const XrSystemGetInfo* /* getInfo */,
+                                                        XrSystemId* systemId) {
+    *systemId = FakeNextSystemId(instance);
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextGetSystemProperties(XrInstance instance, XrSystemId systemId,
+                                                                  XrSystemProperties* properties) {
+    if (systemId != FakeNextSystemId(instance)) {
+        return XR_ERROR_SYSTEM_INVALID;
+    }
+    properties->systemId = systemId;
+    strcpy(properties->systemName, "Fake system");
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextCreateSession(XrInstance /* instance */, const XrSessionCreateInfo* /* createInfo */,
+                                                            XrSession* session) {
+    *session = reinterpret_cast<XrSession>(static_cast<uintptr_t>(0x2000 + g_fake_next_instance_count));
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextDestroySession(XrSession /* session */) { return XR_SUCCESS; }
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextBeginSession(XrSession /* session */, const XrSessionBeginInfo* /* beginInfo */) {
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextEndSession(XrSession /* session */) { return XR_SUCCESS; }
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextWaitFrame(XrSession /* session */, const XrFrameWaitInfo* /* frameWaitInfo */,
+                                                        XrFrameState* /* frameState */) {
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextBeginFrame(XrSession /* session */, const XrFrameBeginInfo* /* frameBeginInfo */) {
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextEndFrame(XrSession /* session */, const XrFrameEndInfo* /* frameEndInfo */) {
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextCreateDebugUtilsMessengerEXT(XrInstance /* instance */,
+                                                                           const XrDebugUtilsMessengerCreateInfoEXT* /* createInfo */,
+                                                                           XrDebugUtilsMessengerEXT* messenger) {
+    static uint64_t messenger_count = 0;
+    *messenger = reinterpret_cast<XrDebugUtilsMessengerEXT>(static_cast<uintptr_t>(0x3000 + ++messenger_count));
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextDestroyDebugUtilsMessengerEXT(XrDebugUtilsMessengerEXT /* messenger */) {
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextSetDebugUtilsObjectNameEXT(XrInstance /* instance */,
+                                                                         const XrDebugUtilsObjectNameInfoEXT* /* nameInfo */) {
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextStructureTypeToString(XrInstance instance, XrStructureType /* value */,
+                                                                    char buffer[XR_MAX_STRUCTURE_NAME_SIZE]) {
+    g_fake_next_string_instance = instance;
+    strcpy(buffer, "XR_TYPE_SYSTEM_GET_INFO");
+    return XR_SUCCESS;
+}
+
+static XRAPI_ATTR XrResult XRAPI_CALL FakeNextGetInstanceProcAddr(XrInstance /* instance */, const char* name,
+                                                                  PFN_xrVoidFunction* function) {
+    if (0 == strcmp(name, "xrDestroyInstance")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextDestroyInstance);
+    } else if (0 == strcmp(name, "xrGetSystem")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextGetSystem);
+    } else if (0 == strcmp(name, "xrGetSystemProperties")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextGetSystemProperties);
+    } else if (0 == strcmp(name, "xrCreateSession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextCreateSession);
+    } else if (0 == strcmp(name, "xrDestroySession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextDestroySession);
+    } else if (0 == strcmp(name, "xrBeginSession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextBeginSession);
+    } else if (0 == strcmp(name, "xrEndSession")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextEndSession);
+    } else if (0 == strcmp(name, "xrWaitFrame")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextWaitFrame);
+    } else if (0 == strcmp(name, "xrBeginFrame")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextBeginFrame);
+    } else if (0 == strcmp(name, "xrEndFrame")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextEndFrame);
+    } else if (0 == strcmp(name, "xrCreateDebugUtilsMessengerEXT")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextCreateDebugUtilsMessengerEXT);
+    } else if (0 == strcmp(name, "xrDestroyDebugUtilsMessengerEXT")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextDestroyDebugUtilsMessengerEXT);
+    } else if (0 == strcmp(name, "xrSetDebugUtilsObjectNameEXT")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextSetDebugUtilsObjectNameEXT);
+    } else if (0 == strcmp(name, "xrStructureTypeToString")) {
+        *function = reinterpret_cast<PFN_xrVoidFunction>(FakeNextStructureTypeToString);
+    } else {
+        *function = nullptr;
+    }
+    return *function ? XR_SUCCESS : XR_ERROR_FUNCTION_UNSUPPORTED;
+}
+
+// Load one of the API layer libraries built in this tree and negotiate with it, so that a test can drive the layer
+// directly.  Returns the library, or nullptr if it could not be loaded or negotiation failed.
+static void* LoadBuiltApiLayer(const char* library_name, const char* layer_name, XrNegotiateApiLayerRequest& layer_request) {
+    std::string current_path;
+    std::string layer_library_path;
+    if (!FileSysUtilsGetCurrentPath(current_path) ||
+        !FileSysUtilsCombinePaths(current_path, std::string("../../api_layers/") + library_name, layer_library_path)) {
+        return nullptr;
+    }
+    void* layer_library = dlopen(layer_library_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (nullptr == layer_library) {
+        return nullptr;
+    }
+    auto negotiate =
+        reinterpret_cast<PFN_xrNegotiateLoaderApiLayerInterface>(dlsym(layer_library, "xrNegotiateLoaderApiLayerInterface"));
+
+    XrNegotiateLoaderInfo loader_info = {};
+    loader_info.structType = XR_LOADER_INTERFACE_STRUCT_LOADER_INFO;
+    loader_info.structVersion = XR_LOADER_INFO_STRUCT_VERSION;
+    loader_info.structSize = sizeof(XrNegotiateLoaderInfo);
+    loader_info.minInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    loader_info.maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+    loader_info.minApiVersion = XR_CURRENT_API_VERSION;
+    loader_info.maxApiVersion = XR_CURRENT_API_VERSION;
+    layer_request = {};
+    layer_request.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST;
+    layer_request.structVersion = XR_API_LAYER_INFO_STRUCT_VERSION;
+    layer_request.structSize = sizeof(XrNegotiateApiLayerRequest);
+    if (nullptr == negotiate || XR_SUCCESS != negotiate(&loader_info, layer_name, &layer_request) ||
+        nullptr == layer_request.getInstanceProcAddr || nullptr == layer_request.createApiLayerInstance) {
+        dlclose(layer_library);
+        return nullptr;
+    }
+    return layer_library;
+}
+
+static void* LoadApiDumpLayer(XrNegotiateApiLayerRequest& layer_request) {
+    return LoadBuiltApiLayer("libXrApiLayer_api_dump.so", "XR_APILAYER_LUNARG_api_dump", layer_request);
+}
+
+static void* LoadCoreValidationLayer(XrNegotiateApiLayerRequest& layer_request) {
+    return LoadBuiltApiLayer("libXrApiLayer_core_validation.so", "XR_APILAYER_LUNARG_core_validation", layer_request);
+}
+
+// Create an instance through a layer loaded above, with the fake functions above standing in for everything below
+// it.  next and the extensions are passed on in the XrInstanceCreateInfo.
+static XrResult CreateBuiltApiLayerInstance(const XrNegotiateApiLayerRequest& layer_request, const char* layer_name,
+                                            const void* next, XrInstance* instance, uint32_t extension_count = 0,
+                                            const char* const* extension_names = nullptr) {
+    XrApiLayerNextInfo next_info = {};
+    next_info.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO;
+    next_info.structVersion = XR_API_LAYER_NEXT_INFO_STRUCT_VERSION;
+    next_info.structSize = sizeof(XrApiLayerNextInfo);
+    strcpy(next_info.layerName, layer_name);
+    next_info.nextGetInstanceProcAddr = FakeNextGetInstanceProcAddr;
+    next_info.nextCreateApiLayerInstance = FakeNextCreateApiLayerInstance;
+    XrApiLayerCreateInfo layer_create_info = {};
+    layer_create_info.structType = XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO;
+    layer_create_info.structVersion = XR_API_LAYER_CREATE_INFO_STRUCT_VERSION;
+    layer_create_info.structSize = sizeof(XrApiLayerCreateInfo);
+    layer_create_info.nextInfo = &next_info;
+    XrInstanceCreateInfo instance_create_info{XR_TYPE_INSTANCE_CREATE_INFO};
+    instance_create_info.next = next;
+    instance_create_info.enabledExtensionCount = extension_count;
+    instance_create_info.enabledExtensionNames = extension_names;
+    strcpy(instance_create_info.applicationInfo.applicationName, "Loader Test");
+    instance_create_info.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+    return layer_request.createApiLayerInstance(&instance_create_info, &layer_create_info, instance);
+}
+
+static XrResult CreateApiDumpLayerInstance(const XrNegotiateApiLayerRequest& layer_request, XrInstance* instance) {
+    return CreateBuiltApiLayerInstance(layer_request, "XR_APILAYER_LUNARG_api_dump", nullptr, instance);
+}
+
+// Core validation instances are headless, so that sessions can be created without a graphics binding.
+static XrResult CreateCoreValidationLayerInstance(const XrNegotiateApiLayerRequest& layer_request, const void* next,
+                                                  XrInstance* instance) {
+    const char* const extension_names[] = {XR_MND_HEADLESS_EXTENSION_NAME};
+    return CreateBuiltApiLayerInstance(layer_request, "XR_APILAYER_LUNARG_core_validation", next, instance, 1, extension_names);
+}
+
+// Test the api_dump layer with several of its own instances alive at once.  The loader only allows one instance, so
+// this drives the layer directly.
+DEFINE_TEST(TestApiDumpMultipleInstances) {
+    INIT_TEST(TestApiDumpMultipleInstances)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadApiDumpLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the api_dump layer")
+    try {
+        PFN_xrGetSystem get_system = nullptr;
+        PFN_xrDestroyInstance destroy_instance = nullptr;
+        if (nullptr != layer_library) {
+            // Keep the dump out of the test output
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "text");
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", "api_dump_multiple_instances.txt");
+
+            const uint32_t instance_count = 4;
+            XrInstance instances[instance_count] = {};
+            for (uint32_t index = 0; index < instance_count; ++index) {
+                TEST_EQUAL(CreateApiDumpLayerInstance(layer_request, &instances[index]), XR_SUCCESS,
+                           "Creating instance " + std::to_string(index))
+            }
+            PFN_xrVoidFunction function = nullptr;
+            layer_request.getInstanceProcAddr(instances[0], "xrGetSystem", &function);
+            get_system = reinterpret_cast<PFN_xrGetSystem>(function);
+            layer_request.getInstanceProcAddr(instances[0], "xrDestroyInstance", &function);
+            destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+            TEST_NOT_EQUAL(get_system, nullptr, "Finding the layer's xrGetSystem")
+            TEST_NOT_EQUAL(destroy_instance, nullptr, "Finding the layer's xrDestroyInstance")
+
+            if (nullptr != get_system && nullptr != destroy_instance) {
+                // Dumping the structure type of the get info makes the layer look up the instance from its dispatch
+                // table, so every live instance must get back its own handle, including once others are destroyed.
+                XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+                system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+                const uint32_t destroy_order[instance_count] = {1, 3, 0, 2};
+                for (uint32_t destroyed = 0; destroyed < instance_count; ++destroyed) {
+                    for (uint32_t remaining = destroyed; remaining < instance_count; ++remaining) {
+                        XrInstance instance = instances[destroy_order[remaining]];
+                        std::string message = "Instance " + std::to_string(destroy_order[remaining]) + " with " +
+                                              std::to_string(destroyed) + " destroyed";
+                        XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                        g_fake_next_string_instance = XR_NULL_HANDLE;
+                        TEST_EQUAL(get_system(instance, &system_get_info, &system_id), XR_SUCCESS, message + " - xrGetSystem")
+                        TEST_EQUAL(g_fake_next_string_instance, instance, message + " - instance from dispatch table")
+                    }
+                    TEST_EQUAL(destroy_instance(instances[destroy_order[destroyed]]), XR_SUCCESS,
+                               "Destroying instance " + std::to_string(destroy_order[destroyed]))
+                }
+                TEST_EQUAL(destroy_instance(instances[0]), XR_ERROR_HANDLE_INVALID, "Destroying an instance twice")
+            }
+            remove("api_dump_multiple_instances.txt");
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpMultipleInstances)
+}
+
+static size_t CountOccurrences(const std::string& text, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t offset = text.find(pattern); offset != std::string::npos; offset = text.find(pattern, offset + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+// Test that an application creating a new instance after destroying its last one keeps getting the output it asked
+// for in the same file, rather than a text dump appended to it.
+DEFINE_TEST(TestApiDumpRecreatedInstance) {
+    INIT_TEST(TestApiDumpRecreatedInstance)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadApiDumpLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the api_dump layer")
+    try {
+        if (nullptr != layer_library) {
+            // Create and destroy an instance twice, returning what was written.
+            auto record_two_instances = [&](const char* export_type, const char* file_name) {
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", export_type);
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", file_name);
+                remove(file_name);
+                for (uint32_t index = 0; index < 2; ++index) {
+                    std::string message = std::string(export_type) + " instance " + std::to_string(index);
+                    XrInstance instance = XR_NULL_HANDLE;
+                    TEST_EQUAL(CreateApiDumpLayerInstance(layer_request, &instance), XR_SUCCESS, message + " - create")
+                    PFN_xrVoidFunction function = nullptr;
+                    layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+                    auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+                    TEST_NOT_EQUAL(destroy_instance, nullptr, message + " - find xrDestroyInstance")
+                    if (nullptr != destroy_instance) {
+                        TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, message + " - destroy")
+                    }
+                }
+                std::ifstream output_file(file_name);
+                return std::string((std::istreambuf_iterator<char>(output_file)), std::istreambuf_iterator<char>());
+            };
+
+            // Both instances are in one JSON array, which is only closed when the layer is unloaded.
+            std::string trace = record_two_instances("trace", "api_dump_recreated_instance.json");
+            TEST_EQUAL(trace.compare(0, 2, "[\n"), 0, "Trace - starts with one header")
+            TEST_EQUAL(CountOccurrences(trace, "\"name\":\"xrCreateInstance\""), 2, "Trace - both creates traced")
+            TEST_EQUAL(CountOccurrences(trace, "\"name\":\"xrDestroyInstance\""), 2, "Trace - both destroys traced")
+            TEST_EQUAL(CountOccurrences(trace, "]\n"), 0, "Trace - not closed while the layer is loaded")
+            TEST_EQUAL(CountOccurrences(trace, "XrInstanceCreateInfo"), 0, "Trace - no text dump")
+
+            // Each time the last instance is destroyed, a report of every call so far is added.
+            std::string stats = record_two_instances("stats", "api_dump_recreated_instance_stats.txt");
+            TEST_EQUAL(CountOccurrences(stats, "API dump statistics over"), 2, "Stats - one report per instance")
+            std::istringstream last_create_line(stats.substr(stats.rfind("\nxrCreateInstance ") + 1));
+            std::string command_name;
+            uint64_t call_count = 0;
+            last_create_line >> command_name >> call_count;
+            TEST_EQUAL(call_count, 2, "Stats - both creates counted")
+            TEST_EQUAL(CountOccurrences(stats, "XrInstanceCreateInfo"), 0, "Stats - no text dump")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("api_dump_recreated_instance.json");
+    remove("api_dump_recreated_instance_stats.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpRecreatedInstance)
+}
+
+// Compare a line of a text dump with the same line decoded from a binary capture.  The decoder has no runtime to
+// name enumerants, and the addresses of data it followed show where it rebuilt that data, so only those values may
+// differ.
+static bool ApiDumpDecodedLineMatches(const std::string& text_line, const std::string& decoded_line) {
+    if (text_line == decoded_line) {
+        return true;
+    }
+    size_t value_offset = text_line.find(" = ");
+    if (value_offset == std::string::npos || text_line.compare(0, value_offset + 3, decoded_line, 0, value_offset + 3) != 0) {
+        return false;
+    }
+    std::string text_value = text_line.substr(value_offset + 3);
+    std::string decoded_value = decoded_line.substr(value_offset + 3);
+    bool is_address = text_value.size() == 18 && decoded_value.size() == 18 && text_value.compare(0, 2, "0x") == 0 &&
+                      decoded_value.compare(0, 2, "0x") == 0;
+    bool is_enumerant = text_value.compare(0, 3, "XR_") == 0 && !decoded_value.empty() &&
+                        decoded_value.find_first_not_of("0123456789") == std::string::npos;
+    return is_address || is_enumerant;
+}
+
+// Test that a binary capture decodes to the text the layer writes for the same calls, which is what the offline
+// decoder promises.
+DEFINE_TEST(TestApiDumpBinaryRoundTrip) {
+    INIT_TEST(TestApiDumpBinaryRoundTrip)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadApiDumpLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the api_dump layer")
+    try {
+        if (nullptr != layer_library) {
+            // Make the same calls, from the same stack depth and with the same instance handle, for each export type.
+            auto record_calls = [&](const char* export_type, const char* file_name) {
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", export_type);
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", file_name);
+                remove(file_name);
+                std::string message = export_type;
+                g_fake_next_instance_count = 0;
+                XrInstance instance = XR_NULL_HANDLE;
+                TEST_EQUAL(CreateApiDumpLayerInstance(layer_request, &instance), XR_SUCCESS, message + " - create")
+                PFN_xrVoidFunction function = nullptr;
+                layer_request.getInstanceProcAddr(instance, "xrGetSystem", &function);
+                auto get_system = reinterpret_cast<PFN_xrGetSystem>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+                auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+                TEST_NOT_EQUAL(get_system, nullptr, message + " - find xrGetSystem")
+                TEST_NOT_EQUAL(destroy_instance, nullptr, message + " - find xrDestroyInstance")
+                if (nullptr != get_system && nullptr != destroy_instance) {
+                    XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+                    system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+                    XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                    TEST_EQUAL(get_system(instance, &system_get_info, &system_id), XR_SUCCESS, message + " - xrGetSystem")
+                    TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, message + " - destroy")
+                }
+            };
+            auto read_file = [](const char* file_name) {
+                std::ifstream file(file_name, std::ios::in | std::ios::binary);
+                return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            };
+
+            record_calls("text", "api_dump_round_trip.txt");
+            record_calls("binary", "api_dump_round_trip.bin");
+            TEST_EQUAL(system("../../api_layers/api_dump_decoder api_dump_round_trip.bin api_dump_round_trip_decoded.txt"), 0,
+                       "Decoding the capture")
+            std::string text = read_file("api_dump_round_trip.txt");
+            std::string decoded = read_file("api_dump_round_trip_decoded.txt");
+            TEST_EQUAL(CountOccurrences(text, "XrResult xrGetSystem"), 1, "Text dump written")
+            TEST_EQUAL(CountOccurrences(decoded, "\n"), CountOccurrences(text, "\n"), "Decoded capture has every line")
+            std::istringstream text_lines(text);
+            std::istringstream decoded_lines(decoded);
+            std::string text_line;
+            std::string decoded_line;
+            uint32_t mismatched_lines = 0;
+            while (std::getline(text_lines, text_line) && std::getline(decoded_lines, decoded_line)) {
+                if (!ApiDumpDecodedLineMatches(text_line, decoded_line)) {
+                    ++mismatched_lines;
+                }
+            }
+            TEST_EQUAL(mismatched_lines, 0, "Decoded capture matches the text dump")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("api_dump_round_trip.txt");
+    remove("api_dump_round_trip.bin");
+    remove("api_dump_round_trip_decoded.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpBinaryRoundTrip)
+}
+
+// Test that replaying a binary capture through the loader and the test runtime replaces the system ids the capture
+// saw with the ones the runtime returns, forgets them once their instance is destroyed, and counts the ones it never
+// saw returned.  The fake functions below the layer only accept a system id from the instance that returned it, and
+// the test runtime only accepts its own, so every replayed call returns what it did during the capture only if the
+// replay remaps the ids correctly.
+DEFINE_TEST(TestApiDumpReplay) {
+    INIT_TEST(TestApiDumpReplay)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadApiDumpLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the api_dump layer")
+    try {
+        std::string current_path;
+        std::string runtime_json;
+        if (nullptr != layer_library && FileSysUtilsGetCurrentPath(current_path) &&
+            FileSysUtilsCombinePaths(current_path, "resources/runtimes/test_runtime.json", runtime_json)) {
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "binary");
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", "api_dump_replay.bin");
+            remove("api_dump_replay.bin");
+
+            XrSystemId first_system_id = XR_NULL_SYSTEM_ID;
+            for (uint32_t pass = 0; pass < 2; ++pass) {
+                std::string message = "Instance " + std::to_string(pass);
+                XrInstance instance = XR_NULL_HANDLE;
+                TEST_EQUAL(CreateApiDumpLayerInstance(layer_request, &instance), XR_SUCCESS, message + " - create")
+                PFN_xrVoidFunction function = nullptr;
+                layer_request.getInstanceProcAddr(instance, "xrGetSystem", &function);
+                auto get_system = reinterpret_cast<PFN_xrGetSystem>(function);
+                layer_request.getInstanceProcAddr(instance, "xrGetSystemProperties", &function);
+                auto get_system_properties = reinterpret_cast<PFN_xrGetSystemProperties>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+                auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+                if (nullptr == get_system || nullptr == get_system_properties || nullptr == destroy_instance) {
+                    TEST_FAIL(message + " - finding the layer's functions")
+                    break;
+                }
+
+                XrSystemProperties properties{XR_TYPE_SYSTEM_PROPERTIES};
+                if (pass == 1) {
+                    // The first instance's system, which the replay must not map to the second instance's.
+                    TEST_EQUAL(get_system_properties(instance, first_system_id, &properties), XR_ERROR_SYSTEM_INVALID,
+                               message + " - system of a destroyed instance")
+                }
+                XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+                system_get_info.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+                XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                TEST_EQUAL(get_system(instance, &system_get_info, &system_id), XR_SUCCESS, message + " - xrGetSystem")
+                TEST_EQUAL(get_system_properties(instance, system_id, &properties), XR_SUCCESS, message + " - own system")
+                if (pass == 0) {
+                    // A system id that was never returned, which the replay passes on unchanged.
+                    TEST_EQUAL(get_system_properties(instance, 0x7777, &properties), XR_ERROR_SYSTEM_INVALID,
+                               message + " - unknown system")
+                    first_system_id = system_id;
+                }
+                TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, message + " - destroy")
+            }
+
+            LoaderTestSetEnvironmentVariable("XR_RUNTIME_JSON", runtime_json);
+            TEST_EQUAL(system("../../api_layers/api_dump_replay api_dump_replay.bin > api_dump_replay.txt"), 0,
+                       "Replaying the capture")
+            LoaderTestUnsetEnvironmentVariable("XR_RUNTIME_JSON");
+            std::ifstream replay_output("api_dump_replay.txt");
+            std::string pass_line;
+            std::getline(replay_output, pass_line);
+            TEST_NOT_EQUAL(pass_line.find(" 0 skipped, 0 results differed, 2 unknown handles"), std::string::npos,
+                           "Every result replayed, with two unknown system ids")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("api_dump_replay.bin");
+    remove("api_dump_replay.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpReplay)
+}
+
+// Test which records the api_dump layer's filter settings let through: listed commands, every Nth frame, and only
+// as many bytes per second as the budget allows.  Settings are read again for each instance, since none of the
+// others is alive when it is created.
+DEFINE_TEST(TestApiDumpFilters) {
+    INIT_TEST(TestApiDumpFilters)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadApiDumpLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the api_dump layer")
+    try {
+        if (nullptr != layer_library) {
+            // Create an instance and a session, make frame_count frames of one xrGetSystemProperties and one
+            // xrEndFrame each, then destroy everything and return what was written.
+            auto record_frames = [&](const std::string& message, uint32_t frame_count) {
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "text");
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", "api_dump_filters.txt");
+                remove("api_dump_filters.txt");
+                XrInstance instance = XR_NULL_HANDLE;
+                TEST_EQUAL(CreateApiDumpLayerInstance(layer_request, &instance), XR_SUCCESS, message + " - create instance")
+                PFN_xrVoidFunction function = nullptr;
+                layer_request.getInstanceProcAddr(instance, "xrGetSystemProperties", &function);
+                auto get_system_properties = reinterpret_cast<PFN_xrGetSystemProperties>(function);
+                layer_request.getInstanceProcAddr(instance, "xrCreateSession", &function);
+                auto create_session = reinterpret_cast<PFN_xrCreateSession>(function);
+                layer_request.getInstanceProcAddr(instance, "xrEndFrame", &function);
+                auto end_frame = reinterpret_cast<PFN_xrEndFrame>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroySession", &function);
+                auto destroy_session = reinterpret_cast<PFN_xrDestroySession>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+                auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+                if (nullptr == get_system_properties || nullptr == create_session || nullptr == end_frame ||
+                    nullptr == destroy_session || nullptr == destroy_instance) {
+                    TEST_FAIL(message + " - finding the layer's functions")
+                    return std::string();
+                }
+                XrSessionCreateInfo session_create_info{XR_TYPE_SESSION_CREATE_INFO};
+                session_create_info.systemId = FakeNextSystemId(instance);
+                XrSession session = XR_NULL_HANDLE;
+                TEST_EQUAL(create_session(instance, &session_create_info, &session), XR_SUCCESS, message + " - create session")
+                for (uint32_t frame = 0; frame < frame_count; ++frame) {
+                    XrSystemProperties properties{XR_TYPE_SYSTEM_PROPERTIES};
+                    get_system_properties(instance, FakeNextSystemId(instance), &properties);
+                    XrFrameEndInfo frame_end_info{XR_TYPE_FRAME_END_INFO};
+                    frame_end_info.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+                    end_frame(session, &frame_end_info);
+                }
+                TEST_EQUAL(destroy_session(session), XR_SUCCESS, message + " - destroy session")
+                TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, message + " - destroy instance")
+                std::ifstream output_file("api_dump_filters.txt");
+                return std::string((std::istreambuf_iterator<char>(output_file)), std::istreambuf_iterator<char>());
+            };
+
+            // Only commands that are included and not excluded.
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_INCLUDE_COMMANDS", "xrGetSystemProperties,xrEndFrame xrCreateSession");
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXCLUDE_COMMANDS", "xrCreateSession");
+            std::string commands = record_frames("Commands", 3);
+            TEST_EQUAL(CountOccurrences(commands, "XrResult xrGetSystemProperties\n"), 3, "Commands - included command")
+            TEST_EQUAL(CountOccurrences(commands, "XrResult xrEndFrame\n"), 3, "Commands - other included command")
+            TEST_EQUAL(CountOccurrences(commands, "XrResult xrCreateSession\n"), 0, "Commands - excluded command")
+            TEST_EQUAL(CountOccurrences(commands, "XrResult xrCreateInstance\n"), 0, "Commands - command not included")
+            LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_INCLUDE_COMMANDS");
+            LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXCLUDE_COMMANDS");
+
+            // Frames 0 and 3 of 6, including everything before the first xrEndFrame.
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_FRAME_INTERVAL", "3");
+            std::string sampled = record_frames("Sampling", 6);
+            TEST_EQUAL(CountOccurrences(sampled, "XrResult xrCreateInstance\n"), 1, "Sampling - first frame")
+            TEST_EQUAL(CountOccurrences(sampled, "XrResult xrGetSystemProperties\n"), 2, "Sampling - calls in sampled frames")
+            TEST_EQUAL(CountOccurrences(sampled, "XrResult xrEndFrame\n"), 2, "Sampling - ends of sampled frames")
+            LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FRAME_INTERVAL");
+
+            // A one-byte budget lets only the first record of each second through.  The calls take far less than a
+            // second, but allow for them straddling the start of the next one.
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_MAX_BYTES_PER_SECOND", "1");
+            std::string budgeted = record_frames("Budget", 20);
+            TEST_EQUAL(budgeted.compare(0, 26, "XrResult xrCreateInstance\n"), 0, "Budget - first record written")
+            TEST_EQUAL(CountOccurrences(budgeted, "XrResult xr") <= 2, true, "Budget - later records left out")
+            LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_MAX_BYTES_PER_SECOND");
+
+            // Settings are gone for the next instance once they are unset.
+            std::string unfiltered = record_frames("Unfiltered", 2);
+            TEST_EQUAL(CountOccurrences(unfiltered, "XrResult xrEndFrame\n"), 2, "Unfiltered - every frame")
+            TEST_EQUAL(CountOccurrences(unfiltered, "XrResult xrCreateSession\n"), 1, "Unfiltered - every command")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("api_dump_filters.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_INCLUDE_COMMANDS");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXCLUDE_COMMANDS");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FRAME_INTERVAL");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_MAX_BYTES_PER_SECOND");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpFilters)
+}
+
+// Test that handles named with xrSetDebugUtilsObjectNameEXT are shown with their names in the api_dump layer's
+// output until they are destroyed, and that the object name filter only lets through calls on the named objects.
+DEFINE_TEST(TestApiDumpObjectNames) {
+    INIT_TEST(TestApiDumpObjectNames)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadApiDumpLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the api_dump layer")
+    try {
+        if (nullptr != layer_library) {
+            // Create an instance, then a session that is named before its second frame and destroyed after it, then
+            // a session with the same handle value for a third frame.  Returns the text written for each frame.
+            auto record_frames = [&](const std::string& message) {
+                std::vector<std::string> frames;
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "text");
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", "api_dump_object_names.txt");
+                remove("api_dump_object_names.txt");
+                XrInstance instance = XR_NULL_HANDLE;
+                TEST_EQUAL(CreateApiDumpLayerInstance(layer_request, &instance), XR_SUCCESS, message + " - create instance")
+                PFN_xrVoidFunction function = nullptr;
+                layer_request.getInstanceProcAddr(instance, "xrSetDebugUtilsObjectNameEXT", &function);
+                auto set_object_name = reinterpret_cast<PFN_xrSetDebugUtilsObjectNameEXT>(function);
+                layer_request.getInstanceProcAddr(instance, "xrCreateSession", &function);
+                auto create_session = reinterpret_cast<PFN_xrCreateSession>(function);
+                layer_request.getInstanceProcAddr(instance, "xrEndFrame", &function);
+                auto end_frame = reinterpret_cast<PFN_xrEndFrame>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroySession", &function);
+                auto destroy_session = reinterpret_cast<PFN_xrDestroySession>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+                auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+                if (nullptr == set_object_name || nullptr == create_session || nullptr == end_frame ||
+                    nullptr == destroy_session || nullptr == destroy_instance) {
+                    TEST_FAIL(message + " - finding the layer's functions")
+                    return frames;
+                }
+
+                // Each frame's records are what was added to the file since the last one
+                size_t frame_start = 0;
+                auto end_recorded_frame = [&](XrSession session) {
+                    XrFrameEndInfo frame_end_info{XR_TYPE_FRAME_END_INFO};
+                    frame_end_info.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+                    end_frame(session, &frame_end_info);
+                    std::ifstream output_file("api_dump_object_names.txt");
+                    std::string output((std::istreambuf_iterator<char>(output_file)), std::istreambuf_iterator<char>());
+                    frames.push_back(output.substr(std::min(frame_start, output.size())));
+                    frame_start = output.size();
+                };
+
+                XrSessionCreateInfo session_create_info{XR_TYPE_SESSION_CREATE_INFO};
+                session_create_info.systemId = FakeNextSystemId(instance);
+                XrSession session = XR_NULL_HANDLE;
+                TEST_EQUAL(create_session(instance, &session_create_info, &session), XR_SUCCESS, message + " - create session")
+                end_recorded_frame(session);
+                XrDebugUtilsObjectNameInfoEXT name_info{XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
+                name_info.objectType = XR_OBJECT_TYPE_SESSION;
+                name_info.objectHandle = MakeHandleGeneric(session);
+                name_info.objectName = "Named Session";
+                TEST_EQUAL(set_object_name(instance, &name_info), XR_SUCCESS, message + " - name session")
+                end_recorded_frame(session);
+                TEST_EQUAL(destroy_session(session), XR_SUCCESS, message + " - destroy session")
+                TEST_EQUAL(create_session(instance, &session_create_info, &session), XR_SUCCESS,
+                           message + " - create session again")
+                end_recorded_frame(session);
+                TEST_EQUAL(destroy_session(session), XR_SUCCESS, message + " - destroy session again")
+                TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, message + " - destroy instance")
+                return frames;
+            };
+
+            std::vector<std::string> named = record_frames("Names");
+            if (named.size() == 3) {
+                TEST_EQUAL(CountOccurrences(named[0], "(Named Session)"), 0, "Names - not shown before naming")
+                TEST_EQUAL(CountOccurrences(named[1], "session = "), 1, "Names - session dumped")
+                TEST_EQUAL(CountOccurrences(named[1], "(Named Session)\n"), 1, "Names - shown after naming")
+                TEST_EQUAL(CountOccurrences(named[1], "XrResult xrSetDebugUtilsObjectNameEXT\n"), 1, "Names - naming call dumped")
+                // Destroying the session is still dumped with its name, but the next one with its handle value is not
+                size_t recreated = named[2].find("XrResult xrCreateSession\n");
+                TEST_EQUAL(CountOccurrences(named[2].substr(0, recreated), "(Named Session)\n"), 1,
+                           "Names - shown when destroyed")
+                TEST_EQUAL(recreated != std::string::npos && CountOccurrences(named[2].substr(recreated), "(Named Session)") == 0,
+                           true, "Names - forgotten once destroyed")
+            }
+
+            // Only the frame ended on the named session is dumped
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_OBJECT_NAMES", "Other Session, Named Session");
+            std::vector<std::string> filtered = record_frames("Filter");
+            if (filtered.size() == 3) {
+                TEST_EQUAL(CountOccurrences(filtered[0], "XrResult xr"), 0, "Filter - nothing before naming")
+                TEST_EQUAL(CountOccurrences(filtered[1], "XrResult xrEndFrame\n"), 1, "Filter - named session's frame")
+                TEST_EQUAL(CountOccurrences(filtered[1], "XrResult xrSetDebugUtilsObjectNameEXT\n"), 0,
+                           "Filter - unnamed instance's call left out")
+                TEST_EQUAL(CountOccurrences(filtered[2], "XrResult xrDestroySession\n"), 1, "Filter - named session destroyed")
+                TEST_EQUAL(CountOccurrences(filtered[2], "XrResult xr"), 1, "Filter - nothing once destroyed")
+            }
+            LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_OBJECT_NAMES");
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("api_dump_object_names.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_OBJECT_NAMES");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpObjectNames)
+}
+
+// Test the api_dump layer's asynchronous file output through a queue of two records.  Callers that wait for room
+// must get their records written in the order they were made, and with the drop policy every record must be either
+// written or counted in a dropped-records note.
+DEFINE_TEST(TestApiDumpAsyncOutput) {
+    INIT_TEST(TestApiDumpAsyncOutput)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadApiDumpLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the api_dump layer")
+    try {
+        if (nullptr != layer_library) {
+            // Create an instance, call xrGetSystem from each thread, alternating the form factor, then destroy the
+            // instance and return what was written.
+            auto record_calls = [&](const char* async_mode, const char* file_name, uint32_t thread_count,
+                                    uint32_t calls_per_thread) {
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "text");
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", file_name);
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_ASYNC", async_mode);
+                LoaderTestSetEnvironmentVariable("XR_API_DUMP_ASYNC_QUEUE_SIZE", "2");
+                remove(file_name);
+                std::string message = async_mode;
+                XrInstance instance = XR_NULL_HANDLE;
+                TEST_EQUAL(CreateApiDumpLayerInstance(layer_request, &instance), XR_SUCCESS, message + " - create")
+                PFN_xrVoidFunction function = nullptr;
+                layer_request.getInstanceProcAddr(instance, "xrGetSystem", &function);
+                auto get_system = reinterpret_cast<PFN_xrGetSystem>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+                auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+                TEST_NOT_EQUAL(get_system, nullptr, message + " - find xrGetSystem")
+                TEST_NOT_EQUAL(destroy_instance, nullptr, message + " - find xrDestroyInstance")
+                if (nullptr != get_system && nullptr != destroy_instance) {
+                    auto make_calls = [=]() {
+                        XrSystemGetInfo system_get_info{XR_TYPE_SYSTEM_GET_INFO};
+                        XrSystemId system_id = XR_NULL_SYSTEM_ID;
+                        for (uint32_t call = 0; call < calls_per_thread; ++call) {
+                            system_get_info.formFactor =
+                                call % 2 == 0 ? XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY : XR_FORM_FACTOR_HANDHELD_DISPLAY;
+                            get_system(instance, &system_get_info, &system_id);
+                        }
+                    };
+                    std::vector<std::thread> threads;
+                    for (uint32_t thread = 0; thread < thread_count; ++thread) {
+                        threads.emplace_back(make_calls);
+                    }
+                    for (std::thread& thread : threads) {
+                        thread.join();
+                    }
+                    TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, message + " - destroy")
+                }
+                std::ifstream output_file(file_name);
+                return std::string((std::istreambuf_iterator<char>(output_file)), std::istreambuf_iterator<char>());
+            };
+
+            // One caller waiting for room: nothing is dropped and every record is in call order.
+            const uint32_t block_calls = 1000;
+            std::string blocked = record_calls("block", "api_dump_async_block.txt", 1, block_calls);
+            TEST_EQUAL(CountOccurrences(blocked, "records dropped"), 0, "Block - nothing dropped")
+            TEST_EQUAL(CountOccurrences(blocked, "XrResult xrGetSystem"), block_calls, "Block - every call written")
+            size_t create_offset = blocked.find("XrResult xrCreateInstance");
+            size_t destroy_offset = blocked.find("XrResult xrDestroyInstance");
+            TEST_EQUAL(create_offset < blocked.find("XrResult xrGetSystem"), true, "Block - create written first")
+            TEST_EQUAL(destroy_offset > blocked.rfind("XrResult xrGetSystem") && destroy_offset != std::string::npos, true,
+                       "Block - destroy written last")
+            uint32_t in_order = 0;
+            uint32_t call = 0;
+            for (size_t offset = blocked.find("formFactor = "); offset != std::string::npos;
+                 offset = blocked.find("formFactor = ", offset + 1), ++call) {
+                std::string form_factor = blocked.substr(offset, blocked.find('\n', offset) - offset);
+                XrFormFactor expected = call % 2 == 0 ? XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY : XR_FORM_FACTOR_HANDHELD_DISPLAY;
+                if (form_factor == "formFactor = " + std::to_string(expected)) {
+                    ++in_order;
+                }
+            }
+            TEST_EQUAL(in_order, block_calls, "Block - calls written in order")
+
+            // Several callers racing for two slots: some records are dropped, and the notes account for all of them.
+            const uint32_t drop_threads = 4;
+            const uint32_t drop_calls = 5000;
+            std::string dropped = record_calls("drop", "api_dump_async_drop.txt", drop_threads, drop_calls);
+            uint64_t dropped_count = 0;
+            std::istringstream dropped_lines(dropped);
+            std::string line;
+            while (std::getline(dropped_lines, line)) {
+                if (line.find("records dropped because the output queue was full") != std::string::npos) {
+                    dropped_count += std::strtoull(line.c_str() + 3, nullptr, 10);
+                }
+            }
+            TEST_NOT_EQUAL(dropped_count, 0, "Drop - records dropped from a full queue")
+            // Besides the calls, the instance is created and destroyed and the test looks up two functions.
+            TEST_EQUAL(CountOccurrences(dropped, "XrResult xr") + dropped_count, drop_threads * drop_calls + 4,
+                       "Drop - every record written or counted")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("api_dump_async_block.txt");
+    remove("api_dump_async_drop.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_ASYNC");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_ASYNC_QUEUE_SIZE");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpAsyncOutput)
+}
+
+// Test the api_dump layer's ring file.  Records written to a ring much smaller than them wrap around it, and a
+// reader that mapped the file beforehand sees only the newest of them, whole and in order.  Then the layer's ring
+// output is shown by api_dump_ring_viewer, which must find only the most recent commands.
+DEFINE_TEST(TestApiDumpRing) {
+    INIT_TEST(TestApiDumpRing)
+
+    try {
+        ApiDumpRing writer;
+        TEST_EQUAL(writer.Create("api_dump_ring_wrap.ring", 256), true, "Wraparound - create the ring")
+        ApiDumpRing reader;
+        TEST_EQUAL(reader.Open("api_dump_ring_wrap.ring"), true, "Wraparound - open the ring to read")
+        if (writer.IsOpen() && reader.IsOpen()) {
+            // Records of different lengths, so they don't line up with the end of the ring the same way each time
+            const uint32_t record_count = 100;
+            auto make_record = [](uint32_t index) { return "record " + std::to_string(index) + std::string(index % 37, '.'); };
+            uint32_t written = 0;
+            for (uint32_t index = 0; index < record_count; ++index) {
+                std::string record = make_record(index);
+                if (writer.Write(record.data(), record.size(), 1000 + index)) {
+                    ++written;
+                }
+            }
+            TEST_EQUAL(written, record_count, "Wraparound - every record written")
+            TEST_EQUAL(writer.WriteOffset() > 4 * writer.RingSize(), true, "Wraparound - records wrapped around the ring")
+            TEST_EQUAL(writer.Write(std::string(256, '.').data(), 256, 0), false, "Wraparound - record larger than the ring")
+
+            uint64_t offset = 0;
+            uint64_t timestamp_ns = 0;
+            std::string record;
+            TEST_EQUAL(reader.Read(offset, timestamp_ns, record), false, "Wraparound - overwritten record not read")
+            TEST_EQUAL(offset, 0, "Wraparound - offset kept for an overwritten record")
+
+            // Everything still in the ring is the newest records, ending with the last one
+            std::vector<uint32_t> indices;
+            uint32_t intact = 0;
+            offset = reader.OldestOffset();
+            while (offset < reader.WriteOffset() && reader.Read(offset, timestamp_ns, record)) {
+                uint32_t index = static_cast<uint32_t>(timestamp_ns - 1000);
+                indices.push_back(index);
+                if (record == make_record(index)) {
+                    ++intact;
+                }
+            }
+            TEST_EQUAL(offset, reader.WriteOffset(), "Wraparound - every remaining record read")
+            TEST_EQUAL(indices.size() > 1, true, "Wraparound - several records remain")
+            TEST_EQUAL(intact, static_cast<uint32_t>(indices.size()), "Wraparound - records read back intact")
+            bool consecutive = !indices.empty() && indices.back() == record_count - 1;
+            for (size_t i = 1; i < indices.size(); ++i) {
+                consecutive = consecutive && indices[i] == indices[i - 1] + 1;
+            }
+            TEST_EQUAL(consecutive, true, "Wraparound - newest records remain in order")
+        }
+        reader.Close();
+        writer.Close();
+    } catch (...) {
+        TEST_FAIL("Exception triggered during wraparound test, automatic failure")
+    }
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadApiDumpLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the api_dump layer")
+    try {
+        if (nullptr != layer_library) {
+            // The smallest ring the layer allows, with far more calls than fit in it
+            const uint32_t call_count = 200;
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE", "ring");
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_FILE_NAME", "api_dump_ring.ring");
+            LoaderTestSetEnvironmentVariable("XR_API_DUMP_RING_SIZE", "4096");
+            XrInstance instance = XR_NULL_HANDLE;
+            TEST_EQUAL(CreateApiDumpLayerInstance(layer_request, &instance), XR_SUCCESS, "Viewer - create instance")
+            PFN_xrVoidFunction function = nullptr;
+            layer_request.getInstanceProcAddr(instance, "xrGetSystemProperties", &function);
+            auto get_system_properties = reinterpret_cast<PFN_xrGetSystemProperties>(function);
+            layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+            auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+            TEST_NOT_EQUAL(get_system_properties, nullptr, "Viewer - find xrGetSystemProperties")
+            TEST_NOT_EQUAL(destroy_instance, nullptr, "Viewer - find xrDestroyInstance")
+            if (nullptr != get_system_properties && nullptr != destroy_instance) {
+                for (uint32_t call = 0; call < call_count; ++call) {
+                    XrSystemProperties properties{XR_TYPE_SYSTEM_PROPERTIES};
+                    get_system_properties(instance, FakeNextSystemId(instance), &properties);
+                }
+                TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, "Viewer - destroy instance")
+
+                TEST_EQUAL(system("../../api_layers/api_dump_ring_viewer api_dump_ring.ring > api_dump_ring_view.txt"), 0,
+                           "Viewer - show the ring")
+                std::ifstream view_file("api_dump_ring_view.txt");
+                std::string view((std::istreambuf_iterator<char>(view_file)), std::istreambuf_iterator<char>());
+                uint32_t shown = CountOccurrences(view, "XrResult xrGetSystemProperties\n");
+                TEST_EQUAL(shown > 0 && shown < call_count, true, "Viewer - only the newest calls shown")
+                TEST_EQUAL(CountOccurrences(view, "XrResult xrCreateInstance\n"), 0, "Viewer - oldest record overwritten")
+                TEST_EQUAL(view.rfind("XrResult xr") == view.rfind("XrResult xrDestroyInstance\n") && !view.empty(), true,
+                           "Viewer - newest record shown last")
+                TEST_EQUAL(CountOccurrences(view, "overwritten before they were read"), 0, "Viewer - nothing skipped")
+            }
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during viewer test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("api_dump_ring_wrap.ring");
+    remove("api_dump_ring_view.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_FILE_NAME");
+    LoaderTestUnsetEnvironmentVariable("XR_API_DUMP_RING_SIZE");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestApiDumpRing)
+}
+
+// Test core validation's check of the next chain of an output structure.  A structure that appears twice must be
+// reported as a duplicate, by name, while a chain of different valid structures must not be reported at all.
+DEFINE_TEST(TestCoreValidationNextChain) {
+    INIT_TEST(TestCoreValidationNextChain)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadCoreValidationLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the core_validation layer")
+    try {
+        if (nullptr != layer_library) {
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_EXPORT_TYPE", "text");
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_FILE_NAME", "core_validation_next_chain.txt");
+            remove("core_validation_next_chain.txt");
+            XrInstance instance = XR_NULL_HANDLE;
+            TEST_EQUAL(CreateCoreValidationLayerInstance(layer_request, nullptr, &instance), XR_SUCCESS, "Create instance")
+            PFN_xrVoidFunction function = nullptr;
+            layer_request.getInstanceProcAddr(instance, "xrGetSystemProperties", &function);
+            auto get_system_properties = reinterpret_cast<PFN_xrGetSystemProperties>(function);
+            layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+            auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+            TEST_NOT_EQUAL(get_system_properties, nullptr, "Find xrGetSystemProperties")
+            TEST_NOT_EQUAL(destroy_instance, nullptr, "Find xrDestroyInstance")
+            if (nullptr != get_system_properties && nullptr != destroy_instance) {
+                auto read_messages = []() {
+                    std::ifstream output_file("core_validation_next_chain.txt");
+                    return std::string((std::istreambuf_iterator<char>(output_file)), std::istreambuf_iterator<char>());
+                };
+
+                XrSystemHandTrackingPropertiesEXT hand_tracking{XR_TYPE_SYSTEM_HAND_TRACKING_PROPERTIES_EXT};
+                XrSystemEyeGazeInteractionPropertiesEXT eye_gaze{XR_TYPE_SYSTEM_EYE_GAZE_INTERACTION_PROPERTIES_EXT};
+                XrSystemProperties properties{XR_TYPE_SYSTEM_PROPERTIES};
+                properties.next = &hand_tracking;
+                hand_tracking.next = &eye_gaze;
+                TEST_EQUAL(get_system_properties(instance, FakeNextSystemId(instance), &properties), XR_SUCCESS,
+                           "Valid chain - call succeeds")
+                TEST_EQUAL(read_messages(), std::string(), "Valid chain - nothing reported")
+
+                XrSystemHandTrackingPropertiesEXT second_hand_tracking{XR_TYPE_SYSTEM_HAND_TRACKING_PROPERTIES_EXT};
+                eye_gaze.next = &second_hand_tracking;
+                g_fake_next_string_instance = XR_NULL_HANDLE;
+                TEST_EQUAL(get_system_properties(instance, FakeNextSystemId(instance), &properties), XR_ERROR_VALIDATION_FAILURE,
+                           "Duplicate - call fails validation")
+                std::string messages = read_messages();
+                TEST_EQUAL(CountOccurrences(messages, "[VALID_ERROR | VUID-XrSystemProperties-next-unique | xrGetSystemProperties]"), 1,
+                           "Duplicate - reported once")
+                TEST_EQUAL(CountOccurrences(messages, "Multiple structures of the same type(s)"), 1,
+                           "Duplicate - reported as a duplicate")
+                TEST_EQUAL(g_fake_next_string_instance, instance, "Duplicate - duplicated type named")
+
+                TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, "Destroy instance")
+            }
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("core_validation_next_chain.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_FILE_NAME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestCoreValidationNextChain)
+}
+
+// Test core validation's frame validation level.  With no frame sampled, a command called every frame must skip its
+// structure checks but still reject an invalid handle, while on sampled frames and at the full level the structures
+// are checked too.
+DEFINE_TEST(TestCoreValidationFrameLevel) {
+    INIT_TEST(TestCoreValidationFrameLevel)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadCoreValidationLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the core_validation layer")
+    try {
+        if (nullptr != layer_library) {
+            // Call xrWaitFrame on a session with a structure of the wrong type, then on a handle that is not a session.
+            // Returns what was reported.
+            auto wait_frames = [&](const std::string& message, XrResult expected_wrong_type) {
+                LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_EXPORT_TYPE", "text");
+                LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_FILE_NAME", "core_validation_frame_level.txt");
+                remove("core_validation_frame_level.txt");
+                XrInstance instance = XR_NULL_HANDLE;
+                TEST_EQUAL(CreateCoreValidationLayerInstance(layer_request, nullptr, &instance), XR_SUCCESS,
+                           message + " - create instance")
+                PFN_xrVoidFunction function = nullptr;
+                layer_request.getInstanceProcAddr(instance, "xrCreateSession", &function);
+                auto create_session = reinterpret_cast<PFN_xrCreateSession>(function);
+                layer_request.getInstanceProcAddr(instance, "xrWaitFrame", &function);
+                auto wait_frame = reinterpret_cast<PFN_xrWaitFrame>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroySession", &function);
+                auto destroy_session = reinterpret_cast<PFN_xrDestroySession>(function);
+                layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+                auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+                if (nullptr == create_session || nullptr == wait_frame || nullptr == destroy_session || nullptr == destroy_instance) {
+                    TEST_FAIL(message + " - finding the layer's functions")
+                    return std::string();
+                }
+                XrSessionCreateInfo session_create_info{XR_TYPE_SESSION_CREATE_INFO};
+                session_create_info.systemId = FakeNextSystemId(instance);
+                XrSession session = XR_NULL_HANDLE;
+                TEST_EQUAL(create_session(instance, &session_create_info, &session), XR_SUCCESS, message + " - create session")
+
+                XrFrameWaitInfo wrong_type_wait_info{XR_TYPE_FRAME_STATE};
+                XrFrameWaitInfo frame_wait_info{XR_TYPE_FRAME_WAIT_INFO};
+                XrFrameState frame_state{XR_TYPE_FRAME_STATE};
+                TEST_EQUAL(wait_frame(session, &wrong_type_wait_info, &frame_state), expected_wrong_type,
+                           message + " - wrong structure type")
+                XrSession not_a_session = TreatIntegerAsHandle<XrSession>(0xbad5e55);
+                TEST_EQUAL(wait_frame(not_a_session, &frame_wait_info, &frame_state), XR_ERROR_HANDLE_INVALID,
+                           message + " - invalid handle")
+
+                TEST_EQUAL(destroy_session(session), XR_SUCCESS, message + " - destroy session")
+                TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, message + " - destroy instance")
+                std::ifstream output_file("core_validation_frame_level.txt");
+                return std::string((std::istreambuf_iterator<char>(output_file)), std::istreambuf_iterator<char>());
+            };
+            const char* wrong_type_vuid = "| VUID-XrFrameWaitInfo-type-type | xrWaitFrame]";
+            const char* invalid_handle_vuid = "| VUID-xrWaitFrame-session-parameter | xrWaitFrame]";
+
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_LEVEL", "frame");
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_FRAME_INTERVAL", "0");
+            std::string unsampled = wait_frames("Unsampled", XR_SUCCESS);
+            TEST_EQUAL(CountOccurrences(unsampled, wrong_type_vuid), 0, "Unsampled - structure not checked")
+            TEST_EQUAL(CountOccurrences(unsampled, invalid_handle_vuid), 1, "Unsampled - handle checked")
+
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_FRAME_INTERVAL", "1");
+            std::string sampled = wait_frames("Sampled", XR_ERROR_VALIDATION_FAILURE);
+            TEST_EQUAL(CountOccurrences(sampled, wrong_type_vuid), 1, "Sampled - structure checked")
+            TEST_EQUAL(CountOccurrences(sampled, invalid_handle_vuid), 1, "Sampled - handle checked")
+
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_LEVEL", "full");
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_FRAME_INTERVAL", "0");
+            std::string full = wait_frames("Full", XR_ERROR_VALIDATION_FAILURE);
+            TEST_EQUAL(CountOccurrences(full, wrong_type_vuid), 1, "Full - structure checked")
+            TEST_EQUAL(CountOccurrences(full, invalid_handle_vuid), 1, "Full - handle checked")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("core_validation_frame_level.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_FILE_NAME");
+    LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_LEVEL");
+    LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_FRAME_INTERVAL");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestCoreValidationFrameLevel)
+}
+
+DEFINE_TEST(TestCoreValidationFrameOrder) {
+    INIT_TEST(TestCoreValidationFrameOrder)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadCoreValidationLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the core_validation layer")
+    try {
+        if (nullptr != layer_library) {
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_EXPORT_TYPE", "text");
+            LoaderTestSetEnvironmentVariable("XR_CORE_VALIDATION_FILE_NAME", "core_validation_frame_order.txt");
+            remove("core_validation_frame_order.txt");
+            XrInstance instance = XR_NULL_HANDLE;
+            TEST_EQUAL(CreateCoreValidationLayerInstance(layer_request, nullptr, &instance), XR_SUCCESS, "Create instance")
+            PFN_xrVoidFunction function = nullptr;
+            layer_request.getInstanceProcAddr(instance, "xrCreateSession", &function);
+            auto create_session = reinterpret_cast<PFN_xrCreateSession>(function);
+            layer_request.getInstanceProcAddr(instance, "xrBeginSession", &function);
+            auto begin_session = reinterpret_cast<PFN_xrBeginSession>(function);
+            layer_request.getInstanceProcAddr(instance, "xrEndSession", &function);
+            auto end_session = reinterpret_cast<PFN_xrEndSession>(function);
+            layer_request.getInstanceProcAddr(instance, "xrWaitFrame", &function);
+            auto wait_frame = reinterpret_cast<PFN_xrWaitFrame>(function);
+            layer_request.getInstanceProcAddr(instance, "xrBeginFrame", &function);
+            auto begin_frame = reinterpret_cast<PFN_xrBeginFrame>(function);
+            layer_request.getInstanceProcAddr(instance, "xrEndFrame", &function);
+            auto end_frame = reinterpret_cast<PFN_xrEndFrame>(function);
+            layer_request.getInstanceProcAddr(instance, "xrDestroySession", &function);
+            auto destroy_session = reinterpret_cast<PFN_xrDestroySession>(function);
+            layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+            auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+            if (nullptr == create_session || nullptr == begin_session || nullptr == end_session || nullptr == wait_frame ||
+                nullptr == begin_frame || nullptr == end_frame || nullptr == destroy_session || nullptr == destroy_instance) {
+                TEST_FAIL("Finding the layer's functions")
+            } else {
+                XrSessionCreateInfo session_create_info{XR_TYPE_SESSION_CREATE_INFO};
+                session_create_info.systemId = FakeNextSystemId(instance);
+                XrSession session = XR_NULL_HANDLE;
+                TEST_EQUAL(create_session(instance, &session_create_info, &session), XR_SUCCESS, "Create session")
+
+                XrSessionBeginInfo session_begin_info{XR_TYPE_SESSION_BEGIN_INFO};
+                session_begin_info.primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+                XrFrameWaitInfo frame_wait_info{XR_TYPE_FRAME_WAIT_INFO};
+                XrFrameState frame_state{XR_TYPE_FRAME_STATE};
+                XrFrameBeginInfo frame_begin_info{XR_TYPE_FRAME_BEGIN_INFO};
+                XrFrameEndInfo frame_end_info{XR_TYPE_FRAME_END_INFO};
+                frame_end_info.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+
+                TEST_EQUAL(begin_frame(session, &frame_begin_info), XR_ERROR_VALIDATION_FAILURE, "xrBeginFrame without xrWaitFrame")
+                TEST_EQUAL(end_frame(session, &frame_end_info), XR_ERROR_VALIDATION_FAILURE, "xrEndFrame without xrBeginFrame")
+
+                // A frame that was waited on or begun does not carry over into the next xrBeginSession or xrEndSession.
+                TEST_EQUAL(wait_frame(session, &frame_wait_info, &frame_state), XR_SUCCESS, "xrWaitFrame")
+                TEST_EQUAL(begin_session(session, &session_begin_info), XR_SUCCESS, "xrBeginSession")
+                TEST_EQUAL(begin_frame(session, &frame_begin_info), XR_ERROR_VALIDATION_FAILURE,
+                           "xrBeginFrame after xrBeginSession without xrWaitFrame")
+                TEST_EQUAL(wait_frame(session, &frame_wait_info, &frame_state), XR_SUCCESS, "xrWaitFrame")
+                TEST_EQUAL(begin_frame(session, &frame_begin_info), XR_SUCCESS, "xrBeginFrame")
+                TEST_EQUAL(end_session(session), XR_SUCCESS, "xrEndSession")
+                TEST_EQUAL(end_frame(session, &frame_end_info), XR_ERROR_VALIDATION_FAILURE,
+                           "xrEndFrame after xrEndSession without xrBeginFrame")
+
+                // A whole frame in order is still valid.
+                TEST_EQUAL(wait_frame(session, &frame_wait_info, &frame_state), XR_SUCCESS, "xrWaitFrame in order")
+                TEST_EQUAL(begin_frame(session, &frame_begin_info), XR_SUCCESS, "xrBeginFrame in order")
+                TEST_EQUAL(end_frame(session, &frame_end_info), XR_SUCCESS, "xrEndFrame in order")
+
+                TEST_EQUAL(destroy_session(session), XR_SUCCESS, "Destroy session")
+            }
+            TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, "Destroy instance")
+
+            std::ifstream output_file("core_validation_frame_order.txt");
+            std::string output((std::istreambuf_iterator<char>(output_file)), std::istreambuf_iterator<char>());
+            TEST_EQUAL(CountOccurrences(output, "| CoreValidation-xrBeginFrame-XrSession_frame_waited-endstate | xrBeginFrame]"), 2,
+                       "xrBeginFrame reported out of order")
+            TEST_EQUAL(CountOccurrences(output, "| CoreValidation-xrEndFrame-XrSession_frame_begun-endstate | xrEndFrame]"), 2,
+                       "xrEndFrame reported out of order")
+            TEST_EQUAL(CountOccurrences(output, "VALID_ERROR"), 4, "Nothing else reported")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+    remove("core_validation_frame_order.txt");
+
+    // Cleanup
+    LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_EXPORT_TYPE");
+    LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_FILE_NAME");
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestCoreValidationFrameOrder)
+}
+
+// Records the ID and text of each message sent to a debug messenger.
+static XRAPI_ATTR XrBool32 XRAPI_CALL RecordDebugUtilsMessage(XrDebugUtilsMessageSeverityFlagsEXT /* messageSeverity */,
+                                                            XrDebugUtilsMessageTypeFlagsEXT /* messageTypes */,
+                                                            const XrDebugUtilsMessengerCallbackDataEXT* callbackData,
+                                                            void* userData) {
+    auto* messages = reinterpret_cast<std::vector<std::string>*>(userData);
+    messages->push_back(std::string(callbackData->messageId) + ": " + callbackData->message);
+    return XR_FALSE;
+}
+
+// Test core validation with only debug messengers taking its messages.  A message no messenger takes must not even
+// be formatted, while one a messenger does take, such as a structure of the wrong type, must say what was expected.
+DEFINE_TEST(TestCoreValidationMessageFilter) {
+    INIT_TEST(TestCoreValidationMessageFilter)
+
+    XrNegotiateApiLayerRequest layer_request = {};
+    void* layer_library = LoadCoreValidationLayer(layer_request);
+    TEST_NOT_EQUAL(layer_library, nullptr, "Loading and negotiating with the core_validation layer")
+    try {
+        if (nullptr != layer_library) {
+            // With no export type set, a messenger given at instance creation turns off the layer's own output.
+            LoaderTestUnsetEnvironmentVariable("XR_CORE_VALIDATION_EXPORT_TYPE");
+            std::vector<std::string> warning_messages;
+            XrDebugUtilsMessengerCreateInfoEXT warning_messenger_info{XR_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT};
+            warning_messenger_info.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+            warning_messenger_info.messageTypes = XR_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+            warning_messenger_info.userCallback = RecordDebugUtilsMessage;
+            warning_messenger_info.userData = &warning_messages;
+            const char* const extension_names[] = {XR_MND_HEADLESS_EXTENSION_NAME, XR_EXT_DEBUG_UTILS_EXTENSION_NAME};
+            XrInstance instance = XR_NULL_HANDLE;
+            TEST_EQUAL(CreateBuiltApiLayerInstance(layer_request, "XR_APILAYER_LUNARG_core_validation", &warning_messenger_info,
+                                                   &instance, 2, extension_names),
+                       XR_SUCCESS, "Create instance")
+            PFN_xrVoidFunction function = nullptr;
+            layer_request.getInstanceProcAddr(instance, "xrGetSystemProperties", &function);
+            auto get_system_properties = reinterpret_cast<PFN_xrGetSystemProperties>(function);
+            layer_request.getInstanceProcAddr(instance, "xrSetDebugUtilsObjectNameEXT", &function);
+            auto set_object_name = reinterpret_cast<PFN_xrSetDebugUtilsObjectNameEXT>(function);
+            layer_request.getInstanceProcAddr(instance, "xrCreateDebugUtilsMessengerEXT", &function);
+            auto create_messenger = reinterpret_cast<PFN_xrCreateDebugUtilsMessengerEXT>(function);
+            layer_request.getInstanceProcAddr(instance, "xrDestroyDebugUtilsMessengerEXT", &function);
+            auto destroy_messenger = reinterpret_cast<PFN_xrDestroyDebugUtilsMessengerEXT>(function);
+            layer_request.getInstanceProcAddr(instance, "xrDestroyInstance", &function);
+            auto destroy_instance = reinterpret_cast<PFN_xrDestroyInstance>(function);
+            if (nullptr == get_system_properties || nullptr == set_object_name || nullptr == create_messenger ||
+                nullptr == destroy_messenger || nullptr == destroy_instance) {
+                TEST_FAIL("Finding the layer's functions")
+            } else {
+                // Messengers are only called once something has been named.
+                XrDebugUtilsObjectNameInfoEXT name_info{XR_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT};
+                name_info.objectType = XR_OBJECT_TYPE_INSTANCE;
+                name_info.objectHandle = MakeHandleGeneric(instance);
+                name_info.objectName = "Filtered Instance";
+                TEST_EQUAL(set_object_name(instance, &name_info), XR_SUCCESS, "Name the instance")
+
+                // Formatting the duplicate next chain message looks up the name of the duplicated type.
+                XrSystemHandTrackingPropertiesEXT hand_tracking{XR_TYPE_SYSTEM_HAND_TRACKING_PROPERTIES_EXT};
+                XrSystemHandTrackingPropertiesEXT second_hand_tracking{XR_TYPE_SYSTEM_HAND_TRACKING_PROPERTIES_EXT};
+                XrSystemProperties properties{XR_TYPE_SYSTEM_PROPERTIES};
+                properties.next = &hand_tracking;
+                hand_tracking.next = &second_hand_tracking;
+                g_fake_next_string_instance = XR_NULL_HANDLE;
+                TEST_EQUAL(get_system_properties(instance, FakeNextSystemId(instance), &properties), XR_ERROR_VALIDATION_FAILURE,
+                           "Filtered - call fails validation")
+                TEST_EQUAL(g_fake_next_string_instance, XR_NULL_HANDLE, "Filtered - message not formatted")
+                TEST_EQUAL(warning_messages.size(), 0, "Filtered - nothing sent to the warning messenger")
+
+                std::vector<std::string> error_messages;
+                XrDebugUtilsMessengerCreateInfoEXT error_messenger_info = warning_messenger_info;
+                error_messenger_info.messageSeverities = XR_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+                error_messenger_info.userData = &error_messages;
+                XrDebugUtilsMessengerEXT error_messenger = XR_NULL_HANDLE;
+                TEST_EQUAL(create_messenger(instance, &error_messenger_info, &error_messenger), XR_SUCCESS,
+                           "Create error messenger")
+                TEST_EQUAL(get_system_properties(instance, FakeNextSystemId(instance), &properties), XR_ERROR_VALIDATION_FAILURE,
+                           "Wanted - call fails validation")
+                TEST_EQUAL(g_fake_next_string_instance, instance, "Wanted - message formatted")
+                // Each structure error is followed by one for the parameter holding the structure.
+                TEST_EQUAL(error_messages.size(), 2, "Wanted - sent to the error messenger")
+                if (!error_messages.empty()) {
+                    TEST_EQUAL(CountOccurrences(error_messages[0], "VUID-XrSystemProperties-next-unique: "), 1,
+                               "Wanted - reported as a duplicate")
+                }
+
+                error_messages.clear();
+                properties.type = XR_TYPE_SYSTEM_GET_INFO;
+                properties.next = nullptr;
+                TEST_EQUAL(get_system_properties(instance, FakeNextSystemId(instance), &properties), XR_ERROR_VALIDATION_FAILURE,
+                           "Wrong type - call fails validation")
+                TEST_EQUAL(error_messages.size(), 2, "Wrong type - sent to the error messenger")
+                if (!error_messages.empty()) {
+                    std::string expected = "VUID-XrSystemProperties-type-type: XrSystemProperties has an invalid XrStructureType " +
+                                           Uint32ToHexString(XR_TYPE_SYSTEM_GET_INFO) + ", expected " +
+                                           Uint32ToHexString(XR_TYPE_SYSTEM_PROPERTIES) + " (XR_TYPE_SYSTEM_PROPERTIES)";
+                    TEST_EQUAL(error_messages[0], expected, "Wrong type - reports the expected type")
+                }
+
+                TEST_EQUAL(destroy_messenger(error_messenger), XR_SUCCESS, "Destroy error messenger")
+                error_messages.clear();
+                properties.type = XR_TYPE_SYSTEM_PROPERTIES;
+                properties.next = &hand_tracking;
+                g_fake_next_string_instance = XR_NULL_HANDLE;
+                TEST_EQUAL(get_system_properties(instance, FakeNextSystemId(instance), &properties), XR_ERROR_VALIDATION_FAILURE,
+                           "Destroyed messenger - call fails validation")
+                TEST_EQUAL(g_fake_next_string_instance, XR_NULL_HANDLE, "Destroyed messenger - message not formatted")
+                TEST_EQUAL(error_messages.size(), 0, "Destroyed messenger - nothing sent")
+            }
+            TEST_EQUAL(destroy_instance(instance), XR_SUCCESS, "Destroy instance")
+        }
+    } catch (...) {
+        TEST_FAIL("Exception triggered during test, automatic failure")
+    }
+
+    if (nullptr != layer_library) {
+        dlclose(layer_library);
+    }
+
+    // Cleanup
+    CleanupEnvironmentVariables();
+
+    // Output results for this test
+    TEST_REPORT(TestCoreValidationMessageFilter)
+}
+#endif  // defined(XR_OS_LINUX)
+
 // Test at least one non-XrInstance function to make sure that the automatic non-instance functions work.
 DEFINE_TEST(TestCreateDestroySession) {
     INIT_TEST(TestCreateDestroySession)
@@ -2116,12 +4082,35 @@ int main(int argc, char* argv[]) {
 
     TestEnumLayers(total_tests, total_passed, total_skipped, total_failed);
     TestEnumInstanceExtensions(total_tests, total_passed, total_skipped, total_failed);
+    TestHandleInfoLock(total_tests, total_passed, total_skipped, total_failed);
+#if defined(XR_OS_LINUX)
+    TestManifestCache(total_tests, total_passed, total_skipped, total_failed);
+    TestParallelManifestDiscovery(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpMultipleInstances(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpRecreatedInstance(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpBinaryRoundTrip(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpReplay(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpFilters(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpObjectNames(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpAsyncOutput(total_tests, total_passed, total_skipped, total_failed);
+    TestApiDumpRing(total_tests, total_passed, total_skipped, total_failed);
+    TestCoreValidationNextChain(total_tests, total_passed, total_skipped, total_failed);
+    TestCoreValidationFrameLevel(total_tests, total_passed, total_skipped, total_failed);
+    TestCoreValidationFrameOrder(total_tests, total_passed, total_skipped, total_failed);
+    TestCoreValidationMessageFilter(total_tests, total_passed, total_skipped, total_failed);
+#endif  // defined(XR_OS_LINUX)
 
     if (g_has_installed_runtime) {
         cout << "Installed XR runtime detected - doing active runtime tests" << endl;
         cout << "----------------------------------------------------------" << endl;
         TestCreateDestroyInstance(total_tests, total_passed, total_skipped, total_failed);
         TestGetSystem(total_tests, total_passed, total_skipped, total_failed);
+        TestGetInstanceProcAddr(total_tests, total_passed, total_skipped, total_failed);
+#if defined(XR_OS_LINUX)
+        TestGetInstanceProcAddrCache(total_tests, total_passed, total_skipped, total_failed);
+        TestManifestRegistry(total_tests, total_passed, total_skipped, total_failed);
+        TestLazyApiLayers(total_tests, total_passed, total_skipped, total_failed);
+#endif  // defined(XR_OS_LINUX)
         TestCreateDestroySession(total_tests, total_passed, total_skipped, total_failed);
     } else {
         cout << "No installed XR runtime detected - active runtime tests skipped(!)" << endl;
@@ -0,0 +1,172 @@
+// Copyright (c) 2017-2021, The Khronos Group Inc.
+//
+// SPDX-License-Identifier: Apache-2.0
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compares the loader's manifest parser with a full jsoncpp parse over a set of generated API layer
+// manifests.  Each manifest carries the fields the loader reads plus a block of metadata that it ignores.
+
+#include "filesystem_utils.hpp"
+#include "manifest_parser.hpp"
+
+#include <json/json.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+namespace {
+
+const char* const kKeptLayerMembers[] = {"name",      "api_version",         "library_path",       "implementation_version",
+                                         "description", "instance_extensions", "disable_environment"};
+
+std::string GenerateManifest(size_t index) {
+    std::ostringstream json;
+    json << "{\n"
+         << "    \"file_format_version\": \"1.0.0\",\n"
+         << "    \"api_layer\": {\n"
+         << "        \"name\": \"XR_APILAYER_BENCHMARK_layer_" << index << "\",\n"
+         << "        \"library_path\": \"./libXrApiLayer_benchmark_" << index << ".so\",\n"
+         << "        \"api_version\": \"1.0\",\n"
+         << "        \"implementation_version\": \"" << index % 7 + 1 << "\",\n"
+         << "        \"description\": \"Generated layer \\\"" << index << "\\\" for parser benchmarking\",\n"
+         << "        \"disable_environment\": \"DISABLE_BENCHMARK_LAYER_" << index << "\",\n"
+         << "        \"instance_extensions\": [\n"
+         << "            { \"name\": \"XR_EXT_benchmark_" << index << "\", \"extension_version\": \"" << index % 3 + 1
+         << "\" }\n"
+         << "        ],\n"
+         << "        \"vendor_metadata\": {\n"
+         << "            // Ignored by the loader.\n"
+         << "            \"build\": { \"id\": " << index * 7919 << ", \"ratio\": 0.25, \"tags\": [";
+    for (size_t tag = 0; tag < 32; ++tag) {
+        json << (tag == 0 ? "" : ", ") << "\"tag_" << tag << "\"";
+    }
+    json << "] },\n"
+         << "            \"history\": [";
+    for (size_t entry = 0; entry < 24; ++entry) {
+        json << (entry == 0 ? "" : ", ") << "{ \"version\": " << entry << ", \"notes\": \"Release notes for entry " << entry
+             << " with \\u00e9scaped text\", \"stable\": " << (entry % 2 == 0 ? "true" : "false") << " }";
+    }
+    json << "]\n"
+         << "        }\n"
+         << "    }\n"
+         << "}\n";
+    return json.str();
+}
+
+bool ReadFile(const std::string& filename, std::string& contents) {
+    std::ifstream stream(filename, std::ifstream::in | std::ifstream::binary);
+    if (!stream.is_open()) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << stream.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+void ReportResult(const std::string& name, double total_ms, size_t file_count) {
+    cout << "    " << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(2) << std::setw(10)
+         << total_ms << " ms" << std::setw(10) << total_ms * 1000.0 / static_cast<double>(file_count) << " us/file" << endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t file_count = 2000;
+    if (argc > 1) {
+        file_count = static_cast<size_t>(std::strtoull(argv[1], nullptr, 10));
+        if (file_count == 0) {
+            cout << "Usage: " << argv[0] << " [manifest count]" << endl;
+            return -1;
+        }
+    }
+
+    std::string current_path;
+    if (!FileSysUtilsGetCurrentPath(current_path)) {
+        cout << "Unable to determine the current directory" << endl;
+        return -1;
+    }
+
+    std::vector<std::string> filenames;
+    for (size_t i = 0; i < file_count; ++i) {
+        std::string filename;
+        FileSysUtilsCombinePaths(current_path, "manifest_parser_benchmark_" + std::to_string(i) + ".json", filename);
+        std::ofstream(filename, std::ofstream::out | std::ofstream::trunc) << GenerateManifest(i);
+        filenames.push_back(filename);
+    }
+
+    // Warm the page cache so that both parsers see the same I/O cost.
+    for (const auto& filename : filenames) {
+        std::string contents;
+        ReadFile(filename, contents);
+    }
+
+    std::vector<Json::Value> jsoncpp_roots(file_count);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < file_count; ++i) {
+        std::ifstream json_stream(filenames[i], std::ifstream::in);
+        Json::CharReaderBuilder builder;
+        std::string errors;
+        Json::parseFromStream(builder, json_stream, &jsoncpp_roots[i], &errors);
+    }
+    auto jsoncpp_end = std::chrono::steady_clock::now();
+
+    std::vector<Json::Value> manifest_roots(file_count);
+    for (size_t i = 0; i < file_count; ++i) {
+        ManifestFileMapping mapping;
+        std::string errors;
+        if (mapping.Open(filenames[i])) {
+            ParseManifestJson(mapping.Data(), mapping.Size(), manifest_roots[i], errors);
+        }
+    }
+    auto manifest_end = std::chrono::steady_clock::now();
+
+    // The loader only looks at these members, so they must match exactly.
+    size_t mismatches = 0;
+    for (size_t i = 0; i < file_count; ++i) {
+        const Json::Value& expected = jsoncpp_roots[i];
+        const Json::Value& actual = manifest_roots[i];
+        bool match = expected["file_format_version"] == actual["file_format_version"];
+        for (const char* member : kKeptLayerMembers) {
+            match = match && expected["api_layer"][member] == actual["api_layer"][member];
+        }
+        if (!match) {
+            cout << "Parsed contents of " << filenames[i] << " differ" << endl;
+            ++mismatches;
+        }
+    }
+
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+    cout << "Manifest parsing (" << file_count << " files):" << endl;
+    ReportResult("jsoncpp parseFromStream", std::chrono::duration_cast<Milliseconds>(jsoncpp_end - start).count(), file_count);
+    ReportResult("ParseManifestJson", std::chrono::duration_cast<Milliseconds>(manifest_end - jsoncpp_end).count(),
+                 file_count);
+
+    for (const auto& filename : filenames) {
+        std::remove(filename.c_str());
+    }
+    return mismatches == 0 ? 0 : -1;
+}
@@ -39,6 +39,11 @@
 extern "C" {
 std::map<XrInstance, PFN_xrGetInstanceProcAddr> g_next_gipa_map;
 
+// Number of calls to this layer's xrGetInstanceProcAddr, so that tests can tell which lookups reach the layer.
+uint32_t g_get_instance_proc_addr_calls = 0;
+
+LAYER_EXPORT uint32_t TestLayerGetInstanceProcAddrCallCount() { return g_get_instance_proc_addr_calls; }
+
 XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrCreateInstance(const XrInstanceCreateInfo * /* info */, XrInstance * /* instance */) {
     // In a layer, LayerTestXrCreateApiLayerInstance is called instead of this function. This should not be called.
     return XR_ERROR_FUNCTION_UNSUPPORTED;
@@ -60,6 +65,7 @@ XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrDestroyInstance(XrInstance instance) {
 }
 
 XRAPI_ATTR XrResult XRAPI_CALL LayerTestXrGetInstanceProcAddr(XrInstance instance, const char *name, PFN_xrVoidFunction *function) {
+    ++g_get_instance_proc_addr_calls;
     if (0 == strcmp(name, "xrGetInstanceProcAddr")) {
         *function = reinterpret_cast<PFN_xrVoidFunction>(LayerTestXrGetInstanceProcAddr);
     } else if (0 == strcmp(name, "xrCreateInstance")) {